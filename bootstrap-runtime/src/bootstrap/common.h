@@ -55,28 +55,13 @@ static void spit(ava_string outfile, const ava_pcode_global_list* pcode) {
 }
 
 static ava_string slurp_file(ava_string infile) {
-  ava_string accum;
-  char buff[4096];
-  size_t nread;
-  FILE* in;
+  ava_string content;
 
-  in = fopen(ava_string_to_cstring(infile), "r");
-  if (!in)
-    err(EX_NOINPUT, "Failed to open %s for reading",
-        ava_string_to_cstring(infile));
+  content = ava_string_of_mmap(ava_string_to_cstring(infile));
+  if (!ava_string_is_present(content))
+    err(EX_NOINPUT, "Failed to read %s", ava_string_to_cstring(infile));
 
-  accum = AVA_EMPTY_STRING;
-  do {
-    nread = fread(buff, 1, sizeof(buff), in);
-    accum = ava_strcat(accum, ava_string_of_bytes(buff, nread));
-  } while (!feof(in) && !ferror(in));
-
-  if (ferror(in))
-    err(EX_IOERR, "Error reading %s", ava_string_to_cstring(infile));
-
-  fclose(in);
-
-  return accum;
+  return content;
 }
 
 static ava_pcode_global_list* slurp(ava_string infile) {
@@ -0,0 +1,71 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__BTREE_MAP_H_
+#define AVA_RUNTIME__BTREE_MAP_H_
+
+#include "avalanche/defs.h"
+#include "avalanche/list.h"
+#include "avalanche/map.h"
+
+/**
+ * @file
+ *
+ * Provides the B+-tree map, the implementation behind ordered maps.
+ *
+ * A B+-tree map, like a list-map, implements the map trait atop an underlying
+ * ava_list_value holding the pairs in map order. Alongside it is a persistent
+ * B+-tree holding one entry per pair, ordered by key and then by position in
+ * the map; cursors are pair indices into the underlying list.
+ *
+ * The details of the tree are described in btree-map.c.
+ */
+
+/**
+ * The maximum number of entries in one node of the tree.
+ */
+#define AVA_BTREE_MAP_ORDER 8
+
+/**
+ * Constructs a new B+-tree map atop the given list.
+ *
+ * The list MUST have an even number of elements. The list is copied into a
+ * fresh list as the tree is built, so it may be of any list type, including
+ * another map.
+ */
+ava_map_value ava_btree_map_of_list(ava_list_value list);
+
+/**
+ * This is for testing.
+ *
+ * Returns the height of the tree in the given B+-tree map; 0 if the tree is
+ * a single leaf.
+ */
+unsigned ava_btree_map_height(ava_map_value map);
+
+/**
+ * This is for testing.
+ *
+ * Checks every structural invariant of the tree in the given B+-tree map:
+ * that entries are in order, that every leaf is at the same depth, that no
+ * node is empty or overfull, that the separators and subtree sizes on
+ * internal nodes are accurate, and that the entries match the pairs of the
+ * underlying list.
+ *
+ * @return Whether all invariants hold.
+ */
+ava_bool ava_btree_map_check(ava_map_value map);
+
+#endif /* AVA_RUNTIME__BTREE_MAP_H_ */
@@ -27,9 +27,18 @@
  * example, if every value is a string, each element will be only 8 bytes wide
  * instead of 24.
  *
+ * Lists of integers which all fit in 32 bits are bit-packed instead, using 32,
+ * 16, 8 (for signed or unsigned bytes) or (for lists of only zeroes and ones)
+ * a single bit per element. Such lists are widened to a larger format as
+ * needed when a value that does not fit is added.
+ *
  * ESBA lists can*not* be empty. All operations on an ESBA list that produce
  * new lists also return an ESBA list, except for slice() and operations which
  * result in an empty list.
+ *
+ * The exception to the above is that set(), append() and concat() return an
+ * RRB list instead once the list has been seen to be kept alive in many
+ * versions which are modified independently (see -rrb-list.h).
  */
 
 /**
@@ -64,12 +73,23 @@ ava_list_value ava_esba_list_of_raw(const ava_value*restrict array,
 ava_list_value ava_esba_list_of_raw_strided(
   const ava_value*restrict array, size_t count, size_t stride);
 
+/**
+ * If the given list is an ESBA list whose elements all have the same
+ * attribute, returns that attribute. Otherwise, returns NULL.
+ *
+ * This only inspects the format of the list, so it takes constant time; but
+ * it may return NULL for a list whose elements happen to share an attribute
+ * after all, for example if the element that differed has since been
+ * replaced with set().
+ */
+const void* ava_esba_list_common_attr(ava_list_value list);
+
 /**
  * This is only for testing.
  *
- * Returns the size of elements being used by the given list, which is assumed
- * to be an ESBA list.
+ * Returns the number of bits of storage used by each element of the given
+ * list, which is assumed to be an ESBA list.
  */
-size_t ava_esba_list_element_size(ava_value list);
+size_t ava_esba_list_element_bits(ava_value list);
 
 #endif /* AVA_RUNTIME__ESBA_LIST_H_ */
@@ -225,6 +225,77 @@ void ava_esba_finish_append(ava_esba esba, size_t num_elements);
  */
 ava_esba ava_esba_set(ava_esba esba, size_t index, const void*restrict data);
 
+/**
+ * Returns the number of times that stale handles have had to copy the array
+ * backing the given ESBA out to a fresh array, including copy-outs of the
+ * arrays from which that array was itself copied.
+ *
+ * A large value indicates that many versions of the array are being kept alive
+ * and read or modified independently, a pattern for which ESBAs perform
+ * poorly. The value is only approximate, since concurrent increments may be
+ * lost.
+ */
+size_t ava_esba_stale_copy_outs(ava_esba esba);
+
+/**
+ * Process-wide counters of contention between users of ESBAs.
+ *
+ * These are only maintained if the runtime was configured with
+ * --enable-esba-stats (which defines AVA_ESBA_STATS), since maintaining them
+ * puts a shared cache line on every path that contends. They are intended for
+ * benchmarks that want to explain their timings, not for use in production.
+ *
+ * @see ava_esba_get_stats()
+ */
+typedef struct {
+  /**
+   * The number of times a writer found room for its write, but failed to take
+   * ownership of the array, either because a concurrent writer took it first
+   * or because the writer's reference was stale or truncating.
+   */
+  size_t cas_failures;
+  /**
+   * The number of times an array was copied out to a fresh one for any
+   * reason, including running out of space.
+   */
+  size_t copy_outs;
+  /**
+   * The number of copy-outs made on behalf of stale handles, ie, those which
+   * had to replay the rollback log.
+   */
+  size_t stale_copy_outs;
+  /**
+   * The number of times a reader freshened a stale handle, but found another
+   * reader had already installed a fresh array, and so discarded its own.
+   */
+  size_t lost_freshen_races;
+  /**
+   * The total number of rollback log entries replayed by stale copy-outs.
+   */
+  size_t replayed_entries;
+  /**
+   * The largest number of rollback log entries replayed by any single
+   * copy-out.
+   */
+  size_t longest_replay;
+} ava_esba_stats;
+
+/**
+ * Reads the current values of the process-wide ESBA counters into dst.
+ *
+ * The counters are read individually, so if other threads are using ESBAs
+ * concurrently the result is not a consistent snapshot.
+ *
+ * @return Whether the counters are maintained at all. If false, dst is
+ * zeroed.
+ */
+ava_bool ava_esba_get_stats(ava_esba_stats* dst);
+
+/**
+ * Resets all process-wide ESBA counters to zero.
+ */
+void ava_esba_reset_stats(void);
+
 /**
  * Returns the number of elements in the given ESBA.
  */
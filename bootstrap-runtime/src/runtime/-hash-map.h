@@ -16,6 +16,7 @@
 #ifndef AVA_RUNTIME__HASH_MAP_H_
 #define AVA_RUNTIME__HASH_MAP_H_
 
+#include "avalanche/value.h"
 #include "avalanche/map.h"
 
 /**
@@ -37,6 +38,9 @@
  * This behaves exactly like ava_map_of_values(), except that count may not be
  * zero, and it always produces a hash-map.
  *
+ * The map uses the default hash strategy (see
+ * ava_value_hash_set_default_strategy()).
+ *
  * @see ava_map_of_values()
  */
 ava_map_value ava_hash_map_of_raw(const ava_value*restrict keys,
@@ -46,10 +50,34 @@ ava_map_value ava_hash_map_of_raw(const ava_value*restrict keys,
                                   size_t count);
 
 /**
- * Constructs a new hash-map from the given non-empty list of even length.
+ * Like ava_hash_map_of_raw(), but with an explicit hash strategy.
+ *
+ * The strategy determines the hash function used for keys that are not all
+ * small ASCII strings. Maps derived from the result keep the same strategy,
+ * though a map using ava_vhs_fast switches to ava_vhs_siphash for good if it
+ * experiences excessive collisions.
+ */
+ava_map_value ava_hash_map_of_raw_with_strategy(
+  const ava_value*restrict keys,
+  size_t key_stride,
+  const ava_value*restrict values,
+  size_t value_stride,
+  size_t count,
+  ava_value_hash_strategy strategy);
+
+/**
+ * Constructs a new hash-map from the given non-empty list of even length,
+ * using the default hash strategy.
  */
 ava_map_value ava_hash_map_of_list(ava_list_value list) AVA_PURE;
 
+/**
+ * Like ava_hash_map_of_list(), but with an explicit hash strategy, as per
+ * ava_hash_map_of_raw_with_strategy().
+ */
+ava_map_value ava_hash_map_of_list_with_strategy(
+  ava_list_value list, ava_value_hash_strategy strategy) AVA_PURE;
+
 /**
  * Returns the name of the hash function being used by the given hash-map.
  *
@@ -65,24 +93,30 @@ ava_map_value ava_hash_map_of_raw_ava_ushort(
   size_t key_stride,
   const ava_value*restrict values,
   size_t value_stride,
-  size_t count);
-ava_map_value ava_hash_map_of_list_ava_ushort(ava_list_value list) AVA_PURE;
+  size_t count,
+  ava_value_hash_strategy strategy);
+ava_map_value ava_hash_map_of_list_ava_ushort(
+  ava_list_value list, ava_value_hash_strategy strategy) AVA_PURE;
 const char* ava_hash_map_get_hash_function_ava_ushort(ava_map_value map);
 ava_map_value ava_hash_map_of_raw_ava_uint(
   const ava_value*restrict keys,
   size_t key_stride,
   const ava_value*restrict values,
   size_t value_stride,
-  size_t count);
-ava_map_value ava_hash_map_of_list_ava_uint(ava_list_value list) AVA_PURE;
+  size_t count,
+  ava_value_hash_strategy strategy);
+ava_map_value ava_hash_map_of_list_ava_uint(
+  ava_list_value list, ava_value_hash_strategy strategy) AVA_PURE;
 const char* ava_hash_map_get_hash_function_ava_uint(ava_map_value map);
 ava_map_value ava_hash_map_of_raw_ava_ulong(
   const ava_value*restrict keys,
   size_t key_stride,
   const ava_value*restrict values,
   size_t value_stride,
-  size_t count);
-ava_map_value ava_hash_map_of_list_ava_ulong(ava_list_value list) AVA_PURE;
+  size_t count,
+  ava_value_hash_strategy strategy);
+ava_map_value ava_hash_map_of_list_ava_ulong(
+  ava_list_value list, ava_value_hash_strategy strategy) AVA_PURE;
 const char* ava_hash_map_get_hash_function_ava_ulong(ava_map_value map);
 
 #endif /* AVA_RUNTIME__HASH_MAP_H_ */
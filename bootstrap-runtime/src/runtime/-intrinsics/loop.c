@@ -57,7 +57,7 @@ typedef struct {
       ava_ast_node* rvalue;
 
       /* Code generation */
-      ava_pcode_register reg_list, reg_index, reg_length;
+      ava_pcode_register reg_list, reg_index, reg_length, reg_cursor;
     } each;
 
     struct {
@@ -103,8 +103,13 @@ typedef struct {
   ava_intr_loop_clause clauses[];
 } ava_intr_loop;
 
+/* `break -` jumps to the break-keep label rather than the break label, since
+ * the accumulator must hold everything collected so far when it exits, and
+ * collect clauses keep that in a list builder until the loop completes.
+ */
 static const ava_codegen_symlabel_name
   ava_intr_loop_break_label = { "loop-break" },
+  ava_intr_loop_break_keep_label = { "loop-break-keep" },
   ava_intr_loop_continue_label = { "loop-continue" };
 
 static const ava_codegen_symreg_name
@@ -523,12 +528,17 @@ static void ava_intr_loop_cg_evaluate(
   ava_codegen_context* context
 ) {
   size_t clause, i;
-  ava_pcode_register accum, iterval;
-  ava_uint iterate_label, completion_label, exit_label;
-  ava_codegen_symlabel suppress_break, suppress_continue;
-  ava_codegen_symlabel provide_break, provide_continue;
+  ava_pcode_register accum, iterval, builder, ltmp;
+  ava_bool collects;
+  ava_uint iterate_label, completion_label, exit_label, break_keep_label;
+  ava_codegen_symlabel suppress_break, suppress_break_keep, suppress_continue;
+  ava_codegen_symlabel provide_break, provide_break_keep, provide_continue;
   ava_codegen_symreg provide_iterval, provide_accum;
 
+  collects = ava_false;
+  for (clause = 0; clause < loop->num_clauses; ++clause)
+    collects |= ava_ilct_collect == loop->clauses[clause].type;
+
   accum.type = ava_prt_data;
   accum.index = ava_codegen_push_reg(context, ava_prt_data, 2);
   iterval.type = ava_prt_data;
@@ -537,8 +547,25 @@ static void ava_intr_loop_cg_evaluate(
   completion_label = ava_codegen_genlabel(context);
   exit_label = ava_codegen_genlabel(context);
 
+  /* Collect clauses append to a list builder instead of the accumulator, so
+   * that values are appended to the list in batches rather than with one
+   * lappend each. The builder is copied into the accumulator on completion
+   * and by `break -`; if the loop throws, the accumulator is never read, so
+   * the builder is simply dropped.
+   */
+  if (collects) {
+    builder.type = ava_prt_data;
+    builder.index = ava_codegen_push_reg(context, ava_prt_data, 1);
+    break_keep_label = ava_codegen_genlabel(context);
+  } else {
+    break_keep_label = exit_label;
+  }
+
   ava_codegen_push_symlabel(&suppress_break, context,
                             &ava_intr_loop_break_label, AVA_LABEL_SUPPRESS);
+  ava_codegen_push_symlabel(&suppress_break_keep, context,
+                            &ava_intr_loop_break_keep_label,
+                            AVA_LABEL_SUPPRESS);
   ava_codegen_push_symlabel(&suppress_continue, context,
                             &ava_intr_loop_continue_label, AVA_LABEL_SUPPRESS);
   ava_codegen_push_symreg(&provide_iterval, context,
@@ -560,6 +587,9 @@ static void ava_intr_loop_cg_evaluate(
       loop->clauses[clause].v.each.reg_length.type = ava_prt_int;
       loop->clauses[clause].v.each.reg_length.index =
         loop->clauses[clause].v.each.reg_index.index + 1;
+      loop->clauses[clause].v.each.reg_cursor.type = ava_prt_data;
+      loop->clauses[clause].v.each.reg_cursor.index =
+        ava_codegen_push_reg(context, ava_prt_data, 1);
       break;
 
     case ava_ilct_for:
@@ -572,6 +602,8 @@ static void ava_intr_loop_cg_evaluate(
 
   /* Initialisation phase */
   AVA_PCXB(ld_imm_vd, accum, AVA_EMPTY_STRING);
+  if (collects)
+    AVA_PCXB(lbuild, builder);
   for (clause = 0; clause < loop->num_clauses; ++clause) {
     ava_codegen_set_location(context, loop->clauses[clause].location);
     switch (loop->clauses[clause].type) {
@@ -586,6 +618,8 @@ static void ava_intr_loop_cg_evaluate(
       AVA_PCXB(llength, loop->clauses[clause].v.each.reg_length,
                loop->clauses[clause].v.each.reg_list);
       AVA_PCXB(ld_imm_i, loop->clauses[clause].v.each.reg_index, 0);
+      AVA_PCXB(lcursor, loop->clauses[clause].v.each.reg_cursor,
+               loop->clauses[clause].v.each.reg_list);
       ava_codegen_pop_reg(context, ava_prt_data, 1);
     } break;
 
@@ -632,9 +666,8 @@ static void ava_intr_loop_cg_evaluate(
           loop->clauses[clause].v.each.lvalues[i], context);
 
         ava_codegen_set_location(context, loop->clauses[clause].location);
-        AVA_PCXB(lindex, loop->each_data_reg,
-                 loop->clauses[clause].v.each.reg_list,
-                 loop->clauses[clause].v.each.reg_index,
+        AVA_PCXB(lcnext, loop->each_data_reg,
+                 loop->clauses[clause].v.each.reg_cursor,
                  exception_type,
                  ava_error_bad_list_multiplicity());
         AVA_PCXB(iadd_imm, loop->clauses[clause].v.each.reg_index,
@@ -689,6 +722,9 @@ static void ava_intr_loop_cg_evaluate(
     case ava_ilct_do: {
       ava_codegen_push_symlabel(&provide_break, context,
                                 &ava_intr_loop_break_label, exit_label);
+      ava_codegen_push_symlabel(&provide_break_keep, context,
+                                &ava_intr_loop_break_keep_label,
+                                break_keep_label);
       ava_codegen_push_symlabel(&provide_continue, context,
                                 &ava_intr_loop_continue_label,
                                 loop->clauses[clause].update_start_label);
@@ -702,6 +738,7 @@ static void ava_intr_loop_cg_evaluate(
 
       ava_codegen_pop_symlabel(context);
       ava_codegen_pop_symlabel(context);
+      ava_codegen_pop_symlabel(context);
     } break;
 
     case ava_ilct_collect:
@@ -726,42 +763,53 @@ static void ava_intr_loop_cg_evaluate(
       break;
 
     case ava_ilct_collect: {
-      ava_pcode_register ltmp, etmp;
+      ava_pcode_register etmp;
 
-      ltmp.type = ava_prt_list;
-      ltmp.index = ava_codegen_push_reg(context, ava_prt_list, 1);
-
-      AVA_PCXB(ld_reg_d, ltmp, accum);
       if (loop->clauses[clause].v.collect.expression) {
         if (loop->clauses[clause].v.collect.expression->v->cg_spread) {
           etmp.type = ava_prt_list;
           etmp.index = ava_codegen_push_reg(context, ava_prt_list, 1);
           ava_ast_node_cg_spread(
             loop->clauses[clause].v.collect.expression, &etmp, context);
-          AVA_PCXB(lcat, ltmp, ltmp, etmp);
+          AVA_PCXB(lbcat, builder, etmp);
           ava_codegen_pop_reg(context, ava_prt_list, 1);
         } else {
           etmp.type = ava_prt_data;
           etmp.index = ava_codegen_push_reg(context, ava_prt_data, 1);
           ava_ast_node_cg_evaluate(
             loop->clauses[clause].v.collect.expression, &etmp, context);
-          AVA_PCXB(lappend, ltmp, ltmp, etmp);
+          AVA_PCXB(lbappend, builder, etmp);
           ava_codegen_pop_reg(context, ava_prt_data, 1);
         }
       } else {
-        AVA_PCXB(lappend, ltmp, ltmp, iterval);
+        AVA_PCXB(lbappend, builder, iterval);
       }
-
-      AVA_PCXB(ld_reg_u, accum, ltmp);
-
-      ava_codegen_pop_reg(context, ava_prt_list, 1);
     } break;
     }
   }
   ava_codegen_goto(context, &loop->header.location, iterate_label);
 
-  /* Completion phase */
-  AVA_PCXB(label, completion_label);
+  if (collects) {
+    ltmp.type = ava_prt_list;
+    ltmp.index = ava_codegen_push_reg(context, ava_prt_list, 1);
+
+    /* Exit via `break -` */
+    AVA_PCXB(label, break_keep_label);
+    AVA_PCXB(lblist, ltmp, builder);
+    AVA_PCXB(ld_reg_u, accum, ltmp);
+    ava_codegen_goto(context, &loop->header.location, exit_label);
+
+    /* Completion phase */
+    AVA_PCXB(label, completion_label);
+    AVA_PCXB(lblist, ltmp, builder);
+    AVA_PCXB(ld_reg_u, accum, ltmp);
+
+    ava_codegen_pop_reg(context, ava_prt_list, 1);
+  } else {
+    /* Completion phase */
+    AVA_PCXB(label, completion_label);
+  }
+
   if (loop->else_clause) {
     if (loop->else_is_expression)
       ava_ast_node_cg_evaluate(loop->else_clause, &accum, context);
@@ -773,11 +821,13 @@ static void ava_intr_loop_cg_evaluate(
   ava_codegen_pop_symreg(context);
   ava_codegen_pop_symlabel(context);
   ava_codegen_pop_symlabel(context);
+  ava_codegen_pop_symlabel(context);
 
   /* Deallocate registers */
   for (clause = loop->num_clauses - 1; clause < loop->num_clauses; --clause) {
     switch (loop->clauses[clause].type) {
     case ava_ilct_each:
+      ava_codegen_pop_reg(context, ava_prt_data, 1);
       ava_codegen_pop_reg(context, ava_prt_int, 2);
       ava_codegen_pop_reg(context, ava_prt_list, 1);
       break;
@@ -795,6 +845,8 @@ static void ava_intr_loop_cg_evaluate(
   if (dst)
     AVA_PCXB(ld_reg_s, *dst, accum);
 
+  if (collects)
+    ava_codegen_pop_reg(context, ava_prt_data, 1);
   ava_codegen_pop_reg(context, ava_prt_data, 2);
 }
 
@@ -953,8 +1005,9 @@ static void ava_intr_loopctl_cg_discard(
 
   jump_target = ava_codegen_get_symlabel(
     context,
-    this->is_break? &ava_intr_loop_break_label :
-                    &ava_intr_loop_continue_label);
+    !this->is_break? &ava_intr_loop_continue_label :
+    this->suppress_write_back? &ava_intr_loop_break_keep_label :
+                               &ava_intr_loop_break_label);
   if (AVA_LABEL_NONE == jump_target) {
     ava_codegen_error(
       context, (ava_ast_node*)this,
@@ -28,6 +28,11 @@
  * larger lists. List-maps should not be created with more than
  * AVA_LIST_MAP_THRESH elements, and they automatically promote themselves to
  * other map implementations when they exceed this limit.
+ *
+ * A list-map built directly over a larger list instead promotes itself once it
+ * has been searched often enough: it builds a hash-map holding the same pairs,
+ * which then answers all further lookups on that value and produces every map
+ * derived from it.
  */
 
 /**
@@ -36,11 +41,38 @@
  */
 #define AVA_LIST_MAP_THRESH 4
 
+/**
+ * The number of pairs a list-map must exceed before it considers building a
+ * hash index.
+ *
+ * Note that AVA_LIST_MAP_THRESH counts list elements, but ava_map_of_values()
+ * builds list-maps of up to that many pairs, so this is kept well clear of
+ * both.
+ */
+#define AVA_LIST_MAP_PROMOTE_MIN_PAIRS (4*AVA_LIST_MAP_THRESH)
+
+/**
+ * A list-map with more than AVA_LIST_MAP_PROMOTE_MIN_PAIRS pairs builds a hash
+ * index once the number of pairs examined by its searches since the last index
+ * was built reaches this multiple of its pair count.
+ */
+#define AVA_LIST_MAP_PROMOTE_FACTOR 4
+
+/**
+ * Returns whether the given list-map has built a hash index for its current
+ * value.
+ *
+ * This is only useful for tests.
+ */
+ava_bool ava_list_map_is_promoted(ava_map_value map);
+
 /**
  * Constructs a new list-map atop the given list.
  *
  * The list MUST have an even number of elements, and SHOULD be less than or
- * equal to 2*AVA_LIST_MAP_THRESH in length.
+ * equal to 2*AVA_LIST_MAP_THRESH in length. Lists of more than
+ * AVA_LIST_MAP_PROMOTE_MIN_PAIRS pairs build a hash index after enough
+ * lookups, as described above.
  */
 ava_map_value ava_list_map_of_list(ava_list_value list) AVA_PURE;
 
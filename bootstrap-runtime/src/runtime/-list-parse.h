@@ -0,0 +1,58 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__LIST_PARSE_H_
+#define AVA_RUNTIME__LIST_PARSE_H_
+
+#include "avalanche/defs.h"
+#include "avalanche/string.h"
+#include "avalanche/list.h"
+
+/**
+ * @file
+ *
+ * Internals of how strings are parsed into lists.
+ *
+ * Strings of at least AVA_LIST_PARALLEL_PARSE_THRESH bytes are split into
+ * parts of roughly AVA_LIST_PARALLEL_PARSE_PART bytes, which are parsed
+ * concurrently on the worker pool and then joined together. The result, and
+ * any error thrown, is identical to parsing the string serially.
+ */
+
+/**
+ * Strings at least this long are parsed in parallel, if there is more than
+ * one CPU to parse them with.
+ */
+#define AVA_LIST_PARALLEL_PARSE_THRESH (4 * 1024 * 1024)
+/**
+ * The approximate size, in bytes, of each part of a string parsed in
+ * parallel.
+ */
+#define AVA_LIST_PARALLEL_PARSE_PART (256 * 1024)
+
+/**
+ * This is for testing.
+ *
+ * Parses the given string as a list the way ava_list_value_of() parses very
+ * long strings, but splitting it into parts of roughly part_length bytes
+ * regardless of its actual length.
+ *
+ * @throws ava_format_exception if str is not a valid list, exactly as
+ * ava_list_value_of() would.
+ */
+ava_list_value ava_list_value_of_string_in_parts(ava_string str,
+                                                 size_t part_length);
+
+#endif /* AVA_RUNTIME__LIST_PARSE_H_ */
@@ -0,0 +1,64 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__LIST_SORT_H_
+#define AVA_RUNTIME__LIST_SORT_H_
+
+#include "avalanche/defs.h"
+#include "avalanche/list.h"
+#include "avalanche/list-sort.h"
+
+/**
+ * @file
+ *
+ * Internals of how lists are sorted.
+ *
+ * Lists of at least AVA_LIST_SORT_PARALLEL_THRESH elements, whether sorted by
+ * a built-in order or a comparator, are split into one piece per thread in
+ * the worker pool. Each piece is sorted independently, then the sorted pieces
+ * are merged pairwise. Every merge is itself split into enough segments to
+ * keep every thread busy, by binary-searching for where each segment's output
+ * begins in the two inputs, so the final merges are as parallel as the first.
+ */
+
+/**
+ * Lists at least this long are sorted in parallel, if there is more than one
+ * CPU to sort them with.
+ */
+#define AVA_LIST_SORT_PARALLEL_THRESH (64 * 1024)
+
+/**
+ * This is for testing.
+ *
+ * Sorts the given list as per ava_list_sort(), but splitting the work into
+ * the given number of pieces regardless of the length of the list or the
+ * number of CPUs available.
+ */
+ava_list_value ava_list_sort_in_pieces(ava_list_value list,
+                                       ava_list_sort_order order,
+                                       size_t pieces);
+
+/**
+ * This is for testing.
+ *
+ * Sorts the given list as per ava_list_sort_by(), but splitting the work into
+ * the given number of pieces regardless of the length of the list or the
+ * number of CPUs available.
+ */
+ava_list_value ava_list_sort_by_in_pieces(ava_list_value list,
+                                          const ava_function* comparator,
+                                          size_t pieces);
+
+#endif /* AVA_RUNTIME__LIST_SORT_H_ */
@@ -0,0 +1,70 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__LIST_STRING_CACHE_H_
+#define AVA_RUNTIME__LIST_STRING_CACHE_H_
+
+#include <atomic_ops.h>
+
+#include "avalanche/defs.h"
+#include "avalanche/string.h"
+#include "avalanche/value.h"
+
+/**
+ * @file
+ *
+ * Caching of the normal-form string of lists whose backing storage is shared
+ * between many versions of the list.
+ *
+ * The same large list is often stringified over and over, for example when it
+ * is passed repeatedly to functions which take strings. A list implementation
+ * can embed an ava_list_string_cache in its backing storage to remember the
+ * string produced for the most recently stringified version.
+ *
+ * Entries are keyed by a version pointer chosen by the implementation plus the
+ * list's length, and the implementation must guarantee that no two distinct
+ * lists sharing the same storage have the same version pointer and length.
+ * Mutating a list always yields a new version or length, so stale entries are
+ * never returned; they are simply replaced on the next miss.
+ */
+
+/**
+ * Lists shorter than this are never cached, since escaping them is cheaper
+ * than the cache entry.
+ */
+#define AVA_LIST_STRING_CACHE_MIN_LENGTH 4
+
+/**
+ * A single-entry cache of the string form of one version of a list.
+ *
+ * A zero-initialised cache is empty.
+ */
+typedef struct {
+  AO_t /* const ava_list_string_cache_entry* */ entry;
+} ava_list_string_cache;
+
+/**
+ * Returns the normal-form string of the given list, as per
+ * ava_list_to_string(), using and updating the given cache.
+ *
+ * @param cache The cache in the storage backing list.
+ * @param version The implementation-defined version pointer of list.
+ * @param list The list to stringify.
+ */
+ava_string ava_list_to_string_cached(ava_list_string_cache* cache,
+                                     const void* version,
+                                     ava_value list);
+
+#endif /* AVA_RUNTIME__LIST_STRING_CACHE_H_ */
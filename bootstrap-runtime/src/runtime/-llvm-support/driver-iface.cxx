@@ -67,6 +67,12 @@ ava::driver_iface::driver_iface(const llvm::Module& module) noexcept {
   ISA(x_lflatten);
   ISA(x_lindex);
   ISA(x_llength);
+  ISA(x_lbuild);
+  ISA(x_lbappend);
+  ISA(x_lbcat);
+  ISA(x_lblist);
+  ISA(x_lcursor);
+  ISA(x_lcnext);
   ISA(x_iadd);
   ISA(x_icmp);
   ISA(x_pre_invoke_s);
@@ -382,6 +382,57 @@ namespace ava {
      * Returns the length of *list
      */
     F x_llength;
+    /**
+     * Implements the lbuild P-Code exe.
+     *
+     * Signature: void* (void)
+     *
+     * Returns a pointer to a new, empty ava_list_builder.
+     */
+    F x_lbuild;
+    /**
+     * Implements the lbappend P-Code exe.
+     *
+     * Signature: void (void* builder, ava_value val)
+     *
+     * Appends val to the ava_list_builder builder.
+     */
+    F x_lbappend;
+    /**
+     * Implements the lbcat P-Code exe.
+     *
+     * Signature: void (void* builder, const ava_fat_list_value* src)
+     *
+     * Appends every element of *src to the ava_list_builder builder.
+     */
+    F x_lbcat;
+    /**
+     * Implements the lblist P-Code exe.
+     *
+     * Signature: void (ava_fat_list_value* dst, void* builder)
+     *
+     * Stores the list accumulated by the ava_list_builder builder in *dst.
+     */
+    F x_lblist;
+    /**
+     * Implements the lcursor P-Code exe.
+     *
+     * Signature: void* (const ava_fat_list_value* src)
+     *
+     * Returns a pointer to a new ava_list_cursor over *src.
+     */
+    F x_lcursor;
+    /**
+     * Implements the lcnext P-Code exe.
+     *
+     * Signature: ava_value (void* cursor,
+     *                       ava_string extype, ava_string exmessage)
+     *
+     * The next value read by the ava_list_cursor cursor is returned, barring
+     * exceptional cases. If the cursor is exhausted, throw an
+     * ava_error_exception with type extype and message exmessage.
+     */
+    F x_lcnext;
     /**
      * Sums two integers.
      *
@@ -209,7 +209,8 @@ ava_value ava_isa_x_conv_vl$(const ava_fat_list_value* l) {
 }
 
 void ava_isa_x_conv_lv$(ava_fat_list_value* dst, ava_value src) {
-  *dst = ava_fat_list_value_of(src);
+  static ava_attribute_cache cache;
+  *dst = ava_fat_list_value_of_cached(src, &cache);
 }
 
 void ava_isa_x_lempty$(ava_fat_list_value* dst) {
@@ -219,15 +220,17 @@ void ava_isa_x_lempty$(ava_fat_list_value* dst) {
 void ava_isa_x_lappend$(ava_fat_list_value* dst,
                         const ava_fat_list_value* src,
                         ava_value val) {
-  *dst = ava_fat_list_value_of(
-    (*src->v->append)(src->c, val).v);
+  static ava_attribute_cache cache;
+  *dst = ava_fat_list_value_of_cached(
+    (*src->v->append)(src->c, val).v, &cache);
 }
 
 void ava_isa_x_lcat$(ava_fat_list_value* dst,
                      const ava_fat_list_value* left,
                      const ava_fat_list_value* right) {
-  *dst = ava_fat_list_value_of(
-    (*left->v->concat)(left->c, right->c).v);
+  static ava_attribute_cache cache;
+  *dst = ava_fat_list_value_of_cached(
+    (*left->v->concat)(left->c, right->c).v, &cache);
 }
 
 
@@ -244,6 +247,7 @@ ava_value ava_isa_x_lhead$(const ava_fat_list_value* src) {
 void ava_isa_x_lbehead$(ava_fat_list_value* dst,
                         const ava_fat_list_value* src) {
   AVA_STATIC_STRING(ava_isa_exception_empty_list_type, "empty-list");
+  static ava_attribute_cache cache;
   size_t length;
 
   length = (*src->v->length)(src->c);
@@ -251,12 +255,15 @@ void ava_isa_x_lbehead$(ava_fat_list_value* dst,
     ava_throw_uex(&ava_error_exception, ava_isa_exception_empty_list_type,
                   ava_error_extract_element_from_empty_list());
 
-  *dst = ava_fat_list_value_of((*src->v->slice)(src->c, 1, length).v);
+  *dst = ava_fat_list_value_of_cached(
+    (*src->v->slice)(src->c, 1, length).v, &cache);
 }
 
 void ava_isa_x_lflatten$(ava_fat_list_value* dst,
                          const ava_fat_list_value* src) {
-  *dst = ava_fat_list_value_of(ava_list_proj_flatten(src->c).v);
+  static ava_attribute_cache cache;
+  *dst = ava_fat_list_value_of_cached(
+    ava_list_proj_flatten(src->c).v, &cache);
 }
 
 ava_value ava_isa_x_lindex$(const ava_fat_list_value* src,
@@ -272,6 +279,42 @@ ava_integer ava_isa_x_llength$(const ava_fat_list_value* src) {
   return (*src->v->length)(src->c);
 }
 
+void* ava_isa_x_lbuild$(void) {
+  ava_list_builder* builder = AVA_NEW(ava_list_builder);
+  ava_list_builder_init(builder);
+  return builder;
+}
+
+void ava_isa_x_lbappend$(void* builder, ava_value val) {
+  ava_list_builder_append((ava_list_builder*)builder, val);
+}
+
+void ava_isa_x_lbcat$(void* builder, const ava_fat_list_value* src) {
+  ava_list_builder_concat((ava_list_builder*)builder, src->c);
+}
+
+void ava_isa_x_lblist$(ava_fat_list_value* dst, void* builder) {
+  static ava_attribute_cache cache;
+  *dst = ava_fat_list_value_of_cached(
+    ava_list_builder_list((ava_list_builder*)builder).v, &cache);
+}
+
+void* ava_isa_x_lcursor$(const ava_fat_list_value* src) {
+  ava_list_cursor* cursor = AVA_NEW(ava_list_cursor);
+  ava_list_cursor_init(cursor, src->c);
+  return cursor;
+}
+
+ava_value ava_isa_x_lcnext$(void* cursor,
+                            ava_string ex_type, ava_string ex_message) {
+  ava_value val;
+
+  if (!ava_list_cursor_next((ava_list_cursor*)cursor, &val))
+    ava_throw_uex(&ava_error_exception, ex_type, ex_message);
+
+  return val;
+}
+
 ava_integer ava_isa_x_iadd$(ava_integer a, ava_integer b) {
   return a + b;
 }
@@ -2111,6 +2111,59 @@ noexcept {
     store_register(p->dst, val, pcfun);
   } return false;
 
+  case ava_pcxt_lbuild: {
+    const ava_pcx_lbuild* p = (const ava_pcx_lbuild*)exe;
+
+    llvm::Value* builder = INVOKE(context.di.x_lbuild);
+    store_strangelet(p->dst, builder, pcfun);
+  } return false;
+
+  case ava_pcxt_lbappend: {
+    const ava_pcx_lbappend* p = (const ava_pcx_lbappend*)exe;
+
+    llvm::Value* builder = load_strangelet(p->accum, pcfun);
+    llvm::Value* esrc = load_register(
+      p->esrc, pcfun, nullptr);
+    INVOKE(context.di.x_lbappend, builder, esrc);
+  } return false;
+
+  case ava_pcxt_lbcat: {
+    const ava_pcx_lbcat* p = (const ava_pcx_lbcat*)exe;
+
+    llvm::Value* builder = load_strangelet(p->accum, pcfun);
+    llvm::Value* src = load_register(
+      p->src, pcfun, tmplists[0]);
+    INVOKE(context.di.x_lbcat, builder, src);
+  } return false;
+
+  case ava_pcxt_lblist: {
+    const ava_pcx_lblist* p = (const ava_pcx_lblist*)exe;
+
+    llvm::Value* builder = load_strangelet(p->accum, pcfun);
+    INVOKE(context.di.x_lblist, tmplists[0], builder);
+    store_register(p->dst, tmplists[0], pcfun);
+  } return false;
+
+  case ava_pcxt_lcursor: {
+    const ava_pcx_lcursor* p = (const ava_pcx_lcursor*)exe;
+
+    llvm::Value* src = load_register(
+      p->src, pcfun, tmplists[0]);
+    llvm::Value* cursor = INVOKE(context.di.x_lcursor, src);
+    store_strangelet(p->dst, cursor, pcfun);
+  } return false;
+
+  case ava_pcxt_lcnext: {
+    const ava_pcx_lcnext* p = (const ava_pcx_lcnext*)exe;
+
+    llvm::Value* cursor = load_strangelet(p->cursor, pcfun);
+    llvm::Value* val = INVOKE(
+      context.di.x_lcnext, cursor,
+      get_ava_string_constant(context, p->extype),
+      get_ava_string_constant(context, p->exmessage));
+    store_register(p->dst, val, pcfun);
+  } return false;
+
   case ava_pcxt_iadd_imm: {
     const ava_pcx_iadd_imm* p = (const ava_pcx_iadd_imm*)exe;
 
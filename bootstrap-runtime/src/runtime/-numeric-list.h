@@ -0,0 +1,45 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__NUMERIC_LIST_H_
+#define AVA_RUNTIME__NUMERIC_LIST_H_
+
+#include "avalanche/list.h"
+
+/**
+ * @file
+ *
+ * Internal interface used by the other list implementations to promote
+ * homogeneous numeric contents to numeric lists.
+ *
+ * @see avalanche/numeric-list.h
+ */
+
+/**
+ * If every value in the given array is an integer-typed value, or every value
+ * is a real-typed value, stores a new numeric list with the same contents into
+ * *dst and returns true. Otherwise, returns false without touching *dst.
+ *
+ * Only the attribute of each value is examined; strings which happen to look
+ * like numbers are not promoted, since doing so would lose their original
+ * string representation.
+ *
+ * The array is copied rather than referenced. length must not be zero.
+ */
+ava_bool ava_numeric_list_of_raw(ava_list_value*restrict dst,
+                                 const ava_value*restrict array,
+                                 size_t length);
+
+#endif /* AVA_RUNTIME__NUMERIC_LIST_H_ */
@@ -0,0 +1,61 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__PARALLEL_H_
+#define AVA_RUNTIME__PARALLEL_H_
+
+#include "avalanche/defs.h"
+
+/**
+ * @file
+ *
+ * Provides a shared pool of worker threads for runtime operations which are
+ * worth splitting across CPUs, such as parsing very large strings.
+ *
+ * The pool is started lazily the first time it is needed. Worker threads are
+ * registered with the garbage collector, so work items may allocate freely,
+ * and may throw Avalanche exceptions, which are passed back to the thread
+ * that called ava_parallel_for().
+ */
+
+/**
+ * Returns the maximum number of threads, including the calling thread, which
+ * ava_parallel_for() will use at once.
+ *
+ * This is always at least 1. Callers can use it to decide whether splitting
+ * work up is worthwhile at all.
+ */
+unsigned ava_parallel_width(void);
+
+/**
+ * Calls fn(userdata, ix) exactly once for every ix in [0,n), distributing the
+ * calls between the worker pool and the calling thread.
+ *
+ * The calls are made in no particular order and may run concurrently. This
+ * function returns only once every call has returned; all memory effects of
+ * the calls are visible to the caller at that point.
+ *
+ * It is safe to call this function from within a work item; the nested call
+ * makes progress even if every worker is busy.
+ *
+ * If a call throws an Avalanche exception (see ava_catch()), no further calls
+ * are started. Once the calls already in progress have returned, the first
+ * exception thrown is rethrown on the calling thread. Calls which are skipped
+ * or cut short this way leave whatever they would have written incomplete.
+ */
+void ava_parallel_for(size_t n, void (*fn)(void* userdata, size_t ix),
+                      void* userdata);
+
+#endif /* AVA_RUNTIME__PARALLEL_H_ */
@@ -197,22 +197,14 @@ static ava_string ava_pcode_sxt_to_string(const ava_struct* sxt) {
   return ava_to_string(ava_value_of_struct(sxt));
 }
 
-static ava_string apply_indent(ava_string str, ava_uint indent) {
-  ava_string base = AVA_EMPTY_STRING;
+static void ava_pcode_begin_elt_string(ava_string_builder*restrict accum,
+                                       ava_uint indent) {
   ava_uint i;
 
   for (i = 0; i < indent; ++i)
-    base = ava_strcat(base, AVA_ASCII9_STRING("\t"));
+    ava_string_builder_append_bytes(accum, "\t", 1);
 
-  return ava_strcat(base, str);
-}
-
-static ava_string ava_pcode_elt_escape(ava_string elt_string) {
-  return ava_strcat(
-    AVA_ASCII9_STRING("["),
-    ava_strcat(
-      elt_string,
-      AVA_ASCII9_STRING("]")));
+  ava_string_builder_append_bytes(accum, "[", 1);
 }
 
 static ava_bool ava_pcode_is_valid_ex_type(ava_integer type) {
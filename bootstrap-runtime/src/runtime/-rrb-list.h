@@ -0,0 +1,60 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__RRB_LIST_H_
+#define AVA_RUNTIME__RRB_LIST_H_
+
+#include "avalanche/list.h"
+
+/**
+ * @file
+ *
+ * Provides lists backed by relaxed-radix-balanced trees.
+ *
+ * RRB lists are fully persistent: every operation which produces a new list
+ * shares all but O(log n) nodes with its input, so set, append, concat, slice
+ * and remove are all O(log n) regardless of how many other versions of the
+ * list are alive. This makes them slower than ESBA lists in the common case of
+ * a list having only one live version, but much faster when many versions are
+ * kept around and modified independently. ESBA lists therefore switch to RRB
+ * lists by themselves once they notice that they are being used that way.
+ *
+ * RRB lists can*not* be empty. All operations on an RRB list that produce new
+ * lists also return an RRB list, except for slice() and operations which
+ * result in an empty list.
+ */
+
+/**
+ * ESBA lists shorter than this are never migrated to RRB lists, since copying
+ * them out in full is cheap anyway.
+ */
+#define AVA_RRB_LIST_THRESH 256
+
+/**
+ * Copies elements in the given range of the given list into a new RRB list.
+ *
+ * end may not be equal to begin.
+ */
+ava_list_value ava_rrb_list_copy_of(ava_list_value list,
+                                    size_t begin, size_t end);
+
+/**
+ * This is for testing.
+ *
+ * Returns whether the given list is an RRB list.
+ */
+ava_bool ava_list_is_rrb_list(ava_list_value list);
+
+#endif /* AVA_RUNTIME__RRB_LIST_H_ */
@@ -0,0 +1,116 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__STRING_KERNELS_H_
+#define AVA_RUNTIME__STRING_KERNELS_H_
+
+#include "avalanche/defs.h"
+
+/**
+ * @file
+ *
+ * Byte-array search, comparison, and UTF-8 kernels used by the string
+ * functions when operating on flat (forced twine) character data.
+ *
+ * Several implementations exist; the runtime selects the best one the host
+ * processor supports the first time any kernel is needed. Every
+ * implementation produces exactly the same results as the scalar one, which is
+ * a thin wrapper around the C library.
+ */
+
+typedef struct ava_string_kernels_s ava_string_kernels;
+
+struct ava_string_kernels_s {
+  /**
+   * Human-readable name of this implementation, eg, "sse2".
+   */
+  const char* name;
+
+  /**
+   * Returns whether the host processor can execute this implementation.
+   */
+  ava_bool (*supported)(void);
+
+  /**
+   * Returns the index of the first occurrence of needle within the first n
+   * bytes of haystack, or -1 if there is none.
+   */
+  ssize_t (*find_byte)(const char*restrict haystack, char needle, size_t n);
+
+  /**
+   * Returns the index of the first byte at which the first n bytes of a and b
+   * differ, or n if they are identical.
+   */
+  size_t (*mismatch)(const char*restrict a, const char*restrict b, size_t n);
+
+  /**
+   * Returns the index of the first occurrence of the byte string needle
+   * within haystack, or -1 if there is none. An empty needle is found at
+   * index 0.
+   */
+  ssize_t (*find_bytes)(const char*restrict haystack, size_t haystack_len,
+                        const char*restrict needle, size_t needle_len);
+
+  /**
+   * Returns the number of leading bytes of the first n bytes of s which are
+   * ASCII, ie, have their high bit clear.
+   */
+  size_t (*ascii_prefix)(const char*restrict s, size_t n);
+
+  /**
+   * Returns the length of the longest prefix of the first n bytes of s which
+   * consists entirely of complete, well-formed UTF-8 sequences (rejecting
+   * overlong forms, surrogates, and code points beyond U+10FFFF).
+   *
+   * In other words, the result is n if s is valid UTF-8, and otherwise the
+   * offset of the first sequence which is invalid or truncated.
+   */
+  size_t (*utf8_valid_prefix)(const char*restrict s, size_t n);
+
+  /**
+   * Returns the number of bytes within the first n bytes of s which are not
+   * UTF-8 continuation bytes; for valid UTF-8, this is the number of code
+   * points.
+   */
+  size_t (*utf8_count)(const char*restrict s, size_t n);
+
+  /**
+   * Returns the offset of the (zero-based) cp'th byte within the first n bytes
+   * of s which is not a UTF-8 continuation byte, or n if there are not that
+   * many such bytes.
+   */
+  size_t (*utf8_offset)(const char*restrict s, size_t n, size_t cp);
+};
+
+/**
+ * The portable implementation, built on memchr() and memcmp(). Always
+ * supported.
+ */
+extern const ava_string_kernels ava_string_kernels_scalar;
+
+/**
+ * NULL-terminated array of every implementation compiled into the runtime,
+ * best first. Not all of them are necessarily supported on the host.
+ */
+extern const ava_string_kernels*const ava_string_kernels_all[];
+
+/**
+ * Returns the best implementation supported on the host.
+ *
+ * The result is computed once and cached.
+ */
+const ava_string_kernels* ava_string_kernels_get(void) AVA_PURE;
+
+#endif /* AVA_RUNTIME__STRING_KERNELS_H_ */
@@ -0,0 +1,101 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA_RUNTIME__STRING_H_
+#define AVA_RUNTIME__STRING_H_
+
+#include <atomic_ops.h>
+
+#include "avalanche/string.h"
+
+/**
+ * @file
+ *
+ * Hooks into the string representation for use by other parts of the runtime.
+ * Nothing here is meaningful outside the runtime itself.
+ */
+
+/**
+ * Like ava_string_to_cstring_buff(), but additionally locates the hash cache
+ * slot associated with the string's flat character data, if any.
+ *
+ * Heap-allocated forced twines (which includes any twine once forced) reserve
+ * one word for this purpose. The slot is initially zero; it is intended to
+ * hold ava_value_hash() of the string, published with a plain atomic store
+ * and re-computed by anyone who reads zero. Since the string is immutable and
+ * the hash deterministic within the process, racing writers always store the
+ * same value.
+ *
+ * *slot is set to NULL if the string has no slot, such as for ASCII9 strings,
+ * static twines (which live in read-only memory), and mapped strings.
+ */
+const char* ava_string_to_cstring_hash_slot(
+  ava_str_tmpbuff tmp, ava_string str, AO_t*restrict* slot);
+
+/**
+ * Returns the properties slot of a string whose hash slot is non-NULL, given
+ * the character data and length returned alongside it by
+ * ava_string_to_cstring_hash_slot().
+ *
+ * The properties slot is one word, initially zero, immediately after the
+ * padded character data. It is owned by string-utf8.c.
+ */
+static inline AO_t* ava_string_props_slot(const char* data, size_t length) {
+  return (AO_t*)(data + (length + sizeof(ava_ulong)) /
+                 sizeof(ava_ulong) * sizeof(ava_ulong));
+}
+
+/**
+ * Physical layout of an interned string.
+ *
+ * The other field of the twine points back to the twine itself, which no
+ * other kind of twine node can do. The character data immediately follows
+ * the structure, and the hash field serves as its hash slot.
+ */
+typedef struct {
+  ava_twine twine;
+  AO_t hash;
+} ava_interned_twine;
+
+/**
+ * Returns whether the given string is the canonical instance produced by
+ * ava_string_intern().
+ *
+ * Two distinct interned strings are never equal, unless the collector lacks
+ * long weak links, in which case a string reachable only from a finaliser may
+ * coexist with a newer interned instance of the same content.
+ */
+static inline ava_bool ava_string_is_interned(ava_string str) {
+  return !ava_string_is_inline(str) &&
+    str.twine == str.twine->tail.other.string.twine &&
+    str.twine->body == (const void*)((const ava_interned_twine*)str.twine + 1);
+}
+
+/**
+ * Allocates a new interned twine holding a copy of the given characters.
+ *
+ * This only creates the twine; it is up to the caller to ensure that it
+ * really is the only interned string with this content.
+ *
+ * @param data The characters of the string.
+ * @param length The length of data, which must be too long to be represented
+ * as an ASCII9 string.
+ * @param hash The ava_value_hash() of the string, with which to initialise
+ * the hash slot.
+ */
+ava_string ava_interned_string_new(const char* data, size_t length,
+                                   ava_ulong hash);
+
+#endif /* AVA_RUNTIME__STRING_H_ */
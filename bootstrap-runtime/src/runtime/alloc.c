@@ -27,6 +27,10 @@
  */
 
 #ifndef AVA_NOGC
+/* Needed so that GC_INIT() enables support for the threads started by
+ * parallel.c.
+ */
+#define GC_THREADS 1
 #if defined(HAVE_GC_GC_H)
 #include <gc/gc.h>
 #elif defined(HAVE_GC_H)
@@ -41,6 +45,8 @@
 #define GC_MALLOC_IGNORE_OFF_PAGE(sz) (calloc(1, (sz)))
 #define GC_MALLOC_ATOMIC_IGNORE_OFF_PAGE(sz) (malloc(sz))
 #define GC_FREE(ptr) (free(ptr))
+#define GC_HIDE_POINTER(ptr) (~(size_t)(ptr))
+#define GC_REVEAL_POINTER(word) ((void*)~(word))
 #endif /* !AVA_NOGC */
 
 #include <string.h>
@@ -112,3 +118,40 @@ void* ava_clone_atomic(const void*restrict src, size_t sz) {
   memcpy(dst, src, sz);
   return dst;
 }
+
+void ava_weak_ref_set(ava_weak_ref*restrict ref, const void* obj) {
+  ref->hidden = GC_HIDE_POINTER(obj);
+#ifndef AVA_NOGC
+  /* Prefer long links, which are only cleared once the object is truly gone,
+   * rather than when it becomes reachable only from finalisable objects.
+   */
+#ifdef HAVE_GC_REGISTER_LONG_LINK
+  if (GC_NO_MEMORY == GC_register_long_link((void**)&ref->hidden, obj))
+#else
+  if (GC_NO_MEMORY == GC_general_register_disappearing_link(
+        (void**)&ref->hidden, obj))
+#endif
+    errx(EX_UNAVAILABLE, "out of memory registering weak reference");
+#endif
+}
+
+#ifndef AVA_NOGC
+static void* ava_weak_ref_do_get(void* ref) {
+  size_t hidden = ((const ava_weak_ref*)ref)->hidden;
+  return hidden? GC_REVEAL_POINTER(hidden) : NULL;
+}
+#endif
+
+void* ava_weak_ref_get(const ava_weak_ref*restrict ref) {
+#ifndef AVA_NOGC
+  /* The collector may clear the reference and free the object at any point
+   * where we don't hold a visible pointer to it, including between reading
+   * the hidden pointer and revealing it. Holding the allocation lock prevents
+   * it from running in that window.
+   */
+  if (!ref->hidden) return NULL;
+  return GC_call_with_alloc_lock(ava_weak_ref_do_get, (void*)ref);
+#else
+  return ref->hidden? GC_REVEAL_POINTER(ref->hidden) : NULL;
+#endif
+}
@@ -31,6 +31,8 @@
 #include "avalanche/list.h"
 #include "-array-list.h"
 #include "-esba-list.h"
+#include "-list-string-cache.h"
+#include "-numeric-list.h"
 
 #define AVA_ARRAY_LIST_MIN_CAPACITY 8
 
@@ -67,6 +69,10 @@ typedef struct {
    * The largest index in values that has actually been populated.
    */
   AO_t used;
+  /**
+   * The string form of the most recently stringified prefix of values.
+   */
+  ava_list_string_cache string_cache;
 
   /**
    * The contents of this array list.
@@ -78,15 +84,26 @@ static ava_array_list* ava_array_list_of_array(
   const ava_value*restrict, size_t, size_t);
 static size_t ava_array_list_growing_capacity(size_t);
 
+static ava_string ava_array_list_to_string(ava_value list);
+
 static const ava_value_trait ava_array_list_generic_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_array_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
 
 AVA_LIST_DEFIMPL(ava_array_list, &ava_array_list_generic_impl)
 
+static ava_string ava_array_list_to_string(ava_value list) {
+  ava_array_list*restrict al = (ava_array_list*)ava_value_attr(list);
+
+  /* Elements are never overwritten in place, so every list sharing al has
+   * the same prefix of values and the length alone tells them apart.
+   */
+  return ava_list_to_string_cached(&al->string_cache, al, list);
+}
+
 unsigned ava_array_list_used(ava_value list) {
   const ava_array_list*restrict al = ava_value_attr(list);
   return al->used;
@@ -97,16 +114,13 @@ ava_list_value ava_array_list_copy_of(
 ) {
   ava_array_list* al = ava_alloc(sizeof(ava_array_list) +
                                  sizeof(ava_value) * (end - begin));
-  size_t i;
 
   al->header.tag = &ava_array_list_data_tag;
   al->header.next = (const ava_attribute*)&ava_array_list_list_impl;
   al->capacity = end - begin;
   al->used = end - begin;
 
-  for (i = begin; i < end; ++i) {
-    al->values[i-begin] = ava_list_index(list, i);
-  }
+  ava_list_index_range(list, begin, end, al->values);
 
   return (ava_list_value) { ava_value_with_ulong(al, end - begin) };
 }
@@ -148,6 +162,16 @@ static ava_value ava_array_list_list_index(ava_list_value list, size_t ix) {
   return al->values[ix];
 }
 
+static void ava_array_list_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_array_list*restrict al = ava_value_attr(list.v);
+
+  assert(begin <= end);
+  assert(end <= ava_value_ulong(list.v));
+  memcpy(dst, al->values + begin, sizeof(ava_value) * (end - begin));
+}
+
 static ava_list_value ava_array_list_list_slice(ava_list_value list,
                                                 size_t begin, size_t end) {
   const ava_array_list*restrict al = ava_value_attr(list.v);
@@ -194,11 +218,46 @@ static ava_list_value ava_array_list_list_append(ava_list_value list,
 
     return (ava_list_value) { ava_value_with_ulong(al, length + 1) };
   } else {
-    list = ava_esba_list_of_raw(al->values, length);
+    if (!ava_numeric_list_of_raw(&list, al->values, length))
+      list = ava_esba_list_of_raw(al->values, length);
     return ava_list_append(list, elt);
   }
 }
 
+static ava_list_value ava_array_list_list_append_n(
+  ava_list_value list, const ava_value*restrict elements, size_t count
+) {
+  ava_array_list*restrict al = (ava_array_list*)ava_value_attr(list.v);
+  size_t length = ava_value_ulong(list.v);
+
+  if (0 == count) return list;
+
+  if (length + count <= al->capacity) {
+    /* Try to append in-place */
+    if (AO_compare_and_swap(&al->used, length, length + count)) {
+      /* Success, skip reallocation */
+      goto mutate_al;
+    }
+  }
+
+  /* Can't append in-place, create a new allocation */
+  if (length + count <= AVA_ARRAY_LIST_THRESH) {
+    al = ava_array_list_of_array(al->values, length,
+                                 ava_array_list_growing_capacity(
+                                   length + count));
+    al->used += count;
+
+    mutate_al:
+    memcpy(al->values + length, elements, sizeof(ava_value) * count);
+
+    return (ava_list_value) { ava_value_with_ulong(al, length + count) };
+  } else {
+    if (!ava_numeric_list_of_raw(&list, al->values, length))
+      list = ava_esba_list_of_raw(al->values, length);
+    return ava_list_append_n(list, elements, count);
+  }
+}
+
 static ava_list_value ava_array_list_list_concat(ava_list_value list,
                                                  ava_list_value other) {
   ava_array_list*restrict al = (ava_array_list*)ava_value_attr(list.v);
@@ -223,17 +282,15 @@ static ava_list_value ava_array_list_list_concat(ava_list_value list,
                                    this_length + other_length));
     al->used += other_length;
 
-    mutate_al:;
-    size_t i;
-    for (i = 0; i < other_length; ++i) {
-      al->values[this_length + i] = ava_list_index(other, i);
-    }
+    mutate_al:
+    ava_list_index_range(other, 0, other_length, al->values + this_length);
 
     return (ava_list_value) {
       ava_value_with_ulong(al, this_length + other_length)
     };
   } else {
-    list = ava_esba_list_of_raw(al->values, this_length);
+    if (!ava_numeric_list_of_raw(&list, al->values, this_length))
+      list = ava_esba_list_of_raw(al->values, this_length);
     return ava_list_concat(list, other);
   }
 }
@@ -35,7 +35,10 @@ AVA_BEGIN_DECLS
 #include "avalanche/context.h"
 #include "avalanche/list.h"
 #include "avalanche/list-proj.h"
+#include "avalanche/list-sort.h"
+#include "avalanche/numeric-list.h"
 #include "avalanche/map.h"
+#include "avalanche/ordered-map.h"
 #include "avalanche/pointer.h"
 #include "avalanche/struct.h"
 #include "avalanche/function.h"
@@ -121,6 +121,40 @@ void* ava_clone(const void*restrict src, size_t sz) AVA_MALLOC;
  * If memory allocation fails, the process is aborted.
  */
 void* ava_clone_atomic(const void*restrict src, size_t sz) AVA_MALLOC;
+
+/**
+ * A reference to a GC-managed object which does not by itself keep the object
+ * alive.
+ *
+ * Once the referent becomes unreachable through anything other than weak
+ * references, the collector clears the weak reference; thereafter,
+ * ava_weak_ref_get() returns NULL.
+ *
+ * A weak reference must live in memory known to the collector (ie, memory
+ * allocated by one of the functions above, or static storage) and must not be
+ * moved or copied after it is set; it is automatically dropped when the memory
+ * containing it is reclaimed. It does not hold a pointer the collector can
+ * recognise, so it may be placed in atomic memory.
+ */
+typedef struct {
+  size_t hidden;
+} ava_weak_ref;
+
+/**
+ * Initialises the given weak reference to refer to obj, which must be the
+ * base pointer of an object allocated by ava_alloc() or similar.
+ *
+ * The weak reference must not already hold a referent which is still alive.
+ */
+void ava_weak_ref_set(ava_weak_ref*restrict ref, const void* obj);
+/**
+ * Returns the object referenced by the given weak reference, or NULL if it
+ * has been collected (or was never set).
+ *
+ * The returned pointer is an ordinary strong reference.
+ */
+void* ava_weak_ref_get(const ava_weak_ref*restrict ref);
+
 /**
  * Syntax sugar for calling ava_alloc() with the size of the selected type and
  * casting it to a pointer to that type.
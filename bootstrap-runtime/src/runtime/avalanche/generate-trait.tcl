@@ -95,6 +95,9 @@ package require Tcl 8.5
 #   /* Augmented value->fat normal value conversion routine. */
 #   prefix_fat_widget_value prefix_fat_widget_value_of(
 #     ava_value value) AVA_PURE;
+#   /* As above, but looks the trait up through an inline cache */
+#   static inline prefix_fat_widget_value prefix_fat_widget_value_of_cached(
+#     ava_value value, ava_attribute_cache*restrict cache);
 #
 #   /* Top-level calls for each method. There are versions that take plain
 #    * ava_values and formatted values for each.
@@ -107,7 +110,8 @@ package require Tcl 8.5
 #              ava_value:               prefix_widget_my_method_v,      \
 #              prefix_widget_value:     prefix_widget_my_method_f)      \
 #       (this, arg1_name, arg2_name)
-#   /* These functions are also implemented; snipped here */
+#   /* These functions are also implemented; snipped here. Each keeps its own
+#    * static ava_attribute_cache for the trait lookup. */
 #   static inline return_type prefix_widget_my_method_v(
 #     ava_value this, arg1_type arg1_name, arg2_type arg2_name);
 #   static inline return_type prefix_widget_my_method_f(
@@ -262,6 +266,26 @@ ${valtype} ${valtype}_of(ava_value value) AVA_PURE;
  */
 ${prefix}_fat_${name}_value ${prefix}_fat_${name}_value_of(
   ava_value value) AVA_PURE;
+
+/**
+ * Equivalent to ${prefix}_fat_${name}_value_of(), but uses the given inline
+ * cache to locate the trait on values which already have it.
+ *
+ * @see ava_get_attribute_cached()
+ */
+static inline ${prefix}_fat_${name}_value
+${prefix}_fat_${name}_value_of_cached(
+  ava_value value, ava_attribute_cache*restrict cache
+) {
+  const ${prefix}_${name}_trait*restrict trait =
+    (const ${prefix}_${name}_trait*)ava_get_attribute_cached(
+      value, &${prefix}_${name}_trait_tag, cache);
+
+  if (AVA_LIKELY(trait))
+    return (${prefix}_fat_${name}_value) { .v = trait, .c = { value } };
+  else
+    return ${prefix}_fat_${name}_value_of(value);
+}
 "
 
 foreach meth $methods {
@@ -307,8 +331,9 @@ $mdoc
         puts ", [typesub $t $self] $n"
       }
       puts ") {"
+      puts "  static ava_attribute_cache cache;"
       puts "  ${prefix}_fat_${name}_value fat = "
-      puts "    ${prefix}_fat_${name}_value_of(_this$thissfx);"
+      puts "    ${prefix}_fat_${name}_value_of_cached(_this$thissfx, &cache);"
       if {"void" ne $return_type} {
         puts "  return"
       }
@@ -192,6 +192,19 @@ ava_bool ava_lex_token_type_is_close_paren(ava_lex_token_type);
  * @return The lexical analyser, managed on the garbage-collected heap.
  */
 ava_lex_context* ava_lex_new(ava_string);
+/**
+ * Creates a new lexical analyser that will tokenise the given string starting
+ * at byte offset begin, which must be the start of a token or of whitespace
+ * preceding one.
+ *
+ * Indices in results are relative to the start of the whole string, as with
+ * ava_lex_new(). Line and column numbers are counted as if begin were the
+ * start of the first line.
+ *
+ * This allows disjoint parts of one large string to be tokenised
+ * independently without copying them out.
+ */
+ava_lex_context* ava_lex_new_at(ava_string str, size_t begin);
 /**
  * Obtains the next token from the lexical analyser.
  *
@@ -22,6 +22,8 @@
 
 #include "defs.h"
 #include "list.h"
+#include "integer.h"
+#include "function.h"
 
 /**
  * @file
@@ -91,6 +93,84 @@ ava_list_value ava_list_proj_demux(ava_list_value list,
  */
 ava_list_value ava_list_proj_group(ava_list_value list, size_t group_sz);
 
+/**
+ * Returns a list whose elements are the result of applying a function to each
+ * element of the input list.
+ *
+ * The function is not invoked until the corresponding element is actually
+ * read. Any exceptions it throws are propagated to the reader.
+ *
+ * @param list The list whose elements are to be transformed.
+ * @param fun The function to apply. It is passed one static parameter, the
+ * input element; its return value becomes the output element.
+ * @param memoise If true, each result is cached the first time it is
+ * computed, so fun is invoked (barring races between threads) at most once
+ * per element. If false, fun is invoked every time an element is read, which
+ * is preferable when fun is cheap and the list is read only once.
+ * @return A list of the same length as list, containing the results of fun.
+ */
+ava_list_value ava_list_proj_map(ava_list_value list, const ava_function* fun,
+                                 ava_bool memoise);
+
+/**
+ * Returns a list containing only those elements of the input list for which a
+ * predicate returns a non-zero integer, in their original order.
+ *
+ * The predicate is evaluated lazily. The projection remembers the index of
+ * every element that passed as it goes, so each element is tested at most
+ * once (barring races between threads). In order to keep the bookkeeping
+ * linear, the predicate may be evaluated somewhat beyond the greatest index
+ * actually read; determining the length of the result requires evaluating it
+ * on every element.
+ *
+ * @param list The list to filter.
+ * @param predicate The function to test each element. It is passed one static
+ * parameter, the input element; its return value is interpreted as an
+ * integer, with the empty string counting as zero.
+ * @return A list of the elements of list which passed the predicate.
+ * @throws ava_format_exception if the predicate returns a non-integer.
+ */
+ava_list_value ava_list_proj_filter(ava_list_value list,
+                                    const ava_function* predicate);
+
+/**
+ * Returns a list of tuples, where the ith tuple is a list containing the ith
+ * element of each input list. For example, the lists [a b c] and [d e f] zip
+ * to produce [[a d] [b e] [c f]].
+ *
+ * Unlike ava_list_proj_interleave(), the input lists need not be of the same
+ * length; the result is as long as the shortest of them.
+ *
+ * ava_list_proj_flatten() turns the result into an interleave projection
+ * without evaluating it.
+ *
+ * @param lists An array of lists to zip.
+ * @param num_lists The number of elements in the lists array.
+ * @return A zip list projection.
+ */
+ava_list_value ava_list_proj_zip(const ava_list_value*restrict lists,
+                                 size_t num_lists);
+
+/**
+ * Returns a list of the integers from begin, inclusive, to end, exclusive,
+ * counting by step. If step is negative, the list counts down, and end is
+ * still exclusive.
+ *
+ * For example, range(1, 10, 3) produces [1 4 7], and range(3, 0, -1) produces
+ * [3 2 1].
+ *
+ * No storage is used for the elements themselves, and slicing the result
+ * produces another range.
+ *
+ * @param begin The first integer in the list.
+ * @param end The bound at which to stop.
+ * @param step The difference between successive integers. Must not be zero.
+ * @return A range list projection, or the empty list if no integers lie in
+ * the range.
+ */
+ava_list_value ava_list_proj_range(ava_integer begin, ava_integer end,
+                                   ava_integer step);
+
 /**
  * Flattens a list.
  *
@@ -99,8 +179,13 @@ ava_list_value ava_list_proj_group(ava_list_value list, size_t group_sz);
  * [a b c d e].
  *
  * This function is aware of values produced by ava_list_proj_group() and can
- * invert it efficiently. It is otherwise not an actual projection and requires
- * copying elements.
+ * invert it efficiently. Results of ava_list_proj_zip() are turned into an
+ * interleave projection, and results of ava_list_proj_range() are returned
+ * as-is, since their elements are already single-element lists. It is
+ * otherwise not an actual projection and requires copying elements; however,
+ * other projections, such as those of ava_list_proj_map() and
+ * ava_list_proj_filter(), are read directly a block at a time, so a pipeline
+ * of projections only allocates the final result.
  *
  * @param list The list to flatten.
  * @return The flattened list.
@@ -0,0 +1,92 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA__INTERNAL_INCLUDE
+#error "Don't include avalanche/list-sort.h directly; just include avalanche.h"
+#endif
+
+#ifndef AVA_RUNTIME_LIST_SORT_H_
+#define AVA_RUNTIME_LIST_SORT_H_
+
+#include "defs.h"
+#include "list.h"
+#include "function.h"
+
+/**
+ * @file
+ *
+ * Provides native sorting of lists.
+ *
+ * All sorts are stable merge sorts. Large lists sorted by one of the built-in
+ * orders are sorted in parallel on the runtime's worker pool.
+ *
+ * Each element is converted to its sort key exactly once, before any
+ * comparison is made, so any exception from that conversion is thrown before
+ * any sorting work is done. Lists whose elements are all ASCII9 strings, all
+ * integer-typed values, or all real-typed values are sorted directly on their
+ * native representation; the result is rebuilt from the sorted keys, and for
+ * numeric keys is a numeric list.
+ */
+
+/**
+ * The built-in orders by which ava_list_sort() can sort a list.
+ */
+typedef enum {
+  /**
+   * Elements are ordered by their string representations, as per
+   * ava_value_strcmp().
+   */
+  ava_lso_lexical = 0,
+  /**
+   * Elements are ordered as integers, interpreted as per
+   * ava_integer_of_value() with a default of 0.
+   */
+  ava_lso_integer,
+  /**
+   * Elements are ordered as reals, interpreted as per ava_real_of_value()
+   * with a default of 0.0. Negative and positive zero are equal; NaNs are
+   * ordered after everything else and are equal to each other.
+   */
+  ava_lso_real
+} ava_list_sort_order;
+
+/**
+ * Returns a list containing the elements of the given list, stably sorted
+ * into ascending order according to the given order.
+ *
+ * @throws ava_format_exception if order is ava_lso_integer or ava_lso_real
+ * and some element cannot be interpreted as such.
+ */
+ava_list_value ava_list_sort(ava_list_value list, ava_list_sort_order order);
+
+/**
+ * Returns a list containing the elements of the given list, stably sorted
+ * into ascending order according to the given comparator.
+ *
+ * The comparator is invoked with two elements, a and b, and must return an
+ * integer which is negative if a orders before b, positive if a orders after
+ * b, and zero if they are equivalent. It must define a consistent total
+ * preorder; if it does not, the result is some unspecified permutation of the
+ * input.
+ *
+ * Large lists are sorted in parallel like those sorted by ava_list_sort(),
+ * so the comparator may be invoked from several threads at once, and must
+ * not depend on which thread it runs on. If it throws, no further
+ * comparisons are started, and the exception propagates out of this call.
+ */
+ava_list_value ava_list_sort_by(ava_list_value list,
+                                const ava_function* comparator);
+
+#endif /* AVA_RUNTIME_LIST_SORT_H_ */
@@ -50,6 +50,9 @@ ava_fat_list_value ava_list_copy_of(ava_fat_list_value list,
 /**
  * Returns a list containing the given sequence of values.
  *
+ * Large sequences consisting entirely of integer-typed values, or entirely of
+ * real-typed values, produce a numeric list (see avalanche/numeric-list.h).
+ *
  * @param values The values that comprise the list. This array is copied, and
  * need not be prerved after this function returns.
  * @param count The number of values to copy.
@@ -63,6 +66,14 @@ ava_list_value ava_list_of_values(const ava_value*restrict values,
  */
 ava_string ava_list_escape(ava_value val) AVA_PURE;
 
+/**
+ * The standard implementation of ava_value.to_string() for normalised lists.
+ *
+ * This reads the list in blocks via ava_list_trait.index_range and builds the
+ * result directly, rather than producing one chunk per element.
+ */
+ava_string ava_list_to_string(ava_value list) AVA_PURE;
+
 /**
  * The standard implementation of ava_value.string_chunk_iterator() for
  * normalised lists.
@@ -76,6 +87,12 @@ ava_datum ava_list_string_chunk_iterator(ava_value);
 ava_string ava_list_iterate_string_chunk(ava_datum*restrict i,
                                          ava_value val);
 
+/**
+ * Implementation of ava_list_trait.index_range which calls
+ * ava_list_trait.index for each element.
+ */
+void ava_list_index_range_by_index(ava_list_value list, size_t begin,
+                                   size_t end, ava_value*restrict dst);
 /**
  * Implementation of ava_list_trait.slice which copies the input list into a
  * new list of an unspecified type.
@@ -86,6 +103,13 @@ ava_list_value ava_list_copy_slice(ava_list_value list, size_t begin, size_t end
  * element into a new list of an unspecified type.
  */
 ava_list_value ava_list_copy_append(ava_list_value list, ava_value elt);
+/**
+ * Implementation of ava_list_trait.append_n which copies the input list and
+ * new elements into a new list of an unspecified type.
+ */
+ava_list_value ava_list_copy_append_n(ava_list_value list,
+                                      const ava_value*restrict elements,
+                                      size_t count);
 /**
  * Implementation of ava_list_trait.concat which copies the lists into a new
  * list of an unspecified type.
@@ -108,4 +132,102 @@ ava_list_value ava_list_copy_set(ava_list_value list, size_t ix, ava_value val);
  */
 ava_list_value ava_empty_list(void) AVA_CONSTFUN;
 
+/**
+ * The number of elements an ava_list_builder holds before appending them to
+ * its list.
+ */
+#define AVA_LIST_BUILDER_BUFFER 16
+
+/**
+ * Accumulates a list one element at a time, appending the elements to the
+ * underlying list in batches through ava_list_trait.append_n() rather than
+ * calling ava_list_trait.append() for each.
+ *
+ * The fields of this structure are internal. A builder must be initialised
+ * with ava_list_builder_init() before use. It is not thread-safe.
+ */
+typedef struct {
+  ava_list_value list;
+  size_t buffered;
+  ava_value buffer[AVA_LIST_BUILDER_BUFFER];
+} ava_list_builder;
+
+/**
+ * Initialises the given list builder to be empty.
+ */
+void ava_list_builder_init(ava_list_builder*restrict builder);
+/**
+ * Appends any elements buffered in the given builder to its list.
+ */
+void ava_list_builder_flush(ava_list_builder*restrict builder);
+/**
+ * Appends elt to the given builder.
+ */
+static inline void ava_list_builder_append(ava_list_builder*restrict builder,
+                                           ava_value elt) {
+  if (AVA_LIST_BUILDER_BUFFER == builder->buffered)
+    ava_list_builder_flush(builder);
+
+  builder->buffer[builder->buffered++] = elt;
+}
+/**
+ * Appends every element of other to the given builder.
+ */
+void ava_list_builder_concat(ava_list_builder*restrict builder,
+                             ava_list_value other);
+/**
+ * Returns the list accumulated by the given builder so far.
+ *
+ * Unlike ava_string_builder_finish(), this does not reset the builder; later
+ * appends continue from the returned list.
+ */
+ava_list_value ava_list_builder_list(ava_list_builder*restrict builder);
+
+/**
+ * The number of elements an ava_list_cursor reads from its list at a time.
+ */
+#define AVA_LIST_CURSOR_BLOCK 16
+
+/**
+ * Reads the elements of a list from front to back, fetching them in blocks
+ * through ava_list_trait.index_range() rather than calling
+ * ava_list_trait.index() for each.
+ *
+ * The fields of this structure are internal. A cursor must be initialised
+ * with ava_list_cursor_init() before use. It is not thread-safe.
+ */
+typedef struct {
+  ava_list_value list;
+  size_t length, fetched;
+  unsigned pos, end;
+  ava_value block[AVA_LIST_CURSOR_BLOCK];
+} ava_list_cursor;
+
+/**
+ * Initialises the given cursor to read list from its first element.
+ */
+void ava_list_cursor_init(ava_list_cursor*restrict cursor,
+                          ava_list_value list);
+/**
+ * Reads the next block of elements into the given cursor.
+ *
+ * @return Whether any elements remained to be read.
+ */
+ava_bool ava_list_cursor_fill(ava_list_cursor*restrict cursor);
+/**
+ * Reads the next element from the given cursor.
+ *
+ * @param dst Set to the next element of the list, if there is one.
+ * @return Whether there was another element, ie, ava_false if the cursor
+ * has reached the end of the list.
+ */
+static inline ava_bool ava_list_cursor_next(ava_list_cursor*restrict cursor,
+                                            ava_value*restrict dst) {
+  if (cursor->pos == cursor->end && !ava_list_cursor_fill(cursor))
+    return ava_false;
+
+  *dst = cursor->block[cursor->pos++];
+  return ava_true;
+}
+
 #endif /* AVA_RUNTIME_LIST_H_ */
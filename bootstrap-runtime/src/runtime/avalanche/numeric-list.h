@@ -0,0 +1,279 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA__INTERNAL_INCLUDE
+#error "Don't include avalanche/numeric-list.h directly; just include avalanche.h"
+#endif
+
+#ifndef AVA_RUNTIME_NUMERIC_LIST_H_
+#define AVA_RUNTIME_NUMERIC_LIST_H_
+
+#include "defs.h"
+#include "list.h"
+#include "integer.h"
+#include "real.h"
+
+/**
+ * @file
+ *
+ * Provides dense lists of integers and reals, and bulk arithmetic over lists.
+ *
+ * A numeric list stores its elements as a flat array of native ava_integers or
+ * ava_reals rather than as ava_values, and boxes them only when they are read
+ * through the list trait. Large lists whose elements are all integer-typed
+ * values, or all real-typed values, are promoted to numeric lists
+ * automatically by ava_list_of_values(). A numeric list stays numeric as long
+ * as only elements of the same type are added to it; anything else silently
+ * converts it to an ordinary ESBA list.
+ *
+ * The reductions below accept any list, interpreting each element as per
+ * ava_integer_of_value() or ava_real_of_value(). Numeric lists of the matching
+ * type skip that step and run directly over their backing arrays, in loops
+ * shaped so that the compiler can vectorise them.
+ */
+
+/**
+ * The comparisons supported by ava_integer_list_select() and
+ * ava_real_list_select(). Each selects elements which compare in the stated
+ * way to the threshold.
+ */
+typedef enum {
+  /**
+   * element < threshold
+   */
+  ava_nc_slt = 0,
+  /**
+   * element <= threshold
+   */
+  ava_nc_leq,
+  /**
+   * element > threshold
+   */
+  ava_nc_sgt,
+  /**
+   * element >= threshold
+   */
+  ava_nc_geq,
+  /**
+   * element == threshold
+   */
+  ava_nc_equ,
+  /**
+   * element != threshold
+   */
+  ava_nc_neq
+} ava_numeric_comparison;
+
+/**
+ * Describes an integer operation which overflowed within a bulk integer
+ * operation, so that the caller can report it in the same terms as the scalar
+ * operation would have.
+ */
+typedef struct {
+  /**
+   * The left operand.
+   */
+  ava_integer a;
+  /**
+   * The operator, eg, "+".
+   */
+  const char* op;
+  /**
+   * The right operand.
+   */
+  ava_integer b;
+} ava_integer_overflow;
+
+/**
+ * Returns a numeric list containing the given integers.
+ *
+ * The array is copied, not referenced. If count is zero, the empty list is
+ * returned.
+ */
+ava_list_value ava_integer_list_of_array(
+  const ava_integer*restrict array, size_t count);
+
+/**
+ * Returns a numeric list containing the given reals.
+ *
+ * The array is copied, not referenced. If count is zero, the empty list is
+ * returned.
+ */
+ava_list_value ava_real_list_of_array(
+  const ava_real*restrict array, size_t count);
+
+/**
+ * Returns whether the given list is a dense numeric list of integers.
+ */
+ava_bool ava_list_is_integer_list(ava_list_value list) AVA_PURE;
+
+/**
+ * Returns whether the given list is a dense numeric list of reals.
+ */
+ava_bool ava_list_is_real_list(ava_list_value list) AVA_PURE;
+
+/**
+ * Computes the sum of the integers in the given list.
+ *
+ * Empty elements count as zero. The sum is computed exactly; intermediate
+ * values never overflow, regardless of the order of the elements.
+ *
+ * @param dst Set to the sum. If the sum does not fit in an ava_integer, it
+ * wraps around.
+ * @param overflow If the sum does not fit in an ava_integer, set to the first
+ * addition which overflows in a left-to-right summation of the list.
+ * @param list The list to sum.
+ * @return Whether the sum fit in an ava_integer.
+ * @throws ava_format_exception if any element is not an integer.
+ */
+ava_bool ava_integer_list_sum(ava_integer*restrict dst,
+                              ava_integer_overflow*restrict overflow,
+                              ava_list_value list);
+
+/**
+ * Computes the minimum of the integers in the given list.
+ *
+ * Empty elements count as zero.
+ *
+ * @param dst Set to the minimum if the list is non-empty.
+ * @param list The list to examine.
+ * @return Whether the list was non-empty.
+ * @throws ava_format_exception if any element is not an integer.
+ */
+ava_bool ava_integer_list_min(ava_integer*restrict dst,
+                              ava_list_value list);
+
+/**
+ * Like ava_integer_list_min(), but computes the maximum.
+ */
+ava_bool ava_integer_list_max(ava_integer*restrict dst,
+                              ava_list_value list);
+
+/**
+ * Computes the dot product of two integer lists of equal length.
+ *
+ * Empty elements count as zero. Unlike ava_integer_list_sum(), the
+ * accumulation is performed left-to-right and overflow is detected at each
+ * step.
+ *
+ * @param dst Set to the dot product, wrapping around on overflow.
+ * @param overflow On overflow, set to the first operation which overflowed.
+ * @param a The left list.
+ * @param b The right list. Behaviour is undefined if it does not have the same
+ * length as a.
+ * @return Whether the computation completed without overflow.
+ * @throws ava_format_exception if any element is not an integer.
+ */
+ava_bool ava_integer_list_dot(ava_integer*restrict dst,
+                              ava_integer_overflow*restrict overflow,
+                              ava_list_value a, ava_list_value b);
+
+/**
+ * Multiplies every integer in the given list by factor.
+ *
+ * Empty elements count as zero.
+ *
+ * @param dst Set to a numeric list containing the products, wrapping around on
+ * overflow.
+ * @param overflow On overflow, set to the first multiplication which
+ * overflowed.
+ * @param list The list to scale.
+ * @param factor The value by which to multiply each element.
+ * @return Whether every multiplication completed without overflow.
+ * @throws ava_format_exception if any element is not an integer.
+ */
+ava_bool ava_integer_list_scale(ava_list_value*restrict dst,
+                                ava_integer_overflow*restrict overflow,
+                                ava_list_value list, ava_integer factor);
+
+/**
+ * Returns a list of the elements of the given list which, when interpreted as
+ * integers, compare to threshold as indicated by cmp, in their original order.
+ *
+ * Empty elements count as zero. If list is an integer numeric list, so is the
+ * result; otherwise, the result contains the original element values.
+ *
+ * @throws ava_format_exception if any element is not an integer.
+ */
+ava_list_value ava_integer_list_select(
+  ava_list_value list, ava_numeric_comparison cmp, ava_integer threshold);
+
+/**
+ * Computes the sum of the reals in the given list.
+ *
+ * Empty elements count as zero. The list is summed in several interleaved
+ * partial sums which are combined at the end, so the result may differ in the
+ * last few bits from a strict left-to-right summation. The result is however
+ * deterministic for a given list.
+ *
+ * @throws ava_format_exception if any element is not a real.
+ */
+ava_real ava_real_list_sum(ava_list_value list);
+
+/**
+ * Computes the minimum of the reals in the given list, ignoring NaNs, in the
+ * same manner as fmin(3).
+ *
+ * Empty elements count as positive infinity, which is also the result if the
+ * list is empty.
+ *
+ * @throws ava_format_exception if any element is not a real.
+ */
+ava_real ava_real_list_min(ava_list_value list);
+
+/**
+ * Computes the maximum of the reals in the given list, ignoring NaNs, in the
+ * same manner as fmax(3).
+ *
+ * Empty elements count as negative infinity, which is also the result if the
+ * list is empty.
+ *
+ * @throws ava_format_exception if any element is not a real.
+ */
+ava_real ava_real_list_max(ava_list_value list);
+
+/**
+ * Computes the dot product of two real lists of equal length.
+ *
+ * Empty elements count as zero. As with ava_real_list_sum(), the products are
+ * accumulated in several interleaved partial sums.
+ *
+ * Behaviour is undefined if the lists are not of the same length.
+ *
+ * @throws ava_format_exception if any element is not a real.
+ */
+ava_real ava_real_list_dot(ava_list_value a, ava_list_value b);
+
+/**
+ * Returns a real numeric list containing every real in the given list
+ * multiplied by factor.
+ *
+ * Empty elements count as zero.
+ *
+ * @throws ava_format_exception if any element is not a real.
+ */
+ava_list_value ava_real_list_scale(ava_list_value list, ava_real factor);
+
+/**
+ * Like ava_integer_list_select(), but interprets elements as reals. Empty
+ * elements count as zero.
+ *
+ * As with the scalar comparison operators, a NaN element compares unequal to
+ * everything, including itself.
+ */
+ava_list_value ava_real_list_select(
+  ava_list_value list, ava_numeric_comparison cmp, ava_real threshold);
+
+#endif /* AVA_RUNTIME_NUMERIC_LIST_H_ */
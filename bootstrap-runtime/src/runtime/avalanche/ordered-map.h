@@ -0,0 +1,124 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef AVA__INTERNAL_INCLUDE
+#error "Don't include avalanche/ordered-map.h directly; just include avalanche.h"
+#endif
+
+#ifndef AVA_RUNTIME_ORDERED_MAP_H_
+#define AVA_RUNTIME_ORDERED_MAP_H_
+
+#include "defs.h"
+#include "value.h"
+#include "list.h"
+#include "map.h"
+
+/**
+ * @file
+ *
+ * Provides access to the pairs of a map in order of their keys.
+ *
+ * The key order of a map sorts its pairs by key, as per ava_value_strcmp();
+ * pairs with equal keys stay in the order they have in the map. The position
+ * of a pair within the key order is called its ordinal. The key order is only
+ * a view; the map itself, and its string form, keep the pairs in their
+ * original order.
+ *
+ * Ordered maps, as returned by ava_ordered_map_of(), keep an index of their
+ * keys in key order, so that the functions below cost O(log n) on them, plus
+ * the size of any result. Maps derived from an ordered map by the map
+ * operations (add, set, remove) are themselves ordered maps. The functions
+ * below accept any map, but must build the index from scratch on each call
+ * if the map is not already ordered, at a cost of O(n log n).
+ */
+
+/**
+ * Returns an ordered map with the same pairs, in the same order, as the given
+ * map.
+ *
+ * If map is already an ordered map, it is returned unchanged.
+ *
+ * Complexity: O(n log n)
+ */
+ava_map_value ava_ordered_map_of(ava_map_value map);
+
+/**
+ * Returns whether the given map is an ordered map, ie, one which can answer
+ * the other functions in this file without building an index.
+ */
+ava_bool ava_map_is_ordered(ava_map_value map) AVA_PURE;
+
+/**
+ * Returns the ordinal of the first pair in the key order of the given map
+ * whose key is not less than the given key.
+ *
+ * @return The ordinal of the first pair with a key greater than or equal to
+ * key, or the number of pairs in the map if there is no such pair.
+ */
+size_t ava_ordered_map_lower_bound(ava_map_value map, ava_value key);
+
+/**
+ * Returns the ordinal of the first pair in the key order of the given map
+ * whose key is greater than the given key.
+ *
+ * The difference between the upper and lower bounds of a key is the number of
+ * pairs with that key.
+ *
+ * @return The ordinal of the first pair with a key greater than key, or the
+ * number of pairs in the map if there is no such pair.
+ */
+size_t ava_ordered_map_upper_bound(ava_map_value map, ava_value key);
+
+/**
+ * Returns a cursor to the pair with the given ordinal in the key order of the
+ * given ordered map.
+ *
+ * Behaviour is undefined if map is not an ordered map, or if ordinal is not
+ * less than the number of pairs in the map.
+ *
+ * @return A cursor which may be used with the map trait methods on map.
+ */
+ava_map_cursor ava_ordered_map_cursor_at(ava_map_value map, size_t ordinal);
+
+/**
+ * Returns the pairs of the given map between the two ordinals, in key order.
+ *
+ * Behaviour is undefined if end is less than begin, or greater than the
+ * number of pairs in the map.
+ *
+ * @param map The map from which to extract pairs.
+ * @param begin The ordinal of the first pair to extract.
+ * @param end The ordinal one past the last pair to extract.
+ * @return A list of alternating keys and values holding each pair whose
+ * ordinal is at least begin and less than end, in key order.
+ */
+ava_list_value ava_ordered_map_slice(ava_map_value map,
+                                     size_t begin, size_t end);
+
+/**
+ * Returns the pairs of the given map whose keys lie between two keys,
+ * inclusive, in key order.
+ *
+ * This is equivalent to slicing map from the lower bound of from to the upper
+ * bound of to, except that it returns an empty list if to is less than from.
+ *
+ * @return A list of alternating keys and values holding each pair whose key
+ * is greater than or equal to from and less than or equal to to, in key
+ * order.
+ */
+ava_list_value ava_ordered_map_range(ava_map_value map,
+                                     ava_value from, ava_value to);
+
+#endif /* AVA_RUNTIME_ORDERED_MAP_H_ */
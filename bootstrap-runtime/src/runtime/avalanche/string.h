@@ -55,6 +55,18 @@ typedef ava_ulong ava_str_tmpbuff[2] AVA_STR_ALIGN;
  * which are extremely common.
  */
 typedef ava_ulong ava_ascii9_string;
+/**
+ * A string of 1 to 7 arbitrary bytes packed into a 64-bit integer. Bit 0 is
+ * always 0 and bit 1 is always 1; bits 2..4 hold the length of the string,
+ * and bits 5..7 are zero. Bits 8..15 are the first byte, bits 16..23 the
+ * second, and so on; all bits beyond the last byte are zero.
+ *
+ * This is used for short strings which cannot be represented as ASCII9 (eg,
+ * because they contain NULs or bytes outside the 7-bit range), which are
+ * otherwise common enough that allocating a twine for each would be wasteful.
+ * No string which can be represented as ASCII9 is ever encoded as BIN7.
+ */
+typedef ava_ulong ava_bin7_string;
 /**
  * An arbitrary byte string of any number of characters. The exact internal
  * format is unspecified.
@@ -64,9 +76,11 @@ typedef struct ava_twine_s ava_twine;
 /**
  * The primary Avalanche string type.
  *
- * The encoding of the string can be identified by testing bit 0 of the ascii9
- * field; if it is zero, the string is a twine or absent. If it is 1, the
- * string is an ascii9 string.
+ * The encoding of the string can be identified by testing the low two bits of
+ * the ascii9 field. If bit 0 is 1, the string is an ascii9 string. Otherwise,
+ * if bit 1 is 1, the string is a bin7 string; if both are zero, the string is
+ * a twine or absent. (Twines are always aligned, so a pointer never has either
+ * bit set.)
  *
  * A string is said to be "absent" if the ascii9 field identifies the string as
  * a twine and the twine field is NULL.
@@ -259,7 +273,7 @@ static inline ava_bool ava_string_is_present(ava_string str) {
 static inline ava_bool ava_string_is_empty(ava_string str) AVA_PURE;
 static inline ava_bool ava_string_is_empty(ava_string str) {
   return 1 == str.ascii9 ||
-    (0 == (str.ascii9 & 1) && 0 == str.twine->length);
+    (0 == (str.ascii9 & 3) && 0 == str.twine->length);
 }
 
 /**
@@ -281,6 +295,54 @@ ava_string ava_string_of_char(char) AVA_PURE;
  * buffer after creation, so the buffer need not be GC-managed or immutable.
  */
 ava_string ava_string_of_bytes(const char*, size_t) AVA_PURE;
+/**
+ * Returns the canonical instance of the given string.
+ *
+ * All live interned strings with the same content are the same object, so
+ * ava_string_equal() and ava_strcmp() can compare them by pointer. The
+ * interning table holds its strings only weakly; an interned string which
+ * becomes unreachable is collected as usual.
+ *
+ * Interning costs a hash table lookup (and, the first time any given content
+ * is seen, a copy), so it is only worthwhile for strings which are retained
+ * in large numbers or compared often. ASCII9 and BIN7 strings are returned
+ * unchanged, since they are already compared by value.
+ *
+ * This function is thread-safe.
+ */
+ava_string ava_string_intern(ava_string str);
+/**
+ * Equivalent to ava_string_intern(ava_string_of_bytes(str, sz)), but does not
+ * allocate a temporary copy of the string if it is already interned.
+ */
+ava_string ava_string_of_bytes_interned(const char* str, size_t sz);
+/**
+ * Equivalent to ava_string_of_bytes_interned(str, strlen(str)).
+ */
+ava_string ava_string_of_cstring_interned(const char* str);
+/**
+ * Returns an ava_string whose contents are that of the file at the given
+ * path.
+ *
+ * Large regular files are mapped into memory read-only rather than being
+ * read, so this takes constant time and only the parts of the file actually
+ * accessed are ever loaded. Forcing the string does not copy it;
+ * ava_string_to_cstring() returns a pointer into the mapping.
+ *
+ * Since such pointers may outlive the string, the mapping is never released,
+ * so this is best suited to files which are read once and kept for most of
+ * the life of the process, such as source files. Behaviour is undefined if
+ * the file is truncated while mapped, and other modifications to the file may
+ * or may not be visible through the string, so this should only be used with
+ * files not expected to change.
+ *
+ * Other files are read in their entirety.
+ *
+ * @param path The path of the file to read.
+ * @return The contents of the file, or the absent string with errno set if
+ * the file could not be opened or read.
+ */
+ava_string ava_string_of_mmap(const char* path);
 /**
  * Returns a GC-managed C string which holds the string contents of the given
  * ava_string. No special handling of embedded NUL characters occurs.
@@ -320,6 +382,19 @@ const char* ava_string_to_cstring_buff(ava_str_tmpbuff tmp,
 void ava_string_to_bytes(void*restrict dst, ava_string str,
                          size_t start, size_t end);
 
+/**
+ * Returns the longest substring of str beginning at *offset which can be
+ * obtained without flattening str, and advances *offset to the end of that
+ * substring. Returns the absent string once *offset reaches the end of str.
+ *
+ * This permits sequential access to very large strings (such as those built
+ * up by many concatenations) without producing a contiguous copy of the whole
+ * string. For most strings, the first chunk is simply the whole string.
+ *
+ * Complexity: O(log(n)) per chunk
+ */
+ava_string ava_string_next_chunk(ava_string str, size_t*restrict offset);
+
 /**
  * Returns the length, in bytes, of the given string.
  *
@@ -332,7 +407,8 @@ size_t ava_strlen(ava_string str) AVA_PURE;
  * Behaviour is undefined if the index is greater than or equal to the length
  * of the string.
  *
- * Complexity: Amortised voluminous O(1)
+ * Complexity: Amortised voluminous O(1); O(log(n)) for large strings built by
+ * concatenation, which are not flattened by this call.
  */
 char ava_string_index(ava_string str, size_t ix) AVA_PURE;
 /**
@@ -342,7 +418,8 @@ char ava_string_index(ava_string str, size_t ix) AVA_PURE;
  * Behaviour is undefined if begin > end or if either index is greater than the
  * length of the string.
  *
- * Complexity: Amortized O(1)
+ * Complexity: Amortized O(1); O(log(n)) for large strings built by
+ * concatenation.
  */
 ava_string ava_string_slice(ava_string, size_t begin, size_t end) AVA_PURE;
 /**
@@ -365,6 +442,56 @@ ava_string ava_string_behead(ava_string str, size_t begin) AVA_PURE;
  */
 ava_string ava_strcat(ava_string left, ava_string right) AVA_PURE;
 
+/**
+ * Accumulates a string from many pieces in a single flat buffer.
+ *
+ * ava_strcat() is amortised O(1), but a long chain of concatenations still
+ * builds a tree of nodes which must be traversed and eventually forced. When
+ * a string is built up by a large number of appends and only used once
+ * complete, a string builder is cheaper: it appends directly into a buffer
+ * which grows geometrically, and ava_string_builder_finish() usually turns
+ * that buffer into the resulting string without copying.
+ *
+ * The fields of this structure are internal. A builder must be initialised
+ * with ava_string_builder_init() before use. It is not thread-safe.
+ */
+typedef struct {
+  char*restrict buffer;
+  size_t length, capacity;
+} ava_string_builder;
+
+/**
+ * Initialises the given string builder to be empty.
+ *
+ * @param capacity The expected final length of the string, or 0 if
+ * unknown. This is only a hint; the builder grows as necessary.
+ */
+void ava_string_builder_init(ava_string_builder*restrict builder,
+                             size_t capacity);
+/**
+ * Appends the first sz bytes of data to the given builder.
+ */
+void ava_string_builder_append_bytes(ava_string_builder*restrict builder,
+                                     const void*restrict data, size_t sz);
+/**
+ * Appends the contents of str to the given builder.
+ *
+ * Large strings built by concatenation are copied without flattening them.
+ */
+void ava_string_builder_append_string(ava_string_builder*restrict builder,
+                                      ava_string str);
+/**
+ * Appends the decimal representation of the given integer to the given
+ * builder.
+ */
+void ava_string_builder_append_integer(ava_string_builder*restrict builder,
+                                       ava_slong i);
+/**
+ * Returns the string accumulated by the given builder, as a single flat
+ * string, and resets the builder to be empty.
+ */
+ava_string ava_string_builder_finish(ava_string_builder*restrict builder);
+
 /**
  * Returns a 32-bit hash of the given ASCII9 string.
  *
@@ -421,6 +548,14 @@ ava_bool ava_string_equal(ava_string a, ava_string b) AVA_PURE;
  */
 ava_ascii9_string ava_string_to_ascii9(ava_string str) AVA_PURE;
 
+/**
+ * Returns an ava_bin7_string representing the given string if it is possible
+ * to represent the string in that format; otherwise, returns 0.
+ *
+ * Strings which can be represented as ASCII9 are never representable as BIN7.
+ */
+ava_bin7_string ava_string_to_bin7(ava_string str) AVA_PURE;
+
 /**
  * Returns the index of the first character which is equal in the two given
  * ASCII9 strings, treating each string as if it were exactly 9 characters long
@@ -441,6 +576,64 @@ ssize_t ava_ascii9_index_of_match(ava_ascii9_string haystack,
  */
 ssize_t ava_strchr(ava_string haystack, char needle) AVA_PURE;
 
+/**
+ * Returns the index of the first occurrence of the string needle within
+ * haystack, or -1 if there is no such occurrence.
+ *
+ * An empty needle occurs at index 0 of every string.
+ *
+ * Equivalent to ava_string_index_of(haystack, needle, 0).
+ */
+ssize_t ava_strstr(ava_string haystack, ava_string needle) AVA_PURE;
+
+/**
+ * Returns the index of the first occurrence of the string needle within
+ * haystack which begins at or after index from, or -1 if there is no such
+ * occurrence.
+ *
+ * An empty needle occurs at every index up to and including the length of
+ * haystack. If from is greater than the length of haystack, returns -1.
+ */
+ssize_t ava_string_index_of(ava_string haystack, ava_string needle,
+                            size_t from) AVA_PURE;
+
+/**
+ * Returns whether every character in the given string is within the 7-bit
+ * ASCII range.
+ *
+ * The result is cached on heap-allocated flat strings, so repeated queries
+ * take constant time.
+ */
+ava_bool ava_string_is_ascii(ava_string str) AVA_PURE;
+
+/**
+ * Returns whether the given string is well-formed UTF-8.
+ *
+ * Overlong encodings, encoded surrogates, code points beyond U+10FFFF, and
+ * truncated sequences are all rejected. The result is cached as with
+ * ava_string_is_ascii().
+ */
+ava_bool ava_string_is_utf8(ava_string str) AVA_PURE;
+
+/**
+ * Returns the number of code points in the given string, interpreted as
+ * UTF-8.
+ *
+ * This is the number of bytes which are not continuation bytes (10xxxxxx), so
+ * the result is well-defined even if the string is not valid UTF-8. The
+ * result is cached as with ava_string_is_ascii().
+ */
+size_t ava_string_utf8_length(ava_string str) AVA_PURE;
+
+/**
+ * Returns the byte offset within the given string of the code point at index
+ * cp, as counted by ava_string_utf8_length().
+ *
+ * If cp is equal to the number of code points, returns the length of the
+ * string. If it is greater, returns -1.
+ */
+ssize_t ava_string_utf8_offset(ava_string str, size_t cp) AVA_PURE;
+
 /**
  * Returns whether the given string is an ASCII9 string.
  */
@@ -448,6 +641,21 @@ static inline ava_bool ava_string_is_ascii9(ava_string str) {
   return str.ascii9 & 1;
 }
 
+/**
+ * Returns whether the given string is a BIN7 string.
+ */
+static inline ava_bool ava_string_is_bin7(ava_string str) {
+  return 2 == (str.ascii9 & 3);
+}
+
+/**
+ * Returns whether the given string is stored inline in the ava_string itself
+ * (ie, is an ASCII9 or BIN7 string) rather than being a twine.
+ */
+static inline ava_bool ava_string_is_inline(ava_string str) {
+  return str.ascii9 & 3;
+}
+
 /**
  * Like ava_strchr(), but faster when needle is a character literal.
  *
@@ -373,6 +373,175 @@ const void* ava_get_attribute(
 #define AVA_GET_ATTRIBUTE(value, type) \
   ((const type*restrict)ava_get_attribute((value), &type##_tag))
 
+/**
+ * The number of distinct attribute chains an ava_attribute_cache can
+ * remember.
+ */
+#define AVA_ATTRIBUTE_CACHE_WAYS 4
+
+/**
+ * A polymorphic inline cache for ava_get_attribute_cached().
+ *
+ * Each call site that performs the same attribute lookup repeatedly (such as
+ * the trait method wrappers) declares one of these with static storage
+ * duration; zero-initialisation produces an empty cache.
+ *
+ * The cache is keyed on the tail of the attribute chain (ie, the second
+ * attribute) rather than on the head, since most heap-allocated types place a
+ * per-instance header attribute at the head of their chain which is followed
+ * by a static chain shared by every instance of the type. Attribute chains are
+ * immutable, so the tail alone determines the result of any lookup that does
+ * not match the head itself.
+ *
+ * Entries are published under a sequence lock, so caches may be shared freely
+ * between threads.
+ *
+ * All fields are internal, except that hits and misses may be read (racily)
+ * for diagnostic purposes.
+ */
+typedef struct ava_attribute_cache_s {
+  /**
+   * Sequence counter. Odd while an entry is being replaced; incremented by
+   * two for every completed replacement.
+   */
+  size_t version;
+  /**
+   * The attribute chain tails for which results are known. NULL indicates an
+   * empty entry.
+   */
+  const ava_attribute* keys[AVA_ATTRIBUTE_CACHE_WAYS];
+  /**
+   * The lookup result corresponding to each element of keys.
+   */
+  const void* values[AVA_ATTRIBUTE_CACHE_WAYS];
+  /**
+   * The number of lookups answered by the cache. Updated without
+   * synchronisation, so may undercount under contention.
+   *
+   * Only maintained if the runtime was configured with
+   * --enable-attribute-cache-stats (which defines AVA_ATTRIBUTE_CACHE_STATS),
+   * since otherwise every hit would write to a cache line shared by every
+   * thread using the site; always zero otherwise.
+   */
+  size_t hits;
+  /**
+   * The number of lookups which had to walk the attribute chain.
+   */
+  size_t misses;
+  /**
+   * Whether this cache has been added to the global cache list.
+   */
+  size_t registered;
+  /**
+   * The next cache in the global cache list.
+   */
+  struct ava_attribute_cache_s* next;
+} ava_attribute_cache;
+
+/**
+ * Aggregate statistics over every ava_attribute_cache that has been used.
+ *
+ * @see ava_attribute_cache_get_stats()
+ */
+typedef struct {
+  /**
+   * The sum of ava_attribute_cache.hits over all caches. Always zero unless
+   * AVA_ATTRIBUTE_CACHE_STATS is defined.
+   */
+  ava_ulong hits;
+  /**
+   * The sum of ava_attribute_cache.misses over all caches.
+   */
+  ava_ulong misses;
+  /**
+   * The number of caches which have been used at least once.
+   */
+  ava_ulong sites;
+  /**
+   * The number of caches which have stopped accepting new entries because
+   * they have seen too many distinct attribute chains.
+   */
+  ava_ulong megamorphic_sites;
+} ava_attribute_cache_stats;
+
+/**
+ * Slow path of ava_get_attribute_cached(). Do not call directly.
+ */
+const void* ava_get_attribute_cache_miss(
+  const ava_attribute*restrict tail,
+  const ava_attribute_tag*restrict tag,
+  ava_attribute_cache*restrict cache);
+
+/**
+ * Equivalent to ava_get_attribute(), but consults and updates the given
+ * inline cache so that repeated lookups on values sharing an attribute chain
+ * reduce to a single pointer comparison.
+ *
+ * A cache must only ever be used with one tag.
+ *
+ * @param value The value whose attribute chain is to be searched.
+ * @param tag The tag of the desired attribute.
+ * @param cache The inline cache for the calling site.
+ * @return The first attribute on value with the given tag, or NULL if there is
+ * none.
+ */
+static inline const void* ava_get_attribute_cached(
+  ava_value value, const ava_attribute_tag*restrict tag,
+  ava_attribute_cache*restrict cache
+) {
+  const ava_attribute*restrict head =
+    (const ava_attribute*)ava_value_attr(value);
+  const ava_attribute* tail;
+  const void* result;
+  size_t version;
+  unsigned i;
+
+  if (head->tag == tag)
+    return head;
+
+  tail = head->next;
+  if (!tail)
+    return NULL;
+
+  version = __atomic_load_n(&cache->version, __ATOMIC_ACQUIRE);
+  for (i = 0; i < AVA_ATTRIBUTE_CACHE_WAYS; ++i) {
+    if (tail == __atomic_load_n(&cache->keys[i], __ATOMIC_RELAXED)) {
+      result = __atomic_load_n(&cache->values[i], __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (AVA_LIKELY(!(version & 1) &&
+                     version == __atomic_load_n(
+                       &cache->version, __ATOMIC_RELAXED))) {
+#ifdef AVA_ATTRIBUTE_CACHE_STATS
+        __atomic_store_n(&cache->hits,
+                         __atomic_load_n(&cache->hits, __ATOMIC_RELAXED) + 1,
+                         __ATOMIC_RELAXED);
+#endif
+        return result;
+      }
+
+      break;
+    }
+  }
+
+  return ava_get_attribute_cache_miss(tail, tag, cache);
+}
+
+/**
+ * Like AVA_GET_ATTRIBUTE(), but uses ava_get_attribute_cached() with the
+ * given cache.
+ */
+#define AVA_GET_ATTRIBUTE_CACHED(value, type, cache)                    \
+  ((const type*restrict)ava_get_attribute_cached(                      \
+    (value), &type##_tag, (cache)))
+
+/**
+ * Sums the statistics of every attribute cache used so far in the process.
+ *
+ * The result is approximate if other threads are concurrently performing
+ * lookups.
+ */
+void ava_attribute_cache_get_stats(ava_attribute_cache_stats* dst);
+
 /**
  * Converts the given value into a monolithic string.
  *
@@ -499,6 +668,57 @@ ava_bool ava_value_equal(ava_value a, ava_value b) AVA_PURE;
  */
 ava_ulong ava_value_hash(ava_value value) AVA_PURE;
 
+/**
+ * Like ava_value_hash(), but much faster, at the cost of being far less
+ * resistant to maliciously chosen values.
+ *
+ * The hash is still keyed per-process, so accidental collisions are no more
+ * likely than with ava_value_hash(); but it should only be used for values
+ * from trusted sources, or in contexts (such as hash-maps) that can fall back
+ * to ava_value_hash() when collisions become excessive.
+ *
+ * The two functions produce unrelated results for the same value.
+ */
+ava_ulong ava_value_hash_fast(ava_value value) AVA_PURE;
+
+/**
+ * Strategies for hashing values, mainly for use by hash-maps.
+ */
+typedef enum {
+  /**
+   * Use ava_value_hash(), which is SipHash and safe against hash-flooding
+   * attacks. This is the default.
+   */
+  ava_vhs_siphash = 0,
+  /**
+   * Use ava_value_hash_fast(), suitable for trusted data.
+   */
+  ava_vhs_fast
+} ava_value_hash_strategy;
+
+/**
+ * Hashes the given value with the function identified by the given
+ * strategy.
+ */
+ava_ulong ava_value_hash_with_strategy(
+  ava_value value, ava_value_hash_strategy strategy) AVA_PURE;
+
+/**
+ * Sets the strategy used by hash-maps constructed without an explicit
+ * strategy.
+ *
+ * This is intended to be called once, immediately after ava_init(), by
+ * programs which know they never handle untrusted data. Changing the default
+ * later only affects maps constructed after the change.
+ */
+void ava_value_hash_set_default_strategy(ava_value_hash_strategy strategy);
+
+/**
+ * Returns the strategy last passed to ava_value_hash_set_default_strategy(),
+ * or ava_vhs_siphash if it has never been called.
+ */
+ava_value_hash_strategy ava_value_hash_get_default_strategy(void);
+
 /**
  * Like ava_value_hash(), except that any two processes on the same platform
  * will produce the same hashes for the same values.
@@ -23,6 +23,9 @@
  */
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <math.h>
 #include <limits.h>
 
@@ -34,7 +37,11 @@ AVA_BEGIN_DECLS
 #include "avalanche/value.h"
 #include "avalanche/list.h"
 #include "avalanche/list-proj.h"
+#include "avalanche/list-sort.h"
+#include "avalanche/function.h"
+#include "avalanche/numeric-list.h"
 #include "avalanche/map.h"
+#include "avalanche/ordered-map.h"
 #include "avalanche/integer.h"
 #include "avalanche/real.h"
 #include "avalanche/pointer.h"
@@ -256,6 +263,91 @@ defun(byte_string__index_lenient)(ava_value str, ava_value index) {
   return ava_value_of_string(ret);
 }
 
+defun(byte_string__intern)(ava_value str) {
+  return ava_value_of_string(ava_string_intern(ava_to_string(str)));
+}
+
+defun(byte_string__is_ascii)(ava_value str) {
+  return ava_value_of_integer(ava_string_is_ascii(ava_to_string(str)));
+}
+
+defun(byte_string__is_utf8)(ava_value str) {
+  return ava_value_of_integer(ava_string_is_utf8(ava_to_string(str)));
+}
+
+defun(byte_string__utf8_length)(ava_value str) {
+  return ava_value_of_integer(ava_string_utf8_length(ava_to_string(str)));
+}
+
+defun(byte_string__utf8_offset)(ava_value str, ava_value cp) {
+  ava_string s;
+  ava_integer ix;
+
+  s = ava_to_string(str);
+  ix = ava_integer_of_value(cp, 0);
+  strict_index_check(ix, ava_string_utf8_length(s) + 1);
+  return ava_value_of_integer(ava_string_utf8_offset(s, ix));
+}
+
+#ifndef COMPILING_DRIVER
+defun(byte_string__read_file)(ava_value path) {
+  AVA_STATIC_STRING(io_error, "io-error");
+  ava_string path_str, content;
+
+  path_str = ava_to_string(path);
+  content = ava_string_of_mmap(ava_string_to_cstring(path_str));
+  if (!ava_string_is_present(content))
+    ava_throw_uex(&ava_user_exception, io_error,
+                  ava_error_file_read_failed(
+                    path_str, ava_string_of_cstring(strerror(errno))));
+
+  return ava_value_of_string(content);
+}
+
+defun(byte_string__write_file)(ava_value path, ava_value content) {
+  AVA_STATIC_STRING(io_error, "io-error");
+  ava_string path_str, chunk, piece;
+  ava_str_tmpbuff tmp;
+  ava_datum it;
+  size_t offset, length;
+  FILE* out;
+  int error;
+
+  path_str = ava_to_string(path);
+  out = fopen(ava_string_to_cstring(path_str), "wb");
+  if (!out) goto fail;
+
+  /* Write the content a chunk at a time, so that huge values such as long
+   * lists are never materialised as a single string.
+   */
+  it = ava_string_chunk_iterator(content);
+  while (ava_string_is_present(
+           (chunk = ava_iterate_string_chunk(&it, content)))) {
+    offset = 0;
+    while (ava_string_is_present(
+             (piece = ava_string_next_chunk(chunk, &offset)))) {
+      length = ava_strlen(piece);
+      if (length != fwrite(ava_string_to_cstring_buff(tmp, piece),
+                           1, length, out)) {
+        error = errno;
+        fclose(out);
+        errno = error;
+        goto fail;
+      }
+    }
+  }
+
+  if (fclose(out)) goto fail;
+
+  return ava_value_of_string(AVA_EMPTY_STRING);
+
+  fail:
+  ava_throw_uex(&ava_user_exception, io_error,
+                ava_error_file_write_failed(
+                  path_str, ava_string_of_cstring(strerror(errno))));
+}
+#endif
+
 /******************** INTEGER OPERATIONS ********************/
 
 defun(integer__add)(ava_value a, ava_value b) {
@@ -866,6 +958,46 @@ size_t fun(map__count_impl)(ava_map_value map, ava_value key) {
 }
 #endif
 
+defun(map__ordered)(ava_value map) {
+  return ava_ordered_map_of(ava_map_value_of(map)).v;
+}
+
+defun(map__lower_bound)(ava_value map, ava_value key) {
+  return ava_value_of_integer(
+    ava_ordered_map_lower_bound(ava_map_value_of(map), key));
+}
+
+defun(map__upper_bound)(ava_value map, ava_value key) {
+  return ava_value_of_integer(
+    ava_ordered_map_upper_bound(ava_map_value_of(map), key));
+}
+
+defun(map__range)(ava_value map, ava_value from, ava_value to) {
+  return ava_ordered_map_range(ava_map_value_of(map), from, to).v;
+}
+
+defun(map__ordered_slice)(ava_value raw_map, ava_value index) {
+  ava_map_value map;
+  ava_integer max, begin, end;
+  ava_interval_value ival;
+
+  map = ava_map_value_of(raw_map);
+  max = ava_map_npairs_f(map);
+
+  ival = ava_interval_value_of(index);
+  if (ava_interval_is_singular(ival)) {
+    begin = ava_interval_get_singular(ival, max);
+    strict_index_check(begin, max);
+    end = begin + 1;
+  } else {
+    begin = ava_interval_get_begin(ival, max);
+    end = ava_interval_get_end(ival, max);
+    strict_range_check(begin, end, max);
+  }
+
+  return ava_ordered_map_slice(map, begin, end).v;
+}
+
 defun(interval__of)(ava_value begin, ava_value end) {
   return ava_interval_value_of_range(
     ava_integer_of_value(begin, 0),
@@ -993,6 +1125,10 @@ defun(list__demux)
 (ava_value list, ava_value offset, ava_value stride);
 defun(list__group)
 (ava_value list, ava_value group_size);
+defun(list__zip)
+(ava_value lists);
+defun(list__range)
+(ava_value begin, ava_value end, ava_value step);
 
 #ifndef COMPILING_DRIVER
 defun(list__interleave)(ava_value raw_lists) {
@@ -1053,12 +1189,220 @@ defun(list__group)(ava_value list, ava_value raw_group_size) {
 
   return ava_list_proj_group(ava_list_value_of(list), group_size).v;
 }
+
+defun(list__zip)(ava_value raw_lists) {
+  ava_list_value* array, on_stack[16];
+  ava_list_value lists = ava_list_value_of(raw_lists);
+  size_t num_lists = ava_list_length_f(lists), i;
+
+  array = num_lists < 16? on_stack :
+    (ava_list_value*)ava_alloc(sizeof(ava_list_value) * num_lists);
+
+  for (i = 0; i < num_lists; ++i)
+    array[i] = ava_list_value_of(ava_list_index_f(lists, i));
+
+  return ava_list_proj_zip(array, num_lists).v;
+}
+
+defun(list__range)(ava_value raw_begin, ava_value raw_end,
+                   ava_value raw_step) {
+  AVA_STATIC_STRING(illegal_argument, "illegal-argument");
+  ava_integer begin, end, step;
+
+  begin = ava_integer_of_value(raw_begin, 0);
+  end = ava_integer_of_value(raw_end, 0);
+  step = ava_integer_of_value(raw_step, 1);
+
+  if (0 == step)
+    ava_throw_uex(&ava_error_exception, illegal_argument,
+                  ava_error_illegal_argument(
+                    AVA_ASCII9_STRING("step"), raw_step));
+
+  return ava_list_proj_range(begin, end, step).v;
+}
 #endif
 
+defun(list__mapped)(ava_value list, ava_value fun) {
+  return ava_list_proj_map(ava_list_value_of(list),
+                           ava_function_of_value(fun), ava_true).v;
+}
+
+defun(list__filtered)(ava_value list, ava_value predicate) {
+  return ava_list_proj_filter(ava_list_value_of(list),
+                              ava_function_of_value(predicate)).v;
+}
+
 defun(list__flatten)(ava_value list) {
   return ava_list_proj_flatten(ava_list_value_of(list)).v;
 }
 
+defun(list__sort)(ava_value list) {
+  return ava_list_sort(ava_list_value_of(list), ava_lso_lexical).v;
+}
+
+defun(list__sort_by)(ava_value list, ava_value comparator) {
+  return ava_list_sort_by(ava_list_value_of(list),
+                          ava_function_of_value(comparator)).v;
+}
+
+/******************** NUMERIC LIST OPERATIONS ********************/
+
+void fun(throw__illegal_comparison)(ava_value op) AVA_NORETURN;
+void fun(throw__numeric_lists_not_of_same_length)
+(ava_integer expected, ava_integer actual) AVA_NORETURN;
+
+#ifndef COMPILING_DRIVER
+void fun(throw__illegal_comparison)(ava_value op) {
+  AVA_STATIC_STRING(illegal_argument, "illegal-argument");
+  ava_throw_uex(&ava_error_exception, illegal_argument,
+                ava_error_illegal_argument(AVA_ASCII9_STRING("op"), op));
+}
+
+void fun(throw__numeric_lists_not_of_same_length)
+(ava_integer expected, ava_integer actual) {
+  AVA_STATIC_STRING(illegal_argument, "illegal-argument");
+  ava_throw_uex(&ava_error_exception, illegal_argument,
+                ava_error_numeric_lists_not_of_same_length(expected, actual));
+}
+#endif
+
+/**
+ * Interprets the comparison argument to the numeric list select functions,
+ * which is either the name of the scalar comparison function or the
+ * corresponding operator.
+ */
+static ava_numeric_comparison numeric_comparison_of_value(ava_value op) {
+  ava_string str = ava_to_string(op);
+
+#define CMP(name, oper, cmp)                                    \
+  if (ava_string_equal(str, AVA_ASCII9_STRING(name)) ||         \
+      ava_string_equal(str, AVA_ASCII9_STRING(oper)))           \
+    return cmp
+  CMP("slt", "<",  ava_nc_slt);
+  CMP("leq", "<=", ava_nc_leq);
+  CMP("sgt", ">",  ava_nc_sgt);
+  CMP("geq", ">=", ava_nc_geq);
+  CMP("equ", "==", ava_nc_equ);
+  CMP("neq", "!=", ava_nc_neq);
+#undef CMP
+
+  fun(throw__illegal_comparison)(op);
+}
+
+static inline void numeric_length_check(ava_list_value a, ava_list_value b) {
+  if (ava_list_length_f(a) != ava_list_length_f(b))
+    fun(throw__numeric_lists_not_of_same_length)(
+      ava_list_length_f(a), ava_list_length_f(b));
+}
+
+static inline void integer_list_overflow(
+  const ava_integer_overflow* overflow
+) {
+#if AVAST_CHECK_LEVEL >= 2
+  ava_throw_str(&ava_undefined_behaviour_exception,
+                ava_error_undef_integer_overflow(
+                  overflow->a, ava_string_of_cstring(overflow->op),
+                  overflow->b));
+#else
+  (void)overflow;
+#endif
+}
+
+defun(integer__sum)(ava_value list) {
+  ava_integer sum;
+  ava_integer_overflow overflow;
+
+  if (!ava_integer_list_sum(&sum, &overflow, ava_list_value_of(list)))
+    integer_list_overflow(&overflow);
+
+  return ava_value_of_integer(sum);
+}
+
+defun(integer__minimum)(ava_value list) {
+  ava_integer min;
+
+  if (!ava_integer_list_min(&min, ava_list_value_of(list)))
+    return ava_value_of_string(AVA_EMPTY_STRING);
+
+  return ava_value_of_integer(min);
+}
+
+defun(integer__maximum)(ava_value list) {
+  ava_integer max;
+
+  if (!ava_integer_list_max(&max, ava_list_value_of(list)))
+    return ava_value_of_string(AVA_EMPTY_STRING);
+
+  return ava_value_of_integer(max);
+}
+
+defun(integer__dot)(ava_value raw_a, ava_value raw_b) {
+  ava_list_value a = ava_list_value_of(raw_a), b = ava_list_value_of(raw_b);
+  ava_integer dot;
+  ava_integer_overflow overflow;
+
+  numeric_length_check(a, b);
+  if (!ava_integer_list_dot(&dot, &overflow, a, b))
+    integer_list_overflow(&overflow);
+
+  return ava_value_of_integer(dot);
+}
+
+defun(integer__scale)(ava_value list, ava_value factor) {
+  ava_list_value result;
+  ava_integer_overflow overflow;
+
+  if (!ava_integer_list_scale(&result, &overflow, ava_list_value_of(list),
+                              ava_integer_of_value(factor, 1)))
+    integer_list_overflow(&overflow);
+
+  return result.v;
+}
+
+defun(integer__select)(ava_value list, ava_value op, ava_value threshold) {
+  return ava_integer_list_select(
+    ava_list_value_of(list), numeric_comparison_of_value(op),
+    ava_integer_of_value(threshold, 0)).v;
+}
+
+defun(integer__sort)(ava_value list) {
+  return ava_list_sort(ava_list_value_of(list), ava_lso_integer).v;
+}
+
+defun(real__sum)(ava_value list) {
+  return ava_value_of_real(ava_real_list_sum(ava_list_value_of(list)));
+}
+
+defun(real__minimum)(ava_value list) {
+  return ava_value_of_real(ava_real_list_min(ava_list_value_of(list)));
+}
+
+defun(real__maximum)(ava_value list) {
+  return ava_value_of_real(ava_real_list_max(ava_list_value_of(list)));
+}
+
+defun(real__dot)(ava_value raw_a, ava_value raw_b) {
+  ava_list_value a = ava_list_value_of(raw_a), b = ava_list_value_of(raw_b);
+
+  numeric_length_check(a, b);
+  return ava_value_of_real(ava_real_list_dot(a, b));
+}
+
+defun(real__scale)(ava_value list, ava_value factor) {
+  return ava_real_list_scale(ava_list_value_of(list),
+                             ava_real_of_value(factor, 1.0)).v;
+}
+
+defun(real__select)(ava_value list, ava_value op, ava_value threshold) {
+  return ava_real_list_select(
+    ava_list_value_of(list), numeric_comparison_of_value(op),
+    ava_real_of_value(threshold, 0.0)).v;
+}
+
+defun(real__sort)(ava_value list) {
+  return ava_list_sort(ava_list_value_of(list), ava_lso_real).v;
+}
+
 /******************** POINTER OPERATIONS ********************/
 
 /* All pointer operations are safe; there is deliberately no exposure of ways
@@ -0,0 +1,1040 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/alloc.h"
+#include "avalanche/string.h"
+#include "avalanche/value.h"
+#include "avalanche/integer.h"
+#include "avalanche/list.h"
+#include "avalanche/map.h"
+#include "avalanche/ordered-map.h"
+#include "-btree-map.h"
+
+#define ORDER AVA_BTREE_MAP_ORDER
+#define PREFIX_BYTES sizeof(ava_ulong)
+
+/*
+
+  A B+-tree map is made of two parts: the underlying list, which holds the
+  pairs in map order exactly as it would for a list-map, and a persistent
+  B+-tree which indexes the pairs in key order.
+
+  THE TREE
+  --------
+
+  Every pair in the map has one entry in the tree, comprising its key and its
+  position (the index of the pair, which is also its cursor). Entries are
+  ordered by key, as per ava_value_strcmp(), and then by position, so every
+  entry is distinct, and pairs with equal keys are adjacent and in map order.
+
+  All entries live in the leaves, which are all at the same depth. For each of
+  its children, an internal node holds a copy of the least entry under that
+  child (its separator), the number of entries under it, and a pointer to it.
+  The subtree sizes make it cheap to convert between entries and their
+  ordinals.
+
+  Unlike most B+-trees, leaves are not linked to their siblings, since the
+  tree is persistent: a modification copies the path from the root to the
+  modified leaf and shares everything else with the original tree, which
+  would be impossible if leaves pointed to each other. Instead, a descent
+  remembers the separator just to the right of the path it takes, which is
+  the successor of the last entry in the leaf it reaches.
+
+  Adding a pair inserts its entry after every entry with an equal key, since
+  its position is greater than that of any pair already in the map, splitting
+  nodes on the way back up as usual. Removing a pair changes the position of
+  every pair after it, which would touch entries all over the tree, so the
+  tree is instead rebuilt bottom-up in one linear pass over its entries,
+  without comparing any keys. Setting a value does not touch the tree at all.
+
+  NODE LAYOUT
+  -----------
+
+  Each node holds up to ORDER entries. Comparing keys in general means
+  stringifying them and chasing pointers to their string data, so every node
+  also holds an ordering prefix for each key: the first eight bytes of its
+  string form, packed big-endian into an ava_ulong and padded with zeroes.
+  Comparing two prefixes as integers gives the same result as ava_strcmp()
+  whenever the prefixes differ. A search within a node therefore scans only
+  the prefix array, which at ORDER*8 = 64 bytes is a cache line's worth, and
+  looks at the keys themselves only when a prefix equals that of the key
+  being sought.
+
+  When it does need to compare keys, the tree uses cheaper comparisons for the
+  common cases of both keys being ASCII9 strings (comparing the encoded
+  strings as integers, as ava_strcmp() does) or both being integers
+  (comparing their decimal representations arithmetically, without
+  formatting them). These give the same results as ava_value_strcmp(), so a
+  tree may hold any mix of keys.
+
+ */
+
+typedef struct ava_btree_map_node_s ava_btree_map_node;
+
+/**
+ * An entry in the tree, or a key for which to search.
+ */
+typedef struct {
+  /**
+   * The ordering prefix of key.
+   */
+  ava_ulong prefix;
+  ava_value key;
+  /**
+   * The index of the pair in the underlying list.
+   */
+  size_t pos;
+} ava_btree_map_entry;
+
+struct ava_btree_map_node_s {
+  /**
+   * The ordering prefix of each key in this node.
+   */
+  ava_ulong prefixes[ORDER];
+  ava_value keys[ORDER];
+  size_t positions[ORDER];
+  /**
+   * The number of entries (in leaves) or children (in internal nodes).
+   */
+  unsigned count;
+  /**
+   * The distance from this node to the leaves; 0 for leaves.
+   */
+  unsigned height;
+
+  /* The remaining fields are only allocated for internal nodes. In those, the
+   * keys, positions, and prefixes above describe the least entry under each
+   * child.
+   */
+
+  /**
+   * The number of entries under each child.
+   */
+  size_t sizes[ORDER];
+  const ava_btree_map_node* children[ORDER];
+};
+
+/**
+ * A separator and child, used while rearranging internal nodes; or an entry,
+ * while rearranging leaves.
+ */
+typedef struct {
+  ava_btree_map_entry entry;
+  size_t size;
+  const ava_btree_map_node* child;
+} ava_btree_map_slot;
+
+/**
+ * The head of the attribute chain on a B+-tree map value. As with list-maps,
+ * the data element of the underlying list is stored directly on the value.
+ */
+typedef struct {
+  ava_attribute header;
+
+  /**
+   * The attribute chain of the underlying list.
+   */
+  const ava_attribute*restrict list_attr;
+
+  /**
+   * The list trait on the underlying list.
+   */
+  const ava_list_trait*restrict v;
+
+  /**
+   * The root of the tree. Never NULL; B+-tree maps are never empty.
+   */
+  const ava_btree_map_node*restrict root;
+} ava_btree_map;
+
+static const ava_attribute_tag ava_btree_map_tag = {
+  .name = "btree-map"
+};
+
+static inline const ava_btree_map* ava_btree_map_of_value(ava_value map);
+static inline ava_list_value ava_btree_map_delegate(ava_value map);
+static inline const ava_list_trait* ava_btree_map_v(ava_value map);
+static ava_map_value ava_btree_map_new(
+  ava_list_value list, const ava_btree_map_node* root);
+static ava_map_value ava_btree_map_redelegate(
+  ava_map_value this, ava_list_value new_delegate,
+  const ava_btree_map_node* new_root);
+
+static ava_ulong ava_btree_map_prefix(ava_value key);
+static signed ava_btree_map_integer_strcmp(ava_integer a, ava_integer b);
+static signed ava_btree_map_compare_keys(ava_value a, ava_value b);
+static signed ava_btree_map_compare_entries(const void* a, const void* b);
+static ava_btree_map_entry ava_btree_map_probe(ava_value key, size_t pos);
+
+static size_t ava_btree_map_node_size(const ava_btree_map_node* node);
+static unsigned ava_btree_map_node_rank(
+  const ava_btree_map_node* node, const ava_btree_map_entry* probe);
+static const ava_btree_map_node* ava_btree_map_node_of_slots(
+  unsigned height, const ava_btree_map_slot* slots, unsigned count);
+static void ava_btree_map_slot_of_entry(
+  ava_btree_map_slot* dst, const ava_btree_map_node* node, unsigned ix);
+static void ava_btree_map_slot_of_child(
+  ava_btree_map_slot* dst, const ava_btree_map_node* child);
+
+static const ava_btree_map_node* ava_btree_map_seek(
+  const ava_btree_map_node* root, const ava_btree_map_entry* probe,
+  size_t* rank, unsigned* ix);
+static const ava_btree_map_node* ava_btree_map_entry_at(
+  const ava_btree_map_node* root, size_t ordinal, unsigned* ix);
+static const ava_btree_map_node* ava_btree_map_insert(
+  const ava_btree_map_node* node, const ava_btree_map_entry* entry,
+  const ava_btree_map_node** split);
+static const ava_btree_map_node* ava_btree_map_build(
+  const ava_btree_map_entry* entries, size_t count);
+static ava_btree_map_entry* ava_btree_map_flatten(
+  ava_btree_map_entry* dst, const ava_btree_map_node* node, size_t removed);
+static ava_value* ava_btree_map_collect(
+  ava_value* dst, const ava_btree_map_node* node,
+  size_t begin, size_t end, ava_list_value list);
+
+static const ava_value_trait ava_btree_map_value_impl = {
+  .header = { .tag = &ava_value_trait_tag, .next = NULL },
+  .to_string = ava_list_to_string,
+  .string_chunk_iterator = ava_list_string_chunk_iterator,
+  .iterate_string_chunk = ava_list_iterate_string_chunk,
+};
+
+AVA_LIST_DEFIMPL(ava_btree_map, &ava_btree_map_value_impl)
+AVA_MAP_DEFIMPL(ava_btree_map, &ava_btree_map_list_impl)
+
+ava_map_value ava_btree_map_of_list(ava_list_value list) {
+  ava_btree_map_entry* entries;
+  ava_value* elements;
+  size_t n, i;
+
+  assert(0 == ava_list_length(list) % 2);
+
+  n = ava_list_length(list) / 2;
+  if (0 == n)
+    return ava_empty_map();
+
+  elements = ava_alloc(sizeof(ava_value) * 2 * n);
+  ava_list_index_range(list, 0, 2 * n, elements);
+
+  entries = ava_alloc(sizeof(ava_btree_map_entry) * n);
+  for (i = 0; i < n; ++i)
+    entries[i] = ava_btree_map_probe(elements[i*2], i);
+
+  /* Positions are distinct, so the order is total and it doesn't matter that
+   * qsort() isn't stable.
+   */
+  qsort(entries, n, sizeof(ava_btree_map_entry),
+        ava_btree_map_compare_entries);
+
+  return ava_btree_map_new(ava_list_of_values(elements, 2 * n),
+                           ava_btree_map_build(entries, n));
+}
+
+static ava_map_value ava_btree_map_new(ava_list_value list,
+                                       const ava_btree_map_node* root) {
+  const ava_list_trait*restrict trait = ava_get_attribute(
+    list.v, &ava_list_trait_tag);
+  ava_btree_map* this;
+
+  assert(trait);
+
+  this = AVA_NEW(ava_btree_map);
+  this->header.tag = &ava_btree_map_tag;
+  this->header.next = (const ava_attribute*)&ava_btree_map_map_impl;
+  this->list_attr = ava_value_attr(list.v);
+  this->v = trait;
+  this->root = root;
+
+  return (ava_map_value) {
+    ava_value_with_ulong(this, ava_value_ulong(list.v))
+  };
+}
+
+static inline const ava_btree_map* ava_btree_map_of_value(ava_value map) {
+  return (const ava_btree_map*)ava_value_attr(map);
+}
+
+static inline ava_list_value ava_btree_map_delegate(ava_value map) {
+  const ava_btree_map*restrict this = ava_btree_map_of_value(map);
+
+  return (ava_list_value) {
+    ava_value_with_ulong(this->list_attr, ava_value_ulong(map))
+  };
+}
+
+static inline const ava_list_trait* ava_btree_map_v(ava_value map) {
+  return ava_btree_map_of_value(map)->v;
+}
+
+static ava_map_value ava_btree_map_redelegate(
+  ava_map_value this, ava_list_value new_delegate,
+  const ava_btree_map_node* new_root
+) {
+  const ava_btree_map*restrict orig = ava_btree_map_of_value(this.v);
+
+  if (ava_value_attr(new_delegate.v) != orig->list_attr ||
+      new_root != orig->root) {
+    return ava_btree_map_new(new_delegate, new_root);
+  } else {
+    /* Nothing on the header changed; any changes are reflected in the new
+     * ulong.
+     */
+    return (ava_map_value) {
+      ava_value_with_ulong(orig, ava_value_ulong(new_delegate.v))
+    };
+  }
+}
+
+static ava_ulong ava_btree_map_prefix(ava_value key) {
+  ava_string str = ava_to_string(key);
+  unsigned char bytes[PREFIX_BYTES];
+  ava_ulong prefix = 0;
+  size_t len, i;
+
+  if (ava_string_is_ascii9(str)) {
+    /* Characters past the end of the string are encoded as zeroes. */
+    for (i = 0; i < PREFIX_BYTES; ++i)
+      prefix = (prefix << 8) | ((str.ascii9 >> (57 - 7*i)) & 0x7F);
+  } else {
+    len = ava_strlen(str);
+    if (len > PREFIX_BYTES) len = PREFIX_BYTES;
+
+    memset(bytes, 0, sizeof(bytes));
+    ava_string_to_bytes(bytes, str, 0, len);
+    for (i = 0; i < PREFIX_BYTES; ++i)
+      prefix = (prefix << 8) | bytes[i];
+  }
+
+  return prefix;
+}
+
+static const ava_ulong ava_btree_map_powers_of_ten[20] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+  10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+  100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+/**
+ * Compares two integers by their decimal representations, with the same
+ * result as ava_strcmp() would give on their string forms.
+ */
+static signed ava_btree_map_integer_strcmp(ava_integer a, ava_integer b) {
+  ava_ulong ma, mb;
+  unsigned da, db;
+
+  if (a == b) return 0;
+  /* The minus sign orders before every digit */
+  if ((a < 0) != (b < 0)) return a < 0? -1 : +1;
+
+  ma = a < 0? -(ava_ulong)a : (ava_ulong)a;
+  mb = b < 0? -(ava_ulong)b : (ava_ulong)b;
+  for (da = 1; da < 20 && ma >= ava_btree_map_powers_of_ten[da]; ++da);
+  for (db = 1; db < 20 && mb >= ava_btree_map_powers_of_ten[db]; ++db);
+
+  /* Pad the shorter representation with zeroes to the length of the longer.
+   * Magnitudes have at most 19 digits, so this cannot overflow. If the two are
+   * then equal, the shorter is a prefix of the longer, so orders first.
+   */
+  if (da < db)
+    ma *= ava_btree_map_powers_of_ten[db - da];
+  else
+    mb *= ava_btree_map_powers_of_ten[da - db];
+
+  if (ma != mb) return ma < mb? -1 : +1;
+  return da < db? -1 : +1;
+}
+
+static signed ava_btree_map_compare_keys(ava_value a, ava_value b) {
+  if (&ava_string_type == ava_value_attr(a) &&
+      &ava_string_type == ava_value_attr(b) &&
+      (ava_value_ulong(a) & ava_value_ulong(b) & 1))
+    return (ava_value_ulong(a) > ava_value_ulong(b)) -
+      (ava_value_ulong(a) < ava_value_ulong(b));
+
+  if (&ava_integer_type == ava_value_attr(a) &&
+      &ava_integer_type == ava_value_attr(b))
+    return ava_btree_map_integer_strcmp(
+      ava_value_slong(a), ava_value_slong(b));
+
+  return ava_value_strcmp(a, b);
+}
+
+static signed ava_btree_map_compare_entries(const void* va, const void* vb) {
+  const ava_btree_map_entry*restrict a = va, *restrict b = vb;
+  signed c;
+
+  if (a->prefix != b->prefix)
+    return a->prefix < b->prefix? -1 : +1;
+
+  c = ava_btree_map_compare_keys(a->key, b->key);
+  if (c) return c;
+
+  return (a->pos > b->pos) - (a->pos < b->pos);
+}
+
+static ava_btree_map_entry ava_btree_map_probe(ava_value key, size_t pos) {
+  return (ava_btree_map_entry) {
+    .prefix = ava_btree_map_prefix(key),
+    .key = key,
+    .pos = pos,
+  };
+}
+
+static size_t ava_btree_map_node_size(const ava_btree_map_node* node) {
+  size_t size = 0;
+  unsigned i;
+
+  if (!node->height)
+    return node->count;
+
+  for (i = 0; i < node->count; ++i)
+    size += node->sizes[i];
+
+  return size;
+}
+
+/**
+ * Returns the number of entries (or separators) in the given node which are
+ * ordered before probe.
+ */
+static unsigned ava_btree_map_node_rank(const ava_btree_map_node* node,
+                                        const ava_btree_map_entry* probe) {
+  unsigned i;
+  signed c;
+
+  for (i = 0; i < node->count; ++i) {
+    if (node->prefixes[i] != probe->prefix) {
+      if (node->prefixes[i] > probe->prefix) break;
+      continue;
+    }
+
+    c = ava_btree_map_compare_keys(node->keys[i], probe->key);
+    if (c > 0 || (0 == c && node->positions[i] >= probe->pos)) break;
+  }
+
+  return i;
+}
+
+static const ava_btree_map_node* ava_btree_map_node_of_slots(
+  unsigned height, const ava_btree_map_slot* slots, unsigned count
+) {
+  ava_btree_map_node* node;
+  unsigned i;
+
+  assert(count > 0 && count <= ORDER);
+
+  node = ava_alloc(height? sizeof(ava_btree_map_node) :
+                   offsetof(ava_btree_map_node, sizes));
+  node->count = count;
+  node->height = height;
+
+  for (i = 0; i < count; ++i) {
+    node->prefixes[i] = slots[i].entry.prefix;
+    node->keys[i] = slots[i].entry.key;
+    node->positions[i] = slots[i].entry.pos;
+
+    if (height) {
+      node->sizes[i] = slots[i].size;
+      node->children[i] = slots[i].child;
+    }
+  }
+
+  return node;
+}
+
+static void ava_btree_map_slot_of_entry(ava_btree_map_slot* dst,
+                                        const ava_btree_map_node* node,
+                                        unsigned ix) {
+  dst->entry.prefix = node->prefixes[ix];
+  dst->entry.key = node->keys[ix];
+  dst->entry.pos = node->positions[ix];
+
+  if (node->height) {
+    dst->size = node->sizes[ix];
+    dst->child = node->children[ix];
+  } else {
+    dst->size = 1;
+    dst->child = NULL;
+  }
+}
+
+static void ava_btree_map_slot_of_child(ava_btree_map_slot* dst,
+                                        const ava_btree_map_node* child) {
+  ava_btree_map_slot_of_entry(dst, child, 0);
+  dst->size = ava_btree_map_node_size(child);
+  dst->child = child;
+}
+
+/**
+ * Finds the first entry in the tree not ordered before probe.
+ *
+ * @param root The root of the tree to search.
+ * @param probe The entry to look for.
+ * @param rank Set to the number of entries ordered before probe, which is
+ * the ordinal of the entry found.
+ * @param ix Set to the index of the entry found within the returned node.
+ * @return The node holding the entry found, or NULL if every entry is
+ * ordered before probe. This is an internal node if the entry is the first
+ * entry to the right of the leaf the search ended in.
+ */
+static const ava_btree_map_node* ava_btree_map_seek(
+  const ava_btree_map_node* root, const ava_btree_map_entry* probe,
+  size_t* rank, unsigned* ix
+) {
+  const ava_btree_map_node* node = root, * next = NULL;
+  unsigned i, child, next_ix = 0;
+  size_t r = 0;
+
+  while (node->height) {
+    /* The entries under the last child whose separator is before probe
+     * include the last entry before probe.
+     */
+    i = ava_btree_map_node_rank(node, probe);
+    child = i? i - 1 : 0;
+    for (i = 0; i < child; ++i)
+      r += node->sizes[i];
+
+    if (child + 1 < node->count) {
+      next = node;
+      next_ix = child + 1;
+    }
+
+    node = node->children[child];
+  }
+
+  i = ava_btree_map_node_rank(node, probe);
+  *rank = r + i;
+
+  if (i < node->count) {
+    *ix = i;
+    return node;
+  } else {
+    *ix = next_ix;
+    return next;
+  }
+}
+
+/**
+ * Finds the entry in the tree with the given ordinal, which must be less
+ * than the size of the tree.
+ *
+ * @return The leaf holding the entry, with *ix set to its index therein.
+ */
+static const ava_btree_map_node* ava_btree_map_entry_at(
+  const ava_btree_map_node* node, size_t ordinal, unsigned* ix
+) {
+  unsigned i;
+
+  while (node->height) {
+    for (i = 0; ordinal >= node->sizes[i]; ++i)
+      ordinal -= node->sizes[i];
+
+    node = node->children[i];
+  }
+
+  *ix = ordinal;
+  return node;
+}
+
+/**
+ * Returns a copy of the given subtree with the given entry inserted.
+ *
+ * @param split If the entries no longer fit in one node, set to the right
+ * half of the new subtree, the return value being the left half; otherwise,
+ * set to NULL. The halves have the same height as node.
+ */
+static const ava_btree_map_node* ava_btree_map_insert(
+  const ava_btree_map_node* node, const ava_btree_map_entry* entry,
+  const ava_btree_map_node** split
+) {
+  ava_btree_map_slot slots[ORDER + 1];
+  const ava_btree_map_node* child, * child_split;
+  unsigned count, i;
+
+  count = node->count;
+  for (i = 0; i < count; ++i)
+    ava_btree_map_slot_of_entry(slots + i, node, i);
+
+  i = ava_btree_map_node_rank(node, entry);
+  if (!node->height) {
+    memmove(slots + i + 1, slots + i, sizeof(ava_btree_map_slot) * (count - i));
+    slots[i].entry = *entry;
+    slots[i].size = 1;
+    slots[i].child = NULL;
+    ++count;
+  } else {
+    if (i) --i;
+    child = ava_btree_map_insert(node->children[i], entry, &child_split);
+    /* This also updates the separator, in case entry is the new least
+     * entry.
+     */
+    ava_btree_map_slot_of_child(slots + i, child);
+
+    if (child_split) {
+      ++i;
+      memmove(slots + i + 1, slots + i,
+              sizeof(ava_btree_map_slot) * (count - i));
+      ava_btree_map_slot_of_child(slots + i, child_split);
+      ++count;
+    }
+  }
+
+  if (count <= ORDER) {
+    *split = NULL;
+    return ava_btree_map_node_of_slots(node->height, slots, count);
+  } else {
+    *split = ava_btree_map_node_of_slots(
+      node->height, slots + count/2, count - count/2);
+    return ava_btree_map_node_of_slots(node->height, slots, count/2);
+  }
+}
+
+/**
+ * Builds a tree from scratch out of the given entries, which must be sorted
+ * and non-empty.
+ *
+ * Each level is divided evenly into the fewest nodes possible, so every node
+ * but a root is at least half full.
+ */
+static const ava_btree_map_node* ava_btree_map_build(
+  const ava_btree_map_entry* entries, size_t count
+) {
+  ava_btree_map_slot slots[ORDER];
+  const ava_btree_map_node** level;
+  size_t groups, g, i, begin, end;
+  unsigned height;
+
+  assert(count > 0);
+
+  groups = (count + ORDER - 1) / ORDER;
+  level = ava_alloc(sizeof(const ava_btree_map_node*) * groups);
+  for (g = 0; g < groups; ++g) {
+    begin = count * g / groups;
+    end = count * (g+1) / groups;
+    for (i = begin; i < end; ++i) {
+      slots[i - begin].entry = entries[i];
+      slots[i - begin].size = 1;
+      slots[i - begin].child = NULL;
+    }
+
+    level[g] = ava_btree_map_node_of_slots(0, slots, end - begin);
+  }
+
+  for (height = 1; groups > 1; ++height) {
+    count = groups;
+    groups = (count + ORDER - 1) / ORDER;
+    /* Each group begins at or after the slot it is written back to, so the
+     * level can be rewritten in place.
+     */
+    for (g = 0; g < groups; ++g) {
+      begin = count * g / groups;
+      end = count * (g+1) / groups;
+      for (i = begin; i < end; ++i)
+        ava_btree_map_slot_of_child(slots + i - begin, level[i]);
+
+      level[g] = ava_btree_map_node_of_slots(height, slots, end - begin);
+    }
+  }
+
+  return level[0];
+}
+
+/**
+ * Writes every entry under the given node to dst in order, except for the
+ * entry at position removed, and with the positions after it shifted down to
+ * close the gap.
+ *
+ * @return The end of the entries written to dst.
+ */
+static ava_btree_map_entry* ava_btree_map_flatten(
+  ava_btree_map_entry* dst, const ava_btree_map_node* node, size_t removed
+) {
+  unsigned i;
+
+  for (i = 0; i < node->count; ++i) {
+    if (node->height) {
+      dst = ava_btree_map_flatten(dst, node->children[i], removed);
+    } else if (node->positions[i] != removed) {
+      dst->prefix = node->prefixes[i];
+      dst->key = node->keys[i];
+      dst->pos = node->positions[i] - (node->positions[i] > removed);
+      ++dst;
+    }
+  }
+
+  return dst;
+}
+
+/**
+ * Writes the key and value of every pair whose entry under the given node
+ * has an ordinal (relative to the node) between begin, inclusive, and end,
+ * exclusive, to dst.
+ *
+ * @param list The underlying list from which to read values.
+ * @return The end of the elements written to dst.
+ */
+static ava_value* ava_btree_map_collect(
+  ava_value* dst, const ava_btree_map_node* node,
+  size_t begin, size_t end, ava_list_value list
+) {
+  size_t size;
+  unsigned i;
+
+  if (!node->height) {
+    for (i = begin; i < end; ++i) {
+      *dst++ = node->keys[i];
+      *dst++ = ava_list_index(list, node->positions[i]*2 + 1);
+    }
+
+    return dst;
+  }
+
+  for (i = 0; i < node->count && end > 0; ++i) {
+    size = node->sizes[i];
+    if (begin < size)
+      dst = ava_btree_map_collect(dst, node->children[i],
+                                  begin, end < size? end : size, list);
+
+    begin = begin > size? begin - size : 0;
+    end = end > size? end - size : 0;
+  }
+
+  return dst;
+}
+
+#define DELEGATE(this,method,...)                                       \
+  (ava_btree_map_v(this.v)->method(ava_btree_map_delegate(this.v) __VA_ARGS__))
+
+static size_t ava_btree_map_map_npairs(ava_map_value this) {
+  return DELEGATE(this, length) / 2;
+}
+
+static ava_map_cursor ava_btree_map_map_find(ava_map_value this,
+                                             ava_value key) {
+  ava_btree_map_entry probe = ava_btree_map_probe(key, 0);
+  const ava_btree_map_node* node;
+  size_t rank;
+  unsigned ix;
+
+  node = ava_btree_map_seek(ava_btree_map_of_value(this.v)->root,
+                            &probe, &rank, &ix);
+  if (node && node->prefixes[ix] == probe.prefix &&
+      0 == ava_btree_map_compare_keys(node->keys[ix], key))
+    return node->positions[ix];
+  else
+    return AVA_MAP_CURSOR_NONE;
+}
+
+static ava_map_cursor ava_btree_map_map_next(ava_map_value this,
+                                             ava_map_cursor cursor) {
+  ava_btree_map_entry probe = ava_btree_map_probe(
+    DELEGATE(this, index,, cursor*2), cursor + 1);
+  const ava_btree_map_node* node;
+  size_t rank;
+  unsigned ix;
+
+  /* Seeking to the position just after the cursor lands on the entry
+   * following the cursor's own.
+   */
+  node = ava_btree_map_seek(ava_btree_map_of_value(this.v)->root,
+                            &probe, &rank, &ix);
+  if (node && node->prefixes[ix] == probe.prefix &&
+      0 == ava_btree_map_compare_keys(node->keys[ix], probe.key))
+    return node->positions[ix];
+  else
+    return AVA_MAP_CURSOR_NONE;
+}
+
+static ava_value ava_btree_map_map_get(ava_map_value this,
+                                       ava_map_cursor cursor) {
+  return DELEGATE(this, index,, cursor*2 + 1);
+}
+
+static ava_value ava_btree_map_map_get_key(ava_map_value this,
+                                           ava_map_cursor cursor) {
+  return DELEGATE(this, index,, cursor*2);
+}
+
+static ava_map_value ava_btree_map_map_set(ava_map_value this,
+                                           ava_map_cursor cursor,
+                                           ava_value value) {
+  return ava_btree_map_redelegate(
+    this, DELEGATE(this, set,, cursor*2 + 1, value),
+    ava_btree_map_of_value(this.v)->root);
+}
+
+static ava_map_value ava_btree_map_map_add(ava_map_value this,
+                                           ava_value key,
+                                           ava_value value) {
+  ava_btree_map_entry entry = ava_btree_map_probe(
+    key, ava_btree_map_map_npairs(this));
+  const ava_btree_map_node* root, * split;
+  ava_btree_map_slot slots[2];
+  ava_list_value new_delegate;
+
+  new_delegate = DELEGATE(this, append,, key);
+  new_delegate = ava_list_append(new_delegate, value);
+
+  root = ava_btree_map_insert(ava_btree_map_of_value(this.v)->root,
+                              &entry, &split);
+  if (split) {
+    ava_btree_map_slot_of_child(slots + 0, root);
+    ava_btree_map_slot_of_child(slots + 1, split);
+    root = ava_btree_map_node_of_slots(root->height + 1, slots, 2);
+  }
+
+  return ava_btree_map_redelegate(this, new_delegate, root);
+}
+
+static ava_map_value ava_btree_map_map_remove(ava_map_value this,
+                                              ava_map_cursor cursor) {
+  ava_btree_map_entry* entries;
+  size_t n;
+
+  n = ava_btree_map_map_npairs(this);
+  if (1 == n)
+    return ava_empty_map();
+
+  entries = ava_alloc(sizeof(ava_btree_map_entry) * n);
+  ava_btree_map_flatten(entries, ava_btree_map_of_value(this.v)->root, cursor);
+
+  return ava_btree_map_redelegate(
+    this, DELEGATE(this, remove,, cursor*2, cursor*2 + 2),
+    ava_btree_map_build(entries, n - 1));
+}
+
+static size_t ava_btree_map_list_length(ava_list_value this) {
+  return DELEGATE(this, length);
+}
+
+static ava_value ava_btree_map_list_index(ava_list_value this, size_t ix) {
+  return DELEGATE(this, index,, ix);
+}
+
+static void ava_btree_map_list_index_range(
+  ava_list_value this, size_t begin, size_t end, ava_value*restrict dst
+) {
+  DELEGATE(this, index_range,, begin, end, dst);
+}
+
+static ava_list_value ava_btree_map_list_slice(ava_list_value this,
+                                               size_t begin, size_t end) {
+  return DELEGATE(this, slice,, begin, end);
+}
+
+static ava_list_value ava_btree_map_list_append(ava_list_value this,
+                                                ava_value element) {
+  return DELEGATE(this, append,, element);
+}
+
+static ava_list_value ava_btree_map_list_append_n(
+  ava_list_value this, const ava_value*restrict elements, size_t count
+) {
+  return DELEGATE(this, append_n,, elements, count);
+}
+
+static ava_list_value ava_btree_map_list_concat(ava_list_value this,
+                                                ava_list_value that) {
+  return DELEGATE(this, concat,, that);
+}
+
+static ava_list_value ava_btree_map_list_remove(ava_list_value this,
+                                                size_t begin, size_t end) {
+  return DELEGATE(this, remove,, begin, end);
+}
+
+static ava_list_value ava_btree_map_list_set(ava_list_value this,
+                                             size_t ix, ava_value value) {
+  return DELEGATE(this, set,, ix, value);
+}
+
+ava_bool ava_map_is_ordered(ava_map_value map) {
+  return &ava_btree_map_tag ==
+    ((const ava_attribute*)ava_value_attr(map.v))->tag ||
+    0 == ava_map_npairs(map);
+}
+
+ava_map_value ava_ordered_map_of(ava_map_value map) {
+  if (ava_map_is_ordered(map))
+    return map;
+  else
+    return ava_btree_map_of_list(ava_list_value_of(map.v));
+}
+
+static size_t ava_ordered_map_bound(ava_map_value map, ava_value key,
+                                    size_t pos) {
+  ava_btree_map_entry probe;
+  size_t rank;
+  unsigned ix;
+
+  if (0 == ava_map_npairs(map))
+    return 0;
+
+  probe = ava_btree_map_probe(key, pos);
+  ava_btree_map_seek(ava_btree_map_of_value(map.v)->root, &probe, &rank, &ix);
+  return rank;
+}
+
+size_t ava_ordered_map_lower_bound(ava_map_value map, ava_value key) {
+  return ava_ordered_map_bound(ava_ordered_map_of(map), key, 0);
+}
+
+size_t ava_ordered_map_upper_bound(ava_map_value map, ava_value key) {
+  return ava_ordered_map_bound(ava_ordered_map_of(map), key, ~(size_t)0);
+}
+
+ava_map_cursor ava_ordered_map_cursor_at(ava_map_value map, size_t ordinal) {
+  const ava_btree_map_node* leaf;
+  unsigned ix;
+
+  assert(&ava_btree_map_tag ==
+         ((const ava_attribute*)ava_value_attr(map.v))->tag);
+  assert(ordinal < ava_map_npairs(map));
+
+  leaf = ava_btree_map_entry_at(ava_btree_map_of_value(map.v)->root,
+                                ordinal, &ix);
+  return leaf->positions[ix];
+}
+
+ava_list_value ava_ordered_map_slice(ava_map_value map,
+                                     size_t begin, size_t end) {
+  ava_value* elements;
+
+  assert(begin <= end);
+
+  if (begin == end)
+    return ava_empty_list();
+
+  map = ava_ordered_map_of(map);
+  elements = ava_alloc(sizeof(ava_value) * 2 * (end - begin));
+  ava_btree_map_collect(elements, ava_btree_map_of_value(map.v)->root,
+                        begin, end, ava_btree_map_delegate(map.v));
+  return ava_list_of_values(elements, 2 * (end - begin));
+}
+
+ava_list_value ava_ordered_map_range(ava_map_value map,
+                                     ava_value from, ava_value to) {
+  size_t begin, end;
+
+  map = ava_ordered_map_of(map);
+  begin = ava_ordered_map_bound(map, from, 0);
+  end = ava_ordered_map_bound(map, to, ~(size_t)0);
+
+  if (end <= begin)
+    return ava_empty_list();
+  else
+    return ava_ordered_map_slice(map, begin, end);
+}
+
+unsigned ava_btree_map_height(ava_map_value map) {
+  return ava_btree_map_of_value(map.v)->root->height;
+}
+
+/**
+ * Recursively checks the invariants under the given node, and that every
+ * entry matches the key at its position in list.
+ *
+ * @param height The height node is expected to have.
+ * @param is_root Whether node is the root, and so may be less than half full.
+ * @param prev The last entry before this subtree, or NULL if none; updated to
+ * the last entry in the subtree.
+ * @param seen Array of flags for each position in the map, to check that
+ * every position occurs exactly once.
+ */
+static ava_bool ava_btree_map_check_node(
+  const ava_btree_map_node* node, unsigned height, ava_bool is_root,
+  ava_btree_map_entry* prev, ava_bool* has_prev,
+  ava_bool* seen, ava_list_value list
+) {
+  ava_btree_map_entry entry;
+  ava_btree_map_entry first;
+  unsigned i;
+  size_t npairs = ava_list_length(list) / 2;
+
+  if (node->height != height) return ava_false;
+  if (0 == node->count || node->count > ORDER) return ava_false;
+  if (!is_root && node->count < ORDER / 2) return ava_false;
+
+  for (i = 0; i < node->count; ++i) {
+    entry.prefix = node->prefixes[i];
+    entry.key = node->keys[i];
+    entry.pos = node->positions[i];
+
+    if (entry.pos >= npairs) return ava_false;
+    if (entry.prefix != ava_btree_map_prefix(entry.key)) return ava_false;
+
+    if (height) {
+      /* The separator must be a copy of the least entry in the child */
+      first.prefix = node->children[i]->prefixes[0];
+      first.key = node->children[i]->keys[0];
+      first.pos = node->children[i]->positions[0];
+      if (0 != ava_btree_map_compare_entries(&entry, &first))
+        return ava_false;
+      if (node->sizes[i] != ava_btree_map_node_size(node->children[i]))
+        return ava_false;
+
+      if (!ava_btree_map_check_node(node->children[i], height - 1, ava_false,
+                                    prev, has_prev, seen, list))
+        return ava_false;
+    } else {
+      if (*has_prev && ava_btree_map_compare_entries(prev, &entry) >= 0)
+        return ava_false;
+      if (seen[entry.pos]) return ava_false;
+      if (!ava_value_equal(entry.key, ava_list_index(list, entry.pos*2)))
+        return ava_false;
+
+      seen[entry.pos] = ava_true;
+      *prev = entry;
+      *has_prev = ava_true;
+    }
+  }
+
+  return ava_true;
+}
+
+ava_bool ava_btree_map_check(ava_map_value map) {
+  const ava_btree_map_node* root = ava_btree_map_of_value(map.v)->root;
+  ava_list_value list = ava_btree_map_delegate(map.v);
+  ava_btree_map_entry prev;
+  ava_bool has_prev = ava_false;
+  ava_bool* seen;
+  size_t npairs, i;
+
+  npairs = ava_list_length(list) / 2;
+  if (ava_btree_map_node_size(root) != npairs) return ava_false;
+
+  seen = ava_alloc_atomic_zero(sizeof(ava_bool) * npairs);
+  if (!ava_btree_map_check_node(root, root->height, ava_true,
+                                &prev, &has_prev, seen, list))
+    return ava_false;
+
+  for (i = 0; i < npairs; ++i)
+    if (!seen[i]) return ava_false;
+
+  return ava_true;
+}
@@ -17,7 +17,6 @@
 #include <config.h>
 #endif
 
-#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -147,37 +146,22 @@ ava_bool ava_compenv_simple_read_source(
   ava_value* dst, ava_string* error, ava_string filename,
   ava_compenv* compenv
 ) {
-  FILE* in;
   ava_string source;
-  size_t nread;
-  char buffer[4096];
 
-  in = fopen(
+  source = ava_string_of_mmap(
     ava_string_to_cstring(
       ava_strcat(
         ava_string_of_datum(compenv->read_source_userdata),
-        filename)), "r");
-  if (!in) goto error;
-
-  source = AVA_EMPTY_STRING;
-  do {
-    nread = fread(buffer, 1, sizeof(buffer), in);
-    source = ava_strcat(source, ava_string_of_bytes(buffer, nread));
-  } while (nread == sizeof(buffer));
-
-  if (ferror(in)) goto error;
-
-  fclose(in);
+        filename)));
+  if (!ava_string_is_present(source)) {
+    *error = ava_string_of_cstring(strerror(errno));
+    return ava_false;
+  }
 
   *dst = ava_map_add(
     ava_empty_map(),
     ava_value_of_string(filename), ava_value_of_string(source)).v;
   return ava_true;
-
-  error:
-  *error = ava_string_of_cstring(strerror(errno));
-  if (in) fclose(in);
-  return ava_false;
 }
 
 void ava_compenv_use_simple_source_reader(
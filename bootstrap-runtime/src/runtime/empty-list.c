@@ -77,6 +77,12 @@ static ava_value ava_empty_list_list_index(ava_list_value el, size_t ix) {
   abort();
 }
 
+static void ava_empty_list_list_index_range(
+  ava_list_value el, size_t begin, size_t end, ava_value*restrict dst
+) {
+  if (begin || end) abort();
+}
+
 static ava_list_value ava_empty_list_list_slice(ava_list_value el,
                                                 size_t begin, size_t end) {
   if (begin || end) abort();
@@ -89,6 +95,12 @@ static ava_list_value ava_empty_list_list_append(ava_list_value el,
   return ava_array_list_of_raw(&elt, 1);
 }
 
+static ava_list_value ava_empty_list_list_append_n(
+  ava_list_value el, const ava_value*restrict elements, size_t count
+) {
+  return ava_list_of_values(elements, count);
+}
+
 static ava_list_value ava_empty_list_list_concat(
   ava_list_value el, ava_list_value other
 ) {
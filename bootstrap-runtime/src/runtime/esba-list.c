@@ -26,9 +26,12 @@
 #include "avalanche/alloc.h"
 #include "avalanche/value.h"
 #include "avalanche/list.h"
+#include "avalanche/integer.h"
 #include "-esba.h"
 #include "-array-list.h"
 #include "-esba-list.h"
+#include "-list-string-cache.h"
+#include "-rrb-list.h"
 
 #include "esba-list-swizzle.inc"
 
@@ -36,6 +39,10 @@ static const ava_attribute_tag ava_esba_list_header_tag = {
   .name = "esba-list-header"
 };
 
+static const ava_attribute_tag ava_esba_list_tail_tag = {
+  .name = "esba-list-tail"
+};
+
 /**
  * Structure used as next_attr on an ESBA.
  *
@@ -43,6 +50,12 @@ static const ava_attribute_tag ava_esba_list_header_tag = {
  * monomorphic, we store a template at the head of the list (which contains the
  * full zeroth value); if all values in the list share a field value with the
  * template, that field is not actually added to the ESBA.
+ *
+ * Lists of integers which all fit in 32 bits or fewer instead use one of the
+ * packed formats, which store several elements in each ESBA element ("word").
+ * The ESBA of such a list only ever holds whole words; any elements past the
+ * last whole word live in an ava_esba_list_tail instead. The list length is
+ * what is stored in the list value (see ava_esba_list_parts_of()).
  */
 typedef struct {
   ava_attribute header;
@@ -55,13 +68,93 @@ typedef struct {
    * The zeroth value in this list, fully expanded.
    */
   ava_value template;
+  /**
+   * The string form of the most recently stringified version of this list,
+   * keyed by the attribute of the list value.
+   *
+   * This is the only mutable part of the header.
+   */
+  ava_list_string_cache string_cache;
 } ava_esba_list_header;
 
+/**
+ * The elements of a packed list past its last whole word.
+ *
+ * Other versions of the list may share the ESBA but extend it differently, so
+ * a partially-filled word cannot live in the ESBA without every append having
+ * to replace it with ava_esba_set(), which would make every older version
+ * stale. Instead, a list whose length is not a multiple of the elements per
+ * word has one of these, private to that version, as its attribute; its next
+ * attribute is the ESBA handle. Appending then only ever creates a new tail,
+ * until the tail fills up and is appended to the ESBA as a whole word.
+ *
+ * Like a bare handle, a tail also serves any shorter length (the hash map, for
+ * example, keeps one attribute for several lengths of its key list). A prefix
+ * ending before the tail's word ends within a word which is whole in the
+ * ESBA, so that word is read from there instead.
+ */
+typedef struct {
+  ava_attribute header;
+  /**
+   * The number of whole words in the ESBA of the version this tail belongs
+   * to, ie, the index of the word the tail stands in for.
+   */
+  size_t whole;
+  /**
+   * The elements of the partial word, in the same layout as a word in the
+   * ESBA. Positions past the end of the list are unspecified.
+   */
+  ava_ulong word;
+} ava_esba_list_tail;
+
+/**
+ * An ESBA list broken down into its parts, which is the form in which lists
+ * are built and modified.
+ */
+typedef struct {
+  /**
+   * The ESBA holding the whole words of the list.
+   */
+  ava_esba esba;
+  /**
+   * The length of the list, in list elements.
+   */
+  size_t length;
+  /**
+   * The elements past the last whole word of a packed list, as per
+   * ava_esba_list_tail.word. Zero if there are none.
+   */
+  ava_ulong tail;
+} ava_esba_list_parts;
+
+/**
+ * The number of elements read at a time when copying from a list of another
+ * type.
+ *
+ * This must be a multiple of every value in ava_esba_list_elements_per_word,
+ * so that block-wise appends to a packed list stay word-aligned.
+ */
+#define AVA_ESBA_LIST_BLOCK 64
+
+/**
+ * The number of stale-handle copy-outs (see ava_esba_stale_copy_outs()) after
+ * which operations that produce a modified ESBA list switch to an RRB list
+ * instead.
+ *
+ * Each copy-out is an O(n) copy caused by some old version of the list being
+ * read or modified, which indicates that the list is being used persistently
+ * rather than linearly. Converting costs one more such copy, after which every
+ * version derived from the RRB list costs only O(log n).
+ */
+#define AVA_ESBA_LIST_RRB_COPY_OUTS 4
+
 /* For clarity, when dealing with "x many pointers big" */
 typedef struct { void* v; } pointer;
 
 static unsigned ava_esba_list_polymorphism(
   ava_value template, ava_value new);
+static unsigned ava_esba_list_contents(const ava_esba_list_header* header);
+static unsigned ava_esba_list_choose_format(unsigned polymorphism);
 
 static const ava_esba_list_header* ava_esba_list_header_of(ava_esba esba);
 static ava_esba ava_esba_list_create_esba(
@@ -72,42 +165,99 @@ static ava_esba ava_esba_list_create_esba_with_header(
 static unsigned ava_esba_list_accum_format(
   ava_list_value list, size_t begin, size_t end,
   ava_value template);
-static ava_esba ava_esba_list_append_sublist(
-  ava_esba esba, unsigned format,
+static void ava_esba_list_read_word(
+  ava_esba esba, size_t index, pointer*restrict dst);
+static void ava_esba_list_read(
+  const ava_esba_list_parts*restrict parts,
+  size_t begin, size_t end, ava_value*restrict dst);
+static void ava_esba_list_append_values(
+  ava_esba_list_parts*restrict parts,
+  const ava_value*restrict values, size_t count, size_t stride);
+static void ava_esba_list_append_sublist(
+  ava_esba_list_parts*restrict parts,
   ava_list_value list, size_t begin, size_t end);
-static ava_esba ava_esba_list_concat_esbas(
-  ava_esba dst, ava_esba src, size_t begin, size_t end);
-static ava_esba ava_esba_list_make_compatible(
-  ava_esba esba, unsigned new_format);
+static void ava_esba_list_concat_esbas(
+  ava_esba_list_parts*restrict dst,
+  const ava_esba_list_parts*restrict src, size_t begin, size_t end);
+static ava_esba_list_parts ava_esba_list_make_compatible(
+  ava_esba_list_parts src, unsigned polymorphism);
+static ava_bool ava_esba_list_should_migrate(ava_list_value list);
 
 
+static ava_string ava_esba_list_to_string(ava_value list);
+
 static const ava_value_trait ava_esba_list_generic_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
   .name = "esba-list",
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_esba_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
 
 AVA_LIST_DEFIMPL(ava_esba_list, &ava_esba_list_generic_impl)
 
-static inline ava_esba to_esba(ava_value val) {
-  return (ava_esba) {
-    .handle = (void*)ava_value_attr(val),
-    .length = ava_value_ulong(val)
-  };
+/**
+ * Returns the number of ESBA elements needed to hold a list of the given
+ * length in the given format, including a partial last word.
+ */
+static inline size_t ava_esba_list_words(unsigned format, size_t length) {
+  size_t per_word = ava_esba_list_elements_per_word[format];
+  return (length + per_word - 1) / per_word;
 }
 
-static inline ava_value to_value(ava_esba esba) {
-  return ava_value_with_ulong(esba.handle, esba.length);
+static inline ava_esba_list_parts ava_esba_list_parts_of(ava_value val) {
+  const ava_attribute*restrict attr = ava_value_attr(val);
+  const ava_esba_list_tail*restrict tail = NULL;
+  ava_esba_list_parts parts;
+  size_t per_word;
+
+  if (&ava_esba_list_tail_tag == attr->tag) {
+    tail = (const ava_esba_list_tail*)attr;
+    attr = attr->next;
+  }
+
+  parts.esba.handle = (void*)attr;
+  parts.esba.length = 0;
+  parts.length = ava_value_ulong(val);
+  per_word = ava_esba_list_elements_per_word[
+    ava_esba_list_header_of(parts.esba)->format];
+  parts.esba.length = parts.length / per_word;
+
+  parts.tail = 0;
+  if (parts.length % per_word) {
+    if (tail && tail->whole == parts.esba.length)
+      parts.tail = tail->word;
+    else
+      ava_esba_list_read_word(parts.esba, parts.esba.length,
+                              (pointer*)&parts.tail);
+  }
+
+  return parts;
+}
+
+static inline ava_esba_list_parts ava_esba_list_empty_parts(ava_esba esba) {
+  return (ava_esba_list_parts) { .esba = esba, .length = 0, .tail = 0 };
 }
 
-static inline ava_list_value to_list_value(ava_esba esba) {
-  return (ava_list_value) { to_value(esba) };
+static ava_list_value ava_esba_list_of_parts(ava_esba_list_parts parts) {
+  const ava_esba_list_header*restrict header =
+    ava_esba_list_header_of(parts.esba);
+  ava_esba_list_tail*restrict tail;
+
+  if (0 == parts.length % ava_esba_list_elements_per_word[header->format])
+    return (ava_list_value) {
+      ava_value_with_ulong(parts.esba.handle, parts.length) };
+
+  tail = AVA_NEW(ava_esba_list_tail);
+  tail->header.tag = &ava_esba_list_tail_tag;
+  tail->header.next = (const ava_attribute*)parts.esba.handle;
+  tail->whole = ava_esba_length(parts.esba);
+  tail->word = parts.tail;
+  return (ava_list_value) { ava_value_with_ulong(tail, parts.length) };
 }
 
 static unsigned ava_esba_list_polymorphism(ava_value template, ava_value new) {
-  unsigned ret = 0;
+  unsigned ret = ava_esba_list_width(new);
   if (ava_value_attr(template) != ava_value_attr(new))
     ret |= POLYMORPH_ATTR;
   if (ava_value_ulong(template) != ava_value_ulong(new))
@@ -116,10 +266,56 @@ static unsigned ava_esba_list_polymorphism(ava_value template, ava_value new) {
   return ret;
 }
 
+/**
+ * Returns the POLYMORPH_* bits accumulated over every element a list with the
+ * given header could possibly contain.
+ */
+static unsigned ava_esba_list_contents(const ava_esba_list_header* header) {
+  unsigned holds = ava_esba_list_format_holds[header->format];
+
+  /* If the ulong is not stored, every element has the template's */
+  if (!(holds & POLYMORPH_ULONG))
+    return (holds & POLYMORPH_SHAPE) | ava_esba_list_width(header->template);
+
+  return holds;
+}
+
+/**
+ * Returns the most compact format able to hold elements with the given
+ * accumulated POLYMORPH_* bits.
+ */
+static unsigned ava_esba_list_choose_format(unsigned polymorphism) {
+  unsigned format;
+
+  /* If the ulongs don't vary, the unpacked format stores nothing at all */
+  if (polymorphism & POLYMORPH_ULONG) {
+    for (format = AVA_ESBA_LIST_FIRST_PACKED_FORMAT;
+         format < AVA_ESBA_LIST_NUM_FORMATS; ++format) {
+      if (!(polymorphism & ~ava_esba_list_format_holds[format]))
+        return format;
+    }
+  }
+
+  return polymorphism & POLYMORPH_SHAPE;
+}
+
 static const ava_esba_list_header* ava_esba_list_header_of(ava_esba esba) {
   return ava_esba_next_attr(esba);
 }
 
+static ava_string ava_esba_list_to_string(ava_value list) {
+  ava_esba_list_parts parts = ava_esba_list_parts_of(list);
+  /* Every set() produces a new handle or tail and every append() a new
+   * length, so the attribute (with the length, which the cache also checks)
+   * is a sufficient version key.
+   */
+  ava_esba_list_header* header =
+    (ava_esba_list_header*)ava_esba_list_header_of(parts.esba);
+
+  return ava_list_to_string_cached(&header->string_cache,
+                                   ava_value_attr(list), list);
+}
+
 static ava_esba ava_esba_list_create_esba(
   unsigned format, ava_value template, size_t capacity
 ) {
@@ -137,7 +333,7 @@ static ava_esba ava_esba_list_create_esba_with_header(
 ) {
   return ava_esba_new(
     sizeof(pointer) * ava_esba_list_element_size_pointers[header->format],
-    capacity,
+    ava_esba_list_words(header->format, capacity),
     ava_alloc_precise, (void*)header);
 }
 
@@ -146,104 +342,239 @@ ava_list_value ava_esba_list_copy_of(
 ) {
   unsigned format;
   ava_value template;
+  ava_esba_list_parts parts;
 
   assert(end != begin);
 
   /* First pass through the range to determine the format */
   template = ava_list_index(list, begin);
-  format = ava_esba_list_accum_format(list, begin, end, template);
+  format = ava_esba_list_choose_format(
+    ava_esba_list_accum_format(list, begin, end, template));
 
   /* Second pass to populate the array */
-  ava_esba esba = ava_esba_list_create_esba(format, template, end - begin);
-  esba = ava_esba_list_append_sublist(esba, format, list, begin, end);
+  parts = ava_esba_list_empty_parts(
+    ava_esba_list_create_esba(format, template, end - begin));
+  ava_esba_list_append_sublist(&parts, list, begin, end);
 
-  return to_list_value(esba);
+  return ava_esba_list_of_parts(parts);
 }
 
+/**
+ * Returns the POLYMORPH_* bits accumulated over the given range of the given
+ * list against the given template, including the width of the template
+ * itself.
+ */
 static unsigned ava_esba_list_accum_format(
   ava_list_value list, size_t begin, size_t end, ava_value template
 ) {
   const ava_esba_list_header*restrict header;
+  ava_value block[AVA_ESBA_LIST_BLOCK];
   unsigned format;
-  size_t i;
+  size_t base, n, i;
 
   if ((header = ava_get_attribute(list.v, &ava_esba_list_header_tag))) {
-    return header->format |
+    return ava_esba_list_contents(header) |
       ava_esba_list_polymorphism(template, header->template);
   }
 
-  format = 0;
-  for (i = begin + 1; i < end && format != POLYMORPH_ALL; ++i) {
-    format |= ava_esba_list_polymorphism(
-      template, ava_list_index(list, i));
+  format = ava_esba_list_width(template);
+  for (base = begin + 1; base < end && format != POLYMORPH_ALL; base += n) {
+    n = end - base;
+    if (n > AVA_ESBA_LIST_BLOCK)
+      n = AVA_ESBA_LIST_BLOCK;
+
+    ava_list_index_range(list, base, base + n, block);
+    for (i = 0; i < n; ++i)
+      format |= ava_esba_list_polymorphism(template, block[i]);
   }
 
   return format;
 }
 
-static ava_esba ava_esba_list_append_sublist(
-  ava_esba esba, unsigned format,
-  ava_list_value list, size_t begin, size_t end
+/**
+ * Copies the ESBA element at the given index into dst.
+ */
+static void ava_esba_list_read_word(
+  ava_esba esba, size_t index, pointer*restrict dst
 ) {
-  size_t i;
+  size_t eltsz = ava_esba_list_element_size_pointers[
+    ava_esba_list_header_of(esba)->format];
+  const pointer* base;
+  ava_esba_tx tx;
+
+  do {
+    base = ava_esba_access(esba, &tx);
+    memcpy(dst, base + index * eltsz, eltsz * sizeof(pointer));
+  } while (!ava_esba_check_access(esba, base, tx));
+}
+
+/**
+ * Copies the list elements in the given range of the given list into dst.
+ */
+static void ava_esba_list_read(
+  const ava_esba_list_parts*restrict parts,
+  size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_esba_list_header*restrict header =
+    ava_esba_list_header_of(parts->esba);
+  ava_esba_list_get_f get = ava_esba_list_get[header->format];
+  size_t whole = ava_esba_length(parts->esba) *
+    ava_esba_list_elements_per_word[header->format];
+  size_t split, i;
+  const pointer* base;
+  ava_esba_tx tx;
+
+  split = end < whole? end : whole;
+
+  /* One transaction for the whole range rather than one per element */
+  if (begin < split) {
+    do {
+      base = ava_esba_access(parts->esba, &tx);
+      for (i = begin; i < split; ++i)
+        get(dst + i - begin, &header->template, base, i);
+    } while (!ava_esba_check_access(parts->esba, base, tx));
+  }
+
+  for (i = begin > whole? begin : whole; i < end; ++i)
+    get(dst + i - begin, &header->template, &parts->tail, i - whole);
+}
+
+/**
+ * Appends count values, taken from every strideth element of values, to the
+ * given list, whose format must already be able to hold them.
+ */
+static void ava_esba_list_append_values(
+  ava_esba_list_parts*restrict parts,
+  const ava_value*restrict values, size_t count, size_t stride
+) {
+  const ava_esba_list_header*restrict header =
+    ava_esba_list_header_of(parts->esba);
+  ava_esba_list_put_f put = ava_esba_list_put[header->format];
+  size_t eltsz = ava_esba_list_element_size_pointers[header->format];
+  size_t per_word = ava_esba_list_elements_per_word[header->format];
+  size_t offset = parts->length % per_word;
+  size_t n, i, flush, whole, words;
   pointer*restrict dst;
 
-  if (ava_get_attribute(list.v, &ava_esba_list_header_tag))
-    return ava_esba_list_concat_esbas(esba, to_esba(list.v), begin, end);
+  /* Fill the tail first. It belongs to this version alone, so it can be
+   * modified freely; it only goes into the ESBA once it is a whole word.
+   */
+  flush = 0;
+  if (offset) {
+    n = per_word - offset;
+    if (n > count)
+      n = count;
+
+    for (i = 0; i < n; ++i)
+      put(&parts->tail, offset + i, values + i * stride);
+
+    values += n * stride;
+    count -= n;
+    parts->length += n;
+    if (parts->length % per_word)
+      return;
+
+    flush = 1;
+  }
 
-  dst = ava_esba_start_append(&esba, end - begin);
+  whole = count / per_word * per_word;
+  words = flush + whole / per_word;
+  if (words) {
+    dst = ava_esba_start_append(&parts->esba, words);
+    if (flush) {
+      memcpy(dst, &parts->tail, eltsz * sizeof(pointer));
+      dst += eltsz;
+    }
+    /* The packed puts merge into the existing word */
+    if (per_word > 1)
+      memset(dst, 0, (words - flush) * eltsz * sizeof(pointer));
 
-  for (i = begin; i < end; ++i) {
-    ava_value val = ava_list_index(list, i);
-    ava_esba_list_swizzle_down[format](dst, &val);
-    dst += ava_esba_list_element_size_pointers[format];
+    for (i = 0; i < whole; ++i)
+      put(dst, i, values + i * stride);
+
+    ava_esba_finish_append(parts->esba, words);
+  }
+
+  parts->tail = 0;
+  for (i = whole; i < count; ++i)
+    put(&parts->tail, i - whole, values + i * stride);
+
+  parts->length += count;
+}
+
+static void ava_esba_list_append_sublist(
+  ava_esba_list_parts*restrict parts,
+  ava_list_value list, size_t begin, size_t end
+) {
+  ava_value block[AVA_ESBA_LIST_BLOCK];
+  ava_esba_list_parts src;
+  size_t base, n;
+
+  if (ava_get_attribute(list.v, &ava_esba_list_header_tag)) {
+    src = ava_esba_list_parts_of(list.v);
+    ava_esba_list_concat_esbas(parts, &src, begin, end);
+    return;
   }
 
-  ava_esba_finish_append(esba, end - begin);
+  for (base = begin; base < end; base += n) {
+    n = end - base;
+    if (n > AVA_ESBA_LIST_BLOCK)
+      n = AVA_ESBA_LIST_BLOCK;
 
-  return esba;
+    ava_list_index_range(list, base, base + n, block);
+    ava_esba_list_append_values(parts, block, n, 1);
+  }
 }
 
-static ava_esba ava_esba_list_concat_esbas(ava_esba dst_esba, ava_esba src_esba,
-                                           size_t begin, size_t end) {
+static void ava_esba_list_concat_esbas(
+  ava_esba_list_parts*restrict dst,
+  const ava_esba_list_parts*restrict src,
+  size_t begin, size_t end
+) {
   const ava_esba_list_header*restrict dst_header =
-    ava_esba_list_header_of(dst_esba);
+    ava_esba_list_header_of(dst->esba);
   const ava_esba_list_header*restrict src_header =
-    ava_esba_list_header_of(src_esba);
-  size_t dst_eltsz = ava_esba_list_element_size_pointers[dst_header->format];
-  size_t src_eltsz = ava_esba_list_element_size_pointers[src_header->format];
-  ava_esba_list_swizzle_down_f dst_swizzle =
-    ava_esba_list_swizzle_down[dst_header->format];
-  ava_esba_list_swizzle_up_f src_swizzle =
-    ava_esba_list_swizzle_up[src_header->format];
-  ava_value value;
-  const pointer*restrict src_base, *restrict src;
-  pointer*restrict dst_base, *restrict dst;
+    ava_esba_list_header_of(src->esba);
+  size_t eltsz = ava_esba_list_element_size_pointers[src_header->format];
+  size_t per_word = ava_esba_list_elements_per_word[src_header->format];
+  size_t whole = ava_esba_length(src->esba) * per_word;
+  ava_value block[AVA_ESBA_LIST_BLOCK];
+  const pointer*restrict src_base;
+  pointer*restrict dst_base;
   ava_esba_tx tx;
-  size_t i;
-
-  dst_base = ava_esba_start_append(&dst_esba, end - begin);
+  size_t words, base, n;
 
-  do {
-    dst = dst_base;
-    src_base = ava_esba_access(src_esba, &tx);
-    src = src_base + src_eltsz * begin;
-
-    if (dst_header->format == src_header->format) {
-      memcpy(dst, src, (end - begin) * dst_eltsz * sizeof(pointer));
-    } else {
-      for (i = begin; i < end; ++i) {
-        src_swizzle(&value, &src_header->template, src);
-        dst_swizzle(dst, &value);
-        src += src_eltsz;
-        dst += dst_eltsz;
-      }
+  /* Whole words in the source ESBA can be copied directly if both sides line
+   * up; anything left over, including the source's tail, goes element by
+   * element.
+   */
+  if (dst_header->format == src_header->format &&
+      0 == begin % per_word && 0 == dst->length % per_word &&
+      begin < whole) {
+    words = ((end < whole? end : whole) - begin) / per_word;
+    if (words) {
+      dst_base = ava_esba_start_append(&dst->esba, words);
+
+      do {
+        src_base = ava_esba_access(src->esba, &tx);
+        memcpy(dst_base, src_base + begin / per_word * eltsz,
+               words * eltsz * sizeof(pointer));
+      } while (!ava_esba_check_access(src->esba, src_base, tx));
+
+      ava_esba_finish_append(dst->esba, words);
+      dst->length += words * per_word;
+      begin += words * per_word;
     }
-  } while (!ava_esba_check_access(src_esba, src_base, tx));
+  }
 
-  ava_esba_finish_append(dst_esba, end - begin);
+  for (base = begin; base < end; base += n) {
+    n = end - base;
+    if (n > AVA_ESBA_LIST_BLOCK)
+      n = AVA_ESBA_LIST_BLOCK;
 
-  return dst_esba;
+    ava_esba_list_read(src, base, base + n, block);
+    ava_esba_list_append_values(dst, block, n, 1);
+  }
 }
 
 ava_list_value ava_esba_list_of_raw(
@@ -259,55 +590,55 @@ ava_list_value ava_esba_list_of_raw_strided(
 ) {
   unsigned format;
   ava_value template;
+  ava_esba_list_parts parts;
   size_t i;
 
   assert(count > 0);
 
   /* First pass to determine format */
-  format = 0;
   template = array[0];
+  format = ava_esba_list_width(template);
   for (i = 1; i < count && format != POLYMORPH_ALL; ++i)
     format |= ava_esba_list_polymorphism(template, array[i*stride]);
+  format = ava_esba_list_choose_format(format);
 
   /* Second pass to copy data */
-  ava_esba esba = ava_esba_list_create_esba(format, template, count);
-  pointer* dst = ava_esba_start_append(&esba, count);
-  for (i = 0; i < count; ++i) {
-    ava_esba_list_swizzle_down[format](dst, array + i * stride);
-    dst += ava_esba_list_element_size_pointers[format];
-  }
-
-  ava_esba_finish_append(esba, count);
+  parts = ava_esba_list_empty_parts(
+    ava_esba_list_create_esba(format, template, count));
+  ava_esba_list_append_values(&parts, array, count, stride);
 
-  return to_list_value(esba);
+  return ava_esba_list_of_parts(parts);
 }
 
 static size_t ava_esba_list_list_length(ava_list_value list) {
-  return ava_esba_length(to_esba(list.v));
+  return ava_value_ulong(list.v);
 }
 
 static ava_value ava_esba_list_list_index(ava_list_value list, size_t ix) {
-  ava_esba esba = to_esba(list.v);
-  const ava_esba_list_header* header = ava_esba_list_header_of(esba);
-  ava_esba_tx tx;
-  const pointer* base, * src;
+  ava_esba_list_parts parts = ava_esba_list_parts_of(list.v);
   ava_value ret;
 
-  assert(ix < ava_esba_length(esba));
-
-  do {
-    base = ava_esba_access(esba, &tx);
-    src = base + ix * ava_esba_list_element_size_pointers[header->format];
-    ava_esba_list_swizzle_up[header->format](&ret, &header->template, src);
-  } while (!ava_esba_check_access(esba, base, tx));
+  assert(ix < ava_esba_list_list_length(list));
 
+  ava_esba_list_read(&parts, ix, ix + 1, &ret);
   return ret;
 }
 
+static void ava_esba_list_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  ava_esba_list_parts parts = ava_esba_list_parts_of(list.v);
+
+  assert(begin <= end);
+  assert(end <= ava_esba_list_list_length(list));
+
+  ava_esba_list_read(&parts, begin, end, dst);
+}
+
 static ava_list_value ava_esba_list_list_slice(ava_list_value list,
                                                size_t begin, size_t end) {
   assert(begin <= end);
-  assert(end <= ava_esba_length(to_esba(list.v)));
+  assert(end <= ava_esba_list_list_length(list));
 
   if (begin == end)
     return ava_empty_list();
@@ -321,63 +652,113 @@ static ava_list_value ava_esba_list_list_slice(ava_list_value list,
   return ava_esba_list_copy_of(list, begin, end);
 }
 
+static ava_bool ava_esba_list_should_migrate(ava_list_value list) {
+  return ava_esba_list_list_length(list) >= AVA_RRB_LIST_THRESH &&
+    ava_esba_stale_copy_outs(ava_esba_list_parts_of(list.v).esba) >=
+    AVA_ESBA_LIST_RRB_COPY_OUTS;
+}
+
 static ava_list_value ava_esba_list_list_append(ava_list_value list,
                                                 ava_value elt) {
-  ava_esba esba;
+  size_t length = ava_esba_list_list_length(list);
+  ava_esba_list_parts parts;
   const ava_esba_list_header*restrict header;
 
-  esba = to_esba(list.v);
-  header = ava_esba_list_header_of(esba);
-  esba = ava_esba_list_make_compatible(
-    esba, ava_esba_list_polymorphism(header->template, elt));
-  header = ava_esba_list_header_of(esba);
+  if (AVA_UNLIKELY(ava_esba_list_should_migrate(list)))
+    return ava_list_append(ava_rrb_list_copy_of(list, 0, length), elt);
 
-  pointer swizzled[ava_esba_list_element_size_pointers[header->format]];
-  ava_esba_list_swizzle_down[header->format](swizzled, &elt);
+  parts = ava_esba_list_parts_of(list.v);
+  header = ava_esba_list_header_of(parts.esba);
+  parts = ava_esba_list_make_compatible(
+    parts, ava_esba_list_polymorphism(header->template, elt));
+  ava_esba_list_append_values(&parts, &elt, 1, 1);
 
-  return to_list_value(ava_esba_append(esba, swizzled, 1));
+  return ava_esba_list_of_parts(parts);
 }
 
-static ava_esba ava_esba_list_make_compatible(ava_esba src_esba,
-                                              unsigned new_format) {
-  const ava_esba_list_header* src_header = ava_esba_list_header_of(src_esba);
+static ava_list_value ava_esba_list_list_append_n(
+  ava_list_value list, const ava_value*restrict elements, size_t count
+) {
+  size_t length = ava_esba_list_list_length(list);
+  ava_esba_list_parts parts;
+  const ava_esba_list_header*restrict header;
+  size_t i;
+  unsigned format;
+
+  if (0 == count)
+    return list;
 
-  if (new_format == (new_format & src_header->format))
-    return src_esba;
+  if (AVA_UNLIKELY(ava_esba_list_should_migrate(list)))
+    return ava_list_append_n(
+      ava_rrb_list_copy_of(list, 0, length), elements, count);
 
-  ava_esba dst_esba = ava_esba_list_create_esba(
-    new_format | src_header->format, src_header->template,
-    ava_esba_length(src_esba));
-  return ava_esba_list_concat_esbas(dst_esba, src_esba,
-                                    0, ava_esba_length(src_esba));
+  /* Reformat at most once for the whole batch */
+  parts = ava_esba_list_parts_of(list.v);
+  header = ava_esba_list_header_of(parts.esba);
+  format = 0;
+  for (i = 0; i < count && format != POLYMORPH_ALL; ++i)
+    format |= ava_esba_list_polymorphism(header->template, elements[i]);
+
+  parts = ava_esba_list_make_compatible(parts, format);
+  ava_esba_list_append_values(&parts, elements, count, 1);
+
+  return ava_esba_list_of_parts(parts);
+}
+
+/**
+ * Returns a list with the same contents as src whose format can also hold
+ * elements with the given POLYMORPH_* bits.
+ *
+ * This is where packed lists are widened when a value that does not fit is
+ * added.
+ */
+static ava_esba_list_parts ava_esba_list_make_compatible(
+  ava_esba_list_parts src, unsigned polymorphism
+) {
+  const ava_esba_list_header* src_header = ava_esba_list_header_of(src.esba);
+  ava_esba_list_parts dst;
+
+  if (!(polymorphism & ~ava_esba_list_format_holds[src_header->format]))
+    return src;
+
+  dst = ava_esba_list_empty_parts(
+    ava_esba_list_create_esba(
+      ava_esba_list_choose_format(
+        polymorphism | ava_esba_list_contents(src_header)),
+      src_header->template, src.length));
+  ava_esba_list_concat_esbas(&dst, &src, 0, src.length);
+  return dst;
 }
 
 static ava_list_value ava_esba_list_list_concat(ava_list_value list,
                                                 ava_list_value other) {
-  ava_esba esba = to_esba(list.v);
+  size_t length = ava_esba_list_list_length(list);
+  ava_esba_list_parts parts;
   const ava_esba_list_header*restrict header;
 
   size_t other_length = ava_list_length(other);
 
-  header = ava_esba_list_header_of(esba);
-  esba = ava_esba_list_make_compatible(
-    esba, ava_esba_list_accum_format(other, 0, other_length,
-                                     header->template));
+  if (AVA_UNLIKELY(ava_esba_list_should_migrate(list)))
+    return ava_list_concat(ava_rrb_list_copy_of(list, 0, length), other);
+
+  parts = ava_esba_list_parts_of(list.v);
+  header = ava_esba_list_header_of(parts.esba);
+  parts = ava_esba_list_make_compatible(
+    parts, ava_esba_list_accum_format(other, 0, other_length,
+                                      header->template));
 
-  header = ava_esba_list_header_of(esba);
-  esba = ava_esba_list_append_sublist(esba, header->format,
-                                      other, 0, other_length);
+  ava_esba_list_append_sublist(&parts, other, 0, other_length);
 
-  return to_list_value(esba);
+  return ava_esba_list_of_parts(parts);
 }
 
 static ava_list_value ava_esba_list_list_remove(
   ava_list_value list, size_t begin, size_t end
 ) {
-  ava_esba src_esba = to_esba(list.v);
+  ava_esba_list_parts src = ava_esba_list_parts_of(list.v), dst;
   const ava_esba_list_header*restrict header =
-    ava_esba_list_header_of(src_esba);
-  size_t length = ava_esba_length(src_esba);
+    ava_esba_list_header_of(src.esba);
+  size_t length = ava_esba_list_list_length(list);
 
   assert(begin <= end);
   assert(end <= length);
@@ -388,35 +769,64 @@ static ava_list_value ava_esba_list_list_remove(
   if (begin == end)
     return list;
 
-  ava_esba dst_esba = ava_esba_list_create_esba_with_header(
-    header, length - (end - begin));
-  dst_esba = ava_esba_list_concat_esbas(dst_esba, src_esba, 0, begin);
-  dst_esba = ava_esba_list_concat_esbas(dst_esba, src_esba, end, length);
+  dst = ava_esba_list_empty_parts(
+    ava_esba_list_create_esba_with_header(
+      header, length - (end - begin)));
+  ava_esba_list_concat_esbas(&dst, &src, 0, begin);
+  ava_esba_list_concat_esbas(&dst, &src, end, length);
 
-  return to_list_value(dst_esba);
+  return ava_esba_list_of_parts(dst);
 }
 
 static ava_list_value ava_esba_list_list_set(
   ava_list_value list, size_t index, ava_value value
 ) {
-  ava_esba esba = to_esba(list.v);
+  size_t length = ava_esba_list_list_length(list);
+  ava_esba_list_parts parts;
   const ava_esba_list_header*restrict header;
+  size_t per_word, whole;
 
-  header = ava_esba_list_header_of(esba);
-  esba = ava_esba_list_make_compatible(
-    esba, ava_esba_list_polymorphism(header->template, value));
+  if (AVA_UNLIKELY(ava_esba_list_should_migrate(list)))
+    return ava_list_set(ava_rrb_list_copy_of(list, 0, length), index, value);
 
-  header = ava_esba_list_header_of(esba);
+  parts = ava_esba_list_parts_of(list.v);
+  header = ava_esba_list_header_of(parts.esba);
+  parts = ava_esba_list_make_compatible(
+    parts, ava_esba_list_polymorphism(header->template, value));
+
+  header = ava_esba_list_header_of(parts.esba);
+  per_word = ava_esba_list_elements_per_word[header->format];
+  whole = ava_esba_length(parts.esba) * per_word;
+
+  /* Elements in the tail only need a new tail */
+  if (index >= whole) {
+    ava_esba_list_put[header->format](&parts.tail, index - whole, &value);
+    return ava_esba_list_of_parts(parts);
+  }
+
+  /* For packed formats, replace the whole word containing the element */
+  pointer word[ava_esba_list_element_size_pointers[header->format]];
+  if (per_word > 1)
+    ava_esba_list_read_word(parts.esba, index / per_word, word);
+
+  ava_esba_list_put[header->format](word, index % per_word, &value);
+  parts.esba = ava_esba_set(parts.esba, index / per_word, word);
+
+  return ava_esba_list_of_parts(parts);
+}
+
+const void* ava_esba_list_common_attr(ava_list_value list) {
+  const ava_esba_list_header*restrict header;
 
-  pointer swizzled[ava_esba_list_element_size_pointers[header->format]];
-  ava_esba_list_swizzle_down[header->format](swizzled, &value);
-  esba = ava_esba_set(esba, index, swizzled);
+  header = ava_get_attribute(list.v, &ava_esba_list_header_tag);
+  if (!header ||
+      (ava_esba_list_format_holds[header->format] & POLYMORPH_ATTR))
+    return NULL;
 
-  return to_list_value(esba);
+  return ava_value_attr(header->template);
 }
 
-size_t ava_esba_list_element_size(ava_value list) {
-  ava_esba esba = to_esba(list);
-  return ava_esba_list_element_size_pointers[
-    ava_esba_list_header_of(esba)->format] * sizeof(pointer);
+size_t ava_esba_list_element_bits(ava_value list) {
+  return ava_esba_list_format_bits[
+    ava_esba_list_header_of(ava_esba_list_parts_of(list).esba)->format];
 }
@@ -200,6 +200,36 @@ static inline void static_assert_ao_t_can_hold_pointer(void) {
   }
 }
 
+#ifdef AVA_ESBA_STATS
+/**
+ * The process-wide counters reported by ava_esba_get_stats(), with the same
+ * meanings as the fields of ava_esba_stats.
+ */
+static struct {
+  AO_t cas_failures;
+  AO_t copy_outs;
+  AO_t stale_copy_outs;
+  AO_t lost_freshen_races;
+  AO_t replayed_entries;
+  AO_t longest_replay;
+} ava_esba_stat;
+
+#define AVA_ESBA_STAT_INC(field) AO_fetch_and_add1(&ava_esba_stat.field)
+#define AVA_ESBA_STAT_ADD(field, n) \
+  AO_fetch_and_add(&ava_esba_stat.field, (n))
+
+static void ava_esba_stat_max(AO_t* dst, AO_t n) {
+  AO_t old;
+
+  do {
+    old = AO_load(dst);
+  } while (n > old && !AO_compare_and_swap(dst, old, n));
+}
+#else
+#define AVA_ESBA_STAT_INC(field) ((void)0)
+#define AVA_ESBA_STAT_ADD(field, n) ((void)0)
+#endif
+
 /**
  * Data within an ESBA is managed in terms of pointer-sized blocks rather than
  * bytes.
@@ -227,6 +257,17 @@ typedef struct {
    */
   void* (*allocator)(size_t);
 
+  /**
+   * The number of times a stale handle has had to copy this array, or an array
+   * from which this one was copied, out to a fresh array.
+   *
+   * This is only a heuristic for clients; it is incremented without any
+   * ordering constraints, and races may cause increments to be lost.
+   *
+   * @see ava_esba_stale_copy_outs()
+   */
+  AO_t stale_copy_outs;
+
   /**
    * The size of the dead segment, in pointers.
    *
@@ -444,6 +485,7 @@ static ava_esba_array* ava_esba_array_new(
 
   array->element_size = element_size;
   array->allocator = allocator;
+  array->stale_copy_outs = 0;
   array->dead_segment_size = initial_capacity * element_size +
     sizeof_ptr(ava_esba_undead_element);
   array->end = array->data + initial_capacity * element_size +
@@ -628,6 +670,8 @@ static ava_esba_handle_value ava_esba_handle_make_fresh(
     if (AO_compare_and_swap_release_write(
           &handle->head, (AO_t)old.head, (AO_t)copy)) {
       AO_store_release_write(&handle->version, (AO_t)copy->end);
+    } else {
+      AVA_ESBA_STAT_INC(lost_freshen_races);
     }
   }
 }
@@ -668,6 +712,26 @@ static ava_esba_array* ava_esba_handle_copy_out(
       &old.head->true_version);
   const ava_esba_undead_element* end = old.version;
 
+  /* If the handle is stale (as opposed to merely truncating or out of space),
+   * count the copy-out against the source array's lineage so that clients can
+   * notice when an array is being heavily shared between versions.
+   */
+  if (start != end)
+    AO_fetch_and_add1(&old.head->stale_copy_outs);
+  dst->stale_copy_outs = AO_load(&old.head->stale_copy_outs);
+
+#ifdef AVA_ESBA_STATS
+  AVA_ESBA_STAT_INC(copy_outs);
+  if (start != end) {
+    AO_t replayed = ((const pointer*)end - (const pointer*)start) /
+      (old.head->element_size + sizeof_ptr(ava_esba_undead_element));
+
+    AVA_ESBA_STAT_INC(stale_copy_outs);
+    AVA_ESBA_STAT_ADD(replayed_entries, replayed);
+    ava_esba_stat_max(&ava_esba_stat.longest_replay, replayed);
+  }
+#endif
+
   /* Replay the undo log from newest to oldest, since older entries take
    * precedence.
    *
@@ -787,6 +851,36 @@ ava_esba ava_esba_set(ava_esba esba, size_t index, const void*restrict data) {
   return esba;
 }
 
+size_t ava_esba_stale_copy_outs(ava_esba esba) {
+  return AO_load(&ava_esba_handle_read(esba.handle).head->stale_copy_outs);
+}
+
+ava_bool ava_esba_get_stats(ava_esba_stats* dst) {
+#ifdef AVA_ESBA_STATS
+  dst->cas_failures = AO_load(&ava_esba_stat.cas_failures);
+  dst->copy_outs = AO_load(&ava_esba_stat.copy_outs);
+  dst->stale_copy_outs = AO_load(&ava_esba_stat.stale_copy_outs);
+  dst->lost_freshen_races = AO_load(&ava_esba_stat.lost_freshen_races);
+  dst->replayed_entries = AO_load(&ava_esba_stat.replayed_entries);
+  dst->longest_replay = AO_load(&ava_esba_stat.longest_replay);
+  return ava_true;
+#else
+  memset(dst, 0, sizeof(*dst));
+  return ava_false;
+#endif
+}
+
+void ava_esba_reset_stats(void) {
+#ifdef AVA_ESBA_STATS
+  AO_store(&ava_esba_stat.cas_failures, 0);
+  AO_store(&ava_esba_stat.copy_outs, 0);
+  AO_store(&ava_esba_stat.stale_copy_outs, 0);
+  AO_store(&ava_esba_stat.lost_freshen_races, 0);
+  AO_store(&ava_esba_stat.replayed_entries, 0);
+  AO_store(&ava_esba_stat.longest_replay, 0);
+#endif
+}
+
 static void ava_esba_make_mutable(
   ava_esba*restrict esba,
   ava_esba_handle_value*restrict val,
@@ -824,6 +918,9 @@ static void ava_esba_make_mutable(
     /* Either not enough space, stale or truncating reference, or conflicting
      * write; need to copy.
      */
+    if (required_space <= believed_dead_size)
+      AVA_ESBA_STAT_INC(cas_failures);
+
     val->head = ava_esba_handle_copy_out(
       esba->handle, believed_live_size, esba->length,
       new_capacity * 2 * val->head->element_size);
@@ -40,13 +40,19 @@
 static ava_value_trait ava_function_generic_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
   .name = "function",
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
 
 AVA_LIST_DEFIMPL(ava_function, &ava_function_generic_impl)
 
+/**
+ * The number of elements of a spread list read at a time when exploding it
+ * into separate parameters.
+ */
+#define AVA_FUNCTION_SPREAD_BLOCK 64
+
 typedef union {
   /* For integer return values */
   ffi_arg returned_uint;
@@ -918,7 +924,7 @@ void ava_function_apply_bind(
   const size_t variadic_collection[]
 ) {
   size_t arg, parm, i;
-  ava_list_value accum;
+  ava_list_builder accum;
 
   for (arg = 0; arg < num_args; ++arg) {
     switch (bound_args[arg].type) {
@@ -933,16 +939,17 @@ void ava_function_apply_bind(
       break;
 
     case ava_fbat_collect:
-      accum = ava_empty_list();
+      ava_list_builder_init(&accum);
       for (i = 0; i < bound_args[arg].v.collection_size; ++i) {
         parm = variadic_collection[i];
         assert(ava_fpt_dynamic != parms[parm].type);
         if (parms[parm].type == ava_fpt_static)
-          accum = ava_list_append(accum, parms[parm].value);
+          ava_list_builder_append(&accum, parms[parm].value);
         else
-          accum = ava_list_concat(accum, ava_list_value_of(parms[parm].value));
+          ava_list_builder_concat(
+            &accum, ava_list_value_of(parms[parm].value));
       }
-      arguments[arg] = accum.v;
+      arguments[arg] = ava_list_builder_list(&accum).v;
       break;
     }
   }
@@ -1222,9 +1229,10 @@ ava_value ava_function_bind_invoke(
 static void ava_function_explode(size_t* num_parms_p,
                                  const ava_function_parameter** parms_p) {
   size_t num_parms = *num_parms_p;
-  size_t exploded_count, i, j;
+  size_t exploded_count, i, j, k, n;
   ava_function_parameter* exploded;
   const ava_function_parameter* parms = *parms_p;
+  ava_value block[AVA_FUNCTION_SPREAD_BLOCK];
   ava_list_value list;
   size_t list_len;
 
@@ -1245,9 +1253,19 @@ static void ava_function_explode(size_t* num_parms_p,
     if (ava_fpt_spread == parms[i].type) {
       list = ava_list_value_of(parms[i].value);
       list_len = ava_list_length(list);
-      for (j = 0; j < list_len; ++j) {
-        exploded[exploded_count].type = ava_fpt_static;
-        exploded[exploded_count++].value = ava_list_index(list, j);
+      /* Read in blocks so that a long spread costs one index_range() call per
+       * block rather than one index() call per element.
+       */
+      for (j = 0; j < list_len; j += n) {
+        n = list_len - j;
+        if (n > AVA_FUNCTION_SPREAD_BLOCK)
+          n = AVA_FUNCTION_SPREAD_BLOCK;
+
+        ava_list_index_range(list, j, j + n, block);
+        for (k = 0; k < n; ++k) {
+          exploded[exploded_count].type = ava_fpt_static;
+          exploded[exploded_count++].value = block[k];
+        }
       }
     } else {
       exploded[exploded_count].type = ava_fpt_static;
@@ -1278,6 +1296,12 @@ void ava_function_partial(ava_argument_spec*restrict argspecs,
                   ava_error_partial_function_apply_too_many_args());
 }
 
+static void ava_function_list_index_range(
+  ava_list_value l, size_t begin, size_t end, ava_value*restrict dst
+) {
+  ava_list_index_range_by_index(l, begin, end, dst);
+}
+
 static ava_list_value ava_function_list_slice(ava_list_value l,
                                               size_t b, size_t e) {
   return ava_list_copy_slice(l, b, e);
@@ -1287,6 +1311,12 @@ static ava_list_value ava_function_list_append(ava_list_value l, ava_value v) {
   return ava_list_copy_append(l, v);
 }
 
+static ava_list_value ava_function_list_append_n(
+  ava_list_value l, const ava_value*restrict elements, size_t count
+) {
+  return ava_list_copy_append_n(l, elements, count);
+}
+
 static ava_list_value ava_function_list_concat(ava_list_value l,
                                                ava_list_value o) {
   return ava_list_copy_concat(l, o);
@@ -704,6 +704,34 @@ set defs {
     }
   }
 
+  serror R0064 file_read_failed {
+    {ava_string filename} {ava_string reason}
+  } {
+    msg "Failed to read \"%filename%\": %reason%"
+    explanation {
+      The named file could not be opened or read.
+    }
+  }
+
+  serror R0065 numeric_lists_not_of_same_length {
+    {ava_integer expected} {ava_integer actual}
+  } {
+    msg "Numeric lists have different length (%expected% vs %actual%)"
+    explanation {
+      Element-wise numeric list operations, such as integer.dot and real.dot,
+      require both lists to have the same length.
+    }
+  }
+
+  serror R0066 file_write_failed {
+    {ava_string filename} {ava_string reason}
+  } {
+    msg "Failed to write \"%filename%\": %reason%"
+    explanation {
+      The named file could not be created or written.
+    }
+  }
+
   serror U3000 undef_integer_overflow {
     {ava_integer a} {ava_string op} {ava_integer b}
   } {
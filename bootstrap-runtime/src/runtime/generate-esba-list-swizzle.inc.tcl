@@ -17,22 +17,77 @@
 set ATTR 1
 set ULONG 2
 
+# Requirement bits beyond ATTR and ULONG: each bit-packed format has a bit
+# which a value sets if it is not an integer that format can represent, so a
+# packed format can hold a set of values exactly when none of them sets its
+# bit. (The names are historical: a value sets WIDTH_8 if it needs more than
+# one bit, WIDTH_16 if it needs more than a signed byte, and so on, and
+# WIDTH_U16 if it needs more than an unsigned byte.) Values which are not
+# integers set all of them.
+set WIDTH_8 4
+set WIDTH_16 8
+set WIDTH_32 16
+set WIDTH_64 32
+set WIDTH_U16 64
+set WIDTH_ALL [expr {$WIDTH_8|$WIDTH_16|$WIDTH_32|$WIDTH_64|$WIDTH_U16}]
+
+# The bit-packed formats, which follow the four swizzled formats, in order of
+# preference. Each is {width min max bit}, giving the range of integers it
+# holds and the requirement bit set by values outside that range. The 1-bit
+# format is unsigned so that it holds booleans, and there are both signed and
+# unsigned 8-bit formats so that byte buffers stay 8 bits wide.
+set packed {
+  {1 0 1 WIDTH_8}
+  {8 -0x80 0x7F WIDTH_16}
+  {8 0 0xFF WIDTH_U16}
+  {16 -0x8000 0x7FFF WIDTH_32}
+  {32 -0x80000000 0x7FFFFFFF WIDTH_64}
+}
+set nformats [expr {4 + [llength $packed]}]
+
+# Returns the requirement bits set by some integer the given packed format can
+# hold; ie, the bits of every packed format whose range does not contain the
+# whole range of the given one.
+proc packed_holds {format} {
+  global packed
+  lassign $format width min max
+  set ret 0
+  foreach other $packed {
+    lassign $other owidth omin omax obit
+    global $obit
+    if {$min < $omin || $max > $omax} {
+      set ret [expr {$ret | [set $obit]}]
+    }
+  }
+  return $ret
+}
+
 puts {
 /* This file was generated by generate-esba-list-swizzle.inc.tcl.
  * Do not edit directly.
  */
 
-typedef void (*ava_esba_list_swizzle_down_f)(
-  void*restrict dst, const ava_value*restrict src);
-typedef void (*ava_esba_list_swizzle_up_f)(
+typedef void (*ava_esba_list_get_f)(
   ava_value*restrict dst, const ava_value*restrict template,
-  const void*restrict src);
+  const void*restrict base, size_t index);
+typedef void (*ava_esba_list_put_f)(
+  void*restrict base, size_t index, const ava_value*restrict src);
 }
 
 puts ""
 puts "#define POLYMORPH_ATTR $ATTR"
 puts "#define POLYMORPH_ULONG $ULONG"
-puts "#define POLYMORPH_ALL ($ATTR|$ULONG)"
+puts "#define POLYMORPH_SHAPE ($ATTR|$ULONG)"
+puts "#define POLYMORPH_WIDTH_8 $WIDTH_8"
+puts "#define POLYMORPH_WIDTH_16 $WIDTH_16"
+puts "#define POLYMORPH_WIDTH_32 $WIDTH_32"
+puts "#define POLYMORPH_WIDTH_64 $WIDTH_64"
+puts "#define POLYMORPH_WIDTH_U16 $WIDTH_U16"
+puts "#define POLYMORPH_WIDTH_ALL $WIDTH_ALL"
+puts "#define POLYMORPH_ALL ($ATTR|$ULONG|$WIDTH_ALL)"
+puts ""
+puts "#define AVA_ESBA_LIST_FIRST_PACKED_FORMAT 4"
+puts "#define AVA_ESBA_LIST_NUM_FORMATS $nformats"
 puts ""
 
 for {set i 0} {$i < 4} {incr i} {
@@ -49,10 +104,16 @@ for {set i 0} {$i < 4} {incr i} {
   puts "} ava_esba_list_swizzled_$i;"
   puts ""
 
-  puts "static void ava_esba_list_swizzle_down_${i}("
-  puts "  ava_esba_list_swizzled_$i*restrict dst,"
+  puts "static void ava_esba_list_put_${i}("
+  puts "  void*restrict base,"
+  puts "  size_t index,"
   puts "  const ava_value*restrict src"
   puts ") {"
+  puts "  ava_esba_list_swizzled_$i*restrict dst ="
+  puts "    (ava_esba_list_swizzled_$i*restrict)base + index;"
+  if {!$attr && !$ulong} {
+    puts "  (void)dst;"
+  }
   foreach field {attr ulong} {
     if {[set $field]} {
       puts "  dst->$field = ava_value_${field}(*src);"
@@ -61,13 +122,19 @@ for {set i 0} {$i < 4} {incr i} {
   puts "}"
   puts ""
 
-  puts "static void ava_esba_list_swizzle_up_${i}("
+  puts "static void ava_esba_list_get_${i}("
   puts "  ava_value*restrict dst,"
   puts "  const ava_value*restrict template,"
-  puts "  const ava_esba_list_swizzled_$i*restrict src"
+  puts "  const void*restrict base,"
+  puts "  size_t index"
   puts ") {"
+  puts "  const ava_esba_list_swizzled_$i*restrict src ="
+  puts "    (const ava_esba_list_swizzled_$i*restrict)base + index;"
   puts "  const ava_attribute*restrict attr;"
   puts "  ava_ulong ulong;"
+  if {!$attr && !$ulong} {
+    puts "  (void)src;"
+  }
   foreach field {attr ulong} {
     if {[set $field]} {
       puts "  $field = src->$field;"
@@ -80,26 +147,134 @@ for {set i 0} {$i < 4} {incr i} {
   puts ""
 }
 
-puts "static const size_t ava_esba_list_element_size_pointers\[4\] = {"
+set i 4
+foreach format $packed {
+  lassign $format width min max
+  set per_word [expr {64 / $width}]
+  set mask [format "0x%llX" [expr {(1 << $width) - 1}]]
+  if {0 == $min} {
+    set extract "(ava_slong)(word >> shift & $mask)"
+  } else {
+    set extract [format "(ava_s%s)(word >> shift)" \
+                     [dict get {8 byte 16 short 32 int} $width]]
+  }
+
+  puts "static void ava_esba_list_put_${i}("
+  puts "  void*restrict base,"
+  puts "  size_t index,"
+  puts "  const ava_value*restrict src"
+  puts ") {"
+  puts "  ava_ulong*restrict word = (ava_ulong*restrict)base + index / $per_word;"
+  puts "  unsigned shift = index % $per_word * $width;"
+  puts ""
+  puts "  *word = (*word & ~((ava_ulong)$mask << shift)) |"
+  puts "    ((ava_value_ulong(*src) & $mask) << shift);"
+  puts "}"
+  puts ""
+
+  puts "static void ava_esba_list_get_${i}("
+  puts "  ava_value*restrict dst,"
+  puts "  const ava_value*restrict template,"
+  puts "  const void*restrict base,"
+  puts "  size_t index"
+  puts ") {"
+  puts "  ava_ulong word = ((const ava_ulong*restrict)base)\[index / $per_word\];"
+  puts "  unsigned shift = index % $per_word * $width;"
+  puts ""
+  puts "  *dst = ava_value_with_slong(ava_value_attr(*template),"
+  puts "                              $extract);"
+  puts "}"
+  puts ""
+
+  incr i
+}
+
+puts "/**"
+puts " * Returns the POLYMORPH_WIDTH_* bits required to store the given value."
+puts " */"
+puts "static unsigned ava_esba_list_width(ava_value value) {"
+puts "  ava_slong i;"
+puts "  unsigned ret;"
+puts ""
+puts "  if (&ava_integer_type != ava_value_attr(value))"
+puts "    return POLYMORPH_WIDTH_ALL;"
+puts ""
+puts "  i = ava_value_slong(value);"
+puts "  ret = 0;"
+foreach format $packed {
+  lassign $format width min max bit
+  puts "  if (i < ${min}LL || i > ${max}LL)"
+  puts "    ret |= POLYMORPH_$bit;"
+}
+puts "  return ret;"
+puts "}"
+puts ""
+
+puts "/**"
+puts " * The size of each element of the underlying ESBA, in pointers. For the"
+puts " * packed formats, each ESBA element is a word holding several list elements."
+puts " */"
+puts "static const size_t ava_esba_list_element_size_pointers\[$nformats\] = {"
 for {set i 0} {$i < 4} {incr i} {
   puts "  sizeof(ava_esba_list_swizzled_$i) / sizeof(void*),"
 }
+foreach format $packed {
+  puts "  sizeof(ava_ulong) / sizeof(void*),"
+}
+puts "};"
+puts ""
+
+puts "/**"
+puts " * The number of list elements held in each element of the underlying ESBA."
+puts " */"
+puts "static const size_t ava_esba_list_elements_per_word\[$nformats\] = {"
+for {set i 0} {$i < 4} {incr i} {
+  puts "  1,"
+}
+foreach format $packed {
+  puts "  [expr {64 / [lindex $format 0]}],"
+}
 puts "};"
 puts ""
 
-puts "static const ava_esba_list_swizzle_down_f"
-puts "ava_esba_list_swizzle_down\[4\] = {"
+puts "/**"
+puts " * The number of bits of storage used by each list element."
+puts " */"
+puts "static const size_t ava_esba_list_format_bits\[$nformats\] = {"
 for {set i 0} {$i < 4} {incr i} {
-  puts "  (ava_esba_list_swizzle_down_f)ava_esba_list_swizzle_down_$i,"
+  puts "  sizeof(ava_esba_list_swizzled_$i) * 8,"
+}
+foreach format $packed {
+  puts "  [lindex $format 0],"
 }
 puts "};"
 puts ""
 
-puts "static const ava_esba_list_swizzle_up_f"
-puts "ava_esba_list_swizzle_up\[4\] = {"
+puts "/**"
+puts " * The POLYMORPH_* bits which each format can accommodate."
+puts " */"
+puts "static const unsigned ava_esba_list_format_holds\[$nformats\] = {"
 for {set i 0} {$i < 4} {incr i} {
-  puts "  (ava_esba_list_swizzle_up_f)ava_esba_list_swizzle_up_$i,"
+  puts "  [expr {$i | $WIDTH_ALL}],"
+}
+foreach format $packed {
+  puts "  [expr {$ULONG | [packed_holds $format]}],"
+}
+puts "};"
+puts ""
+
+puts "static const ava_esba_list_put_f"
+puts "ava_esba_list_put\[$nformats\] = {"
+for {set i 0} {$i < $nformats} {incr i} {
+  puts "  ava_esba_list_put_$i,"
 }
 puts "};"
 puts ""
 
+puts "static const ava_esba_list_get_f"
+puts "ava_esba_list_get\[$nformats\] = {"
+for {set i 0} {$i < $nformats} {incr i} {
+  puts "  ava_esba_list_get_$i,"
+}
+puts "};"
+puts ""
@@ -662,9 +662,11 @@ proc gen-impl {} {
         const ava_pcode_NAME_list* list,
         ava_uint indent
       \) \{
-        ava_string accum = AVA_EMPTY_STRING, elt_string;
+        ava_string_builder accum;
         const ava_pcode_NAME* velt;
+        ava_string_builder_init(&accum, 0);
         TAILQ_FOREACH(velt, list, next) \{
+          ava_pcode_begin_elt_string(&accum, indent);
           switch (velt->type) \{
     } NAME $sname
     dict for {ename elt} [dict get $struct elts] {
@@ -672,29 +674,34 @@ proc gen-impl {} {
         case ava_pcMNEt_ELT: \{
           const ava_pcMNE_ELT* elt AVA_UNUSED;
           elt = (const ava_pcMNE_ELT*)velt;
-          elt_string = AVA_ASCII9_STRING("%ELT");
+          ava_string_builder_append_bytes\(
+            &accum, "%ELT", sizeof("%ELT") - 1\);
       } MNE $smne ELT $ename
       foreach field [dict get $elt fields] {
         set ftype [dict get $field type]
         if {[is-substruct $ftype]} {
           lassign $ftype cname cmne
           putm {
-            elt_string = ava_strcat\(
-              elt_string, AVA_ASCII9_STRING(" ")\);
-            elt_string = ava_strcat\(
-              elt_string, ava_list_escape\(
+            ava_string_builder_append_bytes(&accum, " ", 1);
+            ava_string_builder_append_string\(
+              &accum, ava_list_escape\(
                 ava_value_of_string\(
                   ava_strcat\(
                     AVA_ASCII9_STRING("\n"),
                     ava_pcode_CNAME_list_to_string\(
                       elt->FIELD, indent+1\)\)\)\)\);
           } CNAME $cname FIELD [dict get $field name]
+        } elseif {"int" eq $ftype} {
+          # Decimal integers never need escaping
+          putm {
+            ava_string_builder_append_bytes(&accum, " ", 1);
+            ava_string_builder_append_integer(&accum, elt->FIELD);
+          } FIELD [dict get $field name]
         } else {
           putm {
-            elt_string = ava_strcat\(
-              elt_string, AVA_ASCII9_STRING(" ")\);
-            elt_string = ava_strcat\(
-              elt_string, ava_list_escape\(
+            ava_string_builder_append_bytes(&accum, " ", 1);
+            ava_string_builder_append_string\(
+              &accum, ava_list_escape\(
                 ava_value_of_string\(
                   ava_pcode_TYPE_to_string(elt->FIELD)\)\)\);
           } TYPE $ftype FIELD [dict get $field name]
@@ -708,12 +715,9 @@ proc gen-impl {} {
     putm {
           default: /* unreachable */ abort();
           \} /* switch (velt->type) */
-          accum = ava_strcat\(
-            accum, apply_indent\(
-              ava_pcode_elt_escape(elt_string), indent\)\);
-          accum = ava_strcat(accum, AVA_ASCII9_STRING("\n"));
+          ava_string_builder_append_bytes(&accum, "]\n", 2);
         \} /* end foreach */
-        return accum;
+        return ava_string_builder_finish(&accum);
       \}
     }
 
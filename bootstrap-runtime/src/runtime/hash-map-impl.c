@@ -21,6 +21,21 @@
 #include <string.h>
 #include <assert.h>
 
+#if defined(__SSE2__) && defined(HAVE_EMMINTRIN_H)
+#include <emmintrin.h>
+#define AVA_HASH_MAP_SSE2 1
+#endif
+
+/* A lane of 16-bit indices has 32 tags, which AVX2 can match in one compare.
+ * Unlike the string kernels, this is only used when the whole build targets
+ * AVX2, since an indirect call per probe would cost more than it saves.
+ */
+#if defined(__AVX2__) && defined(HAVE_IMMINTRIN_H) && \
+  defined(AVA_HASH_MAP_SSE2)
+#include <immintrin.h>
+#define AVA_HASH_MAP_AVX2 1
+#endif
+
 #include <atomic_ops.h>
 
 #define AVA__INTERNAL_INCLUDE 1
@@ -28,26 +43,46 @@
 #include "avalanche/alloc.h"
 #include "avalanche/string.h"
 #include "avalanche/value.h"
+#include "avalanche/integer.h"
 #include "avalanche/list.h"
 #include "avalanche/list-proj.h"
 #include "avalanche/map.h"
 #include "-esba.h"
 #include "-esba-list.h"
 #include "-hash-map.h"
+#include "-parallel.h"
 
 #define TYPE AVA_HASH_MAP_HASH_TYPE
 #define ASCII9_COLLISION_THRESH 32
+/* Much higher than for ASCII9, since ordinary clustering routinely produces
+ * runs of a few dozen probes; an actual attack produces runs about as long as
+ * the number of keys the attacker controls.
+ */
+#define FAST_COLLISION_THRESH 256
+/* Integer keys are scattered about as well as by the fast hash, so ordinary
+ * clustering looks the same.
+ */
+#define INTEGER_COLLISION_THRESH 256
 #define ASCII9_SIZE_THRESH (1 << 24)
 #define SIZE_THRESH (1ULL << (sizeof(TYPE)*8 * 3/4))
 #define COLLISION_SHIFT_AMT 4
 #define BME_BITS (sizeof(ava_ulong) * 8)
 #define LANE_SIZE_BYTES 64
 #define LANE_SIZE (LANE_SIZE_BYTES / sizeof(TYPE))
+#define LANE_MASK ((1ULL << LANE_SIZE) - 1)
 #define MIN_CAPACITY LANE_SIZE
+#define TAG_BITS 7
+#define TAG_EMPTY 0x80
+/* Tables for at least this many elements are built in parallel */
+#define BULK_THRESH (1 << 16)
+/* The number of elements hashed by each work item of a bulk build */
+#define BULK_CHUNK_SIZE (1 << 14)
+/* The number of keys fetched from the keys list at once during a bulk build */
+#define BULK_BLOCK_SIZE 64
 
 /*
 
-  The hash-map is essentially composed of six parts:
+  The hash-map is essentially composed of seven parts:
 
   - The keys array, an ESBA list containing every even-indexed list element.
 
@@ -55,9 +90,15 @@
 
   - The index array, which is the hash table proper.
 
+  - The tag array, which holds a few bits of the hash of each entry in the
+    index array so that whole lanes can be searched at once.
+
   - The hash cache, which is an array of hash values parallel to the keys
     array, to speed rehashing and collision handling.
 
+  - The tag cache, which holds the tag of each element of the hash cache so
+    that tables can be rebuilt from the cache alone.
+
   - The deletion bitmap, which tracks soft-deletions of elements.
 
   - The list-index table, which corrects list indices in the presence of soft
@@ -124,7 +165,7 @@
   attempt, the number of prior attempts is added to the hash before the AND, so
   eventually the scheme reduces to simple linear probing.
 
-  There are two hash functions used with the index array:
+  There are four hash functions used with the index array:
 
   ASCII9 hashing is used for the very common case of all keys being relatively
   small, printable, ASCII strings. It uses ava_ascii9_hash(), and is thus
@@ -139,12 +180,111 @@
   - No key collides more than ASCII9_COLLISION_THRESH times.
 
   When any of the above conditions cease to apply, the table is rehashed using
-  ava_value_hash(), which has none of these limitations.
+  the function selected by the map's hash strategy.
+
+  Integer hashing is used in the similarly common case of all keys being
+  integers, such as identifiers or offsets. It runs the integer itself
+  through ava_hash_map_integer_hash(), a cheap bijective mixer, rather than
+  hashing its string representation. The mixer is unkeyed and trivially
+  inverted, so it is as susceptable to malicious collisions as ASCII9
+  hashing; its use is restricted to the following conditions:
+
+  - All keys have ava_integer_type as their attribute. (Integers in any other
+    form, such as strings, are not considered, since they may not be in
+    normal form, and so may not even equal the integer they parse to.)
+
+  - No key collides more than INTEGER_COLLISION_THRESH times.
+
+  When either condition ceases to apply, the table is rehashed using the
+  function selected by the map's hash strategy, as with ASCII9 hashing.
+
+  Fast hashing uses ava_value_hash_fast(), and is used in place of value
+  hashing when the map was constructed with the ava_vhs_fast strategy. It is
+  much cheaper than SipHash, but its resistance to malicious collisions rests
+  only on the secrecy of the process key; so, like ASCII9 hashing, a table
+  using it is rehashed with value hashing if any key collides more than
+  FAST_COLLISION_THRESH times.
+
+  Value hashing uses ava_value_hash(), which has none of these limitations.
+  Tables never move from a stronger function to a weaker one, so a map that
+  has fallen back to value hashing continues to use it through all further
+  modifications.
 
   The index array is doubled in size whenever it reaches 75% capacity.
 
-  The index array shares its structure with the hash cache, so that the two can
-  share the same concurrency control.
+  BULK CONSTRUCTION
+  -----------------
+
+  Building a table for BULK_THRESH or more elements from scratch, whether
+  for a new map or on a rehash, is split across the worker pool when there is
+  one. The index array is allocated at its final size up front, then:
+
+  - Each chunk of BULK_CHUNK_SIZE elements is hashed in parallel into the hash
+    cache (unless the hash cache can be reused), counting how many elements
+    have their first lane in each of a number of equal, contiguous partitions
+    of the index array.
+
+  - Each chunk then scatters its element indices into an array grouped by
+    partition, in the position given by a prefix sum of those counts. Within
+    a partition, elements thus remain in insertion order.
+
+  - Each partition is filled in parallel, placing each element in its first
+    lane exactly as a serial insertion would. An element whose first lane is
+    already full is deferred, since the rest of its probe sequence may belong
+    to another partition.
+
+  - The deferred elements, which are usually few, are inserted serially in
+    insertion order.
+
+  Every element is still placed in the first free slot of its probe sequence,
+  and elements with equal hashes (in particular, equal keys) share a first
+  lane and so are placed in insertion order, so searches behave exactly as
+  with a serially-built table. The exact layout can differ from a serial
+  build, since a deferred element may land after a later one; but only
+  elements inserted after the build can ever be cleared from the table by a
+  fork, and those are inserted serially.
+
+  If any key turns out not to be accepted by the chosen hash function, or a
+  deferred element exceeds the collision threshold, the table is discarded
+  and built serially, which handles those cases as usual.
+
+  The index array shares its structure with the tag array and hash cache, so
+  that all three can share the same concurrency control.
+
+  TAG ARRAY
+  ---------
+
+  The tag array holds one byte per slot of the index array. A slot which has
+  never been written has the tag TAG_EMPTY, which is the only tag with the
+  high bit set; otherwise, the tag is the top TAG_BITS bits of the full 64-bit
+  hash of the entry in the slot, taken before the hash is truncated to the
+  width of the table. (The low bits are no use, since they already determine
+  where the entry lives; and for narrow tables, the top bits of the truncated
+  hash overlap the bits that select the lane as soon as the table has more
+  than a few hundred slots, which would make the tags of a lane all alike.)
+
+  ASCII9 hashes are only 32 bits wide, so they are replicated into the upper
+  half of the full hash. ASCII9 tables never exceed ASCII9_SIZE_THRESH
+  elements, so the top bits of the 32-bit hash are still clear of the lane.
+
+  Since the tag cannot be recovered from the truncated hash in the hash cache,
+  the tag of every element is kept in the tag cache alongside it.
+
+  Searches compare every tag in a lane against the tag of the query at once,
+  and only look at the index array, hash cache, and keys of slots whose tags
+  match. With 7 bits, all but 1 in 128 non-matching slots are rejected this
+  way, which is what makes long probe sequences through full lanes cheap.
+
+  Writers write the tag of a slot before the index. A reader which sees a tag
+  but not the index will see an indeterminate cursor greater than its own
+  length, and so treats it as not present; and a reader which sees the empty
+  tag of a slot just being written treats it as an empty slot, which is
+  correct since anything written to it is beyond the reader's length as well.
+
+  A slot holding a cursor beyond a reader's length but a non-empty, different
+  tag does not end the reader's search, though an empty slot would have.
+  This is harmless: every entry visible to the reader was inserted before
+  anything in that slot, and so cannot be further along the probe sequence.
 
   DELETION BITMAP
   ---------------
@@ -183,7 +323,8 @@
 
   When searching for a slot, the first index that is used is simply the hash
   code truncated by the table mask. If that slot is taken, each other slot in
-  the same lane is tested circularly.
+  the same lane is tested circularly. In practise, each lane is examined as a
+  whole via its tags, and the results rotated into this order.
 
   If all elements in the lane are used, a hash bias is added and the process
   repeats. The first hash bias is the original hash code right-shifted by
@@ -205,7 +346,16 @@ typedef enum {
    * Indicates that the hash function in use is ava_string_hash(), and thus
    * that all keys are ASCII9 strings.
    */
-  ava_hmhf_ascii9
+  ava_hmhf_ascii9,
+  /**
+   * Indicates that the hash function in use is ava_value_hash_fast().
+   */
+  ava_hmhf_fast,
+  /**
+   * Indicates that the hash function in use is ava_hash_map_integer_hash(),
+   * and thus that all keys are integers with ava_integer_type.
+   */
+  ava_hmhf_integer
 } ava_hash_map_hash_function;
 
 static const ava_attribute_tag ava_hash_map_tag = {
@@ -238,9 +388,29 @@ typedef struct {
    * Values beyond the visible length of keys have undefined content.
    *
    * This is part of the same allocation as the ava_hash_map_index structure,
-   * immediately following indices. Its length is 3/4 the value of (mask+1).
+   * immediately following tags. Its length is 3/4 the value of (mask+1).
    */
   TYPE*restrict hash_cache;
+  /**
+   * Array of tags parallel to hash_cache, as per ava_hash_map_tag_of().
+   *
+   * This is part of the same allocation as the ava_hash_map_index structure,
+   * immediately following hash_cache, and has the same length.
+   */
+  unsigned char*restrict tag_cache;
+  /**
+   * Array of tags parallel to indices.
+   *
+   * This is part of the same allocation as the ava_hash_map_index structure,
+   * immediately following indices, and so is also aligned to LANE_SIZE_BYTES.
+   *
+   * Readers: Tags of slots holding cursors less than their own length are
+   * stable and accurate. Other tags are indeterminate.
+   *
+   * Writers: Tags may only be written immediately before the corresponding
+   * slot in indices, under the same conditions.
+   */
+  unsigned char* tags;
   /**
    * Map from reduced hash values to indices in the keys/values arrays.
    *
@@ -320,11 +490,17 @@ typedef struct {
    * not affect correctness.
    */
   AO_t /* const ava_hash_map_list_indices*restrict */ effective_indices;
+
+  /**
+   * The strategy with which this map was constructed, which determines the
+   * hash function used when ASCII9 hashing is unsuitable.
+   */
+  ava_value_hash_strategy hash_strategy;
 } ava_hash_map;
 
 static const ava_value_trait ava_hash_map_value_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
@@ -337,6 +513,10 @@ static ava_bool is_ascii9_string(ava_value value) {
     (ava_value_ulong(value) & 1);
 }
 
+static ava_bool is_integer(ava_value value) {
+  return &ava_integer_type == ava_value_attr(value);
+}
+
 static inline ava_list_value get_keys(ava_value this) {
   const ava_hash_map*restrict data = ava_value_attr(this);
   return (ava_list_value) {
@@ -409,7 +589,8 @@ static size_t ava_hash_map_put(ava_hash_map*restrict map,
 /**
  * Maps the given hash code to the given index.
  *
- * This assumes that the caller already has right access to the index table.
+ * This assumes that the caller already has right access to the index table,
+ * and that the tag cache already holds the tag for index.
  *
  * @param map The map to mutate.
  * @param index The index to map.
@@ -427,13 +608,56 @@ static ava_bool ava_hash_map_put_direct(ava_hash_map*restrict map,
  *
  * @param map The map whose hash table is to be rebuilt.
  * @param num_elements The number of elements in the final result.
- * @param permit_ascii9 Whether the new table may continue using ASCII9 hashing
- * if the old one was using ASCII9 hashing.
+ * @param strengthen Whether the new table must use a stronger hash function
+ * than the old one (if the old one was not already using value hashing).
  * @return The new length of the hash map (including deleted elements).
  */
 static size_t ava_hash_map_rehash(ava_hash_map*restrict map,
                                   size_t num_elements,
-                                  ava_bool permit_ascii9);
+                                  ava_bool strengthen);
+
+/**
+ * Returns the hash function to use for keys that cannot use ASCII9 hashing,
+ * as per the hash strategy of the given map.
+ */
+static ava_hash_map_hash_function ava_hash_map_strategy_function(
+  const ava_hash_map*restrict map);
+
+/**
+ * Returns the hash function to which a table using the given function falls
+ * back after too many collisions.
+ */
+static ava_hash_map_hash_function ava_hash_map_stronger_function(
+  const ava_hash_map*restrict map, ava_hash_map_hash_function function);
+
+/**
+ * Resets every slot of the given index to empty.
+ */
+static void ava_hash_map_clear_index(ava_hash_map_index*restrict index);
+
+/**
+ * Fills the freshly allocated, empty index of the given map with the first
+ * num_elements elements of its keys list, in parallel, as described in BULK
+ * CONSTRUCTION.
+ *
+ * If hashes_cached is true, the hash cache already holds the hash of every
+ * element; otherwise, it is populated as well, and the index's hash function
+ * must be set.
+ *
+ * @return Whether the index was filled. If false, the index is in an
+ * indeterminate state and must be rebuilt serially.
+ */
+static ava_bool ava_hash_map_bulk_fill(ava_hash_map*restrict map,
+                                       size_t num_elements,
+                                       ava_bool hashes_cached);
+
+/**
+ * Determines, in parallel, the hash function which can be used for all of
+ * the first num_elements keys of the given map, as the serial scan in
+ * ava_hash_map_rehash() does.
+ */
+static ava_hash_map_hash_function ava_hash_map_bulk_classify(
+  const ava_hash_map*restrict map, size_t num_elements);
 
 /**
  * If the given hash map has any deleted elements, the keys and values arrays
@@ -485,20 +709,155 @@ static ava_map_cursor ava_hash_map_search(ava_map_value map,
                                           ava_map_cursor start);
 
 static ava_bool ava_hash_map_to_ascii9(ava_value*restrict value);
+static ava_bool ava_hash_map_to_integer(ava_value*restrict value);
+
+/**
+ * Returns whether the given key can be put into a table using the given hash
+ * function.
+ */
+static ava_bool ava_hash_map_function_accepts(
+  ava_hash_map_hash_function function, ava_value key);
 
 static const ava_hash_map_list_indices* ava_hash_map_build_effective_indices(
   const ava_hash_map*restrict this, size_t length);
 
 static ava_map_value ava_hash_map_of_esbas(ava_list_value keys_list,
-                                           ava_list_value values_list);
+                                           ava_list_value values_list,
+                                           ava_value_hash_strategy strategy);
+
+/**
+ * The hash function for integer keys.
+ *
+ * This is the finaliser of MurmurHash3, which is a bijection on 64-bit
+ * integers, so distinct keys only collide in the bits the table discards.
+ */
+static inline ava_ulong ava_hash_map_integer_hash(ava_ulong i) {
+  i ^= i >> 33;
+  i *= 0xFF51AFD7ED558CCDULL;
+  i ^= i >> 33;
+  i *= 0xC4CEB9FE1A85EC53ULL;
+  i ^= i >> 33;
+  return i;
+}
 
-static inline ava_ulong ava_hash_map_hash_index(ava_ulong hash,
-                                                ava_ulong bias,
-                                                size_t try,
-                                                size_t mask) {
-  ava_ulong base = hash + bias + try / LANE_SIZE * LANE_SIZE;
+/**
+ * The full hash of an ASCII9 string, as described in TAG ARRAY.
+ */
+static inline ava_ulong ava_hash_map_ascii9_hash(ava_ulong str) {
+  ava_ulong hash = ava_ascii9_hash(str);
 
-  return (base / LANE_SIZE * LANE_SIZE + (base + try) % LANE_SIZE) & mask;
+  return hash << 32 | hash;
+}
+
+/**
+ * Hashes a key with the given hash function, which must accept it.
+ *
+ * Returns the full hash; the table uses it truncated to TYPE, except for the
+ * tag (see ava_hash_map_tag_of()).
+ */
+static inline ava_ulong ava_hash_map_hash_key(
+  ava_hash_map_hash_function function, ava_value key
+) {
+  switch (function) {
+  case ava_hmhf_value:   return ava_value_hash(key);
+  case ava_hmhf_fast:    return ava_value_hash_fast(key);
+  case ava_hmhf_ascii9:  return ava_hash_map_ascii9_hash(ava_value_ulong(key));
+  case ava_hmhf_integer:
+    return ava_hash_map_integer_hash(ava_value_ulong(key));
+  default:
+    /* unreachable */
+    abort();
+  }
+}
+
+/**
+ * Returns the tag of the given full (untruncated) hash.
+ */
+static inline unsigned char ava_hash_map_tag_of(ava_ulong hash) {
+  return hash >> (64 - TAG_BITS);
+}
+
+/**
+ * Locates the lane examined in the given round of probing for a hash.
+ *
+ * @param hash The hash being probed for.
+ * @param bias The hash bias of this round.
+ * @param round The number of lanes already examined.
+ * @param mask The table mask.
+ * @param offset Set to the slot within the lane at which the round begins.
+ * @return The index of the first slot of the lane.
+ */
+static inline size_t ava_hash_map_lane(ava_ulong hash, ava_ulong bias,
+                                       size_t round, size_t mask,
+                                       unsigned*restrict offset) {
+  ava_ulong base = hash + bias + round * LANE_SIZE;
+
+  *offset = base % LANE_SIZE;
+  return (base / LANE_SIZE * LANE_SIZE) & mask;
+}
+
+/**
+ * Returns the hash bias for the round of probing after the one which used the
+ * given bias.
+ */
+static inline TYPE ava_hash_map_next_bias(TYPE hash, TYPE bias,
+                                          size_t round) {
+  return 0 == round? hash >> COLLISION_SHIFT_AMT :
+    bias >> COLLISION_SHIFT_AMT;
+}
+
+/**
+ * Compares every tag in a lane against the given tag.
+ *
+ * Bit i of each result corresponds to the slot i places after offset,
+ * circularly, so that the lowest set bit is the first such slot in probe
+ * order.
+ *
+ * @param empty Set to a bitmask of the slots in the lane with TAG_EMPTY.
+ * @param tags The tags of the lane.
+ * @param tag The tag to match.
+ * @param offset The slot within the lane at which probing begins.
+ * @return A bitmask of the slots in the lane whose tag equals tag.
+ */
+static inline ava_ulong ava_hash_map_match_lane(
+  ava_ulong*restrict empty, const unsigned char*restrict tags,
+  unsigned char tag, unsigned offset
+) {
+  ava_ulong matches = 0, empties = 0;
+  unsigned i;
+#if defined(AVA_HASH_MAP_SSE2)
+  __m128i needle = _mm_set1_epi8((char)tag), chunk;
+
+  if (LANE_SIZE < 16) {
+    chunk = _mm_loadl_epi64((const __m128i*)tags);
+    matches = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)) & LANE_MASK;
+    empties = _mm_movemask_epi8(chunk) & LANE_MASK;
+#if defined(AVA_HASH_MAP_AVX2)
+  } else if (32 == LANE_SIZE) {
+    __m256i wide = _mm256_load_si256((const __m256i*)tags);
+    matches = (ava_uint)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(wide, _mm256_set1_epi8((char)tag)));
+    empties = (ava_uint)_mm256_movemask_epi8(wide);
+#endif
+  } else {
+    for (i = 0; i < LANE_SIZE; i += 16) {
+      chunk = _mm_load_si128((const __m128i*)(tags + i));
+      matches |= (ava_ulong)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(chunk, needle)) << i;
+      empties |= (ava_ulong)_mm_movemask_epi8(chunk) << i;
+    }
+  }
+#else
+  for (i = 0; i < LANE_SIZE; ++i) {
+    matches |= (ava_ulong)(tag == tags[i]) << i;
+    empties |= (ava_ulong)(TAG_EMPTY == tags[i]) << i;
+  }
+#endif
+
+  *empty = ((empties >> offset) | (empties << (LANE_SIZE - offset))) &
+    LANE_MASK;
+  return ((matches >> offset) | (matches << (LANE_SIZE - offset))) &
+    LANE_MASK;
 }
 
 ava_map_value AVA_GLUE(ava_hash_map_of_raw_,TYPE)(
@@ -506,17 +865,20 @@ ava_map_value AVA_GLUE(ava_hash_map_of_raw_,TYPE)(
   size_t key_stride,
   const ava_value*restrict values,
   size_t value_stride,
-  size_t count
+  size_t count,
+  ava_value_hash_strategy strategy
 ) {
   ava_list_value keys_list, values_list;
 
   keys_list = ava_esba_list_of_raw_strided(keys, count, key_stride);
   values_list = ava_esba_list_of_raw_strided(values, count, value_stride);
 
-  return ava_hash_map_of_esbas(keys_list, values_list);
+  return ava_hash_map_of_esbas(keys_list, values_list, strategy);
 }
 
-ava_map_value AVA_GLUE(ava_hash_map_of_list_,TYPE)(ava_list_value list) {
+ava_map_value AVA_GLUE(ava_hash_map_of_list_,TYPE)(
+  ava_list_value list, ava_value_hash_strategy strategy
+) {
   ava_list_value keys_list, values_list;
 
   assert(0 == ava_list_length(list) % 2);
@@ -529,11 +891,12 @@ ava_map_value AVA_GLUE(ava_hash_map_of_list_,TYPE)(ava_list_value list) {
   values_list = ava_esba_list_copy_of(
     values_list, 0, ava_list_length(values_list));
 
-  return ava_hash_map_of_esbas(keys_list, values_list);
+  return ava_hash_map_of_esbas(keys_list, values_list, strategy);
 }
 
 static ava_map_value ava_hash_map_of_esbas(ava_list_value keys_list,
-                                           ava_list_value values_list) {
+                                           ava_list_value values_list,
+                                           ava_value_hash_strategy strategy) {
   ava_hash_map*restrict this = AVA_NEW(ava_hash_map);
   size_t length;
 
@@ -542,9 +905,10 @@ static ava_map_value ava_hash_map_of_esbas(ava_list_value keys_list,
   this->esba_trait = ava_get_attribute(keys_list.v, &ava_list_trait_tag);
   this->keys = ava_value_attr(keys_list.v);
   this->values = ava_value_attr(values_list.v);
+  this->hash_strategy = strategy;
   length = ava_value_ulong(keys_list.v);
   assert(length == ava_value_ulong(values_list.v));
-  length = ava_hash_map_rehash(this, length, ava_true);
+  length = ava_hash_map_rehash(this, length, ava_false);
 
   return (ava_map_value) {
     ava_value_with_ulong(this, length)
@@ -564,10 +928,14 @@ static ava_hash_map_index* ava_hash_map_index_new(size_t base_cap) {
 
   index = ava_alloc_atomic_precise(sizeof(ava_hash_map_index) +
                                    sizeof(index->indices[0]) * cap +
+                                   sizeof(index->tags[0]) * cap +
                                    sizeof(ava_ulong) * (cap * 3/4) +
+                                   sizeof(index->tag_cache[0]) * (cap * 3/4) +
                                    LANE_SIZE_BYTES);
   index->indices = align_to_lane(index + 1);
-  index->hash_cache = (TYPE*)(index->indices + cap);
+  index->tags = (unsigned char*)(index->indices + cap);
+  index->hash_cache = (TYPE*)(index->tags + cap);
+  index->tag_cache = (unsigned char*)(index->hash_cache + cap * 3/4);
   index->mask = cap-1;
   return index;
 }
@@ -634,21 +1002,62 @@ static ava_bool ava_hash_map_to_ascii9(ava_value*restrict value) {
   }
 }
 
+static ava_bool ava_hash_map_to_integer(ava_value*restrict value) {
+  ava_string str;
+  ava_integer integer;
+  ava_value normal;
+
+  if (is_integer(*value))
+    return ava_true;
+
+  /* Only the normal form of an integer can equal an integer key, so there's
+   * no point in anything more lenient than parsing it and checking that it
+   * comes back out the same.
+   */
+  str = ava_to_string(*value);
+  if (!ava_string_is_integer(str) ||
+      !ava_integer_try_parse(&integer, str, 0))
+    return ava_false;
+
+  normal = ava_value_of_integer(integer);
+  if (!ava_string_equal(str, ava_to_string(normal)))
+    return ava_false;
+
+  *value = normal;
+  return ava_true;
+}
+
+static ava_bool ava_hash_map_function_accepts(
+  ava_hash_map_hash_function function, ava_value key
+) {
+  switch (function) {
+  case ava_hmhf_ascii9:  return is_ascii9_string(key);
+  case ava_hmhf_integer: return is_integer(key);
+  default:               return ava_true;
+  }
+}
+
 static ava_map_cursor ava_hash_map_search(ava_map_value map,
                                           ava_value key,
                                           ava_map_cursor start) {
   const ava_hash_map*restrict this = ava_value_attr(map.v);
 
   TYPE hash, bias = 0, length = ava_value_ulong(map.v);
-  unsigned tries = 0;
-  size_t ix;
+  size_t round, lane;
+  unsigned offset;
+  ava_ulong full_hash, matches, empty;
+  unsigned char tag;
   TYPE cursor;
   ava_value other_key;
   ava_bool equal;
 
   switch (this->index->hash_function) {
   case ava_hmhf_value:
-    hash = ava_value_hash(key);
+    full_hash = ava_value_hash(key);
+    break;
+
+  case ava_hmhf_fast:
+    full_hash = ava_value_hash_fast(key);
     break;
 
   case ava_hmhf_ascii9:
@@ -659,7 +1068,16 @@ static ava_map_cursor ava_hash_map_search(ava_map_value map,
       return AVA_MAP_CURSOR_NONE;
     }
 
-    hash = ava_ascii9_hash(ava_value_ulong(key));
+    full_hash = ava_hash_map_ascii9_hash(ava_value_ulong(key));
+    break;
+
+  case ava_hmhf_integer:
+    if (!ava_hash_map_to_integer(&key)) {
+      /* Not an integer in normal form, so it can't equal any key */
+      return AVA_MAP_CURSOR_NONE;
+    }
+
+    full_hash = ava_hash_map_integer_hash(ava_value_ulong(key));
     break;
 
   default:
@@ -667,52 +1085,67 @@ static ava_map_cursor ava_hash_map_search(ava_map_value map,
     abort();
   }
 
-  for (;;) {
-    ix = ava_hash_map_hash_index(hash, bias, tries, this->index->mask);
-
-    cursor = this->index->indices[ix];
-
-    if (cursor >= length) {
-      /* Empty slot, definitely not in this hash map */
-      return AVA_MAP_CURSOR_NONE;
-    }
-
-    /* Only consider items later than the start point.
-     *
-     * We are guaranteed to always encounter elements in insertion order,
-     * except that an earlier element may be re-encountered later.
-     *
-     * Deleted elements must also be excluded.
-     *
-     * There's no point in fetching the key and comparing them if their full
-     * hashes aren't equal.
+  hash = full_hash;
+  tag = ava_hash_map_tag_of(full_hash);
+  for (round = 0;; ++round) {
+    lane = ava_hash_map_lane(hash, bias, round, this->index->mask, &offset);
+    /* The tags and indices are in different cache lines, but the lane's
+     * indices are almost always needed, so start fetching them right away.
      */
-    if (cursor >= start && !ava_hash_map_is_deleted(this, cursor) &&
-        hash == this->index->hash_cache[cursor]) {
-      /* Check whether it actually corresponds to the query key */
-      other_key = INVOKE_LIST(map.v, keys, index,, cursor);
-      switch (this->index->hash_function) {
-      case ava_hmhf_value:
-        equal = ava_value_equal(key, other_key);
-        break;
-
-      case ava_hmhf_ascii9:
-        equal = ava_value_ulong(key) == ava_value_ulong(other_key);
-        break;
+    __builtin_prefetch(this->index->indices + lane);
+    matches = ava_hash_map_match_lane(
+      &empty, this->index->tags + lane, tag, offset);
+    /* Nothing after the first empty slot is relevant */
+    matches &= (empty & -empty) - 1;
+
+    while (matches) {
+      cursor = this->index->indices[
+        lane + (offset + __builtin_ctzll(matches)) % LANE_SIZE];
+      matches &= matches - 1;
+
+      if (cursor >= length) {
+        /* Empty slot, definitely not in this hash map */
+        return AVA_MAP_CURSOR_NONE;
       }
 
-      if (equal)
-        return cursor;
+      /* Only consider items later than the start point.
+       *
+       * We are guaranteed to always encounter elements in insertion order,
+       * except that an earlier element may be re-encountered later.
+       *
+       * Deleted elements must also be excluded.
+       *
+       * There's no point in fetching the key and comparing them if their full
+       * hashes aren't equal.
+       */
+      if (cursor >= start && !ava_hash_map_is_deleted(this, cursor) &&
+          hash == this->index->hash_cache[cursor]) {
+        /* Check whether it actually corresponds to the query key */
+        other_key = INVOKE_LIST(map.v, keys, index,, cursor);
+        switch (this->index->hash_function) {
+        case ava_hmhf_value:
+        case ava_hmhf_fast:
+          equal = ava_value_equal(key, other_key);
+          break;
+
+        case ava_hmhf_ascii9:
+        case ava_hmhf_integer:
+          equal = ava_value_ulong(key) == ava_value_ulong(other_key);
+          break;
+        }
+
+        if (equal)
+          return cursor;
+      }
     }
 
-    /* No matching element found, shift and try again until we do find one or
-     * encounter an empty slot.
+    /* If the lane had an empty slot, the element would have been put there
+     * had it been present; otherwise, move onto the next lane.
      */
-    ++tries;
-    if (LANE_SIZE == tries)
-      bias = hash >> COLLISION_SHIFT_AMT;
-    else if (0 == tries % LANE_SIZE)
-      bias >>= COLLISION_SHIFT_AMT;
+    if (empty)
+      return AVA_MAP_CURSOR_NONE;
+
+    bias = ava_hash_map_next_bias(hash, bias, round);
   }
 }
 
@@ -736,53 +1169,38 @@ static void ava_hash_map_make_index_writable(ava_hash_map*restrict map,
 static size_t ava_hash_map_put(ava_hash_map*restrict map,
                                size_t expected_length,
                                ava_value key) {
-  ava_bool can_use_ascii9_hash_function;
+  ava_ulong full_hash;
   TYPE hash;
 
-  can_use_ascii9_hash_function = is_ascii9_string(key);
-
   /* Check for conditions that require rehashing.
    *
    * Note that rehashing will add the pair to the newly-built table, since the
    * elements are already present in the table when it returns.
    */
 
-  if ((!can_use_ascii9_hash_function &&
-       ava_hmhf_ascii9 == map->index->hash_function)) {
+  if (!ava_hash_map_function_accepts(map->index->hash_function, key)) {
     /* New key isn't compatible with existing table.
      *
      * We can't add the element to the hash cache, but that's fine since the
      * hash cache isn't usable for this rehash.
      */
-    return ava_hash_map_rehash(map, expected_length+1,
-                               can_use_ascii9_hash_function);
+    return ava_hash_map_rehash(map, expected_length+1, ava_true);
   }
 
-  switch (map->index->hash_function) {
-  case ava_hmhf_value:
-    hash = ava_value_hash(key);
-    break;
-
-  case ava_hmhf_ascii9:
-    hash = ava_ascii9_hash(ava_value_ulong(key));
-    break;
-
-  default:
-    /* unreachable */
-    abort();
-  }
+  full_hash = ava_hash_map_hash_key(map->index->hash_function, key);
+  hash = full_hash;
 
   /* Add to hash cache, needed for any rehashes from hereonout */
   map->index->hash_cache[expected_length] = hash;
+  map->index->tag_cache[expected_length] = ava_hash_map_tag_of(full_hash);
 
   if (desired_capacity(expected_length+1) > map->index->mask+1) {
     /* Load factor exceeded */
-    return ava_hash_map_rehash(map, expected_length+1,
-                               can_use_ascii9_hash_function);
+    return ava_hash_map_rehash(map, expected_length+1, ava_false);
   }
 
   if (ava_hash_map_put_direct(map, expected_length, hash))
-    return ava_hash_map_rehash(map, expected_length+1, 0);
+    return ava_hash_map_rehash(map, expected_length+1, ava_true);
   else
     return expected_length + 1;
 }
@@ -790,36 +1208,40 @@ static size_t ava_hash_map_put(ava_hash_map*restrict map,
 static ava_bool ava_hash_map_put_direct(ava_hash_map*restrict map,
                                         size_t index,
                                         TYPE hash) {
+  ava_hash_map_index*restrict hindex = map->index;
   TYPE bias = 0;
-  TYPE ix;
-  unsigned tries = 0;
-  ava_bool suggest_rehash = ava_false;
+  size_t round, lane, ix, tries;
+  unsigned offset;
+  ava_ulong empty;
+  unsigned char tag = hindex->tag_cache[index];
 
   /* Find the first free slot */
-  for (;;) {
-    ix = ava_hash_map_hash_index(hash, bias, tries, map->index->mask);
-    if (AVA_LIKELY((TYPE)AVA_MAP_CURSOR_NONE == map->index->indices[ix]))
+  for (round = 0;; ++round) {
+    lane = ava_hash_map_lane(hash, bias, round, hindex->mask, &offset);
+    ava_hash_map_match_lane(&empty, hindex->tags + lane, tag, offset);
+    if (AVA_LIKELY(empty))
       break;
 
-    /* Not free, move onto the next */
-    ++tries;
-    if (LANE_SIZE == tries)
-      bias = hash >> COLLISION_SHIFT_AMT;
-    else if (0 == tries % LANE_SIZE)
-      bias >>= COLLISION_SHIFT_AMT;
-
-    /* If using the weaker ASCII9 hash and there've been too many collisions,
-     * give up and rehash with the stronger value hash.
-     */
-    if (AVA_UNLIKELY(tries > ASCII9_COLLISION_THRESH) &&
-        ava_hmhf_ascii9 == map->index->hash_function) {
-      suggest_rehash = 1;
-    }
+    /* Lane full, move onto the next */
+    bias = ava_hash_map_next_bias(hash, bias, round);
   }
 
   /* Free slot at ix */
-  map->index->indices[ix] = index;
-  return suggest_rehash;
+  tries = round * LANE_SIZE + __builtin_ctzll(empty);
+  ix = lane + (offset + __builtin_ctzll(empty)) % LANE_SIZE;
+  hindex->tags[ix] = tag;
+  hindex->indices[ix] = index;
+
+  /* If using one of the weaker hashes and there've been too many collisions,
+   * give up and rehash with a stronger one.
+   */
+  switch (hindex->hash_function) {
+  case ava_hmhf_ascii9: return AVA_UNLIKELY(tries > ASCII9_COLLISION_THRESH);
+  case ava_hmhf_fast:   return AVA_UNLIKELY(tries > FAST_COLLISION_THRESH);
+  case ava_hmhf_integer:
+    return AVA_UNLIKELY(tries > INTEGER_COLLISION_THRESH);
+  default:              return ava_false;
+  }
 }
 
 static ava_hash_map_index* ava_hash_map_fork_index(
@@ -832,23 +1254,322 @@ static ava_hash_map_index* ava_hash_map_fork_index(
   dst->num_elements = limit;
   dst->hash_function = src->hash_function;
   memcpy(dst->indices, src->indices, sizeof(TYPE) * (dst->mask+1));
+  memcpy(dst->tags, src->tags, dst->mask+1);
   for (i = 0; i <= dst->mask; ++i) {
-    if (dst->indices[i] >= limit)
+    if (dst->indices[i] >= limit) {
       dst->indices[i] = (TYPE)AVA_MAP_CURSOR_NONE;
+      dst->tags[i] = TAG_EMPTY;
+    }
   }
   memcpy(dst->hash_cache, src->hash_cache, sizeof(TYPE) * limit);
+  memcpy(dst->tag_cache, src->tag_cache, limit);
 
   return dst;
 }
 
+static ava_hash_map_hash_function ava_hash_map_strategy_function(
+  const ava_hash_map*restrict map
+) {
+  return ava_vhs_fast == map->hash_strategy? ava_hmhf_fast : ava_hmhf_value;
+}
+
+static ava_hash_map_hash_function ava_hash_map_stronger_function(
+  const ava_hash_map*restrict map, ava_hash_map_hash_function function
+) {
+  switch (function) {
+  case ava_hmhf_ascii9:
+  case ava_hmhf_integer: return ava_hash_map_strategy_function(map);
+  case ava_hmhf_fast:
+  case ava_hmhf_value:  return ava_hmhf_value;
+  default:
+    /* unreachable */
+    abort();
+  }
+}
+
+static void ava_hash_map_clear_index(ava_hash_map_index*restrict index) {
+  memset(index->indices, -1, sizeof(TYPE) * (index->mask+1));
+  memset(index->tags, TAG_EMPTY, index->mask+1);
+}
+
+/**
+ * State shared between the work items of a bulk build.
+ */
+typedef struct {
+  ava_hash_map*restrict map;
+  ava_list_value keys;
+  size_t num_elements;
+  ava_bool hashes_cached;
+
+  /**
+   * The number of chunks of BULK_CHUNK_SIZE elements, and the number of
+   * partitions of the index array.
+   */
+  size_t num_chunks, num_parts;
+  /**
+   * log2 of the number of slots in each partition.
+   */
+  unsigned part_shift;
+  /**
+   * A num_chunks*num_parts matrix. Initially, the number of elements in each
+   * chunk whose first lane is in each partition; after the prefix sum, the
+   * position in order at which the chunk places the next such element.
+   */
+  size_t*restrict counts;
+  /**
+   * The start of each partition's elements within order; num_parts+1 long.
+   */
+  size_t*restrict part_begin;
+  /**
+   * The number of elements deferred by each partition. They are moved to the
+   * start of the partition's region of order.
+   */
+  size_t*restrict num_deferred;
+  /**
+   * Every element index, grouped by partition.
+   */
+  TYPE*restrict order;
+
+  /**
+   * Set if any key is not accepted by the index's hash function.
+   */
+  AO_t rejected;
+  /**
+   * Set by ava_hash_map_bulk_classify() if any key is not an ASCII9 string,
+   * or not an integer, respectively.
+   */
+  AO_t not_ascii9, not_integer;
+} ava_hash_map_bulk;
+
+static size_t ava_hash_map_bulk_part_of(const ava_hash_map_bulk*restrict bulk,
+                                        TYPE hash) {
+  unsigned offset;
+
+  return ava_hash_map_lane(hash, 0, 0, bulk->map->index->mask, &offset) >>
+    bulk->part_shift;
+}
+
+static void ava_hash_map_bulk_classify_chunk(void* userdata, size_t chunk) {
+  ava_hash_map_bulk*restrict bulk = userdata;
+  ava_value keys[BULK_BLOCK_SIZE];
+  size_t begin, end, i, n;
+  ava_bool ascii9 = ava_true, integer = ava_true;
+
+  begin = chunk * BULK_CHUNK_SIZE;
+  end = begin + BULK_CHUNK_SIZE < bulk->num_elements?
+    begin + BULK_CHUNK_SIZE : bulk->num_elements;
+
+  for (; begin < end && (ascii9 || integer); begin += n) {
+    n = end - begin < BULK_BLOCK_SIZE? end - begin : BULK_BLOCK_SIZE;
+    bulk->map->esba_trait->index_range(bulk->keys, begin, begin + n, keys);
+    for (i = 0; i < n; ++i) {
+      ascii9 &= is_ascii9_string(keys[i]);
+      integer &= is_integer(keys[i]);
+    }
+  }
+
+  if (!ascii9) AO_store(&bulk->not_ascii9, 1);
+  if (!integer) AO_store(&bulk->not_integer, 1);
+}
+
+static ava_hash_map_hash_function ava_hash_map_bulk_classify(
+  const ava_hash_map*restrict map, size_t num_elements
+) {
+  ava_hash_map_bulk bulk;
+
+  bulk.map = (ava_hash_map*)map;
+  bulk.keys = (ava_list_value) {
+    ava_value_with_ulong(map->keys, num_elements)
+  };
+  bulk.num_elements = num_elements;
+  bulk.not_ascii9 = 0;
+  bulk.not_integer = 0;
+  ava_parallel_for((num_elements + BULK_CHUNK_SIZE - 1) / BULK_CHUNK_SIZE,
+                   ava_hash_map_bulk_classify_chunk, &bulk);
+
+  if (!bulk.not_ascii9)
+    return ava_hmhf_ascii9;
+  else if (!bulk.not_integer)
+    return ava_hmhf_integer;
+  else
+    return ava_hash_map_strategy_function(map);
+}
+
+static void ava_hash_map_bulk_hash_chunk(void* userdata, size_t chunk) {
+  ava_hash_map_bulk*restrict bulk = userdata;
+  ava_hash_map_index*restrict index = bulk->map->index;
+  size_t*restrict counts = bulk->counts + chunk * bulk->num_parts;
+  ava_value keys[BULK_BLOCK_SIZE];
+  ava_ulong full_hash;
+  size_t begin, end, i, n;
+
+  begin = chunk * BULK_CHUNK_SIZE;
+  end = begin + BULK_CHUNK_SIZE < bulk->num_elements?
+    begin + BULK_CHUNK_SIZE : bulk->num_elements;
+
+  if (bulk->hashes_cached) {
+    for (i = begin; i < end; ++i)
+      ++counts[ava_hash_map_bulk_part_of(bulk, index->hash_cache[i])];
+    return;
+  }
+
+  for (; begin < end; begin += n) {
+    n = end - begin < BULK_BLOCK_SIZE? end - begin : BULK_BLOCK_SIZE;
+    bulk->map->esba_trait->index_range(bulk->keys, begin, begin + n, keys);
+    for (i = 0; i < n; ++i) {
+      if (!ava_hash_map_function_accepts(index->hash_function, keys[i])) {
+        AO_store(&bulk->rejected, 1);
+        return;
+      }
+
+      full_hash = ava_hash_map_hash_key(index->hash_function, keys[i]);
+      index->hash_cache[begin + i] = full_hash;
+      index->tag_cache[begin + i] = ava_hash_map_tag_of(full_hash);
+      ++counts[ava_hash_map_bulk_part_of(bulk, index->hash_cache[begin + i])];
+    }
+  }
+}
+
+static void ava_hash_map_bulk_scatter_chunk(void* userdata, size_t chunk) {
+  ava_hash_map_bulk*restrict bulk = userdata;
+  const TYPE*restrict hash_cache = bulk->map->index->hash_cache;
+  size_t*restrict counts = bulk->counts + chunk * bulk->num_parts;
+  size_t begin, end, i;
+
+  begin = chunk * BULK_CHUNK_SIZE;
+  end = begin + BULK_CHUNK_SIZE < bulk->num_elements?
+    begin + BULK_CHUNK_SIZE : bulk->num_elements;
+
+  for (i = begin; i < end; ++i)
+    bulk->order[counts[ava_hash_map_bulk_part_of(bulk, hash_cache[i])]++] = i;
+}
+
+static void ava_hash_map_bulk_fill_part(void* userdata, size_t part) {
+  ava_hash_map_bulk*restrict bulk = userdata;
+  ava_hash_map_index*restrict index = bulk->map->index;
+  size_t k, begin, end, lane, ix, deferred;
+  unsigned offset;
+  ava_ulong empty;
+  TYPE element, hash;
+
+  begin = bulk->part_begin[part];
+  end = bulk->part_begin[part + 1];
+  deferred = 0;
+
+  for (k = begin; k < end; ++k) {
+    element = bulk->order[k];
+    hash = index->hash_cache[element];
+    lane = ava_hash_map_lane(hash, 0, 0, index->mask, &offset);
+    ava_hash_map_match_lane(&empty, index->tags + lane,
+                            index->tag_cache[element], offset);
+
+    if (AVA_LIKELY(empty)) {
+      ix = lane + (offset + __builtin_ctzll(empty)) % LANE_SIZE;
+      index->tags[ix] = index->tag_cache[element];
+      index->indices[ix] = element;
+    } else {
+      bulk->order[begin + deferred++] = element;
+    }
+  }
+
+  bulk->num_deferred[part] = deferred;
+}
+
+static int ava_hash_map_compare_elements(const void* a, const void* b) {
+  TYPE ea = *(const TYPE*)a, eb = *(const TYPE*)b;
+
+  return (ea > eb) - (ea < eb);
+}
+
+static ava_bool ava_hash_map_bulk_fill(ava_hash_map*restrict map,
+                                       size_t num_elements,
+                                       ava_bool hashes_cached) {
+  ava_hash_map_bulk bulk;
+  size_t chunk, part, total, n, num_slots;
+  TYPE*restrict deferred;
+  unsigned width;
+
+  num_slots = map->index->mask + 1;
+  width = ava_parallel_width();
+
+  bulk.map = map;
+  bulk.keys = (ava_list_value) {
+    ava_value_with_ulong(map->keys, num_elements)
+  };
+  bulk.num_elements = num_elements;
+  bulk.hashes_cached = hashes_cached;
+  bulk.num_chunks = (num_elements + BULK_CHUNK_SIZE - 1) / BULK_CHUNK_SIZE;
+  /* Several partitions per thread so that uneven ones balance out, but never
+   * smaller than a lane.
+   */
+  bulk.num_parts = 1;
+  bulk.part_shift = __builtin_ctzll(num_slots);
+  while (bulk.num_parts < 4 * width && num_slots / bulk.num_parts > LANE_SIZE) {
+    bulk.num_parts <<= 1;
+    --bulk.part_shift;
+  }
+  bulk.counts = ava_alloc_atomic_zero(
+    sizeof(size_t) * bulk.num_chunks * bulk.num_parts);
+  bulk.part_begin = ava_alloc_atomic(sizeof(size_t) * (bulk.num_parts + 1));
+  bulk.num_deferred = ava_alloc_atomic(sizeof(size_t) * bulk.num_parts);
+  bulk.order = ava_alloc_atomic(sizeof(TYPE) * num_elements);
+  bulk.rejected = 0;
+
+  ava_parallel_for(bulk.num_chunks, ava_hash_map_bulk_hash_chunk, &bulk);
+  if (bulk.rejected) return ava_false;
+
+  /* Each partition takes its elements from every chunk in turn, so that they
+   * stay in insertion order.
+   */
+  total = 0;
+  for (part = 0; part < bulk.num_parts; ++part) {
+    bulk.part_begin[part] = total;
+    for (chunk = 0; chunk < bulk.num_chunks; ++chunk) {
+      n = bulk.counts[chunk * bulk.num_parts + part];
+      bulk.counts[chunk * bulk.num_parts + part] = total;
+      total += n;
+    }
+  }
+  bulk.part_begin[bulk.num_parts] = total;
+  assert(total == num_elements);
+
+  ava_parallel_for(bulk.num_chunks, ava_hash_map_bulk_scatter_chunk, &bulk);
+  ava_parallel_for(bulk.num_parts, ava_hash_map_bulk_fill_part, &bulk);
+
+  /* Gather the deferred elements into insertion order and insert them
+   * serially, reusing the start of order.
+   */
+  deferred = bulk.order;
+  total = 0;
+  for (part = 0; part < bulk.num_parts; ++part) {
+    memmove(deferred + total, bulk.order + bulk.part_begin[part],
+            sizeof(TYPE) * bulk.num_deferred[part]);
+    total += bulk.num_deferred[part];
+  }
+  qsort(deferred, total, sizeof(TYPE), ava_hash_map_compare_elements);
+
+  for (n = 0; n < total; ++n) {
+    /* A rebuild from the hash cache ignores collisions, as the serial one
+     * does, since the function already survived them.
+     */
+    if (ava_hash_map_put_direct(map, deferred[n],
+                                map->index->hash_cache[deferred[n]]) &&
+        !hashes_cached)
+      return ava_false;
+  }
+
+  return ava_true;
+}
+
 static size_t ava_hash_map_rehash(ava_hash_map*restrict map,
                                   size_t num_elements,
-                                  ava_bool permit_ascii9) {
+                                  ava_bool strengthen) {
   size_t i, orig_num_elements;
   size_t new_size AVA_UNUSED;
   ava_list_value keys;
+  ava_value key;
   ava_hash_map_hash_function preferred_hash_function;
-  ava_bool vacuumed;
+  ava_bool vacuumed, bulk;
   const ava_hash_map_index*restrict old_index = map->index;
 
   orig_num_elements = num_elements;
@@ -859,24 +1580,46 @@ static size_t ava_hash_map_rehash(ava_hash_map*restrict map,
     ava_value_with_ulong(map->keys, num_elements)
   };
 
-  if (NULL != map->index || num_elements > ASCII9_SIZE_THRESH) {
+  bulk = num_elements >= BULK_THRESH && ava_parallel_width() > 1;
+
+  if (NULL != map->index) {
+    /* Never go back to a weaker function */
     preferred_hash_function = map->index->hash_function;
+  } else if (bulk) {
+    preferred_hash_function = ava_hash_map_bulk_classify(map, num_elements);
   } else {
-    preferred_hash_function = ava_hmhf_ascii9;
-    for (i = 0; i < num_elements &&
-           preferred_hash_function != ava_hmhf_value; ++i) {
-      if (!is_ascii9_string(map->esba_trait->index(keys, i))) {
-        preferred_hash_function = ava_hmhf_value;
+    /* Use ASCII9 or integer hashing if the first key permits it and all the
+     * others agree.
+     */
+    key = map->esba_trait->index(keys, 0);
+    if (is_ascii9_string(key))
+      preferred_hash_function = ava_hmhf_ascii9;
+    else if (is_integer(key))
+      preferred_hash_function = ava_hmhf_integer;
+    else
+      preferred_hash_function = ava_hash_map_strategy_function(map);
+
+    for (i = 1; i < num_elements; ++i) {
+      if (!ava_hash_map_function_accepts(
+            preferred_hash_function, map->esba_trait->index(keys, i))) {
+        preferred_hash_function = ava_hash_map_strategy_function(map);
+        break;
       }
     }
   }
 
+  if (ava_hmhf_ascii9 == preferred_hash_function &&
+      num_elements > ASCII9_SIZE_THRESH)
+    preferred_hash_function = ava_hash_map_strategy_function(map);
+
+  if (strengthen)
+    preferred_hash_function = ava_hash_map_stronger_function(
+      map, preferred_hash_function);
+
   map->index = ava_hash_map_index_new(desired_capacity(num_elements));
   map->index->num_elements = 0;
-  map->index->hash_function = permit_ascii9?
-    preferred_hash_function : ava_hmhf_value;
-  memset(map->index->indices, -1,
-         sizeof(TYPE) * (map->index->mask+1));
+  map->index->hash_function = preferred_hash_function;
+  ava_hash_map_clear_index(map->index);
 
   if (old_index && !vacuumed &&
       map->index->hash_function == old_index->hash_function) {
@@ -885,12 +1628,25 @@ static size_t ava_hash_map_rehash(ava_hash_map*restrict map,
      * use the hash cache to quickly rebuild the index instead of needing to
      * fetch and hash values from the ESBA list.
      */
-    for (i = 0; i < num_elements; ++i) {
-      map->index->hash_cache[i] = old_index->hash_cache[i];
-      ava_hash_map_put_direct(map, i, old_index->hash_cache[i]);
+    if (bulk) {
+      memcpy(map->index->hash_cache, old_index->hash_cache,
+             sizeof(TYPE) * num_elements);
+      memcpy(map->index->tag_cache, old_index->tag_cache, num_elements);
+      ava_hash_map_bulk_fill(map, num_elements, ava_true);
+    } else {
+      for (i = 0; i < num_elements; ++i) {
+        map->index->hash_cache[i] = old_index->hash_cache[i];
+        map->index->tag_cache[i] = old_index->tag_cache[i];
+        ava_hash_map_put_direct(map, i, old_index->hash_cache[i]);
+      }
     }
     map->index->num_elements = num_elements;
+  } else if (bulk && ava_hash_map_bulk_fill(map, num_elements, ava_false)) {
+    map->index->num_elements = num_elements;
   } else {
+    if (bulk)
+      ava_hash_map_clear_index(map->index);
+
     for (i = 0; i < num_elements; ++i) {
       new_size = ava_hash_map_put(map, i, map->esba_trait->index(keys, i));
       assert(i+1 == new_size);
@@ -1012,8 +1768,10 @@ static ava_map_value ava_hash_map_map_add(ava_map_value map,
 
   /* If getting too large, promote to the next hash size */
   if (length >= SIZE_THRESH) {
-    return ava_map_add(ava_hash_map_of_list(ava_list_value_of(map.v)),
-                       key, value);
+    return ava_map_add(
+      ava_hash_map_of_list_with_strategy(ava_list_value_of(map.v),
+                                         this.hash_strategy),
+      key, value);
   }
 
   this.keys = ava_value_attr(INVOKE_LIST(map.v, keys, append,, key).v);
@@ -1069,7 +1827,7 @@ static ava_map_value ava_hash_map_map_remove(ava_map_value map,
 
   /* If more than half the map is deleted entries, vacuum and rehash */
   if (this.num_deleted_entries > length / 2) {
-    length = ava_hash_map_rehash(&this, length, ava_true);
+    length = ava_hash_map_rehash(&this, length, ava_false);
   }
 
   /* The list-index table is wrong now, if it had been present */
@@ -1141,6 +1899,12 @@ static const ava_hash_map_list_indices* ava_hash_map_build_effective_indices(
   return dst;
 }
 
+static void ava_hash_map_list_index_range(
+  ava_list_value map, size_t begin, size_t end, ava_value*restrict dst
+) {
+  ava_list_index_range_by_index(map, begin, end, dst);
+}
+
 static ava_list_value ava_hash_map_list_slice(ava_list_value map,
                                               size_t begin, size_t end) {
   return ava_list_copy_slice(map, begin, end);
@@ -1151,6 +1915,12 @@ static ava_list_value ava_hash_map_list_append(ava_list_value map,
   return ava_list_copy_append(map, element);
 }
 
+static ava_list_value ava_hash_map_list_append_n(
+  ava_list_value map, const ava_value*restrict elements, size_t count
+) {
+  return ava_list_copy_append_n(map, elements, count);
+}
+
 static ava_list_value ava_hash_map_list_concat(ava_list_value map,
                                                ava_list_value other) {
   size_t other_length = ava_list_length(other), i;
@@ -1185,7 +1955,9 @@ const char* AVA_GLUE(ava_hash_map_get_hash_function_,TYPE)(ava_map_value map) {
 
   switch (this->index->hash_function) {
   case ava_hmhf_ascii9: return "ascii9";
+  case ava_hmhf_fast:   return "fast";
   case ava_hmhf_value:  return "value";
+  case ava_hmhf_integer: return "integer";
   default:
     /* unreachable */
     abort();
@@ -19,6 +19,7 @@
 
 #define AVA__INTERNAL_INCLUDE 1
 #include "avalanche/defs.h"
+#include "avalanche/value.h"
 #include "avalanche/map.h"
 #include "-hash-map.h"
 
@@ -27,18 +28,38 @@ ava_map_value ava_hash_map_of_raw(const ava_value*restrict keys,
                                   const ava_value*restrict values,
                                   size_t value_stride,
                                   size_t count) {
+  return ava_hash_map_of_raw_with_strategy(
+    keys, key_stride, values, value_stride, count,
+    ava_value_hash_get_default_strategy());
+}
+
+ava_map_value ava_hash_map_of_raw_with_strategy(
+  const ava_value*restrict keys,
+  size_t key_stride,
+  const ava_value*restrict values,
+  size_t value_stride,
+  size_t count,
+  ava_value_hash_strategy strategy
+) {
   if (count < (1 << 12))
     return ava_hash_map_of_raw_ava_ushort(
-      keys, key_stride, values, value_stride, count);
+      keys, key_stride, values, value_stride, count, strategy);
   else if (count < (1 << 24))
     return ava_hash_map_of_raw_ava_uint(
-      keys, key_stride, values, value_stride, count);
+      keys, key_stride, values, value_stride, count, strategy);
   else
     return ava_hash_map_of_raw_ava_ulong(
-      keys, key_stride, values, value_stride, count);
+      keys, key_stride, values, value_stride, count, strategy);
 }
 
 ava_map_value ava_hash_map_of_list(ava_list_value list) {
+  return ava_hash_map_of_list_with_strategy(
+    list, ava_value_hash_get_default_strategy());
+}
+
+ava_map_value ava_hash_map_of_list_with_strategy(
+  ava_list_value list, ava_value_hash_strategy strategy
+) {
   size_t count = ava_list_length(list) / 2;
 
   /* Note that these thresholds are 1 lower than what's used in the
@@ -47,11 +68,11 @@ ava_map_value ava_hash_map_of_list(ava_list_value list) {
    * threshold.
    */
   if (count < (1 << 12))
-    return ava_hash_map_of_list_ava_ushort(list);
+    return ava_hash_map_of_list_ava_ushort(list, strategy);
   else if (count < (1 << 24))
-    return ava_hash_map_of_list_ava_uint(list);
+    return ava_hash_map_of_list_ava_uint(list, strategy);
   else
-    return ava_hash_map_of_list_ava_ulong(list);
+    return ava_hash_map_of_list_ava_ulong(list, strategy);
 }
 
 const char* ava_hash_map_get_hash_function(ava_map_value map) {
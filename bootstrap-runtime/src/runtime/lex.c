@@ -220,6 +220,28 @@ ava_lex_context* ava_lex_new(ava_string str) {
   return lex;
 }
 
+ava_lex_context* ava_lex_new_at(ava_string str, size_t begin) {
+  ava_lex_context* lex = ava_lex_new(str);
+  size_t i;
+
+  assert(begin <= lex->strlen);
+
+  /* Seed the lookbehind with what precedes begin, so that whether the first
+   * token is independent is decided exactly as it would be had the analyser
+   * got here from the start of the string.
+   */
+  for (i = begin > 4? begin - 4 : 0; i < begin; ++i) {
+    lex->prev_char <<= 8;
+    lex->prev_char |= lex->buffer[i] & 0xFF;
+  }
+
+  lex->buffer_off = begin;
+  lex->p.index = begin;
+  lex->p.line_offset = begin;
+
+  return lex;
+}
+
 static unsigned char ava_lex_get(ava_lex_context* lex) {
   if (lex->buffer_off >= lex->strlen)
     return 0;
@@ -19,6 +19,8 @@
 
 #include <assert.h>
 
+#include <atomic_ops.h>
+
 #define AVA__INTERNAL_INCLUDE 1
 #include "avalanche/defs.h"
 #include "avalanche/alloc.h"
@@ -28,10 +30,32 @@
 #include "-hash-map.h"
 #include "-list-map.h"
 
+/**
+ * A hash index over one version of the underlying list of a list-map.
+ *
+ * The index is a hash-map built directly from that version, so its cursors
+ * are the same pair indices used by the list-map.
+ */
+typedef struct {
+  /**
+   * The data element of the version of the delegate this index covers.
+   */
+  ava_ulong version;
+  /**
+   * The hash-map holding the same pairs as that version.
+   */
+  ava_map_value map;
+} ava_list_map_index;
+
 /**
  * The head of the attribute chain on a list-map value; allows obtaining the
  * attribute chain belonging to the underlying list. (The data element of the
  * value is still stored directly on the value.)
+ *
+ * All versions of a list-map whose delegates share an attribute chain share
+ * this header, so the search statistics and hash index below are shared
+ * between them. Since a list value is fully identified by its attribute chain
+ * and data element, the index applies to exactly one version.
  */
 typedef struct {
   ava_attribute header;
@@ -45,6 +69,16 @@ typedef struct {
    * The list trait on the delegate.
    */
   const ava_list_trait*restrict v;
+
+  /**
+   * The number of pairs examined by linear searches of lists sharing this
+   * header since the last hash index was built.
+   */
+  AO_t scanned;
+  /**
+   * The most recently built hash index (const ava_list_map_index*), or NULL.
+   */
+  AO_t index;
 } ava_list_map;
 
 static const ava_attribute_tag ava_list_map_tag = {
@@ -57,10 +91,11 @@ static ava_map_value ava_list_map_redelegate(ava_map_value this,
                                              ava_list_value new_delegate);
 static ava_map_cursor ava_list_map_search(
   ava_map_value this, ava_value key, ava_map_cursor start);
+static const ava_list_map_index* ava_list_map_get_index(ava_map_value this);
 
 static const ava_value_trait ava_list_map_value_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
@@ -81,6 +116,8 @@ ava_map_value ava_list_map_of_list(ava_list_value list) {
   this->header.next = (const ava_attribute*)&ava_list_map_map_impl;
   this->list_attr = ava_value_attr(list.v);
   this->v = trait;
+  this->scanned = 0;
+  this->index = 0;
 
   return (ava_map_value) {
     ava_value_with_ulong(this, ava_value_ulong(list.v))
@@ -108,26 +145,86 @@ static size_t ava_list_map_map_npairs(ava_map_value this) {
   return DELEGATE(this, length) / 2;
 }
 
+static const ava_list_map_index* ava_list_map_get_index(ava_map_value this) {
+  const ava_list_map*restrict header =
+    (const ava_list_map*)ava_value_attr(this.v);
+  const ava_list_map_index* index;
+
+  /* Load-acquire so the index's fields are visible */
+  index = (const ava_list_map_index*)AO_load_acquire_read(
+    (AO_t*)&header->index);
+  if (index && ava_value_ulong(this.v) == index->version)
+    return index;
+  else
+    return NULL;
+}
+
+ava_bool ava_list_map_is_promoted(ava_map_value map) {
+  return !!ava_list_map_get_index(map);
+}
+
+static void ava_list_map_build_index(ava_map_value this) {
+  ava_list_map*restrict header = (ava_list_map*)ava_value_attr(this.v);
+  ava_list_map_index* index;
+
+  index = AVA_NEW(ava_list_map_index);
+  index->version = ava_value_ulong(this.v);
+  index->map = ava_hash_map_of_list(ava_list_map_delegate(this.v));
+
+  /* If another version is indexed concurrently, whichever stores last wins;
+   * the other falls back to linear search until it is promoted again.
+   *
+   * Start counting afresh, so that another version only replaces this index
+   * once its own searches have paid for it, rather than on the strength of
+   * searches this index has already answered.
+   */
+  AO_store(&header->scanned, 0);
+  AO_store_release_write(&header->index, (AO_t)index);
+}
+
 static ava_map_cursor ava_list_map_search(ava_map_value this, ava_value key,
                                           ava_map_cursor start) {
+  ava_list_map*restrict header = (ava_list_map*)ava_value_attr(this.v);
   size_t i, n;
+  AO_t scanned;
 
   n = DELEGATE(this, length) / 2;
   for (i = start; i < n; ++i) {
     if (ava_value_equal(key, DELEGATE(this, index,, i*2)))
-      return i;
+      break;
   }
 
-  return AVA_MAP_CURSOR_NONE;
+  /* A list-map only grows this large when built directly over a large list.
+   * Once searches have examined enough pairs to pay for a hash-map, build one
+   * so that further lookups do not keep scanning the list.
+   */
+  if (n > AVA_LIST_MAP_PROMOTE_MIN_PAIRS) {
+    scanned = AO_fetch_and_add(&header->scanned, i - start) + (i - start);
+    if (scanned >= AVA_LIST_MAP_PROMOTE_FACTOR * n)
+      ava_list_map_build_index(this);
+  }
+
+  return i < n? i : AVA_MAP_CURSOR_NONE;
 }
 
 static ava_map_cursor ava_list_map_map_find(ava_map_value this, ava_value key) {
-  return ava_list_map_search(this, key, 0);
+  const ava_list_map_index* index = ava_list_map_get_index(this);
+
+  if (index)
+    return ava_map_find(index->map, key);
+  else
+    return ava_list_map_search(this, key, 0);
 }
 
 static ava_map_cursor ava_list_map_map_next(ava_map_value this,
                                             ava_map_cursor cursor) {
-  return ava_list_map_search(this, DELEGATE(this, index,, cursor*2), cursor+1);
+  const ava_list_map_index* index = ava_list_map_get_index(this);
+
+  if (index)
+    return ava_map_next(index->map, cursor);
+  else
+    return ava_list_map_search(
+      this, DELEGATE(this, index,, cursor*2), cursor+1);
 }
 
 static ava_value ava_list_map_map_get(ava_map_value this,
@@ -159,15 +256,26 @@ static ava_map_value ava_list_map_redelegate(ava_map_value this,
 static ava_map_value ava_list_map_map_set(ava_map_value this,
                                           ava_map_cursor cursor,
                                           ava_value value) {
-  ava_list_value new_delegate = DELEGATE(this, set,, cursor*2 + 1, value);
+  const ava_list_map_index* index = ava_list_map_get_index(this);
+  ava_list_value new_delegate;
+
+  if (index)
+    return ava_map_set(index->map, cursor, value);
 
+  new_delegate = DELEGATE(this, set,, cursor*2 + 1, value);
   return ava_list_map_redelegate(this, new_delegate);
 }
 
 static ava_map_value ava_list_map_map_add(ava_map_value this,
                                           ava_value key,
                                           ava_value value) {
-  ava_list_value new_delegate = DELEGATE(this, append,, key);
+  const ava_list_map_index* index = ava_list_map_get_index(this);
+  ava_list_value new_delegate;
+
+  if (index)
+    return ava_map_add(index->map, key, value);
+
+  new_delegate = DELEGATE(this, append,, key);
   new_delegate = ava_list_append(new_delegate, value);
 
   if (ava_list_length(new_delegate) <= AVA_LIST_MAP_THRESH) {
@@ -179,8 +287,12 @@ static ava_map_value ava_list_map_map_add(ava_map_value this,
 
 static ava_map_value ava_list_map_map_remove(ava_map_value this,
                                              ava_map_cursor cursor) {
+  const ava_list_map_index* index = ava_list_map_get_index(this);
+
   if (1 == ava_list_map_map_npairs(this)) {
     return ava_empty_map();
+  } else if (index) {
+    return ava_map_remove(index->map, cursor);
   } else {
     return ava_list_map_redelegate(
       this, DELEGATE(this, remove,, cursor*2, cursor*2+2));
@@ -195,6 +307,12 @@ static ava_value ava_list_map_list_index(ava_list_value this, size_t ix) {
   return DELEGATE(this, index,, ix);
 }
 
+static void ava_list_map_list_index_range(
+  ava_list_value this, size_t begin, size_t end, ava_value*restrict dst
+) {
+  DELEGATE(this, index_range,, begin, end, dst);
+}
+
 static ava_list_value ava_list_map_list_slice(ava_list_value this,
                                               size_t begin, size_t end) {
   return DELEGATE(this, slice,, begin, end);
@@ -205,6 +323,12 @@ static ava_list_value ava_list_map_list_append(ava_list_value this,
   return DELEGATE(this, append,, element);
 }
 
+static ava_list_value ava_list_map_list_append_n(
+  ava_list_value this, const ava_value*restrict elements, size_t count
+) {
+  return DELEGATE(this, append_n,, elements, count);
+}
+
 static ava_list_value ava_list_map_list_concat(ava_list_value this,
                                                ava_list_value that) {
   return DELEGATE(this, concat,, that);
@@ -28,8 +28,16 @@
 #include "avalanche/alloc.h"
 #include "avalanche/value.h"
 #include "avalanche/list.h"
+#include "avalanche/integer.h"
+#include "avalanche/function.h"
 #include "avalanche/list-proj.h"
 
+/**
+ * The number of delegate elements read at a time by the index_range
+ * implementations.
+ */
+#define AVA_LIST_PROJ_BLOCK 64
+
 typedef struct {
   size_t num_lists;
   ava_fat_list_value lists[];
@@ -47,19 +55,97 @@ typedef struct {
   AO_t /* const ava_list_value*restrict */ groups[];
 } ava_list_proj_group_list;
 
+typedef struct {
+  ava_fat_list_value delegate;
+  const ava_function* fun;
+  size_t length;
+  ava_bool memoise;
+  /* If memoise, results are calculated once then cached here */
+  AO_t /* const ava_value*restrict */ results[];
+} ava_list_proj_map_list;
+
+/**
+ * The progress of a filter projection through its delegate.
+ *
+ * Tables are immutable once published. A reader that needs to see further
+ * into the delegate builds a larger copy and swaps it in.
+ */
+typedef struct {
+  /**
+   * The number of delegate elements which have been tested.
+   */
+  size_t scanned;
+  /**
+   * The number of elements in indices.
+   */
+  size_t count;
+  /**
+   * The delegate indices of every element among the first scanned which passed
+   * the predicate, in ascending order.
+   */
+  size_t indices[];
+} ava_list_proj_filter_table;
+
+typedef struct {
+  ava_fat_list_value delegate;
+  const ava_function* predicate;
+  size_t delegate_length;
+  AO_t /* const ava_list_proj_filter_table*restrict */ table;
+} ava_list_proj_filter_list;
+
+typedef struct {
+  size_t num_lists, length;
+  ava_fat_list_value lists[];
+} ava_list_proj_zip_list;
+
+typedef struct {
+  ava_integer begin, step;
+  size_t length;
+} ava_list_proj_range_list;
+
 static size_t ava_list_proj_interleave_list_length(ava_list_value list);
 static ava_value ava_list_proj_interleave_list_index(ava_list_value list, size_t ix);
+static void ava_list_proj_interleave_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst);
 
 static size_t ava_list_proj_demux_list_length(ava_list_value list);
 static ava_value ava_list_proj_demux_list_index(ava_list_value list, size_t ix);
+static void ava_list_proj_demux_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst);
 
 static size_t ava_list_proj_group_list_length(ava_list_value list);
 static ava_value ava_list_proj_group_list_index(ava_list_value list, size_t ix);
+static void ava_list_proj_group_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst);
+
+static size_t ava_list_proj_map_list_length(ava_list_value list);
+static ava_value ava_list_proj_map_list_index(ava_list_value list, size_t ix);
+static void ava_list_proj_map_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst);
+
+static size_t ava_list_proj_filter_list_length(ava_list_value list);
+static ava_value ava_list_proj_filter_list_index(ava_list_value list, size_t ix);
+static void ava_list_proj_filter_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst);
+
+static size_t ava_list_proj_zip_list_length(ava_list_value list);
+static ava_value ava_list_proj_zip_list_index(ava_list_value list, size_t ix);
+static void ava_list_proj_zip_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst);
+
+static size_t ava_list_proj_range_list_length(ava_list_value list);
+static ava_value ava_list_proj_range_list_index(ava_list_value list, size_t ix);
+static void ava_list_proj_range_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst);
+static ava_list_value ava_list_proj_range_list_slice(
+  ava_list_value list, size_t begin, size_t end);
+
+static ava_value ava_list_proj_apply(const ava_function* fun, ava_value arg);
 
 static const ava_value_trait ava_list_proj_interleave_generic_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
   .name = "interleave-list-proj",
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
@@ -71,8 +157,10 @@ static const ava_list_trait ava_list_proj_interleave_list_impl = {
   },
   .length = ava_list_proj_interleave_list_length,
   .index = ava_list_proj_interleave_list_index,
+  .index_range = ava_list_proj_interleave_list_index_range,
   .slice = ava_list_copy_slice,
   .append = ava_list_copy_append,
+  .append_n = ava_list_copy_append_n,
   .concat = ava_list_copy_concat,
   .remove = ava_list_copy_remove,
   .set = ava_list_copy_set,
@@ -81,7 +169,7 @@ static const ava_list_trait ava_list_proj_interleave_list_impl = {
 static const ava_value_trait ava_list_proj_demux_generic_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
   .name = "demux-list-proj",
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
@@ -93,8 +181,10 @@ static const ava_list_trait ava_list_proj_demux_list_impl = {
   },
   .length = ava_list_proj_demux_list_length,
   .index = ava_list_proj_demux_list_index,
+  .index_range = ava_list_proj_demux_list_index_range,
   .slice = ava_list_copy_slice,
   .append = ava_list_copy_append,
+  .append_n = ava_list_copy_append_n,
   .concat = ava_list_copy_concat,
   .remove = ava_list_copy_remove,
   .set = ava_list_copy_set,
@@ -103,7 +193,7 @@ static const ava_list_trait ava_list_proj_demux_list_impl = {
 static const ava_value_trait ava_list_proj_group_generic_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
   .name = "group-list-proj",
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
@@ -115,8 +205,106 @@ static const ava_list_trait ava_list_proj_group_list_impl = {
   },
   .length = ava_list_proj_group_list_length,
   .index = ava_list_proj_group_list_index,
+  .index_range = ava_list_proj_group_list_index_range,
+  .slice = ava_list_copy_slice,
+  .append = ava_list_copy_append,
+  .append_n = ava_list_copy_append_n,
+  .concat = ava_list_copy_concat,
+  .remove = ava_list_copy_remove,
+  .set = ava_list_copy_set,
+};
+
+static const ava_value_trait ava_list_proj_map_generic_impl = {
+  .header = { .tag = &ava_value_trait_tag, .next = NULL },
+  .name = "map-list-proj",
+  .to_string = ava_list_to_string,
+  .string_chunk_iterator = ava_list_string_chunk_iterator,
+  .iterate_string_chunk = ava_list_iterate_string_chunk,
+};
+
+static const ava_list_trait ava_list_proj_map_list_impl = {
+  .header = {
+    .tag = &ava_list_trait_tag,
+    .next = (const ava_attribute*)&ava_list_proj_map_generic_impl
+  },
+  .length = ava_list_proj_map_list_length,
+  .index = ava_list_proj_map_list_index,
+  .index_range = ava_list_proj_map_list_index_range,
+  .slice = ava_list_copy_slice,
+  .append = ava_list_copy_append,
+  .append_n = ava_list_copy_append_n,
+  .concat = ava_list_copy_concat,
+  .remove = ava_list_copy_remove,
+  .set = ava_list_copy_set,
+};
+
+static const ava_value_trait ava_list_proj_filter_generic_impl = {
+  .header = { .tag = &ava_value_trait_tag, .next = NULL },
+  .name = "filter-list-proj",
+  .to_string = ava_list_to_string,
+  .string_chunk_iterator = ava_list_string_chunk_iterator,
+  .iterate_string_chunk = ava_list_iterate_string_chunk,
+};
+
+static const ava_list_trait ava_list_proj_filter_list_impl = {
+  .header = {
+    .tag = &ava_list_trait_tag,
+    .next = (const ava_attribute*)&ava_list_proj_filter_generic_impl
+  },
+  .length = ava_list_proj_filter_list_length,
+  .index = ava_list_proj_filter_list_index,
+  .index_range = ava_list_proj_filter_list_index_range,
+  .slice = ava_list_copy_slice,
+  .append = ava_list_copy_append,
+  .append_n = ava_list_copy_append_n,
+  .concat = ava_list_copy_concat,
+  .remove = ava_list_copy_remove,
+  .set = ava_list_copy_set,
+};
+
+static const ava_value_trait ava_list_proj_zip_generic_impl = {
+  .header = { .tag = &ava_value_trait_tag, .next = NULL },
+  .name = "zip-list-proj",
+  .to_string = ava_list_to_string,
+  .string_chunk_iterator = ava_list_string_chunk_iterator,
+  .iterate_string_chunk = ava_list_iterate_string_chunk,
+};
+
+static const ava_list_trait ava_list_proj_zip_list_impl = {
+  .header = {
+    .tag = &ava_list_trait_tag,
+    .next = (const ava_attribute*)&ava_list_proj_zip_generic_impl
+  },
+  .length = ava_list_proj_zip_list_length,
+  .index = ava_list_proj_zip_list_index,
+  .index_range = ava_list_proj_zip_list_index_range,
   .slice = ava_list_copy_slice,
   .append = ava_list_copy_append,
+  .append_n = ava_list_copy_append_n,
+  .concat = ava_list_copy_concat,
+  .remove = ava_list_copy_remove,
+  .set = ava_list_copy_set,
+};
+
+static const ava_value_trait ava_list_proj_range_generic_impl = {
+  .header = { .tag = &ava_value_trait_tag, .next = NULL },
+  .name = "range-list-proj",
+  .to_string = ava_list_to_string,
+  .string_chunk_iterator = ava_list_string_chunk_iterator,
+  .iterate_string_chunk = ava_list_iterate_string_chunk,
+};
+
+static const ava_list_trait ava_list_proj_range_list_impl = {
+  .header = {
+    .tag = &ava_list_trait_tag,
+    .next = (const ava_attribute*)&ava_list_proj_range_generic_impl
+  },
+  .length = ava_list_proj_range_list_length,
+  .index = ava_list_proj_range_list_index,
+  .index_range = ava_list_proj_range_list_index_range,
+  .slice = ava_list_proj_range_list_slice,
+  .append = ava_list_copy_append,
+  .append_n = ava_list_copy_append_n,
   .concat = ava_list_copy_concat,
   .remove = ava_list_copy_remove,
   .set = ava_list_copy_set,
@@ -195,6 +383,33 @@ static ava_value ava_list_proj_interleave_list_index(
   return this->lists[which].v->index(this->lists[which].c, ix);
 }
 
+static void ava_list_proj_interleave_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_list_proj_interleave_list*restrict this = ava_value_ptr(list.v);
+  ava_value block[AVA_LIST_PROJ_BLOCK];
+  size_t n = this->num_lists;
+  size_t which, first, count, done, k, i;
+
+  /* Read each delegate's contribution in blocks and scatter it into place */
+  for (which = 0; which < n; ++which) {
+    first = begin + (which + n - begin % n) % n;
+    if (first >= end) continue;
+
+    count = (end - first + n - 1) / n;
+    for (done = 0; done < count; done += k) {
+      k = count - done;
+      if (k > AVA_LIST_PROJ_BLOCK)
+        k = AVA_LIST_PROJ_BLOCK;
+
+      this->lists[which].v->index_range(
+        this->lists[which].c, first / n + done, first / n + done + k, block);
+      for (i = 0; i < k; ++i)
+        dst[first - begin + (done + i) * n] = block[i];
+    }
+  }
+}
+
 ava_list_value ava_list_proj_demux(ava_list_value delegate,
                                    size_t offset, size_t stride) {
   ava_list_proj_demux_list*restrict this;
@@ -235,6 +450,38 @@ static ava_value ava_list_proj_demux_list_index(
                                  this->offset + ix * this->stride);
 }
 
+static void ava_list_proj_demux_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_list_proj_demux_list*restrict this = ava_value_ptr(list.v);
+  ava_value block[AVA_LIST_PROJ_BLOCK];
+  size_t per_block, k, i, src;
+
+  /* Reading the spans between selected elements only pays off for small
+   * strides.
+   */
+  if (this->stride > AVA_LIST_PROJ_BLOCK / 4) {
+    for (i = begin; i < end; ++i)
+      *dst++ = ava_list_proj_demux_list_index(list, i);
+    return;
+  }
+
+  per_block = (AVA_LIST_PROJ_BLOCK - 1) / this->stride + 1;
+  while (begin < end) {
+    k = end - begin;
+    if (k > per_block)
+      k = per_block;
+
+    src = this->offset + begin * this->stride;
+    this->delegate.v->index_range(
+      this->delegate.c, src, src + (k - 1) * this->stride + 1, block);
+    for (i = 0; i < k; ++i)
+      *dst++ = block[i * this->stride];
+
+    begin += k;
+  }
+}
+
 ava_list_value ava_list_proj_group(ava_list_value delegate, size_t group_size) {
   ava_list_proj_group_list* this;
   size_t num_groups =
@@ -286,24 +533,462 @@ static ava_value ava_list_proj_group_list_index(
   return ret->v;
 }
 
+static void ava_list_proj_group_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  size_t i;
+
+  /* Groups are cached individually, so there is nothing to batch */
+  for (i = begin; i < end; ++i)
+    *dst++ = ava_list_proj_group_list_index(list, i);
+}
+
 ava_list_value ava_list_proj_flatten(ava_list_value list) {
+  const void* impl = ava_get_attribute(list.v, &ava_list_trait_tag);
+  ava_value block[AVA_LIST_PROJ_BLOCK];
   ava_list_value accum;
-  size_t i, n;
+  size_t base, n, i, k;
 
-  if (&ava_list_proj_group_list_impl ==
-      ava_get_attribute(list.v, &ava_list_trait_tag)) {
+  if (&ava_list_proj_group_list_impl == impl) {
     const ava_list_proj_group_list*restrict group = ava_value_ptr(list.v);
     return group->delegate.c;
   }
 
+  if (&ava_list_proj_zip_list_impl == impl) {
+    const ava_list_proj_zip_list*restrict zip = ava_value_ptr(list.v);
+    ava_list_value lists[zip->num_lists];
+
+    /* Interleaving requires the lists to be of the same length, so trim any
+     * which extend beyond what the zip actually used.
+     */
+    for (i = 0; i < zip->num_lists; ++i) {
+      if (zip->length == zip->lists[i].v->length(zip->lists[i].c))
+        lists[i] = zip->lists[i].c;
+      else
+        lists[i] = zip->lists[i].v->slice(zip->lists[i].c, 0, zip->length);
+    }
+
+    return ava_list_proj_interleave(lists, zip->num_lists);
+  }
+
+  /* Each element of a range is an integer, ie, a list of itself */
+  if (&ava_list_proj_range_list_impl == impl)
+    return list;
+
   n = ava_list_length(list);
   if (0 == n)
     return ava_empty_list();
 
-  accum = ava_list_value_of(ava_list_index(list, 0));
-
-  for (i = 1; i < n; ++i)
-    accum = ava_list_concat(accum, ava_list_value_of(ava_list_index(list, i)));
+  /* Read the input a block at a time so that projections can produce their
+   * elements directly into the block rather than being materialised.
+   */
+  accum = ava_empty_list();
+  for (base = 0; base < n; base += k) {
+    k = n - base;
+    if (k > AVA_LIST_PROJ_BLOCK)
+      k = AVA_LIST_PROJ_BLOCK;
+
+    ava_list_index_range(list, base, base + k, block);
+    for (i = 0; i < k; ++i)
+      accum = ava_list_concat(accum, ava_list_value_of(block[i]));
+  }
 
   return accum;
 }
+
+static ava_value ava_list_proj_apply(const ava_function* fun, ava_value arg) {
+  ava_function_parameter parm = {
+    .type = ava_fpt_static,
+    .value = arg,
+  };
+
+  return ava_function_bind_invoke(fun, 1, &parm);
+}
+
+ava_list_value ava_list_proj_map(ava_list_value delegate,
+                                 const ava_function* fun,
+                                 ava_bool memoise) {
+  ava_list_proj_map_list* this;
+  size_t length = ava_list_length(delegate);
+
+  if (0 == length)
+    return ava_empty_list();
+
+  this = ava_alloc(sizeof(ava_list_proj_map_list) +
+                   (memoise? sizeof(AO_t) * length : 0));
+  this->delegate = ava_fat_list_value_of(delegate.v);
+  this->fun = fun;
+  this->length = length;
+  this->memoise = memoise;
+
+  return (ava_list_value) {
+    ava_value_with_ptr(&ava_list_proj_map_list_impl, this)
+  };
+}
+
+static size_t ava_list_proj_map_list_length(ava_list_value list) {
+  const ava_list_proj_map_list*restrict this = ava_value_ptr(list.v);
+  return this->length;
+}
+
+/**
+ * Returns the mapped value of elt, which is at index ix in the delegate,
+ * consulting and updating the cache if memoising.
+ */
+static ava_value ava_list_proj_map_element(
+  ava_list_proj_map_list*restrict this, size_t ix, ava_value elt
+) {
+  const ava_value*restrict cached;
+  ava_value result;
+
+  result = ava_list_proj_apply(this->fun, elt);
+
+  if (this->memoise) {
+    cached = ava_clone(&result, sizeof(result));
+    /* As with groups, racing threads may each compute and store a result.
+     * They are all equally valid.
+     */
+    AO_store_release_write(this->results + ix, (AO_t)cached);
+  }
+
+  return result;
+}
+
+static ava_value ava_list_proj_map_list_index(
+  ava_list_value list, size_t ix
+) {
+  ava_list_proj_map_list*restrict this = (void*)ava_value_ptr(list.v);
+  const ava_value*restrict cached;
+
+  assert(ix < this->length);
+
+  if (this->memoise) {
+    cached = (const ava_value*restrict)AO_load_acquire_read(
+      this->results + ix);
+    if (cached) return *cached;
+  }
+
+  return ava_list_proj_map_element(
+    this, ix, this->delegate.v->index(this->delegate.c, ix));
+}
+
+static void ava_list_proj_map_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  ava_list_proj_map_list*restrict this = (void*)ava_value_ptr(list.v);
+  const ava_value*restrict cached;
+  ava_value block[AVA_LIST_PROJ_BLOCK];
+  size_t k, i;
+
+  assert(begin <= end);
+  assert(end <= this->length);
+
+  while (begin < end) {
+    k = end - begin;
+    if (k > AVA_LIST_PROJ_BLOCK)
+      k = AVA_LIST_PROJ_BLOCK;
+
+    this->delegate.v->index_range(this->delegate.c, begin, begin + k, block);
+    for (i = 0; i < k; ++i) {
+      if (this->memoise &&
+          (cached = (const ava_value*restrict)AO_load_acquire_read(
+            this->results + begin + i)))
+        *dst++ = *cached;
+      else
+        *dst++ = ava_list_proj_map_element(this, begin + i, block[i]);
+    }
+
+    begin += k;
+  }
+}
+
+static const ava_list_proj_filter_table ava_list_proj_filter_empty_table = {
+  .scanned = 0,
+  .count = 0,
+};
+
+ava_list_value ava_list_proj_filter(ava_list_value delegate,
+                                    const ava_function* predicate) {
+  ava_list_proj_filter_list* this;
+  size_t length = ava_list_length(delegate);
+
+  if (0 == length)
+    return ava_empty_list();
+
+  this = AVA_NEW(ava_list_proj_filter_list);
+  this->delegate = ava_fat_list_value_of(delegate.v);
+  this->predicate = predicate;
+  this->delegate_length = length;
+  this->table = (AO_t)&ava_list_proj_filter_empty_table;
+
+  return (ava_list_value) {
+    ava_value_with_ptr(&ava_list_proj_filter_list_impl, this)
+  };
+}
+
+/**
+ * Returns a table for the given filter which either has at least need
+ * entries, or has scanned the whole delegate.
+ */
+static const ava_list_proj_filter_table* ava_list_proj_filter_extend(
+  ava_list_proj_filter_list*restrict this, size_t need
+) {
+  const ava_list_proj_filter_table*restrict old;
+  ava_list_proj_filter_table*restrict new;
+  ava_value block[AVA_LIST_PROJ_BLOCK];
+  size_t chunk, base, end, k, i;
+
+  for (;;) {
+    old = (const ava_list_proj_filter_table*)AO_load_acquire_read(
+      &this->table);
+    if (old->count >= need || old->scanned == this->delegate_length)
+      return old;
+
+    /* Scan at least as far again as has already been scanned, so that the
+     * cost of copying the table is amortised to a constant per element.
+     */
+    chunk = old->scanned > AVA_LIST_PROJ_BLOCK?
+      old->scanned : AVA_LIST_PROJ_BLOCK;
+    if (chunk > this->delegate_length - old->scanned)
+      chunk = this->delegate_length - old->scanned;
+
+    new = ava_alloc_atomic(sizeof(ava_list_proj_filter_table) +
+                           sizeof(size_t) * (old->count + chunk));
+    memcpy(new->indices, old->indices, sizeof(size_t) * old->count);
+    new->count = old->count;
+
+    end = old->scanned + chunk;
+    for (base = old->scanned; base < end; base += k) {
+      k = end - base;
+      if (k > AVA_LIST_PROJ_BLOCK)
+        k = AVA_LIST_PROJ_BLOCK;
+
+      this->delegate.v->index_range(this->delegate.c, base, base + k, block);
+      for (i = 0; i < k; ++i)
+        if (0 != ava_integer_of_value(
+              ava_list_proj_apply(this->predicate, block[i]), 0))
+          new->indices[new->count++] = base + i;
+    }
+    new->scanned = end;
+
+    /* If this fails, another thread got there first; start over with its
+     * table, which may already be sufficient.
+     */
+    (void)AO_compare_and_swap_release_write(
+      &this->table, (AO_t)old, (AO_t)new);
+  }
+}
+
+static size_t ava_list_proj_filter_list_length(ava_list_value list) {
+  ava_list_proj_filter_list*restrict this = (void*)ava_value_ptr(list.v);
+  return ava_list_proj_filter_extend(this, (size_t)-1)->count;
+}
+
+static ava_value ava_list_proj_filter_list_index(
+  ava_list_value list, size_t ix
+) {
+  ava_list_proj_filter_list*restrict this = (void*)ava_value_ptr(list.v);
+  const ava_list_proj_filter_table*restrict table =
+    ava_list_proj_filter_extend(this, ix + 1);
+
+  assert(ix < table->count);
+
+  return this->delegate.v->index(this->delegate.c, table->indices[ix]);
+}
+
+static void ava_list_proj_filter_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  ava_list_proj_filter_list*restrict this = (void*)ava_value_ptr(list.v);
+  const ava_list_proj_filter_table*restrict table =
+    ava_list_proj_filter_extend(this, end);
+  size_t run;
+
+  assert(begin <= end);
+  assert(end <= table->count);
+
+  /* Read runs of adjacent delegate elements in one call */
+  while (begin < end) {
+    for (run = 1; begin + run < end &&
+           table->indices[begin + run] == table->indices[begin] + run; ++run);
+
+    this->delegate.v->index_range(
+      this->delegate.c, table->indices[begin],
+      table->indices[begin] + run, dst);
+    dst += run;
+    begin += run;
+  }
+}
+
+ava_list_value ava_list_proj_zip(const ava_list_value*restrict lists,
+                                 size_t num_lists) {
+  ava_list_proj_zip_list* this;
+  size_t length, i, n;
+
+  if (0 == num_lists)
+    return ava_empty_list();
+
+  this = ava_alloc(sizeof(ava_list_proj_zip_list) +
+                   sizeof(ava_fat_list_value) * num_lists);
+  this->num_lists = num_lists;
+
+  length = (size_t)-1;
+  for (i = 0; i < num_lists; ++i) {
+    this->lists[i] = ava_fat_list_value_of(lists[i].v);
+    n = this->lists[i].v->length(this->lists[i].c);
+    if (n < length)
+      length = n;
+  }
+
+  if (0 == length)
+    return ava_empty_list();
+
+  this->length = length;
+
+  return (ava_list_value) {
+    ava_value_with_ptr(&ava_list_proj_zip_list_impl, this)
+  };
+}
+
+static size_t ava_list_proj_zip_list_length(ava_list_value list) {
+  const ava_list_proj_zip_list*restrict this = ava_value_ptr(list.v);
+  return this->length;
+}
+
+static ava_value ava_list_proj_zip_list_index(
+  ava_list_value list, size_t ix
+) {
+  const ava_list_proj_zip_list*restrict this = ava_value_ptr(list.v);
+  ava_value tuple[this->num_lists];
+  size_t i;
+
+  assert(ix < this->length);
+
+  for (i = 0; i < this->num_lists; ++i)
+    tuple[i] = this->lists[i].v->index(this->lists[i].c, ix);
+
+  return ava_list_of_values(tuple, this->num_lists).v;
+}
+
+static void ava_list_proj_zip_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_list_proj_zip_list*restrict this = ava_value_ptr(list.v);
+  ava_value block[AVA_LIST_PROJ_BLOCK], tuples[AVA_LIST_PROJ_BLOCK];
+  size_t n = this->num_lists, per_block, k, which, i;
+
+  assert(begin <= end);
+  assert(end <= this->length);
+
+  if (n > AVA_LIST_PROJ_BLOCK / 2) {
+    for (i = begin; i < end; ++i)
+      *dst++ = ava_list_proj_zip_list_index(list, i);
+    return;
+  }
+
+  /* Read each input in blocks and gather the tuples in row-major order */
+  per_block = AVA_LIST_PROJ_BLOCK / n;
+  while (begin < end) {
+    k = end - begin;
+    if (k > per_block)
+      k = per_block;
+
+    for (which = 0; which < n; ++which) {
+      this->lists[which].v->index_range(
+        this->lists[which].c, begin, begin + k, block);
+      for (i = 0; i < k; ++i)
+        tuples[i * n + which] = block[i];
+    }
+
+    for (i = 0; i < k; ++i)
+      *dst++ = ava_list_of_values(tuples + i * n, n).v;
+
+    begin += k;
+  }
+}
+
+static ava_list_value ava_list_proj_range_of(
+  ava_integer begin, ava_integer step, size_t length
+) {
+  ava_list_proj_range_list* this;
+
+  if (0 == length)
+    return ava_empty_list();
+
+  this = AVA_NEW(ava_list_proj_range_list);
+  this->begin = begin;
+  this->step = step;
+  this->length = length;
+
+  return (ava_list_value) {
+    ava_value_with_ptr(&ava_list_proj_range_list_impl, this)
+  };
+}
+
+ava_list_value ava_list_proj_range(ava_integer begin, ava_integer end,
+                                   ava_integer step) {
+  ava_ulong distance, stride;
+
+  assert(0 != step);
+
+  /* Work in unsigned arithmetic, since the distance between the endpoints
+   * need not fit in an ava_integer.
+   */
+  if (step > 0) {
+    if (end <= begin) return ava_empty_list();
+    distance = (ava_ulong)end - (ava_ulong)begin;
+    stride = step;
+  } else {
+    if (end >= begin) return ava_empty_list();
+    distance = (ava_ulong)begin - (ava_ulong)end;
+    stride = -(ava_ulong)step;
+  }
+
+  return ava_list_proj_range_of(
+    begin, step, distance / stride + (0 != distance % stride));
+}
+
+static size_t ava_list_proj_range_list_length(ava_list_value list) {
+  const ava_list_proj_range_list*restrict this = ava_value_ptr(list.v);
+  return this->length;
+}
+
+static ava_value ava_list_proj_range_list_index(
+  ava_list_value list, size_t ix
+) {
+  const ava_list_proj_range_list*restrict this = ava_value_ptr(list.v);
+
+  assert(ix < this->length);
+
+  return ava_value_of_integer(
+    (ava_integer)((ava_ulong)this->begin + ix * (ava_ulong)this->step));
+}
+
+static void ava_list_proj_range_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_list_proj_range_list*restrict this = ava_value_ptr(list.v);
+  ava_ulong value = (ava_ulong)this->begin + begin * (ava_ulong)this->step;
+  size_t i;
+
+  assert(begin <= end);
+  assert(end <= this->length);
+
+  for (i = begin; i < end; ++i) {
+    *dst++ = ava_value_of_integer((ava_integer)value);
+    value += this->step;
+  }
+}
+
+static ava_list_value ava_list_proj_range_list_slice(
+  ava_list_value list, size_t begin, size_t end
+) {
+  const ava_list_proj_range_list*restrict this = ava_value_ptr(list.v);
+
+  assert(begin <= end);
+  assert(end <= this->length);
+
+  return ava_list_proj_range_of(
+    (ava_integer)((ava_ulong)this->begin + begin * (ava_ulong)this->step),
+    this->step, end - begin);
+}
@@ -0,0 +1,505 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/alloc.h"
+#include "avalanche/string.h"
+#include "avalanche/value.h"
+#include "avalanche/integer.h"
+#include "avalanche/real.h"
+#include "avalanche/list.h"
+#include "avalanche/numeric-list.h"
+#include "avalanche/function.h"
+#include "avalanche/list-sort.h"
+#include "-esba-list.h"
+#include "-list-sort.h"
+#include "-parallel.h"
+
+/**
+ * Runs of up to this many elements are sorted by insertion sort before any
+ * merging happens.
+ */
+#define AVA_LIST_SORT_RUN 32
+
+/**
+ * The operations needed to sort an array of some particular element type.
+ *
+ * Each function takes an opaque ctx pointer which is passed through to the
+ * element comparison.
+ */
+typedef struct {
+  /**
+   * The size of each element, in bytes.
+   */
+  size_t size;
+  /**
+   * Stably sorts the n elements at base in-place, using tmp, which has room
+   * for n elements, as scratch space.
+   */
+  void (*sort)(void* base, void* tmp, size_t n, const void* ctx);
+  /**
+   * Returns how many of the first d elements of the stable merge of a and b
+   * come from a.
+   */
+  size_t (*split)(const void* a, size_t na, const void* b, size_t nb,
+                  size_t d, const void* ctx);
+  /**
+   * Stably merges the na elements at a and nb elements at b into dst.
+   */
+  void (*merge)(void* dst, const void* a, size_t na,
+                const void* b, size_t nb, const void* ctx);
+} ava_list_sort_kernel;
+
+/**
+ * Defines an ava_list_sort_kernel called name for sorting elements of type
+ * elt_t, where LESS(ctx, a, b) is true if the element at pointer a orders
+ * strictly before that at pointer b.
+ */
+#define AVA_LIST_SORT_KERNEL(name, elt_t, LESS)                         \
+  static void name##_insertion(elt_t* base, size_t n, const void* ctx) { \
+    elt_t x;                                                            \
+    size_t i, j;                                                        \
+                                                                        \
+    for (i = 1; i < n; ++i) {                                           \
+      x = base[i];                                                      \
+      for (j = i; j > 0 && LESS(ctx, &x, base + j - 1); --j)            \
+        base[j] = base[j - 1];                                          \
+      base[j] = x;                                                      \
+    }                                                                   \
+  }                                                                     \
+                                                                        \
+  static void name##_merge(void* vdst, const void* va, size_t na,      \
+                           const void* vb, size_t nb, const void* ctx) { \
+    elt_t*restrict dst = vdst;                                          \
+    const elt_t*restrict a = va, *restrict aend = a + na;               \
+    const elt_t*restrict b = vb, *restrict bend = b + nb;               \
+                                                                        \
+    while (a < aend && b < bend) {                                      \
+      /* Take from a on ties so the merge is stable */                  \
+      if (LESS(ctx, b, a))                                              \
+        *dst++ = *b++;                                                  \
+      else                                                              \
+        *dst++ = *a++;                                                  \
+    }                                                                   \
+                                                                        \
+    memcpy(dst, a, sizeof(elt_t) * (aend - a));                         \
+    dst += aend - a;                                                    \
+    memcpy(dst, b, sizeof(elt_t) * (bend - b));                         \
+  }                                                                     \
+                                                                        \
+  static size_t name##_split(const void* va, size_t na,                \
+                             const void* vb, size_t nb,                 \
+                             size_t d, const void* ctx) {               \
+    const elt_t* a = va, * b = vb;                                      \
+    size_t lo = d > nb? d - nb : 0, hi = d < na? d : na, mid;           \
+                                                                        \
+    /* Find the first a[mid] which b[d-mid-1] orders strictly before;   \
+     * everything in a before it is within the first d elements.        \
+     */                                                                 \
+    while (lo < hi) {                                                   \
+      mid = lo + (hi - lo) / 2;                                         \
+      if (LESS(ctx, b + (d - mid - 1), a + mid))                        \
+        hi = mid;                                                       \
+      else                                                              \
+        lo = mid + 1;                                                   \
+    }                                                                   \
+                                                                        \
+    return lo;                                                          \
+  }                                                                     \
+                                                                        \
+  static void name##_sort(void* vbase, void* vtmp, size_t n,           \
+                          const void* ctx) {                            \
+    elt_t* src = vbase, * dst = vtmp, * swap;                           \
+    size_t i, width, nb;                                                \
+                                                                        \
+    for (i = 0; i < n; i += AVA_LIST_SORT_RUN)                          \
+      name##_insertion(src + i, n - i < AVA_LIST_SORT_RUN?              \
+                       n - i : AVA_LIST_SORT_RUN, ctx);                 \
+                                                                        \
+    for (width = AVA_LIST_SORT_RUN; width < n; width *= 2) {            \
+      for (i = 0; i < n; i += 2 * width) {                              \
+        if (n - i <= width) {                                           \
+          memcpy(dst + i, src + i, sizeof(elt_t) * (n - i));            \
+          continue;                                                     \
+        }                                                               \
+                                                                        \
+        nb = n - i - width < width? n - i - width : width;              \
+        /* Already-ordered neighbours need no merging at all */         \
+        if (!LESS(ctx, src + i + width, src + i + width - 1))           \
+          memcpy(dst + i, src + i, sizeof(elt_t) * (width + nb));       \
+        else                                                            \
+          name##_merge(dst + i, src + i, width,                         \
+                       src + i + width, nb, ctx);                       \
+      }                                                                 \
+                                                                        \
+      swap = src;                                                       \
+      src = dst;                                                        \
+      dst = swap;                                                       \
+    }                                                                   \
+                                                                        \
+    if (src != vbase)                                                   \
+      memcpy(vbase, src, sizeof(elt_t) * n);                            \
+  }                                                                     \
+                                                                        \
+  static const ava_list_sort_kernel name = {                            \
+    .size = sizeof(elt_t),                                              \
+    .sort = name##_sort,                                                \
+    .split = name##_split,                                              \
+    .merge = name##_merge,                                              \
+  }
+
+typedef struct {
+  ava_integer key;
+  ava_value value;
+} ava_list_sort_integer_elt;
+
+typedef struct {
+  ava_real key;
+  ava_value value;
+} ava_list_sort_real_elt;
+
+typedef struct {
+  ava_string key;
+  ava_value value;
+} ava_list_sort_string_elt;
+
+/* NaNs order after everything else and equal to each other */
+static inline ava_bool ava_list_sort_real_less(ava_real a, ava_real b) {
+  return a < b || (isnan(b) && !isnan(a));
+}
+
+static ava_bool ava_list_sort_function_less(
+  const ava_function* comparator, ava_value a, ava_value b);
+
+#define ASCII9_LESS(ctx, a, b) (*(a) < *(b))
+#define INTEGER_LESS(ctx, a, b) (*(a) < *(b))
+#define REAL_LESS(ctx, a, b) ava_list_sort_real_less(*(a), *(b))
+#define KEYED_INTEGER_LESS(ctx, a, b) ((a)->key < (b)->key)
+#define KEYED_REAL_LESS(ctx, a, b) ava_list_sort_real_less((a)->key, (b)->key)
+#define KEYED_STRING_LESS(ctx, a, b) (ava_strcmp((a)->key, (b)->key) < 0)
+#define FUNCTION_LESS(ctx, a, b) ava_list_sort_function_less((ctx), *(a), *(b))
+
+AVA_LIST_SORT_KERNEL(ava_list_sort_ascii9_kernel,
+                     ava_ascii9_string, ASCII9_LESS);
+AVA_LIST_SORT_KERNEL(ava_list_sort_integer_kernel,
+                     ava_integer, INTEGER_LESS);
+AVA_LIST_SORT_KERNEL(ava_list_sort_real_kernel,
+                     ava_real, REAL_LESS);
+AVA_LIST_SORT_KERNEL(ava_list_sort_keyed_integer_kernel,
+                     ava_list_sort_integer_elt, KEYED_INTEGER_LESS);
+AVA_LIST_SORT_KERNEL(ava_list_sort_keyed_real_kernel,
+                     ava_list_sort_real_elt, KEYED_REAL_LESS);
+AVA_LIST_SORT_KERNEL(ava_list_sort_keyed_string_kernel,
+                     ava_list_sort_string_elt, KEYED_STRING_LESS);
+AVA_LIST_SORT_KERNEL(ava_list_sort_function_kernel,
+                     ava_value, FUNCTION_LESS);
+
+typedef struct {
+  const ava_list_sort_kernel* kernel;
+  const void* ctx;
+  char* src, * dst;
+  size_t n;
+  /* While sorting pieces, the length of each piece. While merging, the
+   * length of the sorted runs being merged pairwise. */
+  size_t run;
+  /* While merging, the number of segments each pair is merged in */
+  size_t segments;
+} ava_list_sort_job;
+
+static void ava_list_sort_piece(void* vjob, size_t ix);
+static void ava_list_sort_merge_segment(void* vjob, size_t ix);
+
+/**
+ * Stably sorts the n elements at base with the given kernel, splitting the
+ * work into the given number of pieces.
+ *
+ * tmp must have room for n elements. ctx is passed through to the kernel, and
+ * may be used from several threads at once.
+ *
+ * @return Either base or tmp, whichever holds the sorted elements.
+ */
+static void* ava_list_sort_array(const ava_list_sort_kernel* kernel,
+                                 void* base, void* tmp, size_t n,
+                                 size_t pieces, const void* ctx) {
+  ava_list_sort_job job;
+  size_t pairs;
+  char* swap;
+
+  if (pieces <= 1 || n < pieces * AVA_LIST_SORT_RUN) {
+    (*kernel->sort)(base, tmp, n, ctx);
+    return base;
+  }
+
+  job.kernel = kernel;
+  job.ctx = ctx;
+  job.src = base;
+  job.dst = tmp;
+  job.n = n;
+  job.run = (n + pieces - 1) / pieces;
+  ava_parallel_for(pieces, ava_list_sort_piece, &job);
+
+  while (job.run < n) {
+    pairs = (n + 2 * job.run - 1) / (2 * job.run);
+    job.segments = (pieces + pairs - 1) / pairs;
+    ava_parallel_for(pairs * job.segments, ava_list_sort_merge_segment, &job);
+
+    swap = job.src;
+    job.src = job.dst;
+    job.dst = swap;
+    job.run *= 2;
+  }
+
+  return job.src;
+}
+
+static void ava_list_sort_piece(void* vjob, size_t ix) {
+  const ava_list_sort_job* job = vjob;
+  size_t begin, end, size = job->kernel->size;
+
+  begin = ix * job->run;
+  if (begin >= job->n) return;
+  end = begin + job->run < job->n? begin + job->run : job->n;
+
+  (*job->kernel->sort)(job->src + begin * size, job->dst + begin * size,
+                       end - begin, job->ctx);
+}
+
+static void ava_list_sort_merge_segment(void* vjob, size_t ix) {
+  const ava_list_sort_job* job = vjob;
+  const ava_list_sort_kernel* kernel = job->kernel;
+  size_t pair = ix / job->segments, segment = ix % job->segments;
+  size_t base, na, nb, d0, d1, i0, i1, size = kernel->size;
+  const char* a, * b;
+
+  base = pair * 2 * job->run;
+  na = job->n - base < job->run? job->n - base : job->run;
+  nb = job->n - base - na < job->run? job->n - base - na : job->run;
+  a = job->src + base * size;
+  b = a + na * size;
+
+  d0 = (na + nb) * segment / job->segments;
+  d1 = (na + nb) * (segment + 1) / job->segments;
+  if (d0 == d1) return;
+
+  i0 = (*kernel->split)(a, na, b, nb, d0, job->ctx);
+  i1 = (*kernel->split)(a, na, b, nb, d1, job->ctx);
+  (*kernel->merge)(job->dst + (base + d0) * size,
+                   a + i0 * size, i1 - i0,
+                   b + (d0 - i0) * size, (d1 - i1) - (d0 - i0), job->ctx);
+}
+
+/**
+ * Returns the attribute shared by every element of the given list, whose
+ * contents are also given in values, or NULL if there is none.
+ */
+static const void* ava_list_sort_common_attr(
+  ava_list_value list, const ava_value*restrict values, size_t n
+) {
+  const void* attr;
+  size_t i;
+
+  if (ava_list_is_integer_list(list)) return &ava_integer_type;
+  if (ava_list_is_real_list(list)) return &ava_real_type;
+  if ((attr = ava_esba_list_common_attr(list))) return attr;
+
+  attr = ava_value_attr(values[0]);
+  for (i = 1; i < n; ++i)
+    if (ava_value_attr(values[i]) != attr)
+      return NULL;
+
+  return attr;
+}
+
+static ava_list_value ava_list_sort_lexical(
+  ava_value*restrict values, size_t n, const void* attr, size_t pieces
+) {
+  ava_ascii9_string* ascii9;
+  ava_list_sort_string_elt* elts, * sorted;
+  ava_string str;
+  size_t i;
+
+  if (&ava_string_type == attr) {
+    ascii9 = ava_alloc_atomic(sizeof(ava_ascii9_string) * 2 * n);
+    for (i = 0; i < n; ++i) {
+      str = ava_value_str(values[i]);
+      if (!ava_string_is_ascii9(str)) goto not_ascii9;
+      ascii9[i] = str.ascii9;
+    }
+
+    /* ASCII9 strings order the same as their integer encodings */
+    ascii9 = ava_list_sort_array(&ava_list_sort_ascii9_kernel,
+                                 ascii9, ascii9 + n, n, pieces, NULL);
+    for (i = 0; i < n; ++i)
+      values[i] = ava_value_of_string((ava_string) { .ascii9 = ascii9[i] });
+
+    return ava_list_of_values(values, n);
+  }
+
+  not_ascii9:
+  elts = ava_alloc(sizeof(ava_list_sort_string_elt) * 2 * n);
+  for (i = 0; i < n; ++i) {
+    elts[i].key = ava_to_string(values[i]);
+    elts[i].value = values[i];
+  }
+
+  sorted = ava_list_sort_array(&ava_list_sort_keyed_string_kernel,
+                               elts, elts + n, n, pieces, NULL);
+  for (i = 0; i < n; ++i)
+    values[i] = sorted[i].value;
+
+  return ava_list_of_values(values, n);
+}
+
+static ava_list_value ava_list_sort_integer(
+  ava_value*restrict values, size_t n, const void* attr, size_t pieces
+) {
+  ava_integer* keys;
+  ava_list_sort_integer_elt* elts, * sorted;
+  size_t i;
+
+  if (&ava_integer_type == attr) {
+    keys = ava_alloc_atomic(sizeof(ava_integer) * 2 * n);
+    for (i = 0; i < n; ++i)
+      keys[i] = ava_value_slong(values[i]);
+
+    keys = ava_list_sort_array(&ava_list_sort_integer_kernel,
+                               keys, keys + n, n, pieces, NULL);
+    return ava_integer_list_of_array(keys, n);
+  }
+
+  elts = ava_alloc(sizeof(ava_list_sort_integer_elt) * 2 * n);
+  for (i = 0; i < n; ++i) {
+    elts[i].key = ava_integer_of_value(values[i], 0);
+    elts[i].value = values[i];
+  }
+
+  sorted = ava_list_sort_array(&ava_list_sort_keyed_integer_kernel,
+                               elts, elts + n, n, pieces, NULL);
+  for (i = 0; i < n; ++i)
+    values[i] = sorted[i].value;
+
+  return ava_list_of_values(values, n);
+}
+
+static ava_list_value ava_list_sort_real(
+  ava_value*restrict values, size_t n, const void* attr, size_t pieces
+) {
+  ava_real* keys;
+  ava_list_sort_real_elt* elts, * sorted;
+  size_t i;
+
+  if (&ava_real_type == attr) {
+    keys = ava_alloc_atomic(sizeof(ava_real) * 2 * n);
+    for (i = 0; i < n; ++i)
+      keys[i] = ava_value_real(values[i]);
+
+    keys = ava_list_sort_array(&ava_list_sort_real_kernel,
+                               keys, keys + n, n, pieces, NULL);
+    return ava_real_list_of_array(keys, n);
+  }
+
+  elts = ava_alloc(sizeof(ava_list_sort_real_elt) * 2 * n);
+  for (i = 0; i < n; ++i) {
+    elts[i].key = ava_real_of_value(values[i], 0.0);
+    elts[i].value = values[i];
+  }
+
+  sorted = ava_list_sort_array(&ava_list_sort_keyed_real_kernel,
+                               elts, elts + n, n, pieces, NULL);
+  for (i = 0; i < n; ++i)
+    values[i] = sorted[i].value;
+
+  return ava_list_of_values(values, n);
+}
+
+ava_list_value ava_list_sort(ava_list_value list, ava_list_sort_order order) {
+  size_t n = ava_list_length(list);
+
+  return ava_list_sort_in_pieces(
+    list, order,
+    n >= AVA_LIST_SORT_PARALLEL_THRESH? ava_parallel_width() : 1);
+}
+
+ava_list_value ava_list_sort_in_pieces(ava_list_value list,
+                                       ava_list_sort_order order,
+                                       size_t pieces) {
+  size_t n = ava_list_length(list);
+  ava_value* values;
+  const void* attr;
+
+  if (n < 2) return list;
+
+  values = ava_alloc(sizeof(ava_value) * n);
+  ava_list_index_range(list, 0, n, values);
+  attr = ava_list_sort_common_attr(list, values, n);
+
+  switch (order) {
+  case ava_lso_lexical:
+    return ava_list_sort_lexical(values, n, attr, pieces);
+  case ava_lso_integer:
+    return ava_list_sort_integer(values, n, attr, pieces);
+  case ava_lso_real:
+    return ava_list_sort_real(values, n, attr, pieces);
+  }
+
+  /* unreachable */
+  abort();
+}
+
+static ava_bool ava_list_sort_function_less(
+  const ava_function* comparator, ava_value a, ava_value b
+) {
+  ava_function_parameter parms[2] = {
+    { .type = ava_fpt_static, .value = a },
+    { .type = ava_fpt_static, .value = b },
+  };
+
+  return ava_integer_of_value(
+    ava_function_bind_invoke(comparator, 2, parms), 0) < 0;
+}
+
+ava_list_value ava_list_sort_by(ava_list_value list,
+                                const ava_function* comparator) {
+  size_t n = ava_list_length(list);
+
+  return ava_list_sort_by_in_pieces(
+    list, comparator,
+    n >= AVA_LIST_SORT_PARALLEL_THRESH? ava_parallel_width() : 1);
+}
+
+ava_list_value ava_list_sort_by_in_pieces(ava_list_value list,
+                                          const ava_function* comparator,
+                                          size_t pieces) {
+  size_t n = ava_list_length(list);
+  ava_value* values;
+
+  if (n < 2) return list;
+
+  values = ava_alloc(sizeof(ava_value) * 2 * n);
+  ava_list_index_range(list, 0, n, values);
+  values = ava_list_sort_array(&ava_list_sort_function_kernel,
+                               values, values + n, n, pieces, comparator);
+
+  return ava_list_of_values(values, n);
+}
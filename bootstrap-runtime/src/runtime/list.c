@@ -22,6 +22,8 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <atomic_ops.h>
+
 #define AVA__INTERNAL_INCLUDE 1
 #include "avalanche/defs.h"
 #include "avalanche/alloc.h"
@@ -33,26 +35,50 @@
 #include "avalanche/list.h"
 #include "-array-list.h"
 #include "-esba-list.h"
+#include "-numeric-list.h"
+#include "-list-parse.h"
+#include "-list-string-cache.h"
+#include "-parallel.h"
 
 const ava_attribute_tag ava_list_trait_tag = {
   .name = "list"
 };
 
+/**
+ * The number of elements ava_list_to_string() reads from a list at once.
+ *
+ * This is also the maximum number of elements in each chunk produced by
+ * ava_list_iterate_string_chunk().
+ */
+#define AVA_LIST_TO_STRING_BLOCK 64
+
+/**
+ * An entry in an ava_list_string_cache.
+ */
+typedef struct {
+  const void* version;
+  size_t length;
+  ava_string string;
+} ava_list_string_cache_entry;
+
 static ava_list_value ava_list_value_of_string(
   ava_string str, ava_bool return_empty_on_fail);
 static ava_bool ava_list_is_in_normal_list_form(
   ava_value val, ava_string stringified);
 
 ava_list_value ava_list_value_of(ava_value value) {
-  if (!ava_get_attribute(value, &ava_list_trait_tag))
+  static ava_attribute_cache cache;
+
+  if (!ava_get_attribute_cached(value, &ava_list_trait_tag, &cache))
     return ava_list_value_of_string(ava_to_string(value), ava_false);
   else
     return (ava_list_value) { value };
 }
 
 ava_fat_list_value ava_fat_list_value_of(ava_value value) {
-  const ava_list_trait* trait = ava_get_attribute(
-    value, &ava_list_trait_tag);
+  static ava_attribute_cache cache;
+  const ava_list_trait* trait = ava_get_attribute_cached(
+    value, &ava_list_trait_tag, &cache);
 
   if (!trait) {
     value = ava_list_value_of_string(ava_to_string(value), ava_false).v;
@@ -63,23 +89,123 @@ ava_fat_list_value ava_fat_list_value_of(ava_value value) {
   return (ava_fat_list_value) { .v = trait, .c = { value } };
 }
 
+/*
+  Parsing a string as a list is split into two steps so that very long
+  strings can be parsed in parallel.
+
+  First, one or more parts of the string are parsed independently, each into
+  an ava_list_parse_part. A part can close brackets opened before it began,
+  and can leave brackets open for later parts to close.
+
+  Then the parts are joined, in order, onto a single stack of open lists. Any
+  error found in a part is only reported once everything before it has been
+  joined, so that the first error in the string is always the one reported,
+  exactly as if the whole string had been parsed in one go.
+
+  When a string is parsed in parallel, the boundaries between parts are only
+  guesses; a guess may land within a string literal, for example. Each part
+  therefore runs until the first token which starts at or after the next
+  part's guessed beginning, and records where that token starts. If that is
+  not where the next part actually began, the next part is discarded and
+  parsed again from the right place. Since the lexer only needs to know the
+  preceding characters to resume at the start of any token, every part that
+  survives this check was tokenised exactly as in a serial parse.
+ */
+
+/**
+ * The result of parsing one part of a string as a list.
+ */
+typedef struct {
+  /**
+   * The index at which this part begins.
+   */
+  size_t begin;
+  /**
+   * The index of the first token at or after the stop index of this part, or
+   * the end of the string if there is none.
+   */
+  size_t resume;
+  /**
+   * The number of closing brackets this part contains which close lists
+   * opened before it began.
+   */
+  size_t num_closes;
+  /**
+   * For each of the num_closes closing brackets, the elements to add to the
+   * innermost open list before closing it, and the index of the bracket.
+   */
+  ava_list_value* segments;
+  size_t* close_indices;
+  size_t closes_cap;
+  /**
+   * The elements to add to the innermost open list after all the closes have
+   * been applied, followed by the num_open-1 lists this part itself opened
+   * and did not close, outermost first.
+   */
+  ava_list_value* open;
+  size_t num_open;
+  /**
+   * Whether this part stopped early because of an error, and the message to
+   * report for it if so.
+   */
+  ava_bool failed;
+  ava_string error;
+
+  ava_list_value inline_stack[64];
+} ava_list_parse_part;
+
+static void ava_list_parse_part_run(
+  ava_list_parse_part*restrict part, ava_string str,
+  size_t begin, size_t stop);
+static ava_list_value ava_list_parse_join(
+  ava_list_parse_part*restrict parts, size_t num_parts,
+  ava_string str, ava_bool return_empty_on_fail);
+static ava_list_value ava_list_parse_parallel(
+  ava_string str, size_t part_length, ava_bool return_empty_on_fail);
+
 static ava_list_value ava_list_value_of_string(
   ava_string str, ava_bool return_empty_on_fail
 ) {
-  ava_lex_context* lex = ava_lex_new(str);
+  ava_list_parse_part part;
+  size_t strlen = ava_strlen(str);
+
+  if (strlen >= AVA_LIST_PARALLEL_PARSE_THRESH && ava_parallel_width() > 1)
+    return ava_list_parse_parallel(
+      str, AVA_LIST_PARALLEL_PARSE_PART, return_empty_on_fail);
+
+  ava_list_parse_part_run(&part, str, 0, strlen);
+  return ava_list_parse_join(&part, 1, str, return_empty_on_fail);
+}
+
+ava_list_value ava_list_value_of_string_in_parts(ava_string str,
+                                                 size_t part_length) {
+  assert(part_length > 0);
+  return ava_list_parse_parallel(str, part_length, ava_false);
+}
+
+static void ava_list_parse_part_run(
+  ava_list_parse_part*restrict part, ava_string str,
+  size_t begin, size_t stop
+) {
+  ava_lex_context* lex = ava_lex_new_at(str, begin);
   ava_lex_result result;
-  ava_list_value stack_stack[64];
   ava_list_value* accum, * heap_stack;
   size_t stack_h, stack_cap;
 
   ava_value buffer[64];
   unsigned buffer_ix = 0;
 
-  accum = stack_stack;
+  part->begin = begin;
+  part->num_closes = 0;
+  part->closes_cap = 0;
+  part->segments = NULL;
+  part->close_indices = NULL;
+  part->failed = ava_false;
+
+  accum = part->inline_stack;
   *accum = ava_empty_list();
   stack_h = 0;
-  stack_cap = sizeof(stack_stack) / sizeof(stack_stack[0]);
-  heap_stack = NULL;
+  stack_cap = sizeof(part->inline_stack) / sizeof(part->inline_stack[0]);
 
 #define FLUSH() do {                            \
     if (buffer_ix > 0) {                        \
@@ -90,9 +216,21 @@ static ava_list_value ava_list_value_of_string(
     }                                           \
   } while (0)
 
+#define FAIL(message) do {                      \
+    part->failed = ava_true;                    \
+    part->error = (message);                    \
+    goto done;                                  \
+  } while (0)
+
   for (;;) {
     switch (ava_lex_lex(&result, lex)) {
     case ava_ls_ok:
+      /* Anything from here on belongs to the next part */
+      if (result.index_start >= stop) {
+        part->resume = result.index_start;
+        goto done;
+      }
+
       if (ava_lex_token_type_is_simple(result.type)) {
         buffer[buffer_ix++] = ava_value_of_string(result.str);
         if (buffer_ix == sizeof(buffer) / sizeof(buffer[0]))
@@ -118,67 +256,216 @@ static ava_list_value ava_list_value_of_string(
           FLUSH();
 
           if (0 == stack_h) {
-            if (return_empty_on_fail)
-              return ava_empty_list();
-            else
-              ava_throw_str(&ava_format_exception,
-                            ava_error_list_unbalanced_close_bracket(
-                              result.index_start));
+            /* Closes a list opened before this part; whether there is
+             * actually such a list is only known when joining.
+             */
+            if (part->num_closes == part->closes_cap) {
+              ava_list_value* segments;
+              size_t* close_indices;
+
+              part->closes_cap = part->closes_cap? part->closes_cap * 2 : 4;
+              segments = ava_alloc(
+                sizeof(ava_list_value) * part->closes_cap);
+              close_indices = ava_alloc_atomic(
+                sizeof(size_t) * part->closes_cap);
+              memcpy(segments, part->segments,
+                     sizeof(ava_list_value) * part->num_closes);
+              memcpy(close_indices, part->close_indices,
+                     sizeof(size_t) * part->num_closes);
+              part->segments = segments;
+              part->close_indices = close_indices;
+            }
+
+            part->segments[part->num_closes] = accum[0];
+            part->close_indices[part->num_closes] = result.index_start;
+            ++part->num_closes;
+            accum[0] = ava_empty_list();
           }
 
-          if (1 != ava_strlen(result.str)) {
-            if (return_empty_on_fail)
-              return ava_empty_list();
-            else
-              ava_throw_str(&ava_format_exception,
-                            ava_error_list_tagged_close_bracket(
-                              result.str, result.index_start));
-          }
+          if (1 != ava_strlen(result.str))
+            FAIL(ava_error_list_tagged_close_bracket(
+                   result.str, result.index_start));
 
-          --stack_h;
-          accum[stack_h] = ava_list_append(accum[stack_h], accum[stack_h+1].v);
+          if (stack_h > 0) {
+            --stack_h;
+            accum[stack_h] = ava_list_append(
+              accum[stack_h], accum[stack_h+1].v);
+          }
           break;
 
         default:
-          if (return_empty_on_fail)
-            return ava_empty_list();
-          else
-            ava_throw_str(&ava_format_exception,
-                          ava_error_unexpected_token_parsing_list(
-                            result.index_start, result.str));
-          break;
+          FAIL(ava_error_unexpected_token_parsing_list(
+                 result.index_start, result.str));
         }
       }
       break;
 
     case ava_ls_end_of_input:
+      part->resume = result.index_start;
       goto done;
 
-    case ava_ls_error: {
-      if (return_empty_on_fail)
-        return ava_empty_list();
-      else
-        ava_throw_str(&ava_format_exception,
-                      ava_error_invalid_list_syntax(
-                        result.index_start, result.str));
-    } break;
+    case ava_ls_error:
+      /* Since this part started at a token boundary, this is exactly the
+       * error a serial parse would encounter, even if it is beyond stop.
+       */
+      FAIL(ava_error_invalid_list_syntax(result.index_start, result.str));
     }
   }
 
   done:
+  FLUSH();
+  part->open = accum;
+  part->num_open = stack_h + 1;
+
+#undef FAIL
+#undef FLUSH
+}
+
+static ava_list_value ava_list_parse_join(
+  ava_list_parse_part*restrict parts, size_t num_parts,
+  ava_string str, ava_bool return_empty_on_fail
+) {
+  ava_list_value stack_stack[64];
+  ava_list_value* accum, * heap_stack;
+  size_t stack_h, stack_cap, pos, i, j;
+  ava_list_parse_part* part, redo;
+
+  accum = stack_stack;
+  *accum = ava_empty_list();
+  stack_h = 0;
+  stack_cap = sizeof(stack_stack) / sizeof(stack_stack[0]);
+
+#define FAIL(message) do {                                      \
+    if (return_empty_on_fail)                                   \
+      return ava_empty_list();                                  \
+    else                                                        \
+      ava_throw_str(&ava_format_exception, (message));          \
+  } while (0)
+
+  pos = 0;
+  for (i = 0; i < num_parts; ++i) {
+    part = parts + i;
+
+    if (part->begin != pos) {
+      /* The previous part ran past this one's beginning. If it ran past the
+       * whole of this part too, there's nothing here; otherwise, this part
+       * may have started in the middle of a token, so redo it from where the
+       * previous part actually stopped.
+       */
+      if (i + 1 < num_parts && pos >= parts[i+1].begin)
+        continue;
+
+      ava_list_parse_part_run(
+        &redo, str, pos,
+        i + 1 < num_parts? parts[i+1].begin : ava_strlen(str));
+      part = &redo;
+    }
+
+    for (j = 0; j < part->num_closes; ++j) {
+      accum[stack_h] = ava_list_concat(accum[stack_h], part->segments[j]);
+      if (0 == stack_h)
+        FAIL(ava_error_list_unbalanced_close_bracket(
+               part->close_indices[j]));
+
+      --stack_h;
+      accum[stack_h] = ava_list_append(accum[stack_h], accum[stack_h+1].v);
+    }
+
+    accum[stack_h] = ava_list_concat(accum[stack_h], part->open[0]);
+
+    if (stack_h + part->num_open > stack_cap) {
+      /* Need to allocate more stack space */
+      while (stack_h + part->num_open > stack_cap)
+        stack_cap *= 2;
+      heap_stack = ava_alloc(sizeof(ava_value) * stack_cap);
+      memcpy(heap_stack, accum, sizeof(ava_value) * (stack_h + 1));
+      accum = heap_stack;
+    }
+
+    for (j = 1; j < part->num_open; ++j)
+      accum[++stack_h] = part->open[j];
 
-  if (stack_h > 0) {
-    if (return_empty_on_fail)
-      return ava_empty_list();
-    else
-      ava_throw_str(&ava_format_exception,
-                    ava_error_list_unbalanced_open_bracket(stack_h));
+    if (part->failed)
+      FAIL(part->error);
+
+    pos = part->resume;
   }
 
-  FLUSH();
+  if (stack_h > 0)
+    FAIL(ava_error_list_unbalanced_open_bracket(stack_h));
+
   return accum[0];
+
+#undef FAIL
+}
+
+typedef struct {
+  ava_string str;
+  ava_list_parse_part*restrict parts;
+  size_t num_parts;
+} ava_list_parse_parallel_job;
+
+static void ava_list_parse_parallel_part(void* vjob, size_t ix) {
+  ava_list_parse_parallel_job* job = vjob;
+
+  ava_list_parse_part_run(
+    job->parts + ix, job->str, job->parts[ix].begin,
+    ix + 1 < job->num_parts?
+    job->parts[ix+1].begin : ava_strlen(job->str));
 }
 
+/**
+ * Returns the first index at or after from which immediately follows
+ * whitespace, as that is the likeliest place for a token to start. Gives up
+ * after a while, since parts which start in a bad place are handled anyway.
+ */
+static size_t ava_list_parse_guess_boundary(
+  const char*restrict data, size_t strlen, size_t from
+) {
+  size_t i, limit;
+
+  limit = strlen - from > 4096? from + 4096 : strlen;
+  for (i = from; i < limit; ++i) {
+    if (i > 0 &&
+        (' ' == data[i-1] || '\t' == data[i-1] || '\n' == data[i-1]) &&
+        ' ' != data[i] && '\t' != data[i] &&
+        '\r' != data[i] && '\n' != data[i])
+      return i;
+  }
+
+  return from;
+}
+
+static ava_list_value ava_list_parse_parallel(
+  ava_string str, size_t part_length, ava_bool return_empty_on_fail
+) {
+  ava_list_parse_parallel_job job;
+  ava_str_tmpbuff tmp;
+  const char*restrict data;
+  size_t strlen = ava_strlen(str), num_parts, i;
+
+  if (0 == strlen) return ava_empty_list();
+
+  num_parts = (strlen + part_length - 1) / part_length;
+
+  /* Force the string before splitting it up, so that every part's lexer
+   * shares the one flat copy instead of racing to make their own.
+   */
+  data = ava_string_to_cstring_buff(tmp, str);
+
+  job.str = str;
+  job.num_parts = num_parts;
+  job.parts = ava_alloc(sizeof(ava_list_parse_part) * num_parts);
+  job.parts[0].begin = 0;
+  for (i = 1; i < num_parts; ++i)
+    job.parts[i].begin = ava_list_parse_guess_boundary(
+      data, strlen, i * part_length);
+
+  ava_parallel_for(num_parts, ava_list_parse_parallel_part, &job);
+
+  return ava_list_parse_join(job.parts, num_parts, str,
+                             return_empty_on_fail);
+}
 ava_fat_list_value ava_list_copy_of(ava_fat_list_value list, size_t begin, size_t end) {
   if (end == begin)
     return ava_fat_list_value_of(ava_empty_list().v);
@@ -192,10 +479,14 @@ ava_fat_list_value ava_list_copy_of(ava_fat_list_value list, size_t begin, size_
 }
 
 ava_list_value ava_list_of_values(const ava_value*restrict values, size_t n) {
+  ava_list_value numeric;
+
   if (0 == n)
     return ava_empty_list();
   else if (n <= AVA_ARRAY_LIST_THRESH)
     return ava_array_list_of_raw(values, n);
+  else if (ava_numeric_list_of_raw(&numeric, values, n))
+    return numeric;
   else
     return ava_esba_list_of_raw(values, n);
 }
@@ -204,6 +495,7 @@ ava_string ava_list_escape(ava_value val) {
   ava_bool contains_special = ava_false;
   ava_bool quote_with_verbatim = ava_false;
   ava_string str;
+  ava_string_builder escaped;
 
   const char*restrict strdat;
   ava_str_tmpbuff tmpbuff;
@@ -251,22 +543,27 @@ ava_string ava_list_escape(ava_value val) {
   /* If the value is already in normalised list form, we can just put brackets
    * around it and expect it to work.
    */
-  if (ava_list_is_in_normal_list_form(val, str))
-    return ava_strcat(
-      ava_strcat(AVA_ASCII9_STRING("["), str),
-      AVA_ASCII9_STRING("]"));
+  ava_string_builder_init(&escaped, strlen + 2);
+  if (ava_list_is_in_normal_list_form(val, str)) {
+    ava_string_builder_append_bytes(&escaped, "[", 1);
+    ava_string_builder_append_bytes(&escaped, strdat, strlen);
+    ava_string_builder_append_bytes(&escaped, "]", 1);
+    return ava_string_builder_finish(&escaped);
+  }
 
   /* If surrounding it with double-quotes is sufficient to quote it, do that */
-  if (!quote_with_verbatim)
-    return ava_strcat(
-      AVA_ASCII9_STRING("\""),
-      ava_strcat(str, AVA_ASCII9_STRING("\"")));
+  if (!quote_with_verbatim) {
+    ava_string_builder_append_bytes(&escaped, "\"", 1);
+    ava_string_builder_append_bytes(&escaped, strdat, strlen);
+    ava_string_builder_append_bytes(&escaped, "\"", 1);
+    return ava_string_builder_finish(&escaped);
+  }
 
   /* Escaping will be non-trivial, so use a verbatim */
-  ava_string escaped = AVA_ASCII9_STRING("\\{");
   size_t clean_start = 0;
   ava_bool preceded_by_bs = ava_false;
 
+  ava_string_builder_append_bytes(&escaped, "\\{", 2);
   for (i = 0; i < strlen; ++i) {
     if (preceded_by_bs) {
       switch (strdat[i]) {
@@ -274,11 +571,9 @@ ava_string ava_list_escape(ava_value val) {
       case ';':
       case '}':
         /* Need to escape the preceding backslash */
-        escaped = ava_strcat(
-          escaped, ava_string_slice(
-            str, clean_start, i-1));
-        escaped = ava_strcat(
-          escaped, AVA_ASCII9_STRING("\\;\\"));
+        ava_string_builder_append_bytes(
+          &escaped, strdat + clean_start, i-1 - clean_start);
+        ava_string_builder_append_bytes(&escaped, "\\;\\", 3);
         clean_start = i;
         break;
       }
@@ -300,23 +595,20 @@ ava_string ava_list_escape(ava_value val) {
       val = strdat[i] & 0xF;
       esc[4] = val + (val < 10? '0' : 'A' - 10);
 
-      escaped = ava_strcat(
-        escaped, ava_string_slice(str, clean_start, i));
-      escaped = ava_strcat(
-        escaped, ava_string_of_bytes(esc, sizeof(esc)));
+      ava_string_builder_append_bytes(
+        &escaped, strdat + clean_start, i - clean_start);
+      ava_string_builder_append_bytes(&escaped, esc, sizeof(esc));
       clean_start = i + 1;
     }
 
     preceded_by_bs = '\\' == strdat[i];
   }
 
-  escaped = ava_strcat(
-    escaped, ava_string_slice(
-      str, clean_start, ava_strlen(str)));
-  escaped = ava_strcat(
-    escaped, AVA_ASCII9_STRING("\\}"));
+  ava_string_builder_append_bytes(
+    &escaped, strdat + clean_start, strlen - clean_start);
+  ava_string_builder_append_bytes(&escaped, "\\}", 2);
 
-  return escaped;
+  return ava_string_builder_finish(&escaped);
 }
 
 static ava_bool ava_list_is_in_normal_list_form(
@@ -340,6 +632,15 @@ static ava_bool ava_list_is_in_normal_list_form(
   return ret;
 }
 
+void ava_list_index_range_by_index(ava_list_value list_val, size_t begin,
+                                   size_t end, ava_value*restrict dst) {
+  ava_fat_list_value list = ava_fat_list_value_of(list_val.v);
+  size_t i;
+
+  for (i = begin; i < end; ++i)
+    *dst++ = list.v->index(list.c, i);
+}
+
 ava_list_value ava_list_copy_slice(ava_list_value list,
                                    size_t begin, size_t end) {
   return ava_list_copy_of(ava_fat_list_value_of(list.v), begin, end).c;
@@ -352,6 +653,17 @@ ava_list_value ava_list_copy_append(ava_list_value list_val,
   return list.v->append(list.c, elt);
 }
 
+ava_list_value ava_list_copy_append_n(ava_list_value list_val,
+                                      const ava_value*restrict elements,
+                                      size_t count) {
+  ava_fat_list_value list = ava_fat_list_value_of(list_val.v);
+
+  if (0 == count) return list_val;
+
+  list = ava_list_copy_of(list, 0, list.v->length(list.c));
+  return list.v->append_n(list.c, elements, count);
+}
+
 ava_list_value ava_list_copy_concat(ava_list_value left_val,
                                     ava_list_value right) {
   ava_fat_list_value left = ava_fat_list_value_of(left_val.v);
@@ -379,6 +691,64 @@ ava_list_value ava_list_copy_set(ava_list_value list_val,
   return list.v->set(list.c, ix, val);
 }
 
+ava_string ava_list_to_string(ava_value list_val) {
+  ava_fat_list_value list = ava_fat_list_value_of(list_val);
+  ava_value block[AVA_LIST_TO_STRING_BLOCK];
+  ava_string_builder builder;
+  size_t length, base, n, i;
+
+  length = list.v->length(list.c);
+  if (0 == length)
+    return AVA_EMPTY_STRING;
+  if (1 == length)
+    return ava_list_escape(list.v->index(list.c, 0));
+
+  ava_string_builder_init(&builder, 0);
+  for (base = 0; base < length; base += n) {
+    n = length - base;
+    if (n > AVA_LIST_TO_STRING_BLOCK)
+      n = AVA_LIST_TO_STRING_BLOCK;
+
+    list.v->index_range(list.c, base, base + n, block);
+    for (i = 0; i < n; ++i) {
+      if (base + i > 0)
+        ava_string_builder_append_bytes(&builder, " ", 1);
+      ava_string_builder_append_string(&builder, ava_list_escape(block[i]));
+    }
+  }
+
+  return ava_string_builder_finish(&builder);
+}
+
+ava_string ava_list_to_string_cached(ava_list_string_cache* cache,
+                                     const void* version,
+                                     ava_value list) {
+  const ava_list_string_cache_entry* entry;
+  ava_list_string_cache_entry* new_entry;
+  size_t length = ava_list_length(list);
+
+  if (length < AVA_LIST_STRING_CACHE_MIN_LENGTH)
+    return ava_list_to_string(list);
+
+  /* Load-acquire so the entry's fields are visible */
+  entry = (const ava_list_string_cache_entry*)AO_load_acquire_read(
+    &cache->entry);
+  if (entry && version == entry->version && length == entry->length)
+    return entry->string;
+
+  new_entry = AVA_NEW(ava_list_string_cache_entry);
+  new_entry->version = version;
+  new_entry->length = length;
+  new_entry->string = ava_list_to_string(list);
+
+  /* If another thread is stringifying a different version concurrently,
+   * whichever stores last wins, which is fine for a cache.
+   */
+  AO_store_release_write(&cache->entry, (AO_t)new_entry);
+
+  return new_entry->string;
+}
+
 ava_datum ava_list_string_chunk_iterator(ava_value list) {
   return (ava_datum) { .ulong = 0 };
 }
@@ -387,17 +757,85 @@ ava_string ava_list_iterate_string_chunk(
   ava_datum*restrict it, ava_value list_val
 ) {
   ava_fat_list_value list = ava_fat_list_value_of(list_val);
-  ava_value elt;
-  ava_string eltstr;
+  ava_value block[AVA_LIST_TO_STRING_BLOCK];
+  ava_string_builder builder;
+  size_t length, base, n, i;
 
-  if (it->ulong >= list.v->length(list.c))
+  length = list.v->length(list.c);
+  base = it->ulong;
+  if (base >= length)
     return AVA_ABSENT_STRING;
 
-  elt = list.v->index(list.c, it->ulong++);
-  eltstr = ava_list_escape(elt);
+  /* Produce up to a whole block of elements per chunk, so that streaming a
+   * huge list costs about as much as stringifying it, but without ever
+   * holding more than one block's worth of the string.
+   */
+  n = length - base;
+  if (n > AVA_LIST_TO_STRING_BLOCK)
+    n = AVA_LIST_TO_STRING_BLOCK;
+  it->ulong = base + n;
+
+  list.v->index_range(list.c, base, base + n, block);
+  if (1 == n && 0 == base)
+    return ava_list_escape(block[0]);
+
+  ava_string_builder_init(&builder, 0);
+  for (i = 0; i < n; ++i) {
+    if (base + i > 0)
+      ava_string_builder_append_bytes(&builder, " ", 1);
+    ava_string_builder_append_string(&builder, ava_list_escape(block[i]));
+  }
 
-  if (it->ulong > 1)
-    return ava_strcat(AVA_ASCII9_STRING(" "), eltstr);
-  else
-    return eltstr;
+  return ava_string_builder_finish(&builder);
+}
+
+void ava_list_builder_init(ava_list_builder*restrict builder) {
+  builder->list = ava_empty_list();
+  builder->buffered = 0;
+}
+
+void ava_list_builder_flush(ava_list_builder*restrict builder) {
+  if (builder->buffered) {
+    builder->list = ava_list_append_n(
+      builder->list, builder->buffer, builder->buffered);
+    builder->buffered = 0;
+  }
+}
+
+void ava_list_builder_concat(ava_list_builder*restrict builder,
+                             ava_list_value other) {
+  ava_list_builder_flush(builder);
+  builder->list = ava_list_concat(builder->list, other);
+}
+
+ava_list_value ava_list_builder_list(ava_list_builder*restrict builder) {
+  ava_list_builder_flush(builder);
+  return builder->list;
+}
+
+void ava_list_cursor_init(ava_list_cursor*restrict cursor,
+                          ava_list_value list) {
+  cursor->list = list;
+  cursor->length = ava_list_length(list);
+  cursor->fetched = 0;
+  cursor->pos = 0;
+  cursor->end = 0;
+}
+
+ava_bool ava_list_cursor_fill(ava_list_cursor*restrict cursor) {
+  size_t n;
+
+  n = cursor->length - cursor->fetched;
+  if (!n)
+    return ava_false;
+
+  if (n > AVA_LIST_CURSOR_BLOCK)
+    n = AVA_LIST_CURSOR_BLOCK;
+
+  ava_list_index_range(cursor->list, cursor->fetched,
+                       cursor->fetched + n, cursor->block);
+  cursor->fetched += n;
+  cursor->pos = 0;
+  cursor->end = n;
+  return ava_true;
 }
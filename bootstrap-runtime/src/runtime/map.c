@@ -38,15 +38,18 @@ const ava_attribute_tag ava_map_trait_tag = {
 static ava_map_value ava_map_value_of_list(ava_list_value);
 
 ava_map_value ava_map_value_of(ava_value value) {
-  if (!ava_get_attribute(value, &ava_map_trait_tag))
+  static ava_attribute_cache cache;
+
+  if (!ava_get_attribute_cached(value, &ava_map_trait_tag, &cache))
     return ava_map_value_of_list(ava_list_value_of(value));
   else
     return (ava_map_value) { value };
 }
 
 ava_fat_map_value ava_fat_map_value_of(ava_value value) {
-  const ava_map_trait* trait = ava_get_attribute(
-    value, &ava_map_trait_tag);
+  static ava_attribute_cache cache;
+  const ava_map_trait* trait = ava_get_attribute_cached(
+    value, &ava_map_trait_tag, &cache);
 
   if (!trait) {
     value = ava_map_value_of_list(ava_list_value_of(value)).v;
@@ -0,0 +1,1021 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <atomic_ops.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/alloc.h"
+#include "avalanche/string.h"
+#include "avalanche/value.h"
+#include "avalanche/list.h"
+#include "avalanche/integer.h"
+#include "avalanche/real.h"
+#include "avalanche/numeric-list.h"
+#include "-esba-list.h"
+#include "-numeric-list.h"
+
+#define AVA_NUMERIC_LIST_MIN_CAPACITY 8
+/**
+ * The number of elements converted at a time when reading a list which is not
+ * a numeric list of the desired type.
+ */
+#define AVA_NUMERIC_LIST_BLOCK 64
+/**
+ * The maximum number of elements handed to a kernel at once when reading
+ * directly from a numeric list. This bounds the intermediate values in
+ * ava_integer_list_sum(), and must be a multiple of
+ * AVA_NUMERIC_LIST_LANES.
+ */
+#define AVA_NUMERIC_LIST_RUN ((size_t)1 << 30)
+/**
+ * The number of independent accumulators used by the real-valued reductions.
+ *
+ * Floating-point addition is not associative, so the compiler may not
+ * vectorise a plain left-to-right summation loop. Summing into interleaved
+ * lanes (element i always going to lane i % LANES) makes the vectorisation
+ * explicit, while keeping the result independent of how the list happens to
+ * be represented.
+ */
+#define AVA_NUMERIC_LIST_LANES 4
+
+static const ava_attribute_tag ava_numeric_list_data_tag = {
+  .name = "numeric-list-data"
+};
+
+typedef union {
+  ava_integer i;
+  ava_real r;
+} ava_numeric_list_elt;
+
+/**
+ * The body of a numeric list value.
+ *
+ * This is stored as the first attribute on the value, and the length of the
+ * list in the value ulong, exactly as with array lists. In-place appends use
+ * the same compare-and-swap on the used field; see ava_array_list for why this
+ * is safe.
+ *
+ * Since the elements contain no pointers, the whole structure is allocated
+ * atomically (ie, the GC never scans it).
+ */
+typedef struct {
+  ava_attribute header;
+  /**
+   * Whether the elements are reals (true) or integers (false).
+   */
+  ava_bool is_real;
+  /**
+   * The actual length of values.
+   */
+  size_t capacity;
+  /**
+   * The largest index in values that has actually been populated.
+   */
+  AO_t used;
+
+  /**
+   * The contents of this numeric list, all of which use the same member of
+   * the union as indicated by is_real.
+   */
+  ava_numeric_list_elt values[];
+} ava_numeric_list;
+
+static const ava_value_trait ava_numeric_list_generic_impl = {
+  .header = { .tag = &ava_value_trait_tag, .next = NULL },
+  .to_string = ava_list_to_string,
+  .string_chunk_iterator = ava_list_string_chunk_iterator,
+  .iterate_string_chunk = ava_list_iterate_string_chunk,
+};
+
+AVA_LIST_DEFIMPL(ava_numeric_list, &ava_numeric_list_generic_impl)
+
+static ava_numeric_list* ava_numeric_list_alloc(ava_bool is_real,
+                                                size_t capacity) {
+  ava_numeric_list* nl = ava_alloc_atomic(
+    sizeof(ava_numeric_list) + sizeof(ava_numeric_list_elt) * capacity);
+
+  nl->header.tag = &ava_numeric_list_data_tag;
+  nl->header.next = (const ava_attribute*)&ava_numeric_list_list_impl;
+  nl->is_real = is_real;
+  nl->capacity = capacity;
+  nl->used = 0;
+
+  return nl;
+}
+
+static ava_numeric_list* ava_numeric_list_of_array(
+  ava_bool is_real, const ava_numeric_list_elt*restrict array,
+  size_t length, size_t capacity
+) {
+  ava_numeric_list* nl = ava_numeric_list_alloc(is_real, capacity);
+
+  memcpy(nl->values, array, sizeof(ava_numeric_list_elt) * length);
+  nl->used = length;
+
+  return nl;
+}
+
+static inline ava_list_value ava_numeric_list_value(
+  const ava_numeric_list* nl, size_t length
+) {
+  return (ava_list_value) { ava_value_with_ulong(nl, length) };
+}
+
+static size_t ava_numeric_list_growing_capacity(size_t length) {
+  return length * 2 < AVA_NUMERIC_LIST_MIN_CAPACITY?
+    AVA_NUMERIC_LIST_MIN_CAPACITY : length * 2;
+}
+
+/**
+ * Returns the numeric list backing the given list, or NULL if it is not a
+ * numeric list.
+ */
+static inline const ava_numeric_list* ava_numeric_list_of(
+  ava_list_value list
+) {
+  const ava_attribute* attr = ava_value_attr(list.v);
+
+  return attr && &ava_numeric_list_data_tag == attr->tag?
+    (const ava_numeric_list*)attr : NULL;
+}
+
+static inline ava_value ava_numeric_list_box(
+  const ava_numeric_list*restrict nl, size_t ix
+) {
+  return nl->is_real?
+    ava_value_of_real(nl->values[ix].r) :
+    ava_value_of_integer(nl->values[ix].i);
+}
+
+/**
+ * If the given value can be stored in a numeric list of the given type, stores
+ * its unboxed form into *dst and returns true.
+ */
+static inline ava_bool ava_numeric_list_unbox(
+  ava_numeric_list_elt*restrict dst, ava_bool is_real, ava_value value
+) {
+  if (is_real) {
+    if (&ava_real_type != ava_value_attr(value)) return ava_false;
+    dst->r = ava_value_real(value);
+  } else {
+    if (&ava_integer_type != ava_value_attr(value)) return ava_false;
+    dst->i = ava_value_slong(value);
+  }
+
+  return ava_true;
+}
+
+/**
+ * Converts a numeric list into an ESBA list with the same contents, for when
+ * an operation would introduce an element of a different type.
+ */
+static ava_list_value ava_numeric_list_demote(ava_list_value list) {
+  return ava_esba_list_copy_of(list, 0, ava_value_ulong(list.v));
+}
+
+ava_bool ava_numeric_list_of_raw(ava_list_value*restrict dst,
+                                 const ava_value*restrict array,
+                                 size_t length) {
+  const void* type = ava_value_attr(array[0]);
+  ava_bool is_real;
+  ava_numeric_list* nl;
+  size_t i;
+
+  if (&ava_integer_type == type)
+    is_real = ava_false;
+  else if (&ava_real_type == type)
+    is_real = ava_true;
+  else
+    return ava_false;
+
+  for (i = 1; i < length; ++i)
+    if (type != ava_value_attr(array[i]))
+      return ava_false;
+
+  nl = ava_numeric_list_alloc(is_real, length);
+  if (is_real)
+    for (i = 0; i < length; ++i)
+      nl->values[i].r = ava_value_real(array[i]);
+  else
+    for (i = 0; i < length; ++i)
+      nl->values[i].i = ava_value_slong(array[i]);
+  nl->used = length;
+
+  *dst = ava_numeric_list_value(nl, length);
+  return ava_true;
+}
+
+ava_list_value ava_integer_list_of_array(
+  const ava_integer*restrict array, size_t count
+) {
+  ava_numeric_list* nl;
+
+  if (0 == count) return ava_empty_list();
+
+  nl = ava_numeric_list_alloc(ava_false, count);
+  memcpy(nl->values, array, sizeof(ava_integer) * count);
+  nl->used = count;
+
+  return ava_numeric_list_value(nl, count);
+}
+
+ava_list_value ava_real_list_of_array(
+  const ava_real*restrict array, size_t count
+) {
+  ava_numeric_list* nl;
+
+  if (0 == count) return ava_empty_list();
+
+  nl = ava_numeric_list_alloc(ava_true, count);
+  memcpy(nl->values, array, sizeof(ava_real) * count);
+  nl->used = count;
+
+  return ava_numeric_list_value(nl, count);
+}
+
+ava_bool ava_list_is_integer_list(ava_list_value list) {
+  const ava_numeric_list* nl = ava_numeric_list_of(list);
+  return nl && !nl->is_real;
+}
+
+ava_bool ava_list_is_real_list(ava_list_value list) {
+  const ava_numeric_list* nl = ava_numeric_list_of(list);
+  return nl && nl->is_real;
+}
+
+static size_t ava_numeric_list_list_length(ava_list_value list) {
+  return ava_value_ulong(list.v);
+}
+
+static ava_value ava_numeric_list_list_index(ava_list_value list, size_t ix) {
+  const ava_numeric_list*restrict nl = ava_value_attr(list.v);
+
+  assert(ix < ava_value_ulong(list.v));
+  return ava_numeric_list_box(nl, ix);
+}
+
+static void ava_numeric_list_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_numeric_list*restrict nl = ava_value_attr(list.v);
+  size_t i;
+
+  assert(begin <= end);
+  assert(end <= ava_value_ulong(list.v));
+
+  if (nl->is_real)
+    for (i = begin; i < end; ++i)
+      *dst++ = ava_value_of_real(nl->values[i].r);
+  else
+    for (i = begin; i < end; ++i)
+      *dst++ = ava_value_of_integer(nl->values[i].i);
+}
+
+static ava_list_value ava_numeric_list_list_slice(
+  ava_list_value list, size_t begin, size_t end
+) {
+  const ava_numeric_list*restrict nl = ava_value_attr(list.v);
+
+  assert(begin <= end);
+  assert(end <= ava_value_ulong(list.v));
+
+  if (begin == end)
+    return ava_empty_list();
+
+  if (0 == begin && end * 2 >= nl->capacity)
+    return ava_numeric_list_value(nl, end);
+
+  return ava_numeric_list_value(
+    ava_numeric_list_of_array(nl->is_real, nl->values + begin,
+                              end - begin, end - begin),
+    end - begin);
+}
+
+static ava_list_value ava_numeric_list_list_append(
+  ava_list_value list, ava_value elt
+) {
+  ava_numeric_list*restrict nl = (ava_numeric_list*)ava_value_attr(list.v);
+  size_t length = ava_value_ulong(list.v);
+  ava_numeric_list_elt unboxed;
+
+  if (!ava_numeric_list_unbox(&unboxed, nl->is_real, elt))
+    return ava_list_append(ava_numeric_list_demote(list), elt);
+
+  if (length < nl->capacity) {
+    /* Try to append in-place */
+    if (AO_compare_and_swap(&nl->used, length, length + 1)) {
+      nl->values[length] = unboxed;
+      return ava_numeric_list_value(nl, length + 1);
+    }
+  }
+
+  nl = ava_numeric_list_of_array(
+    nl->is_real, nl->values, length,
+    ava_numeric_list_growing_capacity(length + 1));
+  nl->values[length] = unboxed;
+  ++nl->used;
+
+  return ava_numeric_list_value(nl, length + 1);
+}
+
+static ava_list_value ava_numeric_list_list_append_n(
+  ava_list_value list, const ava_value*restrict elements, size_t count
+) {
+  ava_numeric_list*restrict nl = (ava_numeric_list*)ava_value_attr(list.v);
+  size_t length = ava_value_ulong(list.v);
+  ava_numeric_list_elt unboxed;
+  size_t i;
+
+  if (0 == count) return list;
+
+  /* Every element must fit before any space can be claimed in-place */
+  for (i = 0; i < count; ++i)
+    if (!ava_numeric_list_unbox(&unboxed, nl->is_real, elements[i]))
+      return ava_list_append_n(ava_numeric_list_demote(list),
+                               elements, count);
+
+  if (length + count <= nl->capacity) {
+    /* Try to append in-place */
+    if (AO_compare_and_swap(&nl->used, length, length + count))
+      goto copy_elements;
+  }
+
+  nl = ava_numeric_list_of_array(
+    nl->is_real, nl->values, length,
+    ava_numeric_list_growing_capacity(length + count));
+  nl->used += count;
+
+  copy_elements:
+  for (i = 0; i < count; ++i)
+    ava_numeric_list_unbox(nl->values + length + i, nl->is_real, elements[i]);
+
+  return ava_numeric_list_value(nl, length + count);
+}
+
+static ava_list_value ava_numeric_list_list_concat(
+  ava_list_value list, ava_list_value other
+) {
+  ava_numeric_list*restrict nl = (ava_numeric_list*)ava_value_attr(list.v);
+  const ava_numeric_list*restrict onl = ava_numeric_list_of(other);
+  size_t this_length = ava_value_ulong(list.v);
+  size_t other_length = ava_list_length(other);
+  ava_value block[AVA_NUMERIC_LIST_BLOCK];
+  size_t base, n, i;
+
+  if (0 == other_length) return list;
+
+  if (onl && onl->is_real == nl->is_real) {
+    if (this_length + other_length <= nl->capacity) {
+      /* Try to append in-place */
+      if (AO_compare_and_swap(&nl->used, this_length,
+                              this_length + other_length))
+        goto copy_other;
+    }
+
+    nl = ava_numeric_list_of_array(
+      nl->is_real, nl->values, this_length,
+      ava_numeric_list_growing_capacity(this_length + other_length));
+    nl->used += other_length;
+
+    copy_other:
+    memcpy(nl->values + this_length, onl->values,
+           sizeof(ava_numeric_list_elt) * other_length);
+    return ava_numeric_list_value(nl, this_length + other_length);
+  }
+
+  /* Other is some other kind of list, but its elements may all still be of
+   * our type (eg, a short array list built by numeric code).
+   */
+  nl = ava_numeric_list_of_array(
+    nl->is_real, nl->values, this_length,
+    ava_numeric_list_growing_capacity(this_length + other_length));
+  for (base = 0; base < other_length; base += n) {
+    n = other_length - base;
+    if (n > AVA_NUMERIC_LIST_BLOCK)
+      n = AVA_NUMERIC_LIST_BLOCK;
+
+    ava_list_index_range(other, base, base + n, block);
+    for (i = 0; i < n; ++i)
+      if (!ava_numeric_list_unbox(nl->values + this_length + base + i,
+                                  nl->is_real, block[i]))
+        return ava_list_concat(ava_numeric_list_demote(list), other);
+  }
+  nl->used += other_length;
+
+  return ava_numeric_list_value(nl, this_length + other_length);
+}
+
+static ava_list_value ava_numeric_list_list_remove(
+  ava_list_value list, size_t begin, size_t end
+) {
+  const ava_numeric_list*restrict nl = ava_value_attr(list.v);
+  ava_numeric_list*restrict nnl;
+  size_t length = ava_value_ulong(list.v);
+
+  assert(begin <= end);
+  assert(end <= length);
+
+  if (begin == end)
+    return list;
+
+  if (0 == begin)
+    return ava_numeric_list_list_slice(list, end, length);
+
+  if (length == end)
+    return ava_numeric_list_list_slice(list, 0, begin);
+
+  nnl = ava_numeric_list_of_array(nl->is_real, nl->values, begin,
+                                  length - (end - begin));
+  memcpy(nnl->values + begin, nl->values + end,
+         sizeof(ava_numeric_list_elt) * (length - end));
+  nnl->used += length - end;
+
+  return ava_numeric_list_value(nnl, length - (end - begin));
+}
+
+static ava_list_value ava_numeric_list_list_set(
+  ava_list_value list, size_t index, ava_value value
+) {
+  const ava_numeric_list*restrict nl = ava_value_attr(list.v);
+  ava_numeric_list*restrict mnl;
+  size_t length = ava_value_ulong(list.v);
+  ava_numeric_list_elt unboxed;
+
+  assert(index < length);
+
+  if (!ava_numeric_list_unbox(&unboxed, nl->is_real, value))
+    return ava_list_set(ava_numeric_list_demote(list), index, value);
+
+  mnl = ava_numeric_list_of_array(nl->is_real, nl->values, length, length);
+  mnl->values[index] = unboxed;
+
+  return ava_numeric_list_value(mnl, length);
+}
+
+/******************** BULK OPERATIONS ********************/
+
+/**
+ * Provides sequential access to the elements of an arbitrary list as unboxed
+ * integers or reals.
+ *
+ * If the list is a numeric list of the desired type, the reader hands out
+ * pointers directly into its backing array. Otherwise, elements are converted
+ * into an internal buffer a block at a time.
+ */
+typedef struct {
+  ava_list_value list;
+  /**
+   * The numeric list backing list, or NULL if there is none.
+   */
+  const ava_numeric_list*restrict nl;
+  ava_bool want_real;
+  /**
+   * The value used for elements which are the empty string.
+   */
+  ava_numeric_list_elt dfault;
+  size_t offset, length;
+
+  ava_numeric_list_elt buffer[AVA_NUMERIC_LIST_BLOCK];
+} ava_numeric_list_reader;
+
+static void ava_numeric_list_reader_init(
+  ava_numeric_list_reader*restrict reader, ava_list_value list,
+  ava_bool want_real, ava_numeric_list_elt dfault
+) {
+  reader->list = list;
+  reader->nl = ava_numeric_list_of(list);
+  reader->want_real = want_real;
+  reader->dfault = dfault;
+  reader->offset = 0;
+  reader->length = ava_list_length(list);
+}
+
+/**
+ * Reads up to limit further elements from the reader.
+ *
+ * Exactly min(limit, AVA_NUMERIC_LIST_BLOCK, remaining) elements are read
+ * unless the reader is reading directly from a numeric list of the desired
+ * type, in which case exactly min(limit, AVA_NUMERIC_LIST_RUN, remaining) are.
+ *
+ * @param reader The reader to advance.
+ * @param dst Set to point to the elements read.
+ * @param limit The maximum number of elements to read.
+ * @return The number of elements read, 0 at the end of the list.
+ */
+static size_t ava_numeric_list_reader_next(
+  ava_numeric_list_reader*restrict reader,
+  const ava_numeric_list_elt*restrict* dst,
+  size_t limit
+) {
+  ava_value block[AVA_NUMERIC_LIST_BLOCK];
+  size_t n, i;
+
+  n = reader->length - reader->offset;
+  if (n > limit) n = limit;
+
+  if (reader->nl && reader->nl->is_real == reader->want_real) {
+    if (n > AVA_NUMERIC_LIST_RUN) n = AVA_NUMERIC_LIST_RUN;
+    *dst = reader->nl->values + reader->offset;
+    reader->offset += n;
+    return n;
+  }
+
+  if (n > AVA_NUMERIC_LIST_BLOCK) n = AVA_NUMERIC_LIST_BLOCK;
+
+  if (reader->nl && !reader->nl->is_real) {
+    /* Integers read as reals; no need to box them first */
+    for (i = 0; i < n; ++i)
+      reader->buffer[i].r = reader->nl->values[reader->offset + i].i;
+  } else {
+    ava_list_index_range(reader->list, reader->offset,
+                         reader->offset + n, block);
+    if (reader->want_real)
+      for (i = 0; i < n; ++i)
+        reader->buffer[i].r = ava_real_of_value(block[i], reader->dfault.r);
+    else
+      for (i = 0; i < n; ++i)
+        reader->buffer[i].i = ava_integer_of_value(
+          block[i], reader->dfault.i);
+  }
+
+  *dst = reader->buffer;
+  reader->offset += n;
+  return n;
+}
+
+static inline ava_bool ava_integer_list_matches(
+  ava_integer x, ava_numeric_comparison cmp, ava_integer threshold
+) {
+  switch (cmp) {
+  case ava_nc_slt: return x <  threshold;
+  case ava_nc_leq: return x <= threshold;
+  case ava_nc_sgt: return x >  threshold;
+  case ava_nc_geq: return x >= threshold;
+  case ava_nc_equ: return x == threshold;
+  case ava_nc_neq: return x != threshold;
+  }
+
+  /* unreachable */
+  abort();
+}
+
+static inline ava_bool ava_real_list_matches(
+  ava_real x, ava_numeric_comparison cmp, ava_real threshold
+) {
+  switch (cmp) {
+  case ava_nc_slt: return x <  threshold;
+  case ava_nc_leq: return x <= threshold;
+  case ava_nc_sgt: return x >  threshold;
+  case ava_nc_geq: return x >= threshold;
+  case ava_nc_equ: return x == threshold;
+  case ava_nc_neq: return x != threshold;
+  }
+
+  /* unreachable */
+  abort();
+}
+
+/**
+ * Locates the first overflowing addition in a left-to-right summation of the
+ * given list, which must exist.
+ */
+static void ava_integer_list_find_sum_overflow(
+  ava_integer_overflow*restrict overflow, ava_list_value list
+) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt zero = { .i = 0 };
+  signed long long sum = 0, next;
+  size_t n, i;
+
+  ava_numeric_list_reader_init(&reader, list, ava_false, zero);
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1))) {
+    for (i = 0; i < n; ++i) {
+      if (__builtin_saddll_overflow(sum, src[i].i, &next)) {
+        overflow->a = sum;
+        overflow->op = "+";
+        overflow->b = src[i].i;
+        return;
+      }
+      sum = next;
+    }
+  }
+
+  /* If the exact sum does not fit, the last addition at least must overflow */
+  abort();
+}
+
+ava_bool ava_integer_list_sum(ava_integer*restrict dst,
+                              ava_integer_overflow*restrict overflow,
+                              ava_list_value list) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt zero = { .i = 0 };
+  ava_slong high = 0, run_high;
+  ava_ulong low = 0, run_low;
+  size_t n, i;
+
+  /* Each element is split into a signed high half and unsigned low half,
+   * which are summed separately. Neither half-sum can overflow within a run
+   * (the reader never returns more than AVA_NUMERIC_LIST_RUN elements at
+   * once), so the loop has no data-dependent branches and vectorises freely;
+   * the exact sum is reassembled once at the end.
+   */
+  ava_numeric_list_reader_init(&reader, list, ava_false, zero);
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1))) {
+    run_high = 0;
+    run_low = low;
+    for (i = 0; i < n; ++i) {
+      run_high += src[i].i >> 32;
+      run_low += (ava_ulong)src[i].i & 0xFFFFFFFF;
+    }
+
+    high += run_high + (ava_slong)(run_low >> 32);
+    low = run_low & 0xFFFFFFFF;
+  }
+
+  *dst = (ava_integer)(((ava_ulong)high << 32) | low);
+  if (AVA_LIKELY(high >= -0x80000000LL && high < 0x80000000LL))
+    return ava_true;
+
+  ava_integer_list_find_sum_overflow(overflow, list);
+  return ava_false;
+}
+
+ava_bool ava_integer_list_min(ava_integer*restrict dst,
+                              ava_list_value list) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt zero = { .i = 0 };
+  ava_integer min = 0x7FFFFFFFFFFFFFFFLL;
+  size_t n, i;
+
+  if (0 == ava_list_length(list)) return ava_false;
+
+  ava_numeric_list_reader_init(&reader, list, ava_false, zero);
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1)))
+    for (i = 0; i < n; ++i)
+      min = src[i].i < min? src[i].i : min;
+
+  *dst = min;
+  return ava_true;
+}
+
+ava_bool ava_integer_list_max(ava_integer*restrict dst,
+                              ava_list_value list) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt zero = { .i = 0 };
+  ava_integer max = -0x7FFFFFFFFFFFFFFFLL - 1;
+  size_t n, i;
+
+  if (0 == ava_list_length(list)) return ava_false;
+
+  ava_numeric_list_reader_init(&reader, list, ava_false, zero);
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1)))
+    for (i = 0; i < n; ++i)
+      max = src[i].i > max? src[i].i : max;
+
+  *dst = max;
+  return ava_true;
+}
+
+ava_bool ava_integer_list_dot(ava_integer*restrict dst,
+                              ava_integer_overflow*restrict overflow,
+                              ava_list_value a, ava_list_value b) {
+  ava_numeric_list_reader ra, rb;
+  const ava_numeric_list_elt*restrict pa, *restrict pb;
+  const ava_numeric_list_elt zero = { .i = 0 };
+  signed long long sum = 0, product;
+  ava_bool ok = ava_true;
+  size_t n, i;
+
+  assert(ava_list_length(a) == ava_list_length(b));
+
+  ava_numeric_list_reader_init(&ra, a, ava_false, zero);
+  ava_numeric_list_reader_init(&rb, b, ava_false, zero);
+  /* Both readers return the same number of elements per call, since they are
+   * reading the same number of elements and the limit is no larger than what
+   * a converting reader can return.
+   */
+  while ((n = ava_numeric_list_reader_next(
+            &ra, &pa, AVA_NUMERIC_LIST_BLOCK))) {
+    ava_numeric_list_reader_next(&rb, &pb, n);
+
+    for (i = 0; i < n; ++i) {
+      if (__builtin_smulll_overflow(pa[i].i, pb[i].i, &product)) {
+        if (ok) {
+          overflow->a = pa[i].i;
+          overflow->op = "*";
+          overflow->b = pb[i].i;
+          ok = ava_false;
+        }
+      }
+
+      if (__builtin_saddll_overflow(sum, product, &sum)) {
+        if (ok) {
+          overflow->a = (ava_integer)((ava_ulong)sum - (ava_ulong)product);
+          overflow->op = "+";
+          overflow->b = product;
+          ok = ava_false;
+        }
+      }
+    }
+  }
+
+  *dst = sum;
+  return ok;
+}
+
+ava_bool ava_integer_list_scale(ava_list_value*restrict dst,
+                                ava_integer_overflow*restrict overflow,
+                                ava_list_value list, ava_integer factor) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt zero = { .i = 0 };
+  ava_numeric_list*restrict nl;
+  size_t length = ava_list_length(list), n, i, base;
+  signed long long product;
+  ava_bool ok = ava_true;
+
+  if (0 == length) {
+    *dst = ava_empty_list();
+    return ava_true;
+  }
+
+  nl = ava_numeric_list_alloc(ava_false, length);
+  ava_numeric_list_reader_init(&reader, list, ava_false, zero);
+  base = 0;
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1))) {
+    for (i = 0; i < n; ++i) {
+      if (__builtin_smulll_overflow(src[i].i, factor, &product) && ok) {
+        overflow->a = src[i].i;
+        overflow->op = "*";
+        overflow->b = factor;
+        ok = ava_false;
+      }
+      nl->values[base + i].i = product;
+    }
+    base += n;
+  }
+  nl->used = length;
+
+  *dst = ava_numeric_list_value(nl, length);
+  return ok;
+}
+
+ava_list_value ava_integer_list_select(
+  ava_list_value list, ava_numeric_comparison cmp, ava_integer threshold
+) {
+  const ava_numeric_list*restrict src = ava_numeric_list_of(list);
+  ava_numeric_list*restrict nl;
+  ava_value block[AVA_NUMERIC_LIST_BLOCK], *selected;
+  size_t length = ava_list_length(list), count, base, n, i;
+
+  if (0 == length) return list;
+
+  if (src && !src->is_real) {
+    nl = ava_numeric_list_alloc(ava_false, length);
+    count = 0;
+    for (i = 0; i < length; ++i)
+      if (ava_integer_list_matches(src->values[i].i, cmp, threshold))
+        nl->values[count++] = src->values[i];
+
+    if (0 == count) return ava_empty_list();
+
+    nl->used = count;
+    return ava_numeric_list_value(nl, count);
+  }
+
+  selected = ava_alloc(sizeof(ava_value) * length);
+  count = 0;
+  for (base = 0; base < length; base += n) {
+    n = length - base;
+    if (n > AVA_NUMERIC_LIST_BLOCK)
+      n = AVA_NUMERIC_LIST_BLOCK;
+
+    ava_list_index_range(list, base, base + n, block);
+    for (i = 0; i < n; ++i)
+      if (ava_integer_list_matches(ava_integer_of_value(block[i], 0),
+                                   cmp, threshold))
+        selected[count++] = block[i];
+  }
+
+  return ava_list_of_values(selected, count);
+}
+
+/**
+ * Adds n reals from src to the lanes of acc, element i going to lane
+ * (i % AVA_NUMERIC_LIST_LANES).
+ */
+static void ava_real_list_sum_lanes(
+  ava_real*restrict acc, const ava_numeric_list_elt*restrict src, size_t n
+) {
+  ava_real s0 = acc[0], s1 = acc[1], s2 = acc[2], s3 = acc[3];
+  size_t i;
+
+  for (i = 0; i + AVA_NUMERIC_LIST_LANES <= n; i += AVA_NUMERIC_LIST_LANES) {
+    s0 += src[i+0].r;
+    s1 += src[i+1].r;
+    s2 += src[i+2].r;
+    s3 += src[i+3].r;
+  }
+
+  acc[0] = s0;
+  acc[1] = s1;
+  acc[2] = s2;
+  acc[3] = s3;
+  for (; i < n; ++i)
+    acc[i % AVA_NUMERIC_LIST_LANES] += src[i].r;
+}
+
+ava_real ava_real_list_sum(ava_list_value list) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt zero = { .r = 0.0 };
+  ava_real acc[AVA_NUMERIC_LIST_LANES] = { 0.0, 0.0, 0.0, 0.0 };
+  size_t n;
+
+  ava_numeric_list_reader_init(&reader, list, ava_true, zero);
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1)))
+    ava_real_list_sum_lanes(acc, src, n);
+
+  return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+ava_real ava_real_list_min(ava_list_value list) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt dfault = { .r = INFINITY };
+  ava_real m0 = INFINITY, m1 = INFINITY, m2 = INFINITY, m3 = INFINITY;
+  size_t n, i;
+
+  /* (x < m? x : m) is exactly the semantics of the SSE/AVX min instructions,
+   * and ignores NaN elements since m is never NaN.
+   */
+  ava_numeric_list_reader_init(&reader, list, ava_true, dfault);
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1))) {
+    for (i = 0; i + AVA_NUMERIC_LIST_LANES <= n;
+         i += AVA_NUMERIC_LIST_LANES) {
+      m0 = src[i+0].r < m0? src[i+0].r : m0;
+      m1 = src[i+1].r < m1? src[i+1].r : m1;
+      m2 = src[i+2].r < m2? src[i+2].r : m2;
+      m3 = src[i+3].r < m3? src[i+3].r : m3;
+    }
+    for (; i < n; ++i)
+      m0 = src[i].r < m0? src[i].r : m0;
+  }
+
+  m0 = m1 < m0? m1 : m0;
+  m2 = m3 < m2? m3 : m2;
+  return m2 < m0? m2 : m0;
+}
+
+ava_real ava_real_list_max(ava_list_value list) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt dfault = { .r = -INFINITY };
+  ava_real m0 = -INFINITY, m1 = -INFINITY, m2 = -INFINITY, m3 = -INFINITY;
+  size_t n, i;
+
+  ava_numeric_list_reader_init(&reader, list, ava_true, dfault);
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1))) {
+    for (i = 0; i + AVA_NUMERIC_LIST_LANES <= n;
+         i += AVA_NUMERIC_LIST_LANES) {
+      m0 = src[i+0].r > m0? src[i+0].r : m0;
+      m1 = src[i+1].r > m1? src[i+1].r : m1;
+      m2 = src[i+2].r > m2? src[i+2].r : m2;
+      m3 = src[i+3].r > m3? src[i+3].r : m3;
+    }
+    for (; i < n; ++i)
+      m0 = src[i].r > m0? src[i].r : m0;
+  }
+
+  m0 = m1 > m0? m1 : m0;
+  m2 = m3 > m2? m3 : m2;
+  return m2 > m0? m2 : m0;
+}
+
+ava_real ava_real_list_dot(ava_list_value a, ava_list_value b) {
+  ava_numeric_list_reader ra, rb;
+  const ava_numeric_list_elt*restrict pa, *restrict pb;
+  const ava_numeric_list_elt zero = { .r = 0.0 };
+  ava_real s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+  size_t n, i, limit;
+
+  assert(ava_list_length(a) == ava_list_length(b));
+
+  ava_numeric_list_reader_init(&ra, a, ava_true, zero);
+  ava_numeric_list_reader_init(&rb, b, ava_true, zero);
+  /* Both readers must return the same number of elements on each call. That
+   * is automatic if both read directly from real lists; otherwise, they are
+   * kept in step by limiting them to the conversion block size.
+   */
+  limit = ra.nl && ra.nl->is_real && rb.nl && rb.nl->is_real?
+    (size_t)-1 : AVA_NUMERIC_LIST_BLOCK;
+  while ((n = ava_numeric_list_reader_next(&ra, &pa, limit))) {
+    ava_numeric_list_reader_next(&rb, &pb, n);
+
+    for (i = 0; i + AVA_NUMERIC_LIST_LANES <= n;
+         i += AVA_NUMERIC_LIST_LANES) {
+      s0 += pa[i+0].r * pb[i+0].r;
+      s1 += pa[i+1].r * pb[i+1].r;
+      s2 += pa[i+2].r * pb[i+2].r;
+      s3 += pa[i+3].r * pb[i+3].r;
+    }
+    for (; i < n; ++i) {
+      switch (i % AVA_NUMERIC_LIST_LANES) {
+      case 0: s0 += pa[i].r * pb[i].r; break;
+      case 1: s1 += pa[i].r * pb[i].r; break;
+      case 2: s2 += pa[i].r * pb[i].r; break;
+      case 3: s3 += pa[i].r * pb[i].r; break;
+      }
+    }
+  }
+
+  return (s0 + s1) + (s2 + s3);
+}
+
+ava_list_value ava_real_list_scale(ava_list_value list, ava_real factor) {
+  ava_numeric_list_reader reader;
+  const ava_numeric_list_elt*restrict src;
+  const ava_numeric_list_elt zero = { .r = 0.0 };
+  ava_numeric_list*restrict nl;
+  size_t length = ava_list_length(list), n, i, base;
+
+  if (0 == length) return ava_empty_list();
+
+  nl = ava_numeric_list_alloc(ava_true, length);
+  ava_numeric_list_reader_init(&reader, list, ava_true, zero);
+  base = 0;
+  while ((n = ava_numeric_list_reader_next(&reader, &src, (size_t)-1))) {
+    for (i = 0; i < n; ++i)
+      nl->values[base + i].r = src[i].r * factor;
+    base += n;
+  }
+  nl->used = length;
+
+  return ava_numeric_list_value(nl, length);
+}
+
+ava_list_value ava_real_list_select(
+  ava_list_value list, ava_numeric_comparison cmp, ava_real threshold
+) {
+  const ava_numeric_list*restrict src = ava_numeric_list_of(list);
+  ava_numeric_list*restrict nl;
+  ava_value block[AVA_NUMERIC_LIST_BLOCK], *selected;
+  size_t length = ava_list_length(list), count, base, n, i;
+
+  if (0 == length) return list;
+
+  if (src && src->is_real) {
+    nl = ava_numeric_list_alloc(ava_true, length);
+    count = 0;
+    for (i = 0; i < length; ++i)
+      if (ava_real_list_matches(src->values[i].r, cmp, threshold))
+        nl->values[count++] = src->values[i];
+
+    if (0 == count) return ava_empty_list();
+
+    nl->used = count;
+    return ava_numeric_list_value(nl, count);
+  }
+
+  selected = ava_alloc(sizeof(ava_value) * length);
+  count = 0;
+  for (base = 0; base < length; base += n) {
+    n = length - base;
+    if (n > AVA_NUMERIC_LIST_BLOCK)
+      n = AVA_NUMERIC_LIST_BLOCK;
+
+    ava_list_index_range(list, base, base + n, block);
+    for (i = 0; i < n; ++i)
+      if (ava_real_list_matches(ava_real_of_value(block[i], 0.0),
+                                cmp, threshold))
+        selected[count++] = block[i];
+  }
+
+  return ava_list_of_values(selected, count);
+}
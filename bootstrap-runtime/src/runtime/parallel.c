@@ -0,0 +1,241 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* Worker threads allocate from the GC heap, so they must be created through
+ * the collector's wrapper for pthread_create(), which GC_THREADS enables.
+ */
+#ifndef AVA_NOGC
+#define GC_THREADS 1
+#if defined(HAVE_GC_GC_H)
+#include <gc/gc.h>
+#elif defined(HAVE_GC_H)
+#include <gc.h>
+#else
+#error "Neither <gc/gc.h> nor <gc.h> could be found."
+#endif
+#endif /* !AVA_NOGC */
+
+#include <atomic_ops.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/exception.h"
+#include "-parallel.h"
+
+/**
+ * Upper bound on the number of threads, including the caller, that work on a
+ * single job.
+ */
+#define AVA_PARALLEL_MAX_WIDTH 64
+
+/*
+  Every call to ava_parallel_for() pushes a job onto the front of a shared
+  queue, then works on it itself. Idle workers take the job at the front of
+  the queue and likewise claim indices from it until none remain.
+
+  A job lives on the stack of its caller, so the caller cannot return until no
+  worker refers to it. refs counts the workers currently working on the job;
+  it, and the queue itself, are protected by ava_parallel_lock. Indices are
+  claimed without the lock. Once every index has been claimed and refs is
+  zero, every call has returned.
+
+  Putting new jobs at the front means that nested jobs get help before the
+  job they were started from, which is what lets that outer job finish.
+
+  Every call is made under ava_catch(). The first exception is kept on the
+  job, and next_ix is pushed past the end so that nobody claims any further
+  indices. The caller still waits for refs to drop to zero as usual, since
+  other threads may be in the middle of calls, and then rethrows the
+  exception itself. Nothing ever propagates out of a worker.
+ */
+
+typedef struct ava_parallel_job_s {
+  void (*fn)(void*, size_t);
+  void* userdata;
+  size_t n;
+  AO_t next_ix;
+  unsigned refs;
+  ava_bool queued;
+
+  /**
+   * Set by whichever call throws first, which then owns exception.
+   */
+  AO_t failed;
+  ava_exception exception;
+
+  TAILQ_ENTRY(ava_parallel_job_s) next;
+} ava_parallel_job;
+
+static pthread_mutex_t ava_parallel_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ava_parallel_work_available = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t ava_parallel_job_released = PTHREAD_COND_INITIALIZER;
+static TAILQ_HEAD(, ava_parallel_job_s) ava_parallel_queue =
+  TAILQ_HEAD_INITIALIZER(ava_parallel_queue);
+
+static pthread_once_t ava_parallel_once = PTHREAD_ONCE_INIT;
+static unsigned ava_parallel_num_workers;
+
+static void ava_parallel_start_pool(void);
+static void* ava_parallel_worker_main(void* ignored);
+/**
+ * A single call of a job's function, as passed through ava_catch().
+ */
+typedef struct {
+  const ava_parallel_job* job;
+  size_t ix;
+} ava_parallel_call;
+
+static void ava_parallel_run_job(ava_parallel_job* job);
+static void ava_parallel_call_one(void* call);
+static void ava_parallel_dequeue(ava_parallel_job* job);
+
+unsigned ava_parallel_width(void) {
+  pthread_once(&ava_parallel_once, ava_parallel_start_pool);
+  return ava_parallel_num_workers + 1;
+}
+
+static void ava_parallel_start_pool(void) {
+  pthread_attr_t attr;
+  pthread_t thread;
+  long cpus;
+  unsigned i, width;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+  cpus = 1;
+#endif
+
+  if (cpus < 1)
+    width = 1;
+  else if (cpus > AVA_PARALLEL_MAX_WIDTH)
+    width = AVA_PARALLEL_MAX_WIDTH;
+  else
+    width = cpus;
+
+  if (width <= 1) return;
+
+  if (pthread_attr_init(&attr)) return;
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  /* If thread creation fails part way through, just get by with the workers
+   * that did start; the caller always participates, so even zero workers is
+   * fine.
+   */
+  for (i = 0; i < width - 1; ++i) {
+    if (pthread_create(&thread, &attr, ava_parallel_worker_main, NULL))
+      break;
+  }
+
+  ava_parallel_num_workers = i;
+  pthread_attr_destroy(&attr);
+}
+
+static void* ava_parallel_worker_main(void* ignored) {
+  ava_parallel_job* job;
+
+  pthread_mutex_lock(&ava_parallel_lock);
+  for (;;) {
+    while (TAILQ_EMPTY(&ava_parallel_queue))
+      pthread_cond_wait(&ava_parallel_work_available, &ava_parallel_lock);
+
+    job = TAILQ_FIRST(&ava_parallel_queue);
+    ++job->refs;
+    pthread_mutex_unlock(&ava_parallel_lock);
+
+    ava_parallel_run_job(job);
+
+    pthread_mutex_lock(&ava_parallel_lock);
+    /* Every index has now been claimed, so nobody else needs to find it */
+    ava_parallel_dequeue(job);
+    if (0 == --job->refs)
+      pthread_cond_broadcast(&ava_parallel_job_released);
+  }
+
+  /* unreachable */
+  return NULL;
+}
+
+static void ava_parallel_run_job(ava_parallel_job* job) {
+  ava_parallel_call call;
+  ava_exception ex;
+
+  call.job = job;
+  while ((call.ix = AO_fetch_and_add1(&job->next_ix)) < job->n) {
+    if (ava_catch(&ex, ava_parallel_call_one, &call)) {
+      if (AO_compare_and_swap(&job->failed, 0, 1))
+        job->exception = ex;
+
+      AO_store(&job->next_ix, job->n);
+    }
+  }
+}
+
+static void ava_parallel_call_one(void* vcall) {
+  const ava_parallel_call* call = vcall;
+
+  (*call->job->fn)(call->job->userdata, call->ix);
+}
+
+static void ava_parallel_dequeue(ava_parallel_job* job) {
+  if (job->queued) {
+    TAILQ_REMOVE(&ava_parallel_queue, job, next);
+    job->queued = ava_false;
+  }
+}
+
+void ava_parallel_for(size_t n, void (*fn)(void* userdata, size_t ix),
+                      void* userdata) {
+  ava_parallel_job job;
+  size_t ix;
+
+  if (n <= 1 || 1 == ava_parallel_width()) {
+    for (ix = 0; ix < n; ++ix)
+      (*fn)(userdata, ix);
+    return;
+  }
+
+  job.fn = fn;
+  job.userdata = userdata;
+  job.n = n;
+  job.next_ix = 0;
+  job.refs = 0;
+  job.queued = ava_true;
+  job.failed = 0;
+
+  pthread_mutex_lock(&ava_parallel_lock);
+  TAILQ_INSERT_HEAD(&ava_parallel_queue, &job, next);
+  pthread_cond_broadcast(&ava_parallel_work_available);
+  pthread_mutex_unlock(&ava_parallel_lock);
+
+  ava_parallel_run_job(&job);
+
+  pthread_mutex_lock(&ava_parallel_lock);
+  ava_parallel_dequeue(&job);
+  while (job.refs > 0)
+    pthread_cond_wait(&ava_parallel_job_released, &ava_parallel_lock);
+  pthread_mutex_unlock(&ava_parallel_lock);
+
+  if (job.failed)
+    ava_rethrow(job.exception);
+}
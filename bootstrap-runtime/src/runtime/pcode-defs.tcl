@@ -859,6 +859,108 @@ struct exe x {
     }
   }
 
+  # Creates a list builder.
+  #
+  # Semantics: dst is set to a strangelet referencing a new, empty list
+  # builder. List builders accumulate elements in a buffer and append them to
+  # their list in batches, which is cheaper than an lappend per element.
+  #
+  # The builder is mutable; lbappend and lbcat modify the builder itself, not
+  # the register holding it.
+  elt lbuild {
+    attr can-throw ;# OOM
+    register dv dst {
+      prop reg-write
+    }
+  }
+
+  # Appends an element to a list builder.
+  #
+  # Semantics: The value in esrc is appended to the list builder referenced by
+  # the strangelet in accum.
+  #
+  # Behaviour is undefined if accum was not produced by lbuild.
+  elt lbappend {
+    attr can-throw ;# Eg, OOM, max list length exceeded
+    register dv accum {
+      prop reg-read
+    }
+    register dv esrc {
+      prop reg-read
+    }
+  }
+
+  # Appends a list to a list builder.
+  #
+  # Semantics: Every element of the L-register src is appended, in order, to
+  # the list builder referenced by the strangelet in accum.
+  #
+  # Behaviour is undefined if accum was not produced by lbuild.
+  elt lbcat {
+    attr can-throw ;# Eg, OOM, max list length exceeded
+    register dv accum {
+      prop reg-read
+    }
+    register l src {
+      prop reg-read
+    }
+  }
+
+  # Reads the list accumulated by a list builder.
+  #
+  # Semantics: The L-register dst is set to the list of every element appended
+  # to the list builder referenced by the strangelet in accum so far. The
+  # builder is not reset, and may continue to be used.
+  #
+  # Behaviour is undefined if accum was not produced by lbuild.
+  elt lblist {
+    attr can-throw ;# Eg, OOM, max list length exceeded
+    register l dst {
+      prop reg-write
+    }
+    register dv accum {
+      prop reg-read
+    }
+  }
+
+  # Creates a list cursor.
+  #
+  # Semantics: dst is set to a strangelet referencing a new cursor positioned
+  # at the first element of src. List cursors read their list in blocks, which
+  # is cheaper than an lindex per element.
+  #
+  # The cursor is mutable; lcnext advances the cursor itself, not the register
+  # holding it.
+  elt lcursor {
+    attr can-throw ;# OOM
+    register dv dst {
+      prop reg-write
+    }
+    register l src {
+      prop reg-read
+    }
+  }
+
+  # Reads the next element from a list cursor.
+  #
+  # Semantics: dst is set to the next element of the list read by the cursor
+  # referenced by the strangelet in cursor, and the cursor is advanced past
+  # it. If the cursor has reached the end of its list, an error_exception
+  # whose user type and message is given by extype and exmessage is thrown.
+  #
+  # Behaviour is undefined if cursor was not produced by lcursor.
+  elt lcnext {
+    attr can-throw
+    register dv dst {
+      prop reg-write
+    }
+    register dv cursor {
+      prop reg-read
+    }
+    str extype
+    str exmessage
+  }
+
   # Adds a fixed value to an I-register.
   #
   # Semantics: dst is set to src+incr. The result of overflow is undefined.
@@ -62,7 +62,7 @@ const ava_attribute_tag ava_pointer_trait_tag = {
 static const ava_value_trait ava_pointer_generic_impl = {
   .header = { .tag = &ava_value_trait_tag, .next = NULL },
   .name = "pointer",
-  .to_string = ava_string_of_chunk_iterator,
+  .to_string = ava_list_to_string,
   .string_chunk_iterator = ava_list_string_chunk_iterator,
   .iterate_string_chunk = ava_list_iterate_string_chunk,
 };
@@ -76,14 +76,18 @@ const ava_pointer_prototype ava_pointer_proto_const_void =
   AVA_INIT_POINTER_PROTOTYPE(AVA_EMPTY_STRING_INIT, ava_true);
 
 ava_pointer_value ava_pointer_value_of(ava_value value) {
-  if (!ava_get_attribute(value, &ava_pointer_trait_tag))
+  static ava_attribute_cache cache;
+
+  if (!ava_get_attribute_cached(value, &ava_pointer_trait_tag, &cache))
     return ava_pointer_of_list(ava_list_value_of(value));
   else
     return (ava_pointer_value) { value };
 }
 
 ava_fat_pointer_value ava_fat_pointer_value_of(ava_value value) {
-  const ava_pointer_trait* trait = AVA_GET_ATTRIBUTE(value, ava_pointer_trait);
+  static ava_attribute_cache cache;
+  const ava_pointer_trait* trait = AVA_GET_ATTRIBUTE_CACHED(
+    value, ava_pointer_trait, &cache);
   if (!trait) {
     value = ava_pointer_of_list(ava_list_value_of(value)).v;
     trait = AVA_GET_ATTRIBUTE(value, ava_pointer_trait);
@@ -284,6 +288,12 @@ ava_string ava_pointer_prototype_to_string(
                            AVA_ASCII9_STRING("&") : AVA_ASCII9_STRING("*"));
 }
 
+static void ava_pointer_list_index_range(
+  ava_list_value this, size_t begin, size_t end, ava_value*restrict dst
+) {
+  ava_list_index_range_by_index(this, begin, end, dst);
+}
+
 static ava_list_value ava_pointer_list_slice(ava_list_value this,
                                              size_t begin, size_t end) {
   return ava_list_copy_slice(this, begin, end);
@@ -294,6 +304,12 @@ static ava_list_value ava_pointer_list_append(ava_list_value this,
   return ava_list_copy_append(this, val);
 }
 
+static ava_list_value ava_pointer_list_append_n(
+  ava_list_value this, const ava_value*restrict elements, size_t count
+) {
+  return ava_list_copy_append_n(this, elements, count);
+}
+
 static ava_list_value ava_pointer_list_concat(ava_list_value this,
                                               ava_list_value that) {
   return ava_list_copy_concat(this, that);
@@ -0,0 +1,898 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/alloc.h"
+#include "avalanche/value.h"
+#include "avalanche/list.h"
+#include "-array-list.h"
+#include "-rrb-list.h"
+
+/*
+
+  An RRB list is a tree of immutable nodes. Leaves hold up to AVA_RRB_WIDTH
+  values each; branches hold up to AVA_RRB_WIDTH children, all of the same
+  height. Every operation copies the path(s) from the root to the leaves it
+  affects and shares everything else with the original tree, so old versions
+  are never disturbed.
+
+  A branch whose children are all completely full, except possibly the last,
+  is "dense", and the child containing an index can be found directly by
+  shifting the index, exactly as in a conventional persistent vector. Appends
+  and construction from flat arrays only ever produce dense branches.
+
+  Concatenation and slicing cannot in general preserve density without
+  copying O(n) elements. Branches they produce are instead "relaxed": they
+  carry a table of the cumulative sizes of their children. Since no child can
+  hold more than a dense child would, shifting the index still gives a lower
+  bound on the correct slot, and the size table is scanned forward from
+  there. Concatenation rebalances the nodes along the seam between the two
+  trees so that each branch has at most AVA_RRB_EXTRAS more children than
+  would be strictly necessary, which bounds the length of that scan.
+
+  The concatenation algorithm follows "RRB-Trees: Efficient Immutable
+  Vectors" (Bagwell & Rompf, EPFL-REPORT-169879) as refined in "Improving RRB-
+  Tree Performance through Transience" (L'orange, 2014).
+
+ */
+
+#define AVA_RRB_BITS 5
+#define AVA_RRB_WIDTH (1 << AVA_RRB_BITS)
+/**
+ * The maximum number of extra children a branch produced by concatenation may
+ * have beyond the minimum needed to hold all its grandchildren.
+ */
+#define AVA_RRB_EXTRAS 2
+
+static const ava_attribute_tag ava_rrb_list_root_tag = {
+  .name = "rrb-list-root"
+};
+
+/**
+ * Common header of leaves and branches. Whether a node is a leaf or branch is
+ * determined by its height within the tree; leaves have height zero.
+ */
+typedef struct {
+  /**
+   * The number of values in a leaf, or children in a branch. Always between
+   * 1 and AVA_RRB_WIDTH, inclusive.
+   */
+  unsigned count;
+} ava_rrb_node;
+
+typedef struct {
+  ava_rrb_node header;
+  ava_value values[];
+} ava_rrb_leaf;
+
+typedef struct {
+  ava_rrb_node header;
+  /**
+   * If non-NULL, sizes[i] is the total number of values within children 0
+   * through i, inclusive. If NULL, the branch is dense.
+   */
+  const size_t*restrict sizes;
+  const ava_rrb_node* children[];
+} ava_rrb_branch;
+
+/**
+ * The attribute on an RRB list value. The length of the list is stored in the
+ * value ulong.
+ */
+typedef struct {
+  ava_attribute header;
+  const ava_rrb_node* root;
+  /**
+   * The height of root, ie, the number of branches between the root and any
+   * leaf, including the root.
+   */
+  unsigned height;
+} ava_rrb_list;
+
+static const ava_value_trait ava_rrb_list_generic_impl = {
+  .header = { .tag = &ava_value_trait_tag, .next = NULL },
+  .name = "rrb-list",
+  .to_string = ava_list_to_string,
+  .string_chunk_iterator = ava_list_string_chunk_iterator,
+  .iterate_string_chunk = ava_list_iterate_string_chunk,
+};
+
+AVA_LIST_DEFIMPL(ava_rrb_list, &ava_rrb_list_generic_impl)
+
+static ava_list_value ava_rrb_list_value(
+  const ava_rrb_node* root, unsigned height, size_t length);
+
+static ava_rrb_leaf* ava_rrb_leaf_new(unsigned count);
+static ava_rrb_leaf* ava_rrb_leaf_copy(
+  const ava_rrb_leaf* src, unsigned begin, unsigned end);
+static ava_rrb_branch* ava_rrb_branch_new(unsigned count);
+static const ava_rrb_node* ava_rrb_branch_of(
+  unsigned height, const ava_rrb_node*const* children, unsigned count);
+static void ava_rrb_branch_compute_sizes(
+  ava_rrb_branch* branch, unsigned height);
+
+static size_t ava_rrb_node_size(const ava_rrb_node* node, unsigned height);
+static inline unsigned ava_rrb_branch_slot(
+  const ava_rrb_branch* branch, unsigned height, size_t*restrict ix);
+static const ava_rrb_leaf* ava_rrb_find_leaf(
+  const ava_rrb_list* rrb, size_t*restrict ix);
+
+static const ava_rrb_node* ava_rrb_node_set(
+  const ava_rrb_node* node, unsigned height, size_t ix, ava_value value);
+static const ava_rrb_node* ava_rrb_node_push(
+  const ava_rrb_node* node, unsigned height, ava_value value);
+static const ava_rrb_node* ava_rrb_path(unsigned height, ava_value value);
+static const ava_rrb_node* ava_rrb_node_take(
+  const ava_rrb_node* node, unsigned height, size_t end);
+static const ava_rrb_node* ava_rrb_node_drop(
+  const ava_rrb_node* node, unsigned height, size_t begin);
+
+static const ava_rrb_node* ava_rrb_concat_sub(
+  const ava_rrb_node* left, unsigned left_height,
+  const ava_rrb_node* right, unsigned right_height);
+static const ava_rrb_node* ava_rrb_rebalance(
+  const ava_rrb_branch* left, const ava_rrb_branch* mid,
+  const ava_rrb_branch* right, unsigned height);
+static unsigned ava_rrb_concat_plan(
+  unsigned*restrict plan, const ava_rrb_node*const* nodes, unsigned count);
+static void ava_rrb_execute_plan(
+  const ava_rrb_node** dst, const unsigned*restrict plan, unsigned count,
+  const ava_rrb_node*const* src, unsigned height);
+static ava_list_value ava_rrb_list_concat_trees(
+  const ava_rrb_node* left, unsigned left_height, size_t left_length,
+  const ava_rrb_node* right, unsigned right_height, size_t right_length);
+
+ava_bool ava_list_is_rrb_list(ava_list_value list) {
+  return !!ava_get_attribute(list.v, &ava_rrb_list_root_tag);
+}
+
+ava_list_value ava_rrb_list_copy_of(
+  ava_list_value list, size_t begin, size_t end
+) {
+  const ava_rrb_node** level;
+  ava_rrb_branch* branch;
+  ava_rrb_leaf* leaf;
+  size_t count, parents, i, n;
+  unsigned height;
+
+  assert(begin < end);
+
+  /* Build full leaves directly from the source, then stack full branches on
+   * top of them until there is only one node left. Every node but the last on
+   * each level is full, so all the branches are dense.
+   */
+  count = (end - begin + AVA_RRB_WIDTH - 1) / AVA_RRB_WIDTH;
+  level = ava_alloc(sizeof(ava_rrb_node*) * count);
+  for (i = 0; i < count; ++i) {
+    n = end - begin - i * AVA_RRB_WIDTH;
+    if (n > AVA_RRB_WIDTH)
+      n = AVA_RRB_WIDTH;
+
+    leaf = ava_rrb_leaf_new(n);
+    ava_list_index_range(list, begin + i * AVA_RRB_WIDTH,
+                         begin + i * AVA_RRB_WIDTH + n, leaf->values);
+    level[i] = &leaf->header;
+  }
+
+  for (height = 0; count > 1; ++height) {
+    parents = (count + AVA_RRB_WIDTH - 1) / AVA_RRB_WIDTH;
+    /* Writing level[i] is safe since the children it would overwrite have
+     * already been consumed by the time we get there.
+     */
+    for (i = 0; i < parents; ++i) {
+      n = count - i * AVA_RRB_WIDTH;
+      if (n > AVA_RRB_WIDTH)
+        n = AVA_RRB_WIDTH;
+
+      branch = ava_rrb_branch_new(n);
+      branch->sizes = NULL;
+      memcpy(branch->children, level + i * AVA_RRB_WIDTH,
+             sizeof(ava_rrb_node*) * n);
+      level[i] = &branch->header;
+    }
+    count = parents;
+  }
+
+  return ava_rrb_list_value(level[0], height, end - begin);
+}
+
+static ava_list_value ava_rrb_list_value(
+  const ava_rrb_node* root, unsigned height, size_t length
+) {
+  ava_rrb_list* rrb;
+
+  /* Strip redundant levels left over from slicing and concatenation */
+  while (height > 0 && 1 == root->count) {
+    root = ((const ava_rrb_branch*)root)->children[0];
+    --height;
+  }
+
+  rrb = AVA_NEW(ava_rrb_list);
+  rrb->header.tag = &ava_rrb_list_root_tag;
+  rrb->header.next = (const ava_attribute*)&ava_rrb_list_list_impl;
+  rrb->root = root;
+  rrb->height = height;
+
+  return (ava_list_value) { ava_value_with_ulong(rrb, length) };
+}
+
+static ava_rrb_leaf* ava_rrb_leaf_new(unsigned count) {
+  ava_rrb_leaf* leaf = ava_alloc(sizeof(ava_rrb_leaf) +
+                                 sizeof(ava_value) * count);
+  leaf->header.count = count;
+  return leaf;
+}
+
+static ava_rrb_leaf* ava_rrb_leaf_copy(
+  const ava_rrb_leaf* src, unsigned begin, unsigned end
+) {
+  ava_rrb_leaf* leaf = ava_rrb_leaf_new(end - begin);
+  memcpy(leaf->values, src->values + begin, sizeof(ava_value) * (end - begin));
+  return leaf;
+}
+
+static ava_rrb_branch* ava_rrb_branch_new(unsigned count) {
+  ava_rrb_branch* branch = ava_alloc(sizeof(ava_rrb_branch) +
+                                     sizeof(ava_rrb_node*) * count);
+  branch->header.count = count;
+  return branch;
+}
+
+static const ava_rrb_node* ava_rrb_branch_of(
+  unsigned height, const ava_rrb_node*const* children, unsigned count
+) {
+  ava_rrb_branch* branch = ava_rrb_branch_new(count);
+  memcpy(branch->children, children, sizeof(ava_rrb_node*) * count);
+  ava_rrb_branch_compute_sizes(branch, height);
+  return &branch->header;
+}
+
+static void ava_rrb_branch_compute_sizes(
+  ava_rrb_branch* branch, unsigned height
+) {
+  size_t full = (size_t)1 << (AVA_RRB_BITS * height);
+  size_t* sizes, cumulative;
+  unsigned i, n = branch->header.count;
+
+  for (i = 0; i + 1 < n; ++i)
+    if (full != ava_rrb_node_size(branch->children[i], height - 1))
+      goto relaxed;
+
+  branch->sizes = NULL;
+  return;
+
+  relaxed:
+  sizes = ava_alloc_atomic(sizeof(size_t) * n);
+  cumulative = 0;
+  for (i = 0; i < n; ++i) {
+    cumulative += ava_rrb_node_size(branch->children[i], height - 1);
+    sizes[i] = cumulative;
+  }
+  branch->sizes = sizes;
+}
+
+static size_t ava_rrb_node_size(const ava_rrb_node* node, unsigned height) {
+  const ava_rrb_branch* branch;
+  size_t size = 0;
+
+  /* Only the rightmost child of a dense branch can be less than full, so only
+   * the right spine needs to be walked.
+   */
+  for (; height > 0; --height) {
+    branch = (const ava_rrb_branch*)node;
+    if (branch->sizes)
+      return size + branch->sizes[branch->header.count - 1];
+
+    size += (size_t)(branch->header.count - 1) << (AVA_RRB_BITS * height);
+    node = branch->children[branch->header.count - 1];
+  }
+
+  return size + node->count;
+}
+
+static inline unsigned ava_rrb_branch_slot(
+  const ava_rrb_branch* branch, unsigned height, size_t*restrict ix
+) {
+  unsigned slot = *ix >> (AVA_RRB_BITS * height);
+
+  if (branch->sizes) {
+    while (branch->sizes[slot] <= *ix)
+      ++slot;
+
+    if (slot)
+      *ix -= branch->sizes[slot - 1];
+  } else {
+    *ix -= (size_t)slot << (AVA_RRB_BITS * height);
+  }
+
+  return slot;
+}
+
+static const ava_rrb_leaf* ava_rrb_find_leaf(
+  const ava_rrb_list* rrb, size_t*restrict ix
+) {
+  const ava_rrb_node* node = rrb->root;
+  const ava_rrb_branch* branch;
+  unsigned height;
+
+  for (height = rrb->height; height > 0; --height) {
+    branch = (const ava_rrb_branch*)node;
+    node = branch->children[ava_rrb_branch_slot(branch, height, ix)];
+  }
+
+  return (const ava_rrb_leaf*)node;
+}
+
+static size_t ava_rrb_list_list_length(ava_list_value list) {
+  return ava_value_ulong(list.v);
+}
+
+static ava_value ava_rrb_list_list_index(ava_list_value list, size_t ix) {
+  assert(ix < ava_value_ulong(list.v));
+
+  return ava_rrb_find_leaf(ava_value_attr(list.v), &ix)->values[ix];
+}
+
+static void ava_rrb_list_list_index_range(
+  ava_list_value list, size_t begin, size_t end, ava_value*restrict dst
+) {
+  const ava_rrb_list*restrict rrb = ava_value_attr(list.v);
+  const ava_rrb_leaf*restrict leaf;
+  size_t ix, n;
+
+  assert(begin <= end);
+  assert(end <= ava_value_ulong(list.v));
+
+  /* One descent per leaf rather than per element */
+  while (begin < end) {
+    ix = begin;
+    leaf = ava_rrb_find_leaf(rrb, &ix);
+    n = leaf->header.count - ix;
+    if (n > end - begin)
+      n = end - begin;
+
+    memcpy(dst, leaf->values + ix, sizeof(ava_value) * n);
+    dst += n;
+    begin += n;
+  }
+}
+
+static ava_list_value ava_rrb_list_list_slice(
+  ava_list_value list, size_t begin, size_t end
+) {
+  const ava_rrb_list*restrict rrb = ava_value_attr(list.v);
+  size_t length = ava_value_ulong(list.v);
+  const ava_rrb_node* root;
+
+  assert(begin <= end);
+  assert(end <= length);
+
+  if (begin == end)
+    return ava_empty_list();
+
+  if (0 == begin && length == end)
+    return list;
+
+  if (end - begin < AVA_ARRAY_LIST_THRESH / 2)
+    return ava_array_list_copy_of(list, begin, end);
+
+  root = ava_rrb_node_take(rrb->root, rrb->height, end);
+  root = ava_rrb_node_drop(root, rrb->height, begin);
+  return ava_rrb_list_value(root, rrb->height, end - begin);
+}
+
+static const ava_rrb_node* ava_rrb_node_take(
+  const ava_rrb_node* node, unsigned height, size_t end
+) {
+  const ava_rrb_branch* src;
+  const ava_rrb_node* child;
+  ava_rrb_branch* dst;
+  size_t* sizes;
+  size_t ix;
+  unsigned slot;
+
+  if (0 == height) {
+    if (end == node->count)
+      return node;
+
+    return &ava_rrb_leaf_copy((const ava_rrb_leaf*)node, 0, end)->header;
+  }
+
+  src = (const ava_rrb_branch*)node;
+  ix = end - 1;
+  slot = ava_rrb_branch_slot(src, height, &ix);
+  child = ava_rrb_node_take(src->children[slot], height - 1, ix + 1);
+
+  if (slot + 1 == src->header.count && child == src->children[slot])
+    return node;
+
+  dst = ava_rrb_branch_new(slot + 1);
+  memcpy(dst->children, src->children, sizeof(ava_rrb_node*) * slot);
+  dst->children[slot] = child;
+
+  /* A prefix of a dense branch is still dense, since only its new last child
+   * can be less than full.
+   */
+  if (src->sizes) {
+    sizes = ava_alloc_atomic(sizeof(size_t) * (slot + 1));
+    memcpy(sizes, src->sizes, sizeof(size_t) * slot);
+    sizes[slot] = (slot ? sizes[slot - 1] : 0) + ix + 1;
+    dst->sizes = sizes;
+  } else {
+    dst->sizes = NULL;
+  }
+
+  return &dst->header;
+}
+
+static const ava_rrb_node* ava_rrb_node_drop(
+  const ava_rrb_node* node, unsigned height, size_t begin
+) {
+  const ava_rrb_branch* src;
+  ava_rrb_branch* dst;
+  size_t ix;
+  unsigned slot;
+
+  if (0 == begin)
+    return node;
+
+  if (0 == height)
+    return &ava_rrb_leaf_copy((const ava_rrb_leaf*)node,
+                              begin, node->count)->header;
+
+  src = (const ava_rrb_branch*)node;
+  ix = begin;
+  slot = ava_rrb_branch_slot(src, height, &ix);
+
+  dst = ava_rrb_branch_new(src->header.count - slot);
+  dst->children[0] = ava_rrb_node_drop(src->children[slot], height - 1, ix);
+  memcpy(dst->children + 1, src->children + slot + 1,
+         sizeof(ava_rrb_node*) * (src->header.count - slot - 1));
+  ava_rrb_branch_compute_sizes(dst, height);
+
+  return &dst->header;
+}
+
+static ava_list_value ava_rrb_list_list_append(
+  ava_list_value list, ava_value elt
+) {
+  const ava_rrb_list*restrict rrb = ava_value_attr(list.v);
+  const ava_rrb_node* root, * pair[2];
+  unsigned height = rrb->height;
+
+  root = ava_rrb_node_push(rrb->root, height, elt);
+  if (!root) {
+    /* The tree is full; grow a new root */
+    pair[0] = rrb->root;
+    pair[1] = ava_rrb_path(height, elt);
+    root = ava_rrb_branch_of(++height, pair, 2);
+  }
+
+  return ava_rrb_list_value(root, height, ava_value_ulong(list.v) + 1);
+}
+
+static ava_list_value ava_rrb_list_list_append_n(
+  ava_list_value list, const ava_value*restrict elements, size_t count
+) {
+  size_t i;
+
+  /* A batch big enough to fill a leaf is cheaper to build as its own tree
+   * and concatenate than to push one path copy at a time.
+   */
+  if (count >= AVA_RRB_WIDTH)
+    return ava_rrb_list_list_concat(
+      list, ava_list_of_values(elements, count));
+
+  for (i = 0; i < count; ++i)
+    list = ava_rrb_list_list_append(list, elements[i]);
+
+  return list;
+}
+
+/**
+ * Returns a copy of node with value appended to its rightmost leaf, or NULL
+ * if there is no room in node to do so.
+ */
+static const ava_rrb_node* ava_rrb_node_push(
+  const ava_rrb_node* node, unsigned height, ava_value value
+) {
+  const ava_rrb_branch* src;
+  const ava_rrb_node* child;
+  ava_rrb_branch* dst;
+  ava_rrb_leaf* leaf;
+  size_t* sizes;
+  unsigned last;
+
+  if (0 == height) {
+    if (AVA_RRB_WIDTH == node->count)
+      return NULL;
+
+    leaf = ava_rrb_leaf_new(node->count + 1);
+    memcpy(leaf->values, ((const ava_rrb_leaf*)node)->values,
+           sizeof(ava_value) * node->count);
+    leaf->values[node->count] = value;
+    return &leaf->header;
+  }
+
+  src = (const ava_rrb_branch*)node;
+  last = src->header.count - 1;
+  child = ava_rrb_node_push(src->children[last], height - 1, value);
+
+  if (child) {
+    dst = ava_rrb_branch_new(src->header.count);
+    memcpy(dst->children, src->children,
+           sizeof(ava_rrb_node*) * src->header.count);
+    dst->children[last] = child;
+
+    if (src->sizes) {
+      sizes = ava_alloc_atomic(sizeof(size_t) * src->header.count);
+      memcpy(sizes, src->sizes, sizeof(size_t) * src->header.count);
+      ++sizes[last];
+      dst->sizes = sizes;
+    } else {
+      dst->sizes = NULL;
+    }
+
+    return &dst->header;
+  }
+
+  if (AVA_RRB_WIDTH == src->header.count)
+    return NULL;
+
+  /* Start a new child. Whether the result is still dense depends on whether
+   * the old last child was completely full, which is not implied by it having
+   * no room if it was itself relaxed, so just recompute the sizes. This only
+   * happens once every AVA_RRB_WIDTH appends at most.
+   */
+  dst = ava_rrb_branch_new(src->header.count + 1);
+  memcpy(dst->children, src->children,
+         sizeof(ava_rrb_node*) * src->header.count);
+  dst->children[src->header.count] = ava_rrb_path(height - 1, value);
+  ava_rrb_branch_compute_sizes(dst, height);
+  return &dst->header;
+}
+
+/**
+ * Returns a node of the given height containing only value.
+ */
+static const ava_rrb_node* ava_rrb_path(unsigned height, ava_value value) {
+  ava_rrb_leaf* leaf;
+  ava_rrb_branch* branch;
+  const ava_rrb_node* node;
+
+  leaf = ava_rrb_leaf_new(1);
+  leaf->values[0] = value;
+  node = &leaf->header;
+
+  while (height-- > 0) {
+    branch = ava_rrb_branch_new(1);
+    branch->sizes = NULL;
+    branch->children[0] = node;
+    node = &branch->header;
+  }
+
+  return node;
+}
+
+static ava_list_value ava_rrb_list_list_concat(
+  ava_list_value list, ava_list_value other
+) {
+  const ava_rrb_list*restrict rrb = ava_value_attr(list.v);
+  const ava_rrb_list*restrict orrb;
+  size_t other_length = ava_list_length(other);
+
+  if (0 == other_length)
+    return list;
+
+  /* Anything else needs to be copied anyway, and a flat copy into a fresh
+   * tree is the cheapest way to do that.
+   */
+  if (!ava_list_is_rrb_list(other))
+    other = ava_rrb_list_copy_of(other, 0, other_length);
+
+  orrb = ava_value_attr(other.v);
+  return ava_rrb_list_concat_trees(
+    rrb->root, rrb->height, ava_value_ulong(list.v),
+    orrb->root, orrb->height, other_length);
+}
+
+static ava_list_value ava_rrb_list_concat_trees(
+  const ava_rrb_node* left, unsigned left_height, size_t left_length,
+  const ava_rrb_node* right, unsigned right_height, size_t right_length
+) {
+  return ava_rrb_list_value(
+    ava_rrb_concat_sub(left, left_height, right, right_height),
+    (left_height > right_height? left_height : right_height) + 1,
+    left_length + right_length);
+}
+
+/**
+ * Concatenates the trees rooted at left and right.
+ *
+ * The result is a branch one level higher than the taller of the two, which
+ * has either one or two children.
+ */
+static const ava_rrb_node* ava_rrb_concat_sub(
+  const ava_rrb_node* left, unsigned left_height,
+  const ava_rrb_node* right, unsigned right_height
+) {
+  const ava_rrb_branch* lb = (const ava_rrb_branch*)left;
+  const ava_rrb_branch* rb = (const ava_rrb_branch*)right;
+  const ava_rrb_node* mid, * pair[2];
+  ava_rrb_leaf* leaf;
+
+  if (left_height > right_height) {
+    mid = ava_rrb_concat_sub(lb->children[lb->header.count - 1],
+                             left_height - 1, right, right_height);
+    return ava_rrb_rebalance(lb, (const ava_rrb_branch*)mid, NULL,
+                             left_height);
+  } else if (left_height < right_height) {
+    mid = ava_rrb_concat_sub(left, left_height,
+                             rb->children[0], right_height - 1);
+    return ava_rrb_rebalance(NULL, (const ava_rrb_branch*)mid, rb,
+                             right_height);
+  } else if (left_height > 0) {
+    mid = ava_rrb_concat_sub(lb->children[lb->header.count - 1],
+                             left_height - 1,
+                             rb->children[0], right_height - 1);
+    return ava_rrb_rebalance(lb, (const ava_rrb_branch*)mid, rb,
+                             left_height);
+  } else {
+    /* Two leaves; merge them if they fit in one, and otherwise leave it to
+     * the rebalancing one level up.
+     */
+    if (left->count + right->count <= AVA_RRB_WIDTH) {
+      leaf = ava_rrb_leaf_new(left->count + right->count);
+      memcpy(leaf->values, ((const ava_rrb_leaf*)left)->values,
+             sizeof(ava_value) * left->count);
+      memcpy(leaf->values + left->count, ((const ava_rrb_leaf*)right)->values,
+             sizeof(ava_value) * right->count);
+      pair[0] = &leaf->header;
+      return ava_rrb_branch_of(1, pair, 1);
+    } else {
+      pair[0] = left;
+      pair[1] = right;
+      return ava_rrb_branch_of(1, pair, 2);
+    }
+  }
+}
+
+/**
+ * Merges the children of left (except its last), mid, and right (except its
+ * first), all of the given height, redistributing the grandchildren so that
+ * there are not too many children.
+ *
+ * left and right may be NULL. The result is a branch of height+1 with one or
+ * two children.
+ */
+static const ava_rrb_node* ava_rrb_rebalance(
+  const ava_rrb_branch* left, const ava_rrb_branch* mid,
+  const ava_rrb_branch* right, unsigned height
+) {
+  const ava_rrb_node* all[2 * AVA_RRB_WIDTH], * packed[2 * AVA_RRB_WIDTH];
+  const ava_rrb_node* top[2];
+  unsigned plan[2 * AVA_RRB_WIDTH];
+  unsigned count = 0, packed_count, i;
+
+  if (left)
+    for (i = 0; i + 1 < left->header.count; ++i)
+      all[count++] = left->children[i];
+  for (i = 0; i < mid->header.count; ++i)
+    all[count++] = mid->children[i];
+  if (right)
+    for (i = 1; i < right->header.count; ++i)
+      all[count++] = right->children[i];
+
+  packed_count = ava_rrb_concat_plan(plan, all, count);
+  ava_rrb_execute_plan(packed, plan, packed_count, all, height - 1);
+
+  if (packed_count <= AVA_RRB_WIDTH) {
+    top[0] = ava_rrb_branch_of(height, packed, packed_count);
+    return ava_rrb_branch_of(height + 1, top, 1);
+  } else {
+    top[0] = ava_rrb_branch_of(height, packed, AVA_RRB_WIDTH);
+    top[1] = ava_rrb_branch_of(height, packed + AVA_RRB_WIDTH,
+                               packed_count - AVA_RRB_WIDTH);
+    return ava_rrb_branch_of(height + 1, top, 2);
+  }
+}
+
+/**
+ * Determines how to redistribute the contents of the given nodes.
+ *
+ * On return, plan[i] is the number of elements the ith output node is to
+ * have. Nodes are merged into their successors, lowest first, until the number
+ * of nodes is within AVA_RRB_EXTRAS of the minimum.
+ *
+ * @return The number of output nodes.
+ */
+static unsigned ava_rrb_concat_plan(
+  unsigned*restrict plan, const ava_rrb_node*const* nodes, unsigned count
+) {
+  unsigned total = 0, optimal, remaining, merged, i, j;
+
+  for (i = 0; i < count; ++i) {
+    plan[i] = nodes[i]->count;
+    total += plan[i];
+  }
+
+  optimal = (total + AVA_RRB_WIDTH - 1) / AVA_RRB_WIDTH;
+
+  i = 0;
+  while (count > optimal + AVA_RRB_EXTRAS) {
+    /* Find the first node which isn't full, and spread its contents over the
+     * nodes following it.
+     */
+    while (AVA_RRB_WIDTH == plan[i])
+      ++i;
+
+    remaining = plan[i];
+    do {
+      assert(i + 1 < count);
+      merged = remaining + plan[i + 1];
+      if (merged > AVA_RRB_WIDTH)
+        merged = AVA_RRB_WIDTH;
+
+      remaining = remaining + plan[i + 1] - merged;
+      plan[i] = merged;
+      ++i;
+    } while (remaining > 0);
+
+    /* The node at i was absorbed by its predecessors */
+    for (j = i; j + 1 < count; ++j)
+      plan[j] = plan[j + 1];
+
+    --count;
+    --i;
+  }
+
+  return count;
+}
+
+/**
+ * Builds nodes of the given height according to a plan from
+ * ava_rrb_concat_plan(), taking their contents in order from src.
+ *
+ * Source nodes which the plan leaves unchanged are reused as-is.
+ */
+static void ava_rrb_execute_plan(
+  const ava_rrb_node** dst, const unsigned*restrict plan, unsigned count,
+  const ava_rrb_node*const* src, unsigned height
+) {
+  ava_rrb_leaf* leaf;
+  ava_rrb_branch* branch;
+  unsigned src_ix = 0, offset = 0, filled, take, k;
+
+  for (k = 0; k < count; ++k) {
+    if (0 == offset && src[src_ix]->count == plan[k]) {
+      dst[k] = src[src_ix++];
+      continue;
+    }
+
+    if (0 == height) {
+      leaf = ava_rrb_leaf_new(plan[k]);
+      for (filled = 0; filled < plan[k]; filled += take) {
+        take = src[src_ix]->count - offset;
+        if (take > plan[k] - filled)
+          take = plan[k] - filled;
+
+        memcpy(leaf->values + filled,
+               ((const ava_rrb_leaf*)src[src_ix])->values + offset,
+               sizeof(ava_value) * take);
+        offset += take;
+        if (offset == src[src_ix]->count) {
+          ++src_ix;
+          offset = 0;
+        }
+      }
+      dst[k] = &leaf->header;
+    } else {
+      branch = ava_rrb_branch_new(plan[k]);
+      for (filled = 0; filled < plan[k]; filled += take) {
+        take = src[src_ix]->count - offset;
+        if (take > plan[k] - filled)
+          take = plan[k] - filled;
+
+        memcpy(branch->children + filled,
+               ((const ava_rrb_branch*)src[src_ix])->children + offset,
+               sizeof(ava_rrb_node*) * take);
+        offset += take;
+        if (offset == src[src_ix]->count) {
+          ++src_ix;
+          offset = 0;
+        }
+      }
+      ava_rrb_branch_compute_sizes(branch, height);
+      dst[k] = &branch->header;
+    }
+  }
+}
+
+static ava_list_value ava_rrb_list_list_remove(
+  ava_list_value list, size_t begin, size_t end
+) {
+  const ava_rrb_list*restrict rrb = ava_value_attr(list.v);
+  size_t length = ava_value_ulong(list.v);
+
+  assert(begin <= end);
+  assert(end <= length);
+
+  if (begin == end)
+    return list;
+
+  if (0 == begin && length == end)
+    return ava_empty_list();
+
+  if (0 == begin)
+    return ava_rrb_list_value(ava_rrb_node_drop(rrb->root, rrb->height, end),
+                              rrb->height, length - end);
+
+  if (length == end)
+    return ava_rrb_list_value(ava_rrb_node_take(rrb->root, rrb->height, begin),
+                              rrb->height, begin);
+
+  return ava_rrb_list_concat_trees(
+    ava_rrb_node_take(rrb->root, rrb->height, begin), rrb->height, begin,
+    ava_rrb_node_drop(rrb->root, rrb->height, end), rrb->height, length - end);
+}
+
+static ava_list_value ava_rrb_list_list_set(
+  ava_list_value list, size_t index, ava_value value
+) {
+  const ava_rrb_list*restrict rrb = ava_value_attr(list.v);
+
+  assert(index < ava_value_ulong(list.v));
+
+  return ava_rrb_list_value(
+    ava_rrb_node_set(rrb->root, rrb->height, index, value),
+    rrb->height, ava_value_ulong(list.v));
+}
+
+static const ava_rrb_node* ava_rrb_node_set(
+  const ava_rrb_node* node, unsigned height, size_t ix, ava_value value
+) {
+  const ava_rrb_branch* src;
+  ava_rrb_branch* dst;
+  ava_rrb_leaf* leaf;
+  unsigned slot;
+
+  if (0 == height) {
+    leaf = ava_rrb_leaf_copy((const ava_rrb_leaf*)node, 0, node->count);
+    leaf->values[ix] = value;
+    return &leaf->header;
+  }
+
+  src = (const ava_rrb_branch*)node;
+  slot = ava_rrb_branch_slot(src, height, &ix);
+
+  /* The sizes don't change, so the table can be shared */
+  dst = ava_rrb_branch_new(src->header.count);
+  dst->sizes = src->sizes;
+  memcpy(dst->children, src->children,
+         sizeof(ava_rrb_node*) * src->header.count);
+  dst->children[slot] = ava_rrb_node_set(
+    src->children[slot], height - 1, ix, value);
+
+  return &dst->header;
+}
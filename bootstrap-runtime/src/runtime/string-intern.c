@@ -0,0 +1,255 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <atomic_ops.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/alloc.h"
+#include "avalanche/string.h"
+#include "avalanche/value.h"
+#include "-internal-defs.h"
+#include "-string.h"
+
+/*
+
+  The interning table is a hash set of weak references to interned strings.
+
+  It is split into AVA_INTERN_NSHARDS independent shards, selected by the top
+  bits of the string's hash, so that threads interning different strings
+  rarely contend. Each shard is an open-addressing table with linear probing,
+  protected by a spinlock; the critical sections are short, apart from the
+  occasional rebuild.
+
+  Each entry records the string's hash alongside the weak reference, so that
+  probing only needs to look at the referent (which requires taking the GC
+  allocation lock) when the hashes match. An entry whose hash is zero has
+  never been used, and terminates probing. An entry with a hash but whose
+  weak reference has been cleared by the collector is dead; it continues
+  probe sequences and may be reused by a later insertion. Dead entries are
+  dropped when the shard is rebuilt, which happens when live plus dead
+  entries exceed three quarters of the capacity.
+
+  Hashes are ava_value_hash() of the string, so interning a string also fills
+  its hash slot, and strings created by interning start with their hash slot
+  already filled. (A hash of zero is stored as 1 in the table, since zero
+  means "unused".)
+
+ */
+
+#define AVA_INTERN_NSHARDS_BITS 6
+#define AVA_INTERN_NSHARDS (1 << AVA_INTERN_NSHARDS_BITS)
+#define AVA_INTERN_MIN_CAPACITY 16
+/**
+ * The maximum length of a string passed to ava_string_of_bytes_interned()
+ * which is hashed from a stack copy rather than a heap string.
+ */
+#define AVA_INTERN_STACK_MAX 256
+
+typedef struct {
+  ava_ulong hash;
+  ava_weak_ref string;
+} ava_intern_entry;
+
+typedef struct {
+  AO_t lock;
+  /* Entries with a non-zero hash, whether live or dead */
+  size_t used;
+  /* Always a power of two, or 0 if entries is NULL */
+  size_t capacity;
+  ava_intern_entry*restrict entries;
+} ava_intern_shard;
+
+static ava_intern_shard ava_intern_shards[AVA_INTERN_NSHARDS];
+
+/**
+ * Returns the interned string with the given hash and content, interning a
+ * new one if there is none yet.
+ *
+ * @param data The content, of which at least length bytes are readable.
+ * @param length The length of the string; the string must not be representable
+ * as ASCII9 or BIN7.
+ * @param hash The ava_value_hash() of the string.
+ */
+static ava_string ava_intern_get(const char*restrict data, size_t length,
+                                 ava_ulong hash);
+/**
+ * Rebuilds the given locked shard with space for at least one more entry.
+ */
+static void ava_intern_shard_rebuild(ava_intern_shard*restrict shard);
+
+static inline void ava_intern_shard_lock(ava_intern_shard*restrict shard) {
+  while (AVA_UNLIKELY(!AO_compare_and_swap_acquire(&shard->lock, 0, 1)))
+    AVA_SPINLOOP;
+}
+
+static inline void ava_intern_shard_unlock(ava_intern_shard*restrict shard) {
+  AO_store_release(&shard->lock, 0);
+}
+
+ava_string ava_string_intern(ava_string str) {
+  ava_ascii9_string a9;
+  ava_bin7_string b7;
+  ava_str_tmpbuff tmp;
+  const char* data;
+
+  if ((a9 = ava_string_to_ascii9(str)))
+    return (ava_string) { .ascii9 = a9 };
+  if ((b7 = ava_string_to_bin7(str)))
+    return (ava_string) { .ascii9 = b7 };
+  if (ava_string_is_interned(str))
+    return str;
+
+  data = ava_string_to_cstring_buff(tmp, str);
+  return ava_intern_get(data, ava_strlen(str),
+                        ava_value_hash(ava_value_of_string(str)));
+}
+
+ava_string ava_string_of_bytes_interned(const char* str, size_t sz) {
+  ava_ulong buf[AVA_INTERN_STACK_MAX / sizeof(ava_ulong) + 1];
+  ava_twine tmp;
+
+  /* Short strings which fit ASCII9 or BIN7 must not be interned, and it is
+   * easier to let ava_string_of_bytes() work out whether they do; long strings
+   * would be copied anyway.
+   */
+  if (sz <= 9 || sz > AVA_INTERN_STACK_MAX)
+    return ava_string_intern(ava_string_of_bytes(str, sz));
+
+  /* Otherwise, hash the string through a temporary static-like twine (which
+   * has no hash slot), so that nothing is allocated if the string is already
+   * interned.
+   */
+  buf[sz / sizeof(ava_ulong)] = 0;
+  memcpy(buf, str, sz);
+  tmp.body = buf;
+  tmp.length = sz;
+  tmp.tail.overhead = 0;
+  tmp.tail.other.offset = 0;
+
+  return ava_intern_get(
+    str, sz, ava_value_hash(ava_value_of_string((ava_string) {
+          .twine = &tmp })));
+}
+
+ava_string ava_string_of_cstring_interned(const char* str) {
+  return ava_string_of_bytes_interned(str, strlen(str));
+}
+
+static ava_string ava_intern_get(const char*restrict data, size_t length,
+                                 ava_ulong hash) {
+  ava_intern_shard*restrict shard;
+  ava_intern_entry*restrict entry, *restrict reusable;
+  const ava_twine*restrict twine;
+  ava_ulong key;
+  size_t i, mask;
+  ava_string ret;
+
+  key = hash? hash : 1;
+  shard = ava_intern_shards + (key >> (64 - AVA_INTERN_NSHARDS_BITS));
+
+  ava_intern_shard_lock(shard);
+
+  reusable = NULL;
+  mask = shard->capacity - 1;
+  for (i = key & mask; shard->capacity; i = (i + 1) & mask) {
+    entry = shard->entries + i;
+
+    if (!entry->hash) break;
+
+    if (entry->hash == key) {
+      twine = ava_weak_ref_get(&entry->string);
+      if (!twine) {
+        if (!reusable) reusable = entry;
+      } else if (length == twine->length &&
+                 !memcmp(data, twine->body, length)) {
+        ava_intern_shard_unlock(shard);
+        return (ava_string) { .twine = twine };
+      }
+    } else if (!reusable && !entry->string.hidden) {
+      /* Cheap racy test; reuse is only a matter of efficiency, and a dead
+       * entry never comes back to life.
+       */
+      reusable = entry;
+    }
+  }
+
+  /* Not found; add a new string */
+  ret = ava_interned_string_new(data, length, hash);
+
+  if (!reusable) {
+    if ((shard->used + 1) * 4 > shard->capacity * 3) {
+      ava_intern_shard_rebuild(shard);
+      mask = shard->capacity - 1;
+    }
+
+    for (i = key & mask; shard->entries[i].hash; i = (i + 1) & mask);
+    reusable = shard->entries + i;
+    ++shard->used;
+  }
+
+  reusable->hash = key;
+  ava_weak_ref_set(&reusable->string, ret.twine);
+
+  ava_intern_shard_unlock(shard);
+  return ret;
+}
+
+static void ava_intern_shard_rebuild(ava_intern_shard*restrict shard) {
+  struct {
+    ava_ulong hash;
+    const void* string;
+  }*restrict live;
+  ava_intern_entry*restrict entries;
+  size_t capacity, nlive, i, j, mask;
+
+  /* Grab strong references to the live strings first, so that none of them
+   * die between deciding the new size and populating the new table.
+   */
+  live = ava_alloc(sizeof(*live) * (shard->capacity + 1));
+  nlive = 0;
+  for (i = 0; i < shard->capacity; ++i) {
+    if (shard->entries[i].hash &&
+        (live[nlive].string = ava_weak_ref_get(&shard->entries[i].string)))
+      live[nlive++].hash = shard->entries[i].hash;
+  }
+
+  capacity = AVA_INTERN_MIN_CAPACITY;
+  while ((nlive + 1) * 2 > capacity)
+    capacity *= 2;
+
+  /* The entries hold no visible pointers, so they can be atomic. The weak
+   * references in the old table are dropped automatically when it is
+   * collected.
+   */
+  entries = ava_alloc_atomic_zero(sizeof(ava_intern_entry) * capacity);
+  mask = capacity - 1;
+  for (i = 0; i < nlive; ++i) {
+    for (j = live[i].hash & mask; entries[j].hash; j = (j + 1) & mask);
+
+    entries[j].hash = live[i].hash;
+    ava_weak_ref_set(&entries[j].string, live[i].string);
+  }
+
+  shard->entries = entries;
+  shard->capacity = capacity;
+  shard->used = nlive;
+}
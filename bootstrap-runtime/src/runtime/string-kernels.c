@@ -0,0 +1,928 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#if defined(__SSE2__) && defined(HAVE_EMMINTRIN_H)
+#include <emmintrin.h>
+#define AVA_HAVE_SSE2_KERNELS 1
+#endif
+
+#if defined(HAVE_AVX2_TARGET_ATTRIBUTE) && defined(HAVE_IMMINTRIN_H) && \
+  defined(HAVE_CPUID_H) && defined(AVA_HAVE_SSE2_KERNELS)
+#include <immintrin.h>
+#include <cpuid.h>
+#define AVA_HAVE_AVX2_KERNELS 1
+#endif
+
+#include <atomic_ops.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "-string-kernels.h"
+
+/*
+
+  All of the vector kernels follow the same pattern: process the input in
+  full-width unaligned blocks, then finish the last partial block with the
+  next narrower implementation. No kernel ever reads outside the bounds it was
+  given, even though forced twines are padded to an 8-byte boundary, since the
+  kernels are also run on ASCII9 temporary buffers and arbitrary test data.
+
+  The substring search is the "generic SIMD" algorithm: each block compares
+  the first and last bytes of the needle against the haystack at every
+  position simultaneously, and only positions where both match are verified
+  with a full comparison. This rejects almost every position in natural text
+  without touching the middle of the needle.
+
+  Code point counting and indexing only need to distinguish continuation
+  bytes (10xxxxxx) from everything else, which is a single signed comparison
+  per byte; the population count of the resulting mask gives the number of
+  code points in a block.
+
+  The AVX2 UTF-8 validator is the lookup algorithm of Keiser and Lemire
+  ("Validating UTF-8 In Less Than One Instruction Per Byte", 2021). Each
+  error in a two-byte window is classified by three 16-entry table lookups
+  (the high nybble of the first byte, its low nybble, and the high nybble of
+  the second byte), each of which yields the set of errors that nybble is
+  consistent with; a byte pair is invalid if all three agree on some error.
+  The only errors this cannot see are those concerning the third and fourth
+  bytes of a sequence, which are handled by checking that exactly the bytes
+  two or three positions after a three- or four-byte lead are continuations.
+  Blocks only report whether they contain an error, so once one does, the
+  validator backs up to the start of the sequence in progress and lets the
+  scalar implementation find exactly where. SSE2 lacks the byte shuffle the
+  lookups need, so its validator only vectorises skipping ASCII runs.
+
+ */
+
+static ava_bool ava_string_kernels_always(void);
+
+static ssize_t ava_string_kernels_scalar_find_byte(
+  const char*restrict haystack, char needle, size_t n);
+static size_t ava_string_kernels_scalar_mismatch(
+  const char*restrict a, const char*restrict b, size_t n);
+static ssize_t ava_string_kernels_scalar_find_bytes(
+  const char*restrict haystack, size_t haystack_len,
+  const char*restrict needle, size_t needle_len);
+static size_t ava_string_kernels_scalar_ascii_prefix(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_scalar_utf8_valid_prefix(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_scalar_utf8_count(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_scalar_utf8_offset(
+  const char*restrict s, size_t n, size_t cp);
+
+/**
+ * Returns the length of the well-formed UTF-8 sequence at the start of s, of
+ * which n > 0 bytes are readable, or 0 if it is invalid or truncated.
+ */
+static inline unsigned ava_string_kernels_utf8_sequence_length(
+  const unsigned char*restrict s, size_t n);
+
+const ava_string_kernels ava_string_kernels_scalar = {
+  .name = "scalar",
+  .supported = ava_string_kernels_always,
+  .find_byte = ava_string_kernels_scalar_find_byte,
+  .mismatch = ava_string_kernels_scalar_mismatch,
+  .find_bytes = ava_string_kernels_scalar_find_bytes,
+  .ascii_prefix = ava_string_kernels_scalar_ascii_prefix,
+  .utf8_valid_prefix = ava_string_kernels_scalar_utf8_valid_prefix,
+  .utf8_count = ava_string_kernels_scalar_utf8_count,
+  .utf8_offset = ava_string_kernels_scalar_utf8_offset,
+};
+
+#ifdef AVA_HAVE_SSE2_KERNELS
+static ssize_t ava_string_kernels_sse2_find_byte(
+  const char*restrict haystack, char needle, size_t n);
+static size_t ava_string_kernels_sse2_mismatch(
+  const char*restrict a, const char*restrict b, size_t n);
+static ssize_t ava_string_kernels_sse2_find_bytes(
+  const char*restrict haystack, size_t haystack_len,
+  const char*restrict needle, size_t needle_len);
+static size_t ava_string_kernels_sse2_ascii_prefix(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_sse2_utf8_valid_prefix(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_sse2_utf8_count(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_sse2_utf8_offset(
+  const char*restrict s, size_t n, size_t cp);
+
+static const ava_string_kernels ava_string_kernels_sse2 = {
+  .name = "sse2",
+  .supported = ava_string_kernels_always,
+  .find_byte = ava_string_kernels_sse2_find_byte,
+  .mismatch = ava_string_kernels_sse2_mismatch,
+  .find_bytes = ava_string_kernels_sse2_find_bytes,
+  .ascii_prefix = ava_string_kernels_sse2_ascii_prefix,
+  .utf8_valid_prefix = ava_string_kernels_sse2_utf8_valid_prefix,
+  .utf8_count = ava_string_kernels_sse2_utf8_count,
+  .utf8_offset = ava_string_kernels_sse2_utf8_offset,
+};
+#endif
+
+#ifdef AVA_HAVE_AVX2_KERNELS
+static ava_bool ava_string_kernels_avx2_supported(void);
+static ssize_t ava_string_kernels_avx2_find_byte(
+  const char*restrict haystack, char needle, size_t n);
+static size_t ava_string_kernels_avx2_mismatch(
+  const char*restrict a, const char*restrict b, size_t n);
+static ssize_t ava_string_kernels_avx2_find_bytes(
+  const char*restrict haystack, size_t haystack_len,
+  const char*restrict needle, size_t needle_len);
+static size_t ava_string_kernels_avx2_ascii_prefix(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_avx2_utf8_valid_prefix(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_avx2_utf8_count(
+  const char*restrict s, size_t n);
+static size_t ava_string_kernels_avx2_utf8_offset(
+  const char*restrict s, size_t n, size_t cp);
+
+static const ava_string_kernels ava_string_kernels_avx2 = {
+  .name = "avx2",
+  .supported = ava_string_kernels_avx2_supported,
+  .find_byte = ava_string_kernels_avx2_find_byte,
+  .mismatch = ava_string_kernels_avx2_mismatch,
+  .find_bytes = ava_string_kernels_avx2_find_bytes,
+  .ascii_prefix = ava_string_kernels_avx2_ascii_prefix,
+  .utf8_valid_prefix = ava_string_kernels_avx2_utf8_valid_prefix,
+  .utf8_count = ava_string_kernels_avx2_utf8_count,
+  .utf8_offset = ava_string_kernels_avx2_utf8_offset,
+};
+#endif
+
+const ava_string_kernels*const ava_string_kernels_all[] = {
+#ifdef AVA_HAVE_AVX2_KERNELS
+  &ava_string_kernels_avx2,
+#endif
+#ifdef AVA_HAVE_SSE2_KERNELS
+  &ava_string_kernels_sse2,
+#endif
+  &ava_string_kernels_scalar,
+  NULL
+};
+
+static AO_t ava_string_kernels_selected;
+
+const ava_string_kernels* ava_string_kernels_get(void) {
+  const ava_string_kernels*const* candidate;
+  const ava_string_kernels* selected;
+
+  selected = (const ava_string_kernels*)AO_load_acquire_read(
+    &ava_string_kernels_selected);
+  if (AVA_LIKELY(selected))
+    return selected;
+
+  /* Racing threads all arrive at the same answer, so there's no need to do
+   * anything more than publish it.
+   */
+  for (candidate = ava_string_kernels_all; !(*candidate)->supported();
+       ++candidate);
+
+  selected = *candidate;
+  AO_store_release_write(&ava_string_kernels_selected, (AO_t)selected);
+  return selected;
+}
+
+static ava_bool ava_string_kernels_always(void) {
+  return ava_true;
+}
+
+static ssize_t ava_string_kernels_scalar_find_byte(
+  const char*restrict haystack, char needle, size_t n
+) {
+  const char* found;
+
+  found = memchr(haystack, needle, n);
+  return found? found - haystack : -1;
+}
+
+static size_t ava_string_kernels_scalar_mismatch(
+  const char*restrict a, const char*restrict b, size_t n
+) {
+  size_t i;
+
+  /* memcmp() can tell us whether there is a difference much faster than we can
+   * find it ourselves, and the common case in the callers is equality.
+   */
+  if (!memcmp(a, b, n)) return n;
+
+  for (i = 0; a[i] == b[i]; ++i);
+  return i;
+}
+
+static ssize_t ava_string_kernels_scalar_find_bytes(
+  const char*restrict haystack, size_t haystack_len,
+  const char*restrict needle, size_t needle_len
+) {
+  const char* candidate, * last;
+
+  if (0 == needle_len) return 0;
+  if (needle_len > haystack_len) return -1;
+
+  candidate = haystack;
+  last = haystack + haystack_len - needle_len;
+  while (candidate <= last &&
+         (candidate = memchr(candidate, needle[0], last - candidate + 1))) {
+    if (!memcmp(candidate + 1, needle + 1, needle_len - 1))
+      return candidate - haystack;
+
+    ++candidate;
+  }
+
+  return -1;
+}
+
+static size_t ava_string_kernels_scalar_ascii_prefix(
+  const char*restrict s, size_t n
+) {
+  size_t i;
+
+  for (i = 0; i < n && !(s[i] & 0x80); ++i);
+  return i;
+}
+
+static inline unsigned ava_string_kernels_utf8_sequence_length(
+  const unsigned char*restrict s, size_t n
+) {
+  /* Permitted range of the second byte, which is where overlong forms,
+   * surrogates and out-of-range code points are all distinguished.
+   */
+  unsigned char lo = 0x80, hi = 0xBF;
+  unsigned length, i;
+
+  if (s[0] < 0x80) {
+    return 1;
+  } else if (s[0] < 0xC2) {
+    /* Continuation, or the lead of an overlong two-byte form */
+    return 0;
+  } else if (s[0] < 0xE0) {
+    length = 2;
+  } else if (s[0] < 0xF0) {
+    length = 3;
+    if (0xE0 == s[0]) lo = 0xA0;
+    if (0xED == s[0]) hi = 0x9F;
+  } else if (s[0] < 0xF5) {
+    length = 4;
+    if (0xF0 == s[0]) lo = 0x90;
+    if (0xF4 == s[0]) hi = 0x8F;
+  } else {
+    return 0;
+  }
+
+  if (n < length || s[1] < lo || s[1] > hi)
+    return 0;
+
+  for (i = 2; i < length; ++i)
+    if (0x80 != (s[i] & 0xC0))
+      return 0;
+
+  return length;
+}
+
+static size_t ava_string_kernels_scalar_utf8_valid_prefix(
+  const char*restrict s, size_t n
+) {
+  size_t i;
+  unsigned length;
+
+  for (i = 0; i < n; i += length)
+    if (!(length = ava_string_kernels_utf8_sequence_length(
+            (const unsigned char*)s + i, n - i)))
+      break;
+
+  return i;
+}
+
+static size_t ava_string_kernels_scalar_utf8_count(
+  const char*restrict s, size_t n
+) {
+  size_t i, count = 0;
+
+  for (i = 0; i < n; ++i)
+    count += 0x80 != (s[i] & 0xC0);
+
+  return count;
+}
+
+static size_t ava_string_kernels_scalar_utf8_offset(
+  const char*restrict s, size_t n, size_t cp
+) {
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    if (0x80 != (s[i] & 0xC0) && 0 == cp--)
+      return i;
+
+  return n;
+}
+
+#ifdef AVA_HAVE_SSE2_KERNELS
+
+static ssize_t ava_string_kernels_sse2_find_byte(
+  const char*restrict haystack, char needle, size_t n
+) {
+  __m128i pattern = _mm_set1_epi8(needle), block, b0, b1, b2, b3;
+  unsigned matches;
+  size_t i;
+
+  for (i = 0; i + 64 <= n; i += 64) {
+    b0 = _mm_cmpeq_epi8(
+      _mm_loadu_si128((const __m128i*)(haystack + i +  0)), pattern);
+    b1 = _mm_cmpeq_epi8(
+      _mm_loadu_si128((const __m128i*)(haystack + i + 16)), pattern);
+    b2 = _mm_cmpeq_epi8(
+      _mm_loadu_si128((const __m128i*)(haystack + i + 32)), pattern);
+    b3 = _mm_cmpeq_epi8(
+      _mm_loadu_si128((const __m128i*)(haystack + i + 48)), pattern);
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(b0, b1),
+                                       _mm_or_si128(b2, b3))))
+      break;
+  }
+
+  for (; i + 16 <= n; i += 16) {
+    block = _mm_loadu_si128((const __m128i*)(haystack + i));
+    matches = _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+    if (matches)
+      return i + __builtin_ctz(matches);
+  }
+
+  for (; i < n; ++i)
+    if (haystack[i] == needle)
+      return i;
+
+  return -1;
+}
+
+static size_t ava_string_kernels_sse2_mismatch(
+  const char*restrict a, const char*restrict b, size_t n
+) {
+  __m128i ablock, bblock, e0, e1, e2, e3;
+  unsigned equal;
+  size_t i;
+
+  for (i = 0; i + 64 <= n; i += 64) {
+#define EQ(off) _mm_cmpeq_epi8(                                 \
+      _mm_loadu_si128((const __m128i*)(a + i + (off))),         \
+      _mm_loadu_si128((const __m128i*)(b + i + (off))))
+    e0 = EQ(0);
+    e1 = EQ(16);
+    e2 = EQ(32);
+    e3 = EQ(48);
+#undef EQ
+    if (0xFFFF != _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(e0, e1),
+                                                  _mm_and_si128(e2, e3))))
+      break;
+  }
+
+  for (; i + 16 <= n; i += 16) {
+    ablock = _mm_loadu_si128((const __m128i*)(a + i));
+    bblock = _mm_loadu_si128((const __m128i*)(b + i));
+    equal = _mm_movemask_epi8(_mm_cmpeq_epi8(ablock, bblock));
+    if (0xFFFF != equal)
+      return i + __builtin_ctz(~equal);
+  }
+
+  for (; i < n && a[i] == b[i]; ++i);
+  return i;
+}
+
+/**
+ * Verifies candidate positions produced by a block of the generic SIMD
+ * substring search.
+ *
+ * @param haystack The start of the block.
+ * @param candidates Bitmask of positions within the block at which the first
+ * and last bytes of the needle match.
+ * @return The offset within the block of the first true match, or -1.
+ */
+static inline ssize_t ava_string_kernels_verify_candidates(
+  const char*restrict haystack, unsigned candidates,
+  const char*restrict needle, size_t needle_len
+) {
+  unsigned bit;
+
+  while (candidates) {
+    bit = __builtin_ctz(candidates);
+    /* The first and last bytes are already known to match */
+    if (needle_len <= 2 ||
+        !memcmp(haystack + bit + 1, needle + 1, needle_len - 2))
+      return bit;
+
+    candidates &= candidates - 1;
+  }
+
+  return -1;
+}
+
+/**
+ * Completes a substring search with the scalar algorithm, starting at offset
+ * start into the haystack.
+ */
+static ssize_t ava_string_kernels_find_bytes_tail(
+  const char*restrict haystack, size_t haystack_len,
+  const char*restrict needle, size_t needle_len,
+  size_t start
+) {
+  ssize_t found;
+
+  found = ava_string_kernels_scalar_find_bytes(
+    haystack + start, haystack_len - start, needle, needle_len);
+  return found < 0? -1 : found + (ssize_t)start;
+}
+
+static ssize_t ava_string_kernels_sse2_find_bytes(
+  const char*restrict haystack, size_t haystack_len,
+  const char*restrict needle, size_t needle_len
+) {
+  __m128i first, last, bfirst, blast;
+  unsigned candidates;
+  ssize_t found;
+  size_t i;
+
+  if (0 == needle_len) return 0;
+  if (needle_len > haystack_len) return -1;
+  if (1 == needle_len)
+    return ava_string_kernels_sse2_find_byte(haystack, needle[0],
+                                             haystack_len);
+
+  first = _mm_set1_epi8(needle[0]);
+  last = _mm_set1_epi8(needle[needle_len - 1]);
+
+  for (i = 0; i + needle_len - 1 + 16 <= haystack_len; i += 16) {
+    bfirst = _mm_loadu_si128((const __m128i*)(haystack + i));
+    blast = _mm_loadu_si128((const __m128i*)(haystack + i + needle_len - 1));
+    candidates = _mm_movemask_epi8(
+      _mm_and_si128(_mm_cmpeq_epi8(bfirst, first),
+                    _mm_cmpeq_epi8(blast, last)));
+    found = ava_string_kernels_verify_candidates(
+      haystack + i, candidates, needle, needle_len);
+    if (found >= 0)
+      return i + found;
+  }
+
+  return ava_string_kernels_find_bytes_tail(
+    haystack, haystack_len, needle, needle_len, i);
+}
+
+static size_t ava_string_kernels_sse2_ascii_prefix(
+  const char*restrict s, size_t n
+) {
+  unsigned high;
+  size_t i;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    high = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i)));
+    if (high)
+      return i + __builtin_ctz(high);
+  }
+
+  return i + ava_string_kernels_scalar_ascii_prefix(s + i, n - i);
+}
+
+static size_t ava_string_kernels_sse2_utf8_valid_prefix(
+  const char*restrict s, size_t n
+) {
+  size_t i = 0;
+  unsigned length;
+
+  while (i < n) {
+    i += ava_string_kernels_sse2_ascii_prefix(s + i, n - i);
+
+    /* Validate the non-ASCII run one sequence at a time */
+    while (i < n && (s[i] & 0x80)) {
+      if (!(length = ava_string_kernels_utf8_sequence_length(
+              (const unsigned char*)s + i, n - i)))
+        return i;
+
+      i += length;
+    }
+  }
+
+  return i;
+}
+
+static size_t ava_string_kernels_sse2_utf8_count(
+  const char*restrict s, size_t n
+) {
+  /* Continuation bytes are exactly those <= -65 when signed */
+  __m128i limit = _mm_set1_epi8(-65);
+  size_t i, count = 0;
+
+  for (i = 0; i + 16 <= n; i += 16)
+    count += __builtin_popcount(
+      _mm_movemask_epi8(
+        _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*)(s + i)), limit)));
+
+  return count + ava_string_kernels_scalar_utf8_count(s + i, n - i);
+}
+
+static size_t ava_string_kernels_sse2_utf8_offset(
+  const char*restrict s, size_t n, size_t cp
+) {
+  __m128i limit = _mm_set1_epi8(-65);
+  unsigned starts, count;
+  size_t i;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    starts = _mm_movemask_epi8(
+      _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*)(s + i)), limit));
+    count = __builtin_popcount(starts);
+    if (cp < count) {
+      while (cp--)
+        starts &= starts - 1;
+      return i + __builtin_ctz(starts);
+    }
+
+    cp -= count;
+  }
+
+  return i + ava_string_kernels_scalar_utf8_offset(s + i, n - i, cp);
+}
+
+#endif /* AVA_HAVE_SSE2_KERNELS */
+
+#ifdef AVA_HAVE_AVX2_KERNELS
+
+static ava_bool ava_string_kernels_avx2_supported(void) {
+  unsigned eax, ebx, ecx, edx, xcr0_lo, xcr0_hi;
+
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return ava_false;
+
+  /* The processor must support AVX and the OS must save the YMM registers on
+   * context switch (OSXSAVE, then XCR0 bits 1 and 2).
+   */
+  if (!(ecx & bit_AVX) || !(ecx & bit_OSXSAVE))
+    return ava_false;
+
+  /* xgetbv, spelt out so as not to require -mxsave */
+  __asm__ (".byte 0x0f, 0x01, 0xd0"
+           : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+  (void)xcr0_hi;
+  if (0x6 != (xcr0_lo & 0x6))
+    return ava_false;
+
+  if (__get_cpuid_max(0, NULL) < 7)
+    return ava_false;
+
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return !!(ebx & bit_AVX2);
+}
+
+__attribute__((target("avx2")))
+static ssize_t ava_string_kernels_avx2_find_byte(
+  const char*restrict haystack, char needle, size_t n
+) {
+  __m256i pattern = _mm256_set1_epi8(needle), b0, b1, b2, b3;
+  unsigned matches;
+  ssize_t found;
+  size_t i;
+
+  /* Test four blocks at a time, only working out which one matched once
+   * something does.
+   */
+  for (i = 0; i + 128 <= n; i += 128) {
+    b0 = _mm256_cmpeq_epi8(
+      _mm256_loadu_si256((const __m256i*)(haystack + i +  0)), pattern);
+    b1 = _mm256_cmpeq_epi8(
+      _mm256_loadu_si256((const __m256i*)(haystack + i + 32)), pattern);
+    b2 = _mm256_cmpeq_epi8(
+      _mm256_loadu_si256((const __m256i*)(haystack + i + 64)), pattern);
+    b3 = _mm256_cmpeq_epi8(
+      _mm256_loadu_si256((const __m256i*)(haystack + i + 96)), pattern);
+    if (_mm256_movemask_epi8(
+          _mm256_or_si256(_mm256_or_si256(b0, b1),
+                          _mm256_or_si256(b2, b3))))
+      break;
+  }
+
+  for (; i + 32 <= n; i += 32) {
+    b0 = _mm256_loadu_si256((const __m256i*)(haystack + i));
+    matches = _mm256_movemask_epi8(_mm256_cmpeq_epi8(b0, pattern));
+    if (matches)
+      return i + __builtin_ctz(matches);
+  }
+
+  /* Avoid the AVX-SSE transition penalty on entering the legacy-encoded SSE2
+   * kernel.
+   */
+  _mm256_zeroupper();
+  found = ava_string_kernels_sse2_find_byte(haystack + i, needle, n - i);
+  return found < 0? -1 : found + (ssize_t)i;
+}
+
+__attribute__((target("avx2")))
+static size_t ava_string_kernels_avx2_mismatch(
+  const char*restrict a, const char*restrict b, size_t n
+) {
+  __m256i ablock, bblock, e0, e1, e2, e3;
+  unsigned equal;
+  size_t i;
+
+  for (i = 0; i + 128 <= n; i += 128) {
+#define EQ(off) _mm256_cmpeq_epi8(                                   \
+      _mm256_loadu_si256((const __m256i*)(a + i + (off))),          \
+      _mm256_loadu_si256((const __m256i*)(b + i + (off))))
+    e0 = EQ(0);
+    e1 = EQ(32);
+    e2 = EQ(64);
+    e3 = EQ(96);
+#undef EQ
+    if (0xFFFFFFFFU != (unsigned)_mm256_movemask_epi8(
+          _mm256_and_si256(_mm256_and_si256(e0, e1),
+                           _mm256_and_si256(e2, e3))))
+      break;
+  }
+
+  for (; i + 32 <= n; i += 32) {
+    ablock = _mm256_loadu_si256((const __m256i*)(a + i));
+    bblock = _mm256_loadu_si256((const __m256i*)(b + i));
+    equal = _mm256_movemask_epi8(_mm256_cmpeq_epi8(ablock, bblock));
+    if (0xFFFFFFFFU != equal)
+      return i + __builtin_ctz(~equal);
+  }
+
+  _mm256_zeroupper();
+  return i + ava_string_kernels_sse2_mismatch(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static ssize_t ava_string_kernels_avx2_find_bytes(
+  const char*restrict haystack, size_t haystack_len,
+  const char*restrict needle, size_t needle_len
+) {
+  __m256i first, last, bfirst, blast;
+  unsigned candidates;
+  ssize_t found;
+  size_t i;
+
+  if (0 == needle_len) return 0;
+  if (needle_len > haystack_len) return -1;
+  if (1 == needle_len)
+    return ava_string_kernels_avx2_find_byte(haystack, needle[0],
+                                             haystack_len);
+
+  first = _mm256_set1_epi8(needle[0]);
+  last = _mm256_set1_epi8(needle[needle_len - 1]);
+
+  for (i = 0; i + needle_len - 1 + 32 <= haystack_len; i += 32) {
+    bfirst = _mm256_loadu_si256((const __m256i*)(haystack + i));
+    blast = _mm256_loadu_si256(
+      (const __m256i*)(haystack + i + needle_len - 1));
+    candidates = _mm256_movemask_epi8(
+      _mm256_and_si256(_mm256_cmpeq_epi8(bfirst, first),
+                       _mm256_cmpeq_epi8(blast, last)));
+    found = ava_string_kernels_verify_candidates(
+      haystack + i, candidates, needle, needle_len);
+    if (found >= 0)
+      return i + found;
+  }
+
+  return ava_string_kernels_find_bytes_tail(
+    haystack, haystack_len, needle, needle_len, i);
+}
+
+__attribute__((target("avx2")))
+static size_t ava_string_kernels_avx2_ascii_prefix(
+  const char*restrict s, size_t n
+) {
+  unsigned high;
+  size_t i;
+
+  for (i = 0; i + 32 <= n; i += 32) {
+    high = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(s + i)));
+    if (high)
+      return i + __builtin_ctz(high);
+  }
+
+  _mm256_zeroupper();
+  return i + ava_string_kernels_sse2_ascii_prefix(s + i, n - i);
+}
+
+/* Error classes for the UTF-8 lookup tables; see the notes at the top of the
+ * file. Each describes a two-byte window (first byte, second byte).
+ */
+/* 11______ 0_______ or 11______ 11______ */
+#define AVA_UTF8_TOO_SHORT      (1 << 0)
+/* 0_______ 10______ */
+#define AVA_UTF8_TOO_LONG       (1 << 1)
+/* 11100000 100_____ */
+#define AVA_UTF8_OVERLONG_3     (1 << 2)
+/* 11110100 1001____, 11110100 101_____, or 111101__ 1001____ and similar
+ * leads beyond F4 */
+#define AVA_UTF8_TOO_LARGE      (1 << 3)
+/* 11101101 101_____ */
+#define AVA_UTF8_SURROGATE      (1 << 4)
+/* 1100000_ 10______ */
+#define AVA_UTF8_OVERLONG_2     (1 << 5)
+/* 11110101 1000____ and similar leads beyond F4 */
+#define AVA_UTF8_TOO_LARGE_1000 (1 << 6)
+/* 11110000 1000____ (shares a bit with the above, since both only occur with
+ * a second byte of 1000____) */
+#define AVA_UTF8_OVERLONG_4     (1 << 6)
+/* 10______ 10______ */
+#define AVA_UTF8_TWO_CONTS      (1 << 7)
+#define AVA_UTF8_CARRY (AVA_UTF8_TOO_SHORT | AVA_UTF8_TOO_LONG |        \
+                        AVA_UTF8_TWO_CONTS)
+
+#define AVA_UTF8_TABLE(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p)                 \
+  _mm256_setr_epi8(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,                     \
+                   a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p)
+
+__attribute__((target("avx2")))
+static size_t ava_string_kernels_avx2_utf8_valid_prefix(
+  const char*restrict s, size_t n
+) {
+  const __m256i byte_1_high_table = AVA_UTF8_TABLE(
+    /* 0_______ ________ */
+    AVA_UTF8_TOO_LONG, AVA_UTF8_TOO_LONG, AVA_UTF8_TOO_LONG, AVA_UTF8_TOO_LONG,
+    AVA_UTF8_TOO_LONG, AVA_UTF8_TOO_LONG, AVA_UTF8_TOO_LONG, AVA_UTF8_TOO_LONG,
+    /* 10______ ________ */
+    AVA_UTF8_TWO_CONTS, AVA_UTF8_TWO_CONTS,
+    AVA_UTF8_TWO_CONTS, AVA_UTF8_TWO_CONTS,
+    /* 1100____ ________ */
+    AVA_UTF8_TOO_SHORT | AVA_UTF8_OVERLONG_2,
+    /* 1101____ ________ */
+    AVA_UTF8_TOO_SHORT,
+    /* 1110____ ________ */
+    AVA_UTF8_TOO_SHORT | AVA_UTF8_OVERLONG_3 | AVA_UTF8_SURROGATE,
+    /* 1111____ ________ */
+    AVA_UTF8_TOO_SHORT | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000 |
+    AVA_UTF8_OVERLONG_4);
+  const __m256i byte_1_low_table = AVA_UTF8_TABLE(
+    /* ____0000 ________ */
+    AVA_UTF8_CARRY | AVA_UTF8_OVERLONG_3 | AVA_UTF8_OVERLONG_2 |
+    AVA_UTF8_OVERLONG_4,
+    /* ____0001 ________ */
+    AVA_UTF8_CARRY | AVA_UTF8_OVERLONG_2,
+    /* ____001_ ________ */
+    AVA_UTF8_CARRY,
+    AVA_UTF8_CARRY,
+    /* ____0100 ________ */
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE,
+    /* ____0101 ________ through ____1100 ________ */
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    /* ____1101 ________ */
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000 |
+    AVA_UTF8_SURROGATE,
+    /* ____111_ ________ */
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000,
+    AVA_UTF8_CARRY | AVA_UTF8_TOO_LARGE | AVA_UTF8_TOO_LARGE_1000);
+  const __m256i byte_2_high_table = AVA_UTF8_TABLE(
+    /* ________ 0_______ */
+    AVA_UTF8_TOO_SHORT, AVA_UTF8_TOO_SHORT,
+    AVA_UTF8_TOO_SHORT, AVA_UTF8_TOO_SHORT,
+    AVA_UTF8_TOO_SHORT, AVA_UTF8_TOO_SHORT,
+    AVA_UTF8_TOO_SHORT, AVA_UTF8_TOO_SHORT,
+    /* ________ 1000____ */
+    AVA_UTF8_TOO_LONG | AVA_UTF8_OVERLONG_2 | AVA_UTF8_TWO_CONTS |
+    AVA_UTF8_OVERLONG_3 | AVA_UTF8_TOO_LARGE_1000 | AVA_UTF8_OVERLONG_4,
+    /* ________ 1001____ */
+    AVA_UTF8_TOO_LONG | AVA_UTF8_OVERLONG_2 | AVA_UTF8_TWO_CONTS |
+    AVA_UTF8_OVERLONG_3 | AVA_UTF8_TOO_LARGE,
+    /* ________ 101_____ */
+    AVA_UTF8_TOO_LONG | AVA_UTF8_OVERLONG_2 | AVA_UTF8_TWO_CONTS |
+    AVA_UTF8_SURROGATE | AVA_UTF8_TOO_LARGE,
+    AVA_UTF8_TOO_LONG | AVA_UTF8_OVERLONG_2 | AVA_UTF8_TWO_CONTS |
+    AVA_UTF8_SURROGATE | AVA_UTF8_TOO_LARGE,
+    /* ________ 11______ */
+    AVA_UTF8_TOO_SHORT, AVA_UTF8_TOO_SHORT,
+    AVA_UTF8_TOO_SHORT, AVA_UTF8_TOO_SHORT);
+  const __m256i nybble = _mm256_set1_epi8(0x0F);
+  const __m256i high_bit = _mm256_set1_epi8((char)0x80);
+  const __m256i third_byte_limit = _mm256_set1_epi8(0xE0 - 0x80);
+  const __m256i fourth_byte_limit = _mm256_set1_epi8(0xF0 - 0x80);
+  __m256i block, prev = _mm256_setzero_si256(), straddle;
+  __m256i prev1, prev2, prev3, special, must23, error;
+  size_t i, restart;
+
+  for (i = 0; i + 32 <= n; i += 32) {
+    block = _mm256_loadu_si256((const __m256i*)(s + i));
+
+    /* If this block and the one before are both pure ASCII, there is nothing
+     * to check.
+     */
+    if (!_mm256_movemask_epi8(_mm256_or_si256(block, prev))) {
+      prev = block;
+      continue;
+    }
+
+    /* prevN is the input shifted N bytes later, pulling in the end of the
+     * previous block.
+     */
+    straddle = _mm256_permute2x128_si256(prev, block, 0x21);
+    prev1 = _mm256_alignr_epi8(block, straddle, 16 - 1);
+    prev2 = _mm256_alignr_epi8(block, straddle, 16 - 2);
+    prev3 = _mm256_alignr_epi8(block, straddle, 16 - 3);
+
+    special = _mm256_and_si256(
+      _mm256_and_si256(
+        _mm256_shuffle_epi8(
+          byte_1_high_table,
+          _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nybble)),
+        _mm256_shuffle_epi8(
+          byte_1_low_table, _mm256_and_si256(prev1, nybble))),
+      _mm256_shuffle_epi8(
+        byte_2_high_table,
+        _mm256_and_si256(_mm256_srli_epi16(block, 4), nybble)));
+
+    /* Bytes two after a 111_____ or three after a 1111____ must be
+     * continuations, which is exactly when TWO_CONTS is expected.
+     */
+    must23 = _mm256_and_si256(
+      _mm256_or_si256(_mm256_subs_epu8(prev2, third_byte_limit),
+                      _mm256_subs_epu8(prev3, fourth_byte_limit)),
+      high_bit);
+    error = _mm256_xor_si256(must23, special);
+
+    if (!_mm256_testz_si256(error, error))
+      break;
+
+    prev = block;
+  }
+
+  _mm256_zeroupper();
+
+  /* Everything before the sequence in progress at i is known to be valid (a
+   * sequence left incomplete at the end of a block is only checked by the
+   * next one), so let the scalar implementation take it from there.
+   */
+  for (restart = i; restart > 0 && i - restart < 4; )
+    if (0x80 != (s[--restart] & 0xC0))
+      break;
+
+  return restart + ava_string_kernels_scalar_utf8_valid_prefix(
+    s + restart, n - restart);
+}
+
+__attribute__((target("avx2")))
+static size_t ava_string_kernels_avx2_utf8_count(
+  const char*restrict s, size_t n
+) {
+  __m256i limit = _mm256_set1_epi8(-65);
+  size_t i, count = 0;
+
+  for (i = 0; i + 32 <= n; i += 32)
+    count += __builtin_popcount(
+      _mm256_movemask_epi8(
+        _mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i*)(s + i)),
+                          limit)));
+
+  _mm256_zeroupper();
+  return count + ava_string_kernels_sse2_utf8_count(s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t ava_string_kernels_avx2_utf8_offset(
+  const char*restrict s, size_t n, size_t cp
+) {
+  __m256i limit = _mm256_set1_epi8(-65);
+  unsigned starts, count;
+  size_t i;
+
+  for (i = 0; i + 32 <= n; i += 32) {
+    starts = _mm256_movemask_epi8(
+      _mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i*)(s + i)), limit));
+    count = __builtin_popcount(starts);
+    if (cp < count) {
+      _mm256_zeroupper();
+      while (cp--)
+        starts &= starts - 1;
+      return i + __builtin_ctz(starts);
+    }
+
+    cp -= count;
+  }
+
+  _mm256_zeroupper();
+  return i + ava_string_kernels_sse2_utf8_offset(s + i, n - i, cp);
+}
+
+#endif /* AVA_HAVE_AVX2_KERNELS */
@@ -0,0 +1,175 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/alloc.h"
+#include "avalanche/string.h"
+
+/**
+ * Files smaller than this are simply read into an ordinary string, since a
+ * mapping costs at least a page plus a couple of system calls, and small
+ * files are usually read in their entirety anyway.
+ */
+#define AVA_MMAP_THRESH 65536
+
+#ifdef HAVE_SYS_MMAN_H
+static ava_string ava_string_map_fd(int fd, size_t length);
+#endif
+static ava_string ava_string_read_fd(int fd, size_t hint);
+
+ava_string ava_string_of_mmap(const char* path) {
+  struct stat st;
+  ava_string ret;
+  int fd, saved_errno;
+
+  do {
+    fd = open(path, O_RDONLY);
+  } while (-1 == fd && EINTR == errno);
+  if (-1 == fd) return AVA_ABSENT_STRING;
+
+  if (fstat(fd, &st)) goto error;
+
+#ifdef HAVE_SYS_MMAN_H
+  if (S_ISREG(st.st_mode) && st.st_size >= AVA_MMAP_THRESH &&
+      (ava_ulong)st.st_size < SIZE_MAX / 2)
+    ret = ava_string_map_fd(fd, st.st_size);
+  else
+#endif
+    ret = ava_string_read_fd(fd, S_ISREG(st.st_mode)? st.st_size : 0);
+
+  if (!ava_string_is_present(ret)) goto error;
+
+  close(fd);
+  return ret;
+
+  error:
+  saved_errno = errno;
+  close(fd);
+  errno = saved_errno;
+  return AVA_ABSENT_STRING;
+}
+
+#ifdef HAVE_SYS_MMAN_H
+/*
+ * A mapped string is a forced twine whose body points straight at the
+ * mapping, laid out like a static twine (see string.c): other is zero, so it
+ * has no hash slot, and the character data lies outside the heap.
+ *
+ * The mapping covers the file followed by at least one zero byte, rounded up
+ * to a whole number of pages; the tail of the file's last page is zero-filled
+ * by the system, and if there is no such tail an anonymous page provides the
+ * terminator. The data is thus NUL-terminated and padded like that of any
+ * other forced twine.
+ *
+ * Pointers into the mapping escape freely through ava_string_to_cstring()
+ * and friends (the lexer holds one for the whole file), and they cannot keep
+ * any GC object alive, so there is no point at which the mapping is known to
+ * be unused. It is therefore never released.
+ */
+static ava_string ava_string_map_fd(int fd, size_t length) {
+  ava_twine* twine;
+  size_t page_size, size;
+  void* base;
+  int saved_errno;
+
+  page_size = sysconf(_SC_PAGESIZE);
+  size = (length + page_size) / page_size * page_size;
+
+  /* Reserve the whole range, including the terminator, with zero pages, then
+   * put the file over the start of it.
+   */
+  base = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (MAP_FAILED == base) return AVA_ABSENT_STRING;
+
+  if (MAP_FAILED == mmap(base, length, PROT_READ,
+                         MAP_PRIVATE | MAP_FIXED, fd, 0)) {
+    saved_errno = errno;
+    munmap(base, size);
+    errno = saved_errno;
+    return AVA_ABSENT_STRING;
+  }
+
+  twine = ava_alloc_atomic(sizeof(ava_twine));
+  twine->body = base;
+  twine->length = length;
+  twine->tail.overhead = 0;
+  twine->tail.other.offset = 0;
+
+  return (ava_string) { .twine = twine };
+}
+#endif
+
+static ava_string ava_string_read_fd(int fd, size_t hint) {
+  char* buffer;
+  size_t capacity, length;
+  ssize_t nread;
+  ava_string ret;
+  int saved_errno;
+
+  /* hint is only the size at the time of the stat; read one more byte than
+   * that so that the loop finds EOF without needing to grow the buffer.
+   */
+  capacity = hint + 1 > 4096? hint + 1 : 4096;
+  buffer = malloc(capacity);
+  if (!buffer) return AVA_ABSENT_STRING;
+
+  length = 0;
+  for (;;) {
+    if (length == capacity) {
+      char* grown = realloc(buffer, capacity * 2);
+      if (!grown) {
+        free(buffer);
+        errno = ENOMEM;
+        return AVA_ABSENT_STRING;
+      }
+      buffer = grown;
+      capacity *= 2;
+    }
+
+    nread = read(fd, buffer + length, capacity - length);
+    if (0 == nread) break;
+    if (-1 == nread) {
+      if (EINTR == errno) continue;
+
+      saved_errno = errno;
+      free(buffer);
+      errno = saved_errno;
+      return AVA_ABSENT_STRING;
+    }
+
+    length += nread;
+  }
+
+  ret = ava_string_of_bytes(buffer, length);
+  free(buffer);
+  return ret;
+}
@@ -0,0 +1,239 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic_ops.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "avalanche/defs.h"
+#include "avalanche/string.h"
+#include "-string.h"
+#include "-string-kernels.h"
+
+/*
+
+  UTF-8 queries are answered one rope leaf at a time (see
+  ava_string_next_chunk()), running the string kernels over each leaf's flat
+  character data. What is learnt about a leaf is cached in its properties
+  slot (see -string.h), so repeated queries on the same string, or on
+  different ropes sharing leaves, never rescan a leaf.
+
+  The properties word is zero until computed; otherwise it holds the
+  AVA_UTF8_PROPS_* flags below and the number of code points in the leaf.
+  Like the hash slot, it is published with a plain atomic store, since
+  racing writers always compute the same value.
+
+  A leaf being invalid by itself does not make the whole string invalid,
+  since a sequence may straddle two leaves. Validation therefore falls back
+  to a detailed scan of any leaf which is not valid alone, carrying an
+  incomplete trailing sequence over into the next leaf.
+
+ */
+
+#define AVA_UTF8_PROPS_KNOWN ((AO_t)1)
+#define AVA_UTF8_PROPS_ASCII ((AO_t)2)
+#define AVA_UTF8_PROPS_VALID ((AO_t)4)
+#define AVA_UTF8_PROPS_COUNT_SHIFT 3
+
+/**
+ * A rope leaf and what is known about it.
+ */
+typedef struct {
+  /**
+   * The flat character data of the leaf.
+   */
+  const char* data;
+  /**
+   * The length of data, in bytes.
+   */
+  size_t length;
+  /**
+   * The properties word of the leaf, as described above.
+   */
+  AO_t props;
+} ava_utf8_leaf;
+
+/**
+ * Reads the next leaf of str into *leaf, advancing *offset past it.
+ *
+ * *offset must be on a leaf boundary (as it is if it starts at zero and is
+ * only advanced by this function).
+ *
+ * @return Whether there was another leaf.
+ */
+static ava_bool ava_utf8_next_leaf(ava_utf8_leaf*restrict leaf,
+                                   ava_str_tmpbuff tmp,
+                                   ava_string str, size_t*restrict offset);
+
+/**
+ * Computes the properties word for the given character data.
+ */
+static AO_t ava_utf8_compute_props(const char*restrict data, size_t length);
+
+/**
+ * Returns the length of the sequence introduced by the given lead byte, or 0
+ * if it cannot begin a well-formed sequence.
+ */
+static unsigned ava_utf8_lead_length(unsigned char lead);
+
+static ava_bool ava_utf8_next_leaf(ava_utf8_leaf*restrict leaf,
+                                   ava_str_tmpbuff tmp,
+                                   ava_string str, size_t*restrict offset) {
+  ava_string chunk;
+  AO_t*restrict hash_slot, *restrict props_slot;
+
+  chunk = ava_string_next_chunk(str, offset);
+  if (!ava_string_is_present(chunk)) return ava_false;
+
+  leaf->length = ava_strlen(chunk);
+  leaf->data = ava_string_to_cstring_hash_slot(tmp, chunk, &hash_slot);
+  if (ava_string_is_ascii9(chunk)) {
+    leaf->props = AVA_UTF8_PROPS_KNOWN | AVA_UTF8_PROPS_ASCII |
+      AVA_UTF8_PROPS_VALID | leaf->length << AVA_UTF8_PROPS_COUNT_SHIFT;
+  } else if (!hash_slot) {
+    leaf->props = ava_utf8_compute_props(leaf->data, leaf->length);
+  } else {
+    props_slot = ava_string_props_slot(leaf->data, leaf->length);
+    leaf->props = AO_load(props_slot);
+    if (!leaf->props) {
+      leaf->props = ava_utf8_compute_props(leaf->data, leaf->length);
+      AO_store(props_slot, leaf->props);
+    }
+  }
+
+  return ava_true;
+}
+
+static AO_t ava_utf8_compute_props(const char*restrict data, size_t length) {
+  const ava_string_kernels* kernels = ava_string_kernels_get();
+
+  if (length == kernels->ascii_prefix(data, length))
+    return AVA_UTF8_PROPS_KNOWN | AVA_UTF8_PROPS_ASCII |
+      AVA_UTF8_PROPS_VALID | length << AVA_UTF8_PROPS_COUNT_SHIFT;
+
+  return AVA_UTF8_PROPS_KNOWN |
+    (length == kernels->utf8_valid_prefix(data, length)?
+     AVA_UTF8_PROPS_VALID : 0) |
+    kernels->utf8_count(data, length) << AVA_UTF8_PROPS_COUNT_SHIFT;
+}
+
+static unsigned ava_utf8_lead_length(unsigned char lead) {
+  if (lead < 0x80) return 1;
+  if (lead < 0xC2) return 0;
+  if (lead < 0xE0) return 2;
+  if (lead < 0xF0) return 3;
+  if (lead < 0xF5) return 4;
+  return 0;
+}
+
+ava_bool ava_string_is_ascii(ava_string str) {
+  ava_str_tmpbuff tmp;
+  ava_utf8_leaf leaf;
+  size_t offset = 0;
+
+  while (ava_utf8_next_leaf(&leaf, tmp, str, &offset))
+    if (!(leaf.props & AVA_UTF8_PROPS_ASCII))
+      return ava_false;
+
+  return ava_true;
+}
+
+ava_bool ava_string_is_utf8(ava_string str) {
+  const ava_string_kernels* kernels = ava_string_kernels_get();
+  ava_str_tmpbuff tmp;
+  ava_utf8_leaf leaf;
+  size_t offset = 0, i, valid, needed;
+  /* An incomplete sequence carried over from the end of the previous leaf */
+  char carry[4];
+  size_t carry_length = 0, carry_needed = 0;
+
+  while (ava_utf8_next_leaf(&leaf, tmp, str, &offset)) {
+    if (!carry_length && (leaf.props & AVA_UTF8_PROPS_VALID))
+      continue;
+
+    i = 0;
+    if (carry_length) {
+      needed = carry_needed - carry_length;
+      if (needed > leaf.length) needed = leaf.length;
+      memcpy(carry + carry_length, leaf.data, needed);
+      carry_length += needed;
+      i = needed;
+
+      if (carry_length < carry_needed)
+        continue;
+
+      if (carry_needed != kernels->utf8_valid_prefix(carry, carry_needed))
+        return ava_false;
+
+      carry_length = 0;
+    }
+
+    valid = i + kernels->utf8_valid_prefix(leaf.data + i, leaf.length - i);
+    if (valid == leaf.length)
+      continue;
+
+    /* The only error that might not really be one is a sequence truncated by
+     * the end of the leaf; whether the bytes present are correct is checked
+     * once it is complete.
+     */
+    carry_needed = ava_utf8_lead_length(leaf.data[valid]);
+    if (carry_needed <= leaf.length - valid)
+      return ava_false;
+
+    carry_length = leaf.length - valid;
+    memcpy(carry, leaf.data + valid, carry_length);
+  }
+
+  return !carry_length;
+}
+
+size_t ava_string_utf8_length(ava_string str) {
+  ava_str_tmpbuff tmp;
+  ava_utf8_leaf leaf;
+  size_t offset = 0, count = 0;
+
+  while (ava_utf8_next_leaf(&leaf, tmp, str, &offset))
+    count += leaf.props >> AVA_UTF8_PROPS_COUNT_SHIFT;
+
+  return count;
+}
+
+ssize_t ava_string_utf8_offset(ava_string str, size_t cp) {
+  ava_str_tmpbuff tmp;
+  ava_utf8_leaf leaf;
+  size_t offset = 0, base, count;
+
+  for (base = 0; ava_utf8_next_leaf(&leaf, tmp, str, &offset);
+       base += leaf.length) {
+    count = leaf.props >> AVA_UTF8_PROPS_COUNT_SHIFT;
+    if (cp < count) {
+      if (leaf.props & AVA_UTF8_PROPS_ASCII)
+        return base + cp;
+      else
+        return base + ava_string_kernels_get()->utf8_offset(
+          leaf.data, leaf.length, cp);
+    }
+
+    cp -= count;
+  }
+
+  return cp? -1 : (ssize_t)base;
+}
@@ -31,6 +31,8 @@
 #define AVA__INTERNAL_INCLUDE 1
 #include "avalanche/alloc.h"
 #include "avalanche/string.h"
+#include "-string.h"
+#include "-string-kernels.h"
 
 /*
 
@@ -75,32 +77,133 @@
   - Forced. body is a const char* pointing to string data returnable from
     ava_string_to_cstring(). other is undefined. Forced is the only node type
     to which nodes can be mutated; in such cases, the other field is explicitly
-    cleared to release whatever memory it may hold. overhead is also undefined
-    for forced nodes, though it is never changed once set.
+    overwritten to release whatever memory it may hold. overhead is also
+    undefined for forced nodes, though it is never changed once set.
+
+  Forced nodes on the heap carry a hash slot: one word, initially zero, which
+  caches ava_value_hash() of the string so that long keys are only hashed once
+  no matter how many maps they are put into. The slot always immediately
+  precedes the character data. Twines allocated already forced store their
+  characters in other, so the slot is overhead; twines forced later allocate
+  the slot at the front of the new character buffer, and set other to 1 to
+  record that it exists. Static twines (from AVA_STATIC_STRING() or the code
+  generator) have neither property, since their other is always zero and their
+  character data lies outside the node; they have no slot, which is just as
+  well since they are usually in read-only memory. Large files read by
+  ava_string_of_mmap() (see string-mmap.c) are laid out the same way, with
+  their character data in a read-only mapping. Conversely, a forced node whose
+  other is zero despite having been forced (eg, a slice at offset 0 read while
+  another thread is forcing it) merely fails to use its slot.
+
+  Every node with a hash slot also has a properties slot, another zeroed word
+  following the padding after the character data, in which string-utf8.c
+  caches whether the string is ASCII or valid UTF-8 and how many code points
+  it contains.
+
+  Interned strings (see string-intern.c) are forced nodes allocated with the
+  layout of ava_interned_twine: other points to the node itself and the
+  character data follows the hash slot after the node. No other node can
+  point to itself, so this identifies them cheaply. Provided the collector
+  supports long weak links (see ava_weak_ref_set()), there is only ever one
+  live interned string with any given content, so two interned strings are
+  equal if and only if they are the same node. With only short links, the
+  table entry for a string that is reachable only from a finaliser can be
+  cleared while the string survives, and the same content then interned
+  again, so ava_string_equal() does not rely on this.
 
   - Concat. body is an ava_twine*, other is an ava_string. The forced string is
     composed of all the characters of body followed by all the characters of
     other.
 
   - Tacnoc. Essentially a concat in reverse order, for the case where the left
-    string is an ASCII9 string (which cannot be stored in body due to alignment
-    restrictions). body is an ava_twine*, other is an ASCII9 ava_string. The
-    forced string is composed of all the characters of other followed by all
-    the characters of body.
+    string is an inline (ASCII9 or BIN7) string (which cannot be stored in body
+    due to alignment restrictions). body is an ava_twine*, other is an inline
+    ava_string. The forced string is composed of all the characters of other
+    followed by all the characters of body.
 
   - Slice. body is an ava_twine*, other is a size_t offset. The forced string
     is the first length characters of body, starting from the offsetth
     character.
 
+  - Rope. Like concat, except that other is always a twine, and the node is
+    part of a balanced rope (see below). The node is physically an ava_rope,
+    which additionally records the height of the subtree.
+
+  Ropes
+
+  Forcing on read works well for strings that are built and then read as a
+  whole, but not for very large strings which are extended incrementally and
+  read at random in between: every read of a new version flattens the whole
+  string again. Once a concatenation produces a string of at least
+  AVA_ROPE_THRESH characters (or involves a rope already), it instead produces
+  a rope node, and these are handled quite differently.
+
+  - Ropes are never forced on construction, regardless of overhead. Instead,
+    overhead is kept proportional to length by coalescing adjacent small
+    leaves (any non-rope string is a leaf) into flat leaves of up to
+    AVA_ROPE_LEAF_SIZE characters.
+
+  - Ropes are kept height-balanced in the manner of an AVL tree, with the join
+    operation rebalancing the spine it descends. Since every node knows the
+    length of its left child, locating a character takes O(log(n)) time.
+
+  - Indexing, slicing, and chunk iteration descend through the rope nodes
+    rather than forcing the root. Slicing a rope produces a new rope sharing
+    the untouched subtrees. Leaves are still forced on read as usual; this is
+    bounded by the size of the leaf rather than the string.
+
+  - ava_string_to_cstring() and friends force the rope as with any other
+    node, at which point it becomes an ordinary flat string.
+
  */
 
 typedef enum {
   ava_tt_forced = 0,
   ava_tt_concat,
   ava_tt_tacnoc,
-  ava_tt_slice
+  ava_tt_slice,
+  ava_tt_rope
 } ava_twine_tag;
 
+/**
+ * The minimum length, in characters, of a concatenation for it to produce a
+ * rope.
+ */
+#define AVA_ROPE_THRESH 1024
+/**
+ * The maximum size of a leaf produced by coalescing smaller leaves in a rope.
+ */
+#define AVA_ROPE_LEAF_SIZE 256
+
+/**
+ * The physical representation of an ava_tt_rope twine node.
+ */
+typedef struct {
+  ava_twine twine;
+  /**
+   * The height of this node; ie, 1 + the greater of the heights of its
+   * children, with non-rope children having height 0.
+   *
+   * Once the node has been forced, this is meaningless, and the node is
+   * treated as a leaf of height 0.
+   */
+  unsigned height;
+} ava_rope;
+
+/**
+ * A consistent snapshot of a possible rope node.
+ */
+typedef struct {
+  /**
+   * The children of the rope. Only meaningful if the node is a rope.
+   */
+  ava_string left, right;
+  /**
+   * The height of the node, or 0 if it is not a rope.
+   */
+  unsigned height;
+} ava_rope_view;
+
 static void assert_aligned(const void* ptr) {
   assert(0 == (size_t)ptr % AVA_STRING_ALIGNMENT);
 }
@@ -115,12 +218,27 @@ static ava_ascii9_string ava_ascii9_concat(ava_ascii9_string,
 static ava_ascii9_string ava_ascii9_slice(ava_ascii9_string, size_t, size_t);
 static ava_bool ava_ascii9_starts_with(ava_ascii9_string big,
                                        ava_ascii9_string small);
+static ava_bin7_string ava_bin7_encode(const char*, size_t);
+static void ava_bin7_decode(ava_ulong*restrict dst, ava_bin7_string);
+static size_t ava_bin7_length(ava_bin7_string);
+static char ava_bin7_index(ava_bin7_string, size_t);
+static ava_bin7_string ava_bin7_concat(ava_bin7_string, ava_bin7_string);
+/**
+ * Decodes the given inline (ASCII9 or BIN7) string into dst as a
+ * NUL-terminated C string.
+ */
+static void ava_inline_decode(ava_ulong*restrict dst, ava_string str);
+/**
+ * Returns the length of the given inline (ASCII9 or BIN7) string.
+ */
+static size_t ava_inline_length(ava_string str);
 
 /**
  * Allocates a flat, forced twine with space for the given number of
  * characters.
  *
- * The character data begins at &twine->tail. Padding is zeroed.
+ * The character data begins at &twine->tail.other and is preceded by the
+ * zeroed hash slot. Padding is zeroed.
  */
 static ava_twine* ava_twine_alloc(size_t capacity);
 /**
@@ -157,6 +275,66 @@ static inline ava_twine_tag ava_twine_get_tag(const void* body);
 static inline void* ava_twine_get_body_ptr(const void* body);
 static const void* ava_twine_pack_body(ava_twine_tag tag,
                                        const void* body_ptr);
+/**
+ * Reads the tag, body pointer, and other field of the given twine such that
+ * they are consistent with each other even if the twine is being forced
+ * concurrently.
+ */
+static inline ava_twine_tag ava_twine_read(
+  const ava_twine*restrict twine,
+  const void** body, ava_twine_tail_other* other);
+
+/**
+ * Returns whether the given string is currently a rope node.
+ */
+static ava_bool ava_string_is_rope(ava_string str);
+/**
+ * Populates dst with a snapshot of the given string as a rope node.
+ *
+ * @return Whether str was a rope node. If false, dst->height is 0 and the
+ * other fields are undefined.
+ */
+static ava_bool ava_rope_view_of(ava_rope_view*restrict dst, ava_string str);
+/**
+ * Returns the height of the given string considered as a rope.
+ */
+static unsigned ava_rope_height(ava_string str);
+/**
+ * Concatenates the two strings as a balanced rope.
+ */
+static ava_string ava_rope_join(ava_string left, ava_string right);
+/**
+ * Constructs a single rope node with the given children, which must be
+ * non-empty.
+ *
+ * ASCII9 children are converted to flat twines.
+ */
+static ava_string ava_rope_node(ava_string left, ava_string right);
+/**
+ * Constructs a rope node with the given children, whose heights may differ by
+ * at most 2, performing a rotation if needed to restore balance.
+ */
+static ava_string ava_rope_balance(ava_string left, ava_string right);
+/**
+ * Returns a flat string containing the characters of the two given non-rope
+ * strings.
+ */
+static ava_string ava_rope_coalesce(ava_string left, ava_string right);
+/**
+ * Slices the given string, sharing subtrees if it is a rope.
+ */
+static ava_string ava_rope_slice(ava_string str, size_t begin, size_t end);
+/**
+ * Descends rope nodes from *str until reaching the leaf containing the
+ * character at *ix, updating both to refer to that leaf.
+ */
+static void ava_rope_locate(ava_string*restrict str, size_t*restrict ix);
+/**
+ * Copies the given range of characters of str into dst without memoising any
+ * forcing.
+ */
+static void ava_string_copy_out(char*restrict dst, ava_string str,
+                                size_t offset, size_t count);
 
 static ava_bool ava_string_can_encode_ascii9(const char* str,
                                              size_t sz) {
@@ -187,6 +365,16 @@ static ava_ascii9_string ava_ascii9_encode(
   return accum;
 }
 
+static ava_bin7_string ava_bin7_encode(const char* str, size_t sz) {
+  ava_bin7_string accum = 2 | (sz << 2);
+  unsigned i;
+
+  for (i = 0; i < sz; ++i)
+    accum |= ((ava_bin7_string)(unsigned char)str[i]) << (8 + 8*i);
+
+  return accum;
+}
+
 ava_string ava_string_of_cstring(const char* str) {
   return ava_string_of_bytes(str, strlen(str));
 }
@@ -204,14 +392,17 @@ static ava_twine* ava_twine_alloc(size_t sz) {
   padded_sz = (sz + sizeof(ava_ulong)) /
     sizeof(ava_ulong) * sizeof(ava_ulong);
 
-  twine = ava_alloc_atomic(offsetof(ava_twine, tail) + padded_sz);
-  dst = (char*)&twine->tail;
+  twine = ava_alloc_atomic(offsetof(ava_twine, tail.other) + padded_sz +
+                           sizeof(AO_t));
+  dst = (char*)&twine->tail.other;
   assert_aligned(dst);
 
   twine->body = dst;
   twine->length = sz;
+  twine->tail.overhead = 0;
 
-  memset(dst + sz, 0, padded_sz - sz);
+  /* Zero the padding and the properties slot */
+  memset(dst + sz, 0, padded_sz - sz + sizeof(AO_t));
   return twine;
 }
 
@@ -222,6 +413,8 @@ ava_string ava_string_of_bytes(const char* str, size_t sz) {
 
   if (ava_string_can_encode_ascii9(str, sz)) {
     ret.ascii9 = ava_ascii9_encode(str, sz);
+  } else if (sz <= 7) {
+    ret.ascii9 = ava_bin7_encode(str, sz);
   } else {
     twine = ava_twine_alloc(sz);
     dst = (char*)twine->body;
@@ -235,10 +428,35 @@ ava_string ava_string_of_bytes(const char* str, size_t sz) {
   return ret;
 }
 
+ava_string ava_interned_string_new(const char* data, size_t sz,
+                                   ava_ulong hash) {
+  ava_interned_twine* interned;
+  char* dst;
+  size_t padded_sz;
+
+  padded_sz = (sz + sizeof(ava_ulong)) /
+    sizeof(ava_ulong) * sizeof(ava_ulong);
+
+  interned = ava_alloc_atomic(sizeof(ava_interned_twine) + padded_sz +
+                              sizeof(AO_t));
+  dst = (char*)(interned + 1);
+  assert_aligned(dst);
+
+  interned->twine.body = dst;
+  interned->twine.length = sz;
+  interned->twine.tail.overhead = 0;
+  interned->twine.tail.other.string.twine = &interned->twine;
+  interned->hash = hash;
+
+  memcpy(dst, data, sz);
+  memset(dst + sz, 0, padded_sz - sz + sizeof(AO_t));
+  return (ava_string) { .twine = &interned->twine };
+}
+
 const char* ava_string_to_cstring(ava_string str) {
-  if (ava_string_is_ascii9(str)) {
+  if (ava_string_is_inline(str)) {
     ava_ulong* dst = ava_alloc_atomic(2 * sizeof(ava_ulong));
-    ava_ascii9_decode(dst, str.ascii9);
+    ava_inline_decode(dst, str);
     return (char*)dst;
   } else {
     return ava_twine_force(str.twine);
@@ -247,14 +465,39 @@ const char* ava_string_to_cstring(ava_string str) {
 
 const char* ava_string_to_cstring_buff(ava_str_tmpbuff buff,
                                        ava_string str) {
-  if (ava_string_is_ascii9(str)) {
-    ava_ascii9_decode(buff, str.ascii9);
+  if (ava_string_is_inline(str)) {
+    ava_inline_decode(buff, str);
     return (const char*)buff;
   } else {
     return ava_twine_force(str.twine);
   }
 }
 
+const char* ava_string_to_cstring_hash_slot(
+  ava_str_tmpbuff buff, ava_string str, AO_t*restrict* slot
+) {
+  const char* data;
+
+  if (ava_string_is_inline(str)) {
+    *slot = NULL;
+    ava_inline_decode(buff, str);
+    return (const char*)buff;
+  }
+
+  data = ava_twine_force(str.twine);
+  /* The twine is now forced, so other is either the initial zero of a static
+   * twine, the marker left by ava_twine_force(), or a stale value from before
+   * forcing; see "Forced" in the design notes above.
+   */
+  if ((const void*)data == (const void*)&str.twine->tail.other ||
+      str.twine->tail.other.offset)
+    *slot = ((AO_t*)data) - 1;
+  else
+    *slot = NULL;
+
+  return data;
+}
+
 static void ava_ascii9_decode(ava_ulong*restrict dst, ava_ascii9_string s) {
   ava_ulong w0, w1, c0, c1, c2, c3, c4, c5, c6, c7, c8;
 
@@ -303,14 +546,42 @@ static void ava_ascii9_decode(ava_ulong*restrict dst, ava_ascii9_string s) {
   dst[1] = w1;
 }
 
+static void ava_bin7_decode(ava_ulong*restrict dst, ava_bin7_string s) {
+#if WORDS_BIGENDIAN
+  ava_ulong w = 0;
+  unsigned i;
+
+  for (i = 0; i < 7; ++i)
+    w |= ((s >> (8 + 8*i)) & 0xFF) << (56 - 8*i);
+
+  dst[0] = w;
+#else
+  /* The bytes are already in memory order; just drop the header byte, which
+   * leaves the eighth byte as the terminating NUL.
+   */
+  dst[0] = s >> 8;
+#endif
+  dst[1] = 0;
+}
+
+static void ava_inline_decode(ava_ulong*restrict dst, ava_string str) {
+  if (ava_string_is_ascii9(str))
+    ava_ascii9_decode(dst, str.ascii9);
+  else
+    ava_bin7_decode(dst, str.ascii9);
+}
+
 void ava_string_to_bytes(void*restrict dst, ava_string str,
                          size_t start, size_t end) {
   ava_str_tmpbuff a9buf;
   const void*restrict src;
 
-  if (ava_string_is_ascii9(str)) {
-    ava_ascii9_decode(a9buf, str.ascii9);
+  if (ava_string_is_inline(str)) {
+    ava_inline_decode(a9buf, str);
     src = a9buf;
+  } else if (ava_string_is_rope(str)) {
+    ava_twine_force_into(dst, str.twine, start, end - start);
+    return;
   } else {
     src = ava_twine_force(str.twine);
   }
@@ -355,9 +626,22 @@ static size_t ava_ascii9_length(ava_ascii9_string s) {
 #endif /* defined(__GNUC__) && defined(__SSE4_2__) */
 }
 
+static size_t ava_bin7_length(ava_bin7_string s) {
+  return (s >> 2) & 7;
+}
+
+static size_t ava_inline_length(ava_string str) {
+  if (ava_string_is_ascii9(str))
+    return ava_ascii9_length(str.ascii9);
+  else
+    return ava_bin7_length(str.ascii9);
+}
+
 size_t ava_strlen(ava_string str) {
   if (str.ascii9 & 1) {
     return ava_ascii9_length(str.ascii9);
+  } else if (str.ascii9 & 2) {
+    return ava_bin7_length(str.ascii9);
   } else {
     return str.twine->length;
   }
@@ -367,9 +651,17 @@ static char ava_ascii9_index(ava_ascii9_string str, size_t ix) {
   return (str >> (1 + (8 - ix)*7)) & 0x7F;
 }
 
+static char ava_bin7_index(ava_bin7_string str, size_t ix) {
+  return (str >> (8 + 8*ix)) & 0xFF;
+}
+
 char ava_string_index(ava_string str, size_t ix) {
+  ava_rope_locate(&str, &ix);
+
   if (ava_string_is_ascii9(str)) {
     return ava_ascii9_index(str.ascii9, ix);
+  } else if (ava_string_is_bin7(str)) {
+    return ava_bin7_index(str.ascii9, ix);
   } else {
     return ava_twine_force(str.twine)[ix];
   }
@@ -381,6 +673,13 @@ static ava_ascii9_string ava_ascii9_concat(
   return a | (b >> 7 * ava_ascii9_length(a));
 }
 
+static ava_bin7_string ava_bin7_concat(ava_bin7_string a, ava_bin7_string b) {
+  /* The lengths occupy the same bits in both, and their sum is at most 7, so
+   * adding the headers sums the lengths without carrying out of the field.
+   */
+  return (a + (b & 0xFF) - 2) | ((b >> 8) << (8 + 8 * ava_bin7_length(a)));
+}
+
 ava_string ava_strcat(ava_string a, ava_string b) {
   size_t alen, blen;
   ava_string ret;
@@ -399,18 +698,43 @@ ava_string ava_strcat(ava_string a, ava_string b) {
   if (0 == alen) return b;
   if (0 == blen) return a;
 
+  /* Short concatenations involving BIN7 strings remain inline. A BIN7 string
+   * concatenated with anything cannot be ASCII9, so two BIN7 strings can be
+   * combined directly; mixing in an ASCII9 string needs to go through the
+   * bytes, and may end up as a flat twine.
+   */
+  if (ava_string_is_bin7(a) && ava_string_is_bin7(b) && alen + blen <= 7)
+    return (ava_string) { .ascii9 = ava_bin7_concat(a.ascii9, b.ascii9) };
+
+  if (ava_string_is_inline(a) && ava_string_is_inline(b) &&
+      alen + blen <= 9) {
+    ava_str_tmpbuff atmp, btmp;
+    char cat[18];
+
+    ava_inline_decode(atmp, a);
+    ava_inline_decode(btmp, b);
+    memcpy(cat, atmp, alen);
+    memcpy(cat + alen, btmp, blen);
+    return ava_string_of_bytes(cat, alen + blen);
+  }
+
+  if (alen + blen >= AVA_ROPE_THRESH ||
+      ava_string_is_rope(a) || ava_string_is_rope(b))
+    return ava_rope_join(a, b);
+
   ret.ascii9 = 0;
 
-  if (ava_string_is_ascii9(a) && ava_string_is_ascii9(b)) {
+  if (ava_string_is_inline(a) && ava_string_is_inline(b)) {
     ava_twine*restrict twine = ava_twine_alloc(alen + blen);
-    char*restrict dst = (char*)&twine->tail;
-    ava_str_tmpbuff second;
+    char*restrict dst = (char*)twine->body;
+    ava_str_tmpbuff first, second;
 
-    ava_ascii9_decode((ava_ulong*)dst, a.ascii9);
-    ava_ascii9_decode(second, b.ascii9);
+    ava_inline_decode(first, a);
+    ava_inline_decode(second, b);
+    memcpy(dst, first, alen);
     memcpy(dst + alen, second, blen);
     ret.twine = twine;
-  } else if (ava_string_is_ascii9(a)) {
+  } else if (ava_string_is_inline(a)) {
     ava_twine twine;
 
     twine.body = ava_twine_pack_body(ava_tt_tacnoc, b.twine);
@@ -424,7 +748,7 @@ ava_string ava_strcat(ava_string a, ava_string b) {
     twine.body = ava_twine_pack_body(ava_tt_concat, a.twine);
     twine.length = alen + blen;
     twine.tail.overhead = sizeof(ava_twine) + ava_twine_get_overhead(a.twine);
-    if (!ava_string_is_ascii9(b))
+    if (!ava_string_is_inline(b))
       twine.tail.overhead += ava_twine_get_overhead(b.twine);
     twine.tail.other.string = b;
     ret.twine = ava_twine_maybe_force(&twine);
@@ -433,6 +757,110 @@ ava_string ava_strcat(ava_string a, ava_string b) {
   return ret;
 }
 
+/**
+ * The minimum non-zero capacity of a string builder.
+ */
+#define AVA_STRING_BUILDER_MIN_CAPACITY 64
+
+/**
+ * Ensures that the given builder has space for at least sz more characters.
+ *
+ * The builder's buffer is always the character data of a fresh forced twine
+ * (as from ava_twine_alloc()), with space for the terminating NUL and padding
+ * beyond capacity, so that ava_string_builder_finish() can simply adopt it.
+ */
+static void ava_string_builder_reserve(ava_string_builder*restrict builder,
+                                       size_t sz);
+
+void ava_string_builder_init(ava_string_builder*restrict builder,
+                             size_t capacity) {
+  builder->buffer = NULL;
+  builder->length = 0;
+  builder->capacity = 0;
+
+  if (capacity)
+    ava_string_builder_reserve(builder, capacity);
+}
+
+static void ava_string_builder_reserve(ava_string_builder*restrict builder,
+                                       size_t sz) {
+  ava_twine*restrict twine;
+  size_t capacity;
+
+  if (AVA_LIKELY(builder->capacity - builder->length >= sz))
+    return;
+
+  capacity = builder->capacity? builder->capacity * 2 :
+    AVA_STRING_BUILDER_MIN_CAPACITY;
+  if (capacity < builder->length + sz)
+    capacity = builder->length + sz;
+
+  twine = ava_twine_alloc(capacity);
+  memcpy((char*)twine->body, builder->buffer, builder->length);
+
+  builder->buffer = (char*)twine->body;
+  builder->capacity = capacity;
+}
+
+void ava_string_builder_append_bytes(ava_string_builder*restrict builder,
+                                     const void*restrict data, size_t sz) {
+  ava_string_builder_reserve(builder, sz);
+  memcpy(builder->buffer + builder->length, data, sz);
+  builder->length += sz;
+}
+
+void ava_string_builder_append_string(ava_string_builder*restrict builder,
+                                      ava_string str) {
+  size_t sz = ava_strlen(str);
+
+  ava_string_builder_reserve(builder, sz);
+  ava_string_to_bytes(builder->buffer + builder->length, str, 0, sz);
+  builder->length += sz;
+}
+
+void ava_string_builder_append_integer(ava_string_builder*restrict builder,
+                                       ava_slong i) {
+  char digits[24], *p = digits + sizeof(digits);
+  /* Negate in unsigned arithmetic so that INT64_MIN works */
+  ava_ulong u = i < 0? -(ava_ulong)i : (ava_ulong)i;
+
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+
+  if (i < 0)
+    *--p = '-';
+
+  ava_string_builder_append_bytes(builder, p, digits + sizeof(digits) - p);
+}
+
+ava_string ava_string_builder_finish(ava_string_builder*restrict builder) {
+  ava_twine*restrict twine;
+  ava_string ret;
+  size_t length = builder->length;
+
+  /* Copy out if the result is small enough for ASCII9 or would waste more
+   * than a quarter of the buffer.
+   */
+  if (length <= 9 || length < builder->capacity - builder->capacity / 4) {
+    ret = ava_string_of_bytes(builder->buffer, length);
+  } else {
+    twine = (ava_twine*)(builder->buffer - offsetof(ava_twine, tail.other));
+    twine->length = length;
+    /* Zero the padding and the properties slot, both of which may have moved
+     * into what was the unused part of the buffer.
+     */
+    memset(builder->buffer + length, 0,
+           (length + sizeof(ava_ulong)) / sizeof(ava_ulong) *
+           sizeof(ava_ulong) - length + sizeof(AO_t));
+    ret.twine = twine;
+  }
+
+  ava_string_builder_init(builder, 0);
+  return ret;
+}
+
 static ava_ascii9_string ava_ascii9_slice(ava_ascii9_string str,
                                           size_t begin, size_t end) {
   str <<= 7 * begin;
@@ -453,9 +881,30 @@ ava_string ava_string_slice(ava_string str, size_t begin, size_t end) {
   if (0 == begin && ava_strlen(str) == end)
     return str;
 
-  /* Convert to an ASCII9 string if possible */
+  /* Convert to an inline string if possible. (Slices of BIN7 strings also go
+   * through here, since the result could be ASCII9.)
+   */
   if (end - begin <= 9) {
-    return ava_string_of_bytes(ava_twine_force(str.twine) + begin, end - begin);
+    char tmp[9];
+
+    ava_string_copy_out(tmp, str, begin, end - begin);
+    return ava_string_of_bytes(tmp, end - begin);
+  }
+
+  if (ava_string_is_rope(str)) {
+    /* Small slices of ropes are better off flat; larger ones share
+     * structure with the original.
+     */
+    if (end - begin <= AVA_ROPE_LEAF_SIZE) {
+      ava_twine*restrict flat = ava_twine_alloc(end - begin);
+      ava_twine_force_into((char*)flat->body, str.twine,
+                           begin, end - begin);
+      ret.ascii9 = 0;
+      ret.twine = flat;
+      return ret;
+    }
+
+    return ava_rope_slice(str, begin, end);
   }
 
   twine.body = ava_twine_pack_body(ava_tt_slice, str.twine);
@@ -494,20 +943,23 @@ ava_string ava_string_behead(ava_string str, size_t begin) {
 signed ava_strcmp(ava_string a, ava_string b) {
   ava_str_tmpbuff atmp, btmp;
   const char*restrict ac, *restrict bc;
-  size_t n, alen, blen;
-  signed cmp;
+  size_t n, alen, blen, mismatch;
 
   if (ava_string_is_ascii9(a) && ava_string_is_ascii9(b))
     return (a.ascii9 > b.ascii9) - (a.ascii9 < b.ascii9);
 
+  if (a.twine == b.twine)
+    return 0;
+
   ac = ava_string_to_cstring_buff(atmp, a);
   bc = ava_string_to_cstring_buff(btmp, b);
   alen = ava_strlen(a);
   blen = ava_strlen(b);
   n = alen < blen? alen : blen;
-  cmp = memcmp(ac, bc, n);
+  mismatch = ava_string_kernels_get()->mismatch(ac, bc, n);
 
-  if (cmp) return cmp;
+  if (mismatch < n)
+    return (unsigned char)ac[mismatch] - (unsigned char)bc[mismatch];
 
   return (alen > blen) - (alen < blen);
 }
@@ -515,11 +967,23 @@ signed ava_strcmp(ava_string a, ava_string b) {
 ava_bool ava_string_equal(ava_string a, ava_string b) {
   if (ava_string_is_ascii9(a) || ava_string_is_ascii9(b)) {
     return ava_string_to_ascii9(a) == ava_string_to_ascii9(b);
+  } else if (ava_string_is_bin7(a) || ava_string_is_bin7(b)) {
+    return ava_string_to_bin7(a) == ava_string_to_bin7(b);
   } else {
-    size_t alen = ava_strlen(a), blen = ava_strlen(b);
+    size_t alen, blen;
+
+    if (a.twine == b.twine)
+      return ava_true;
+#if defined(HAVE_GC_REGISTER_LONG_LINK) || defined(AVA_NOGC)
+    if (ava_string_is_interned(a) && ava_string_is_interned(b))
+      return ava_false;
+#endif
+
+    alen = ava_strlen(a);
+    blen = ava_strlen(b);
     return alen == blen &&
-      0 == memcmp(ava_twine_force(a.twine), ava_twine_force(b.twine),
-                  alen);
+      alen == ava_string_kernels_get()->mismatch(
+        ava_twine_force(a.twine), ava_twine_force(b.twine), alen);
   }
 }
 
@@ -546,7 +1010,8 @@ ava_bool ava_string_starts_with(ava_string big, ava_string small) {
   smallc = ava_string_to_cstring_buff(smalltmp, small);
   bigc = ava_string_to_cstring_buff(bigtmp, big);
 
-  return !memcmp(bigc, smallc, small_len);
+  return small_len == ava_string_kernels_get()->mismatch(
+    bigc, smallc, small_len);
 }
 
 static ava_bool ava_ascii9_starts_with(ava_ascii9_string big,
@@ -585,6 +1050,8 @@ ava_ascii9_string ava_string_to_ascii9(ava_string str) {
 
   if (ava_string_is_ascii9(str))
     return str.ascii9;
+  if (ava_string_is_bin7(str))
+    return 0;
 
   len = ava_strlen(str);
   if (len > 9)
@@ -597,6 +1064,24 @@ ava_ascii9_string ava_string_to_ascii9(ava_string str) {
     return 0;
 }
 
+ava_bin7_string ava_string_to_bin7(ava_string str) {
+  const char* dat;
+  size_t len;
+
+  if (ava_string_is_inline(str))
+    return ava_string_is_bin7(str)? str.ascii9 : 0;
+
+  len = ava_strlen(str);
+  if (0 == len || len > 7)
+    return 0;
+
+  dat = ava_twine_force(str.twine);
+  if (ava_string_can_encode_ascii9(dat, len))
+    return 0;
+  else
+    return ava_bin7_encode(dat, len);
+}
+
 ssize_t ava_ascii9_index_of_match(ava_ascii9_string a,
                                   ava_ascii9_string b) {
   ava_ascii9_string mask = 0x8102040810204081LL;
@@ -637,7 +1122,8 @@ ssize_t ava_ascii9_index_of_match(ava_ascii9_string a,
 }
 
 ssize_t ava_strchr(ava_string haystack, char needle) {
-  const char* dat, * found;
+  ava_str_tmpbuff tmp;
+  const char* dat;
 
   if (ava_string_is_ascii9(haystack)) {
     if (!_AVA_IS_ASCII9_CHAR(needle))
@@ -650,13 +1136,41 @@ ssize_t ava_strchr(ava_string haystack, char needle) {
                  needle, needle, needle,
                  needle, needle, needle));
   } else {
-    dat = ava_twine_force(haystack.twine);
-    found = memchr(dat, needle, ava_strlen(haystack));
-    if (found)
-      return found - dat;
-    else
-      return -1;
+    dat = ava_string_to_cstring_buff(tmp, haystack);
+    return ava_string_kernels_get()->find_byte(
+      dat, needle, ava_strlen(haystack));
+  }
+}
+
+ssize_t ava_strstr(ava_string haystack, ava_string needle) {
+  return ava_string_index_of(haystack, needle, 0);
+}
+
+ssize_t ava_string_index_of(ava_string haystack, ava_string needle,
+                            size_t from) {
+  ava_str_tmpbuff haytmp, needletmp;
+  const char* hayc, * needlec;
+  size_t hay_len, needle_len;
+  ssize_t found;
+
+  hay_len = ava_strlen(haystack);
+  if (from > hay_len) return -1;
+
+  needle_len = ava_strlen(needle);
+  if (needle_len > hay_len - from) return -1;
+  if (0 == needle_len) return from;
+
+  if (1 == needle_len && ava_string_is_ascii9(haystack)) {
+    found = ava_strchr(ava_string_behead(haystack, from),
+                       ava_string_index(needle, 0));
+    return found < 0? -1 : found + (ssize_t)from;
   }
+
+  hayc = ava_string_to_cstring_buff(haytmp, haystack);
+  needlec = ava_string_to_cstring_buff(needletmp, needle);
+  found = ava_string_kernels_get()->find_bytes(
+    hayc + from, hay_len - from, needlec, needle_len);
+  return found < 0? -1 : found + (ssize_t)from;
 }
 
 static inline ava_twine_tag ava_twine_get_tag(const void* body) {
@@ -673,6 +1187,226 @@ static const void* ava_twine_pack_body(ava_twine_tag tag,
   return (const void*)(tag + (ava_intptr)body_ptr);
 }
 
+static inline ava_twine_tag ava_twine_read(
+  const ava_twine*restrict twine,
+  const void** body, ava_twine_tail_other* other
+) {
+  const void* packed;
+
+  /* other must be read first; if the twine is forced after this point, the
+   * body we read below will be the forced one, and other will be ignored.
+   */
+  *other = twine->tail.other;
+  packed = (const void*)AO_load_acquire_read((const AO_t*)&twine->body);
+  *body = ava_twine_get_body_ptr(packed);
+  return ava_twine_get_tag(packed);
+}
+
+static ava_bool ava_string_is_rope(ava_string str) {
+  return !ava_string_is_inline(str) &&
+    ava_tt_rope == ava_twine_get_tag(
+      (const void*)AO_load_acquire_read((const AO_t*)&str.twine->body));
+}
+
+static ava_bool ava_rope_view_of(ava_rope_view*restrict dst, ava_string str) {
+  ava_twine_tail_other other;
+  const void* body;
+
+  if (ava_string_is_inline(str) ||
+      ava_tt_rope != ava_twine_read(str.twine, &body, &other)) {
+    dst->height = 0;
+    return ava_false;
+  }
+
+  dst->left.twine = body;
+  dst->right = other.string;
+  dst->height = ((const ava_rope*)str.twine)->height;
+  return ava_true;
+}
+
+static unsigned ava_rope_height(ava_string str) {
+  ava_rope_view view;
+
+  ava_rope_view_of(&view, str);
+  return view.height;
+}
+
+static ava_string ava_rope_join(ava_string left, ava_string right) {
+  ava_rope_view lv, rv;
+  size_t llen, rlen;
+  ava_bool lrope, rrope;
+
+  llen = ava_strlen(left);
+  rlen = ava_strlen(right);
+  if (0 == llen) return right;
+  if (0 == rlen) return left;
+
+  lrope = ava_rope_view_of(&lv, left);
+  rrope = ava_rope_view_of(&rv, right);
+
+  if (!lrope && !rrope) {
+    if (llen + rlen <= 9) {
+      char tmp[9];
+
+      ava_string_copy_out(tmp, left, 0, llen);
+      ava_string_copy_out(tmp + llen, right, 0, rlen);
+      return ava_string_of_bytes(tmp, llen + rlen);
+    } else if (llen + rlen <= AVA_ROPE_LEAF_SIZE)
+      return ava_rope_coalesce(left, right);
+    else
+      return ava_rope_node(left, right);
+  }
+
+  /* If one side is much taller than the other, descend its inner spine until
+   * the heights match, then rebalance on the way back up. Small leaves are
+   * always pushed all the way down so that they get coalesced with the
+   * neighbouring leaf.
+   */
+  if (lrope && (lv.height > rv.height + 1 ||
+                (!rrope && rlen < AVA_ROPE_LEAF_SIZE / 2)))
+    return ava_rope_balance(lv.left, ava_rope_join(lv.right, right));
+
+  if (rrope && (rv.height > lv.height + 1 ||
+                (!lrope && llen < AVA_ROPE_LEAF_SIZE / 2)))
+    return ava_rope_balance(ava_rope_join(left, rv.left), rv.right);
+
+  return ava_rope_node(left, right);
+}
+
+static ava_string ava_rope_node(ava_string left, ava_string right) {
+  ava_rope*restrict rope;
+  unsigned lheight, rheight;
+  ava_string ret;
+
+  assert(!ava_string_is_empty(left));
+  assert(!ava_string_is_empty(right));
+
+  /* Rope nodes only reference twines, so that force_into() never needs to
+   * deal with an inline right-hand side and so that the left can go in the
+   * body.
+   */
+  if (ava_string_is_inline(left))
+    left = ava_rope_coalesce(left, AVA_EMPTY_STRING);
+  if (ava_string_is_inline(right))
+    right = ava_rope_coalesce(right, AVA_EMPTY_STRING);
+
+  lheight = ava_rope_height(left);
+  rheight = ava_rope_height(right);
+
+  rope = AVA_NEW(ava_rope);
+  rope->twine.body = ava_twine_pack_body(ava_tt_rope, left.twine);
+  rope->twine.length = left.twine->length + right.twine->length;
+  rope->twine.tail.overhead = sizeof(ava_rope) +
+    ava_twine_get_overhead(left.twine) +
+    ava_twine_get_overhead(right.twine);
+  rope->twine.tail.other.string = right;
+  rope->height = 1 + (lheight > rheight? lheight : rheight);
+
+  ret.ascii9 = 0;
+  ret.twine = &rope->twine;
+  return ret;
+}
+
+static ava_string ava_rope_balance(ava_string left, ava_string right) {
+  ava_rope_view lv, rv, inner;
+
+  ava_rope_view_of(&lv, left);
+  ava_rope_view_of(&rv, right);
+
+  if (lv.height > rv.height + 1) {
+    /* Left-heavy; rotate right, first rotating the left child left if its
+     * inner grandchild is the taller one.
+     */
+    if (ava_rope_height(lv.left) < ava_rope_height(lv.right) &&
+        ava_rope_view_of(&inner, lv.right))
+      return ava_rope_node(ava_rope_node(lv.left, inner.left),
+                           ava_rope_node(inner.right, right));
+    else
+      return ava_rope_node(lv.left, ava_rope_node(lv.right, right));
+  }
+
+  if (rv.height > lv.height + 1) {
+    if (ava_rope_height(rv.right) < ava_rope_height(rv.left) &&
+        ava_rope_view_of(&inner, rv.left))
+      return ava_rope_node(ava_rope_node(left, inner.left),
+                           ava_rope_node(inner.right, rv.right));
+    else
+      return ava_rope_node(ava_rope_node(left, rv.left), rv.right);
+  }
+
+  return ava_rope_node(left, right);
+}
+
+static ava_string ava_rope_coalesce(ava_string left, ava_string right) {
+  size_t llen = ava_strlen(left), rlen = ava_strlen(right);
+  ava_twine*restrict twine = ava_twine_alloc(llen + rlen);
+  char*restrict dst = (char*)twine->body;
+
+  ava_string_copy_out(dst, left, 0, llen);
+  ava_string_copy_out(dst + llen, right, 0, rlen);
+  return (ava_string) { .twine = twine };
+}
+
+static ava_string ava_rope_slice(ava_string str, size_t begin, size_t end) {
+  ava_rope_view view;
+  size_t llen;
+
+  if (0 == begin && ava_strlen(str) == end)
+    return str;
+
+  if (!ava_rope_view_of(&view, str))
+    return ava_string_slice(str, begin, end);
+
+  llen = ava_strlen(view.left);
+  if (end <= llen)
+    return ava_rope_slice(view.left, begin, end);
+  if (begin >= llen)
+    return ava_rope_slice(view.right, begin - llen, end - llen);
+
+  return ava_rope_join(ava_rope_slice(view.left, begin, llen),
+                       ava_rope_slice(view.right, 0, end - llen));
+}
+
+static void ava_rope_locate(ava_string*restrict str, size_t*restrict ix) {
+  ava_rope_view view;
+  size_t llen;
+
+  while (ava_rope_view_of(&view, *str)) {
+    llen = ava_strlen(view.left);
+    if (*ix < llen) {
+      *str = view.left;
+    } else {
+      *str = view.right;
+      *ix -= llen;
+    }
+  }
+}
+
+static void ava_string_copy_out(char*restrict dst, ava_string str,
+                                size_t offset, size_t count) {
+  ava_str_tmpbuff tmp;
+
+  if (ava_string_is_inline(str)) {
+    ava_inline_decode(tmp, str);
+    memcpy(dst, (const char*)tmp + offset, count);
+  } else {
+    ava_twine_force_into(dst, str.twine, offset, count);
+  }
+}
+
+ava_string ava_string_next_chunk(ava_string str, size_t*restrict offset) {
+  ava_string leaf = str;
+  size_t leaf_offset = *offset, length;
+
+  if (*offset >= ava_strlen(str))
+    return AVA_ABSENT_STRING;
+
+  ava_rope_locate(&leaf, &leaf_offset);
+  length = ava_strlen(leaf);
+  *offset += length - leaf_offset;
+  return ava_string_behead(leaf, leaf_offset);
+}
+
 static const char* ava_twine_force(const ava_twine*restrict twine) {
   const void*restrict body =
     (const void*)AO_load_acquire_read((const AO_t*)&twine->body);
@@ -686,10 +1420,17 @@ static const char* ava_twine_force(const ava_twine*restrict twine) {
      */
     size_t full_sz = (base_sz + sizeof(ava_ulong)) /
       sizeof(ava_ulong) * sizeof(ava_ulong);
-    char*restrict dst = ava_alloc_atomic(full_sz);
+    /* The hash slot goes in front of the data, the properties slot after */
+    AO_t*restrict slot = ava_alloc_atomic(sizeof(AO_t) + full_sz +
+                                          sizeof(AO_t));
+    char*restrict dst = (char*)(slot + 1);
+
+    *slot = 0;
 
-    /* Zero the padding, including the terminating NUL */
-    memset(dst + base_sz, 0, full_sz - base_sz);
+    /* Zero the padding, including the terminating NUL, and the properties
+     * slot.
+     */
+    memset(dst + base_sz, 0, full_sz - base_sz + sizeof(AO_t));
 
     ava_twine_force_into(dst, twine, 0, twine->length);
 
@@ -699,8 +1440,10 @@ static const char* ava_twine_force(const ava_twine*restrict twine) {
      */
     AO_store_release_write((AO_t*)&twine->body,
                            (AO_t)(ava_twine_pack_body(ava_tt_forced, dst)));
-    /* Destroy other so that any memory it holds is freed */
-    ((ava_twine*restrict)twine)->tail.other.string.ascii9 = 0;
+    /* Destroy other so that any memory it holds is freed, leaving a non-zero
+     * value to indicate the hash slot.
+     */
+    ((ava_twine*restrict)twine)->tail.other.offset = 1;
 
     return dst;
   }
@@ -767,6 +1510,7 @@ static void ava_twine_force_into(char*restrict dst,
     break;
 
   case ava_tt_concat:
+  case ava_tt_rope:
     body_twine = body;
     if (offset + count <= body_twine->length) {
       /* Only need the left child */
@@ -774,8 +1518,8 @@ static void ava_twine_force_into(char*restrict dst,
       goto tailcall;
     } else if (offset >= body_twine->length) {
       /* Only need the right child */
-      if (ava_string_is_ascii9(other.string)) {
-        ava_ascii9_decode(a9tmp, other.string.ascii9);
+      if (ava_string_is_inline(other.string)) {
+        ava_inline_decode(a9tmp, other.string);
         memcpy(dst, (const char*)a9tmp + offset - body_twine->length, count);
       } else {
         twine = other.string.twine;
@@ -785,11 +1529,11 @@ static void ava_twine_force_into(char*restrict dst,
     } else {
       /* Need to inspect both sides.
        *
-       * If the right side is ASCII9, decode it now so we don't need to suport
-       * returning to an ASCII9 string.
+       * If the right side is inline, decode it now so we don't need to
+       * suport returning to an inline string.
        */
-      if (ava_string_is_ascii9(other.string)) {
-        ava_ascii9_decode(a9tmp, other.string.ascii9);
+      if (ava_string_is_inline(other.string)) {
+        ava_inline_decode(a9tmp, other.string);
         memcpy(dst + body_twine->length - offset,
                a9tmp, count - body_twine->length);
       } else {
@@ -810,11 +1554,11 @@ static void ava_twine_force_into(char*restrict dst,
     break;
 
   case ava_tt_tacnoc:
-    assert(ava_string_is_ascii9(other.string));
-    a9len = ava_ascii9_length(other.string.ascii9);
+    assert(ava_string_is_inline(other.string));
+    a9len = ava_inline_length(other.string);
 
     if (offset < a9len) {
-      ava_ascii9_decode(a9tmp, other.string.ascii9);
+      ava_inline_decode(a9tmp, other.string);
       memcpy(dst, (const char*)a9tmp + offset,
              count > a9len - offset? a9len - offset : count);
     }
@@ -873,7 +1617,7 @@ static const ava_twine* ava_twine_maybe_force(const ava_twine*restrict twine) {
 
   if (twine->tail.overhead > twine->length) {
     heap_twine = ava_twine_alloc(twine->length);
-    ava_twine_force_into((char*)&heap_twine->tail, twine, 0, twine->length);
+    ava_twine_force_into((char*)heap_twine->body, twine, 0, twine->length);
     return heap_twine;
   } else {
     return ava_clone(twine, sizeof(ava_twine));
@@ -30,10 +30,13 @@
 #include <nmmintrin.h>
 #endif
 
+#include <atomic_ops.h>
+
 #define AVA__INTERNAL_INCLUDE 1
 #define AVA_IN_VALUE_C
 #include "avalanche/string.h"
 #include "avalanche/value.h"
+#include "-string.h"
 
 #ifndef AVA_SIPHASH_C
 /**
@@ -64,16 +67,106 @@ const void* ava_get_attribute(ava_value value,
   return NULL;
 }
 
+/**
+ * The number of misses after which an attribute cache stops replacing
+ * entries. Sites which see this many distinct attribute chains are unlikely to
+ * benefit from caching, and continuing to replace entries would only cause
+ * writes to a shared cache line on every lookup.
+ */
+#define AVA_ATTRIBUTE_CACHE_MAX_FILLS (4 * AVA_ATTRIBUTE_CACHE_WAYS)
+
+static ava_attribute_cache* ava_attribute_cache_list;
+
+static void ava_attribute_cache_register(ava_attribute_cache*restrict cache) {
+  ava_attribute_cache* head;
+
+  if (!AO_compare_and_swap((AO_t*)&cache->registered, 0, 1))
+    return;
+
+  do {
+    head = (ava_attribute_cache*)AO_load((AO_t*)&ava_attribute_cache_list);
+    cache->next = head;
+  } while (!AO_compare_and_swap_release(
+             (AO_t*)&ava_attribute_cache_list, (AO_t)head, (AO_t)cache));
+}
+
+const void* ava_get_attribute_cache_miss(
+  const ava_attribute*restrict tail,
+  const ava_attribute_tag*restrict tag,
+  ava_attribute_cache*restrict cache
+) {
+  const ava_attribute*restrict attr;
+  size_t version, misses;
+
+  for (attr = tail; attr; attr = attr->next)
+    if (tag == attr->tag)
+      break;
+
+  misses = AO_fetch_and_add1((AO_t*)&cache->misses);
+  if (AVA_UNLIKELY(0 == misses))
+    ava_attribute_cache_register(cache);
+
+  if (misses >= AVA_ATTRIBUTE_CACHE_MAX_FILLS)
+    return attr;
+
+  /* Only fill if nobody else is currently doing so; losing the race just
+   * means this result isn't cached this time around.
+   */
+  version = AO_load((AO_t*)&cache->version);
+  if (!(version & 1) &&
+      AO_compare_and_swap((AO_t*)&cache->version, version, version + 1)) {
+    /* Replace entries round-robin; the version counts replacements. */
+    unsigned slot = (version >> 1) % AVA_ATTRIBUTE_CACHE_WAYS;
+
+    AO_nop_write();
+    AO_store((AO_t*)&cache->keys[slot], (AO_t)tail);
+    AO_store((AO_t*)&cache->values[slot], (AO_t)attr);
+    AO_store_release((AO_t*)&cache->version, version + 2);
+  }
+
+  return attr;
+}
+
+void ava_attribute_cache_get_stats(ava_attribute_cache_stats* dst) {
+  const ava_attribute_cache* cache;
+  size_t misses;
+
+  dst->hits = dst->misses = dst->sites = dst->megamorphic_sites = 0;
+  for (cache = (const ava_attribute_cache*)AO_load_acquire(
+         (AO_t*)&ava_attribute_cache_list);
+       cache; cache = cache->next) {
+    misses = AO_load((AO_t*)&cache->misses);
+    dst->hits += AO_load((AO_t*)&cache->hits);
+    dst->misses += misses;
+    ++dst->sites;
+    if (misses > AVA_ATTRIBUTE_CACHE_MAX_FILLS)
+      ++dst->megamorphic_sites;
+  }
+}
+
 ava_string ava_string_of_chunk_iterator(ava_value value) {
-  ava_string accum = AVA_EMPTY_STRING, chunk;
+  ava_string first, chunk;
+  ava_string_builder builder;
   ava_datum iterator;
 
   iterator = ava_string_chunk_iterator(value);
-  while (ava_string_is_present(
-           (chunk = ava_iterate_string_chunk(&iterator, value))))
-    accum = ava_strcat(accum, chunk);
-
-  return accum;
+  first = ava_iterate_string_chunk(&iterator, value);
+  if (!ava_string_is_present(first))
+    return AVA_EMPTY_STRING;
+
+  /* Values with a single chunk (the common case) need no copying at all */
+  chunk = ava_iterate_string_chunk(&iterator, value);
+  if (!ava_string_is_present(chunk))
+    return first;
+
+  ava_string_builder_init(&builder, ava_strlen(first) + ava_strlen(chunk));
+  ava_string_builder_append_string(&builder, first);
+  do {
+    ava_string_builder_append_string(&builder, chunk);
+  } while (ava_string_is_present(
+             (chunk = ava_iterate_string_chunk(&iterator, value))));
+
+  return ava_string_builder_finish(&builder);
 }
 
 ava_datum ava_singleton_string_chunk_iterator(ava_value value) {
@@ -121,6 +214,8 @@ signed ava_value_strcmp(ava_value a, ava_value b) {
 }
 
 static ava_ulong ava_siphash_k[2];
+static ava_value_hash_strategy ava_value_hash_default_strategy =
+  ava_vhs_siphash;
 
 void ava_value_hash_init(void) {
 #ifdef HAVE_ARC4RANDOM_BUF
@@ -163,10 +258,100 @@ static inline ava_ulong rotl(ava_ulong x, ava_ulong b) {
   return (x << b) | (x >> (64 - b));
 }
 
+/**
+ * Computes the SipHash of the given 8-byte-aligned data.
+ *
+ * n is the number of whole words in data, rem the number of bytes in the
+ * partial word following them (which must be zero-padded), and strlen the
+ * length to mix into the final block.
+ */
+static ava_ulong ava_siphash(const ava_ulong*restrict data,
+                             size_t n, size_t rem, size_t strlen,
+                             ava_ulong k0, ava_ulong k1);
 static ava_ulong ava_value_siphash(ava_value value, ava_ulong k0, ava_ulong k1);
+/**
+ * Computes the fast hash of the given 8-byte-aligned data.
+ *
+ * Parameters are as per ava_siphash().
+ */
+static ava_ulong ava_fasthash(const ava_ulong*restrict data,
+                              size_t n, size_t rem, size_t strlen,
+                              ava_ulong k0, ava_ulong k1);
 
 ava_ulong ava_value_hash(ava_value value) {
-  return ava_value_siphash(value, ava_siphash_k[0], ava_siphash_k[1]);
+  ava_string str;
+  ava_ulong a9, hash;
+  ava_str_tmpbuff tmpbuf;
+  const ava_ulong*restrict data;
+  AO_t*restrict slot;
+  size_t strlen;
+
+  /* See ava_value_siphash() for why inline strings are special */
+  str = ava_to_string(value);
+  if ((a9 = ava_string_to_ascii9(str)) || (a9 = ava_string_to_bin7(str)))
+    return ava_siphash(&a9, 1, 0, 0, ava_siphash_k[0], ava_siphash_k[1]);
+
+  /* Long strings are frequently hashed many times over (eg, the same keys
+   * being put into several maps, or a map being rebuilt), so remember the
+   * result in the string itself where possible.
+   *
+   * Zero doubles as "not yet computed"; the rare string which actually hashes
+   * to zero simply gets rehashed every time.
+   */
+  data = (const ava_ulong*)ava_string_to_cstring_hash_slot(tmpbuf, str, &slot);
+  if (slot && (hash = AO_load(slot)))
+    return hash;
+
+  strlen = ava_strlen(str);
+  hash = ava_siphash(data, strlen / sizeof(ava_ulong),
+                     strlen % sizeof(ava_ulong), strlen,
+                     ava_siphash_k[0], ava_siphash_k[1]);
+  if (slot)
+    AO_store(slot, hash);
+
+  return hash;
+}
+
+ava_ulong ava_value_hash_fast(ava_value value) {
+  ava_string str;
+  ava_ulong a9;
+  ava_str_tmpbuff tmpbuf;
+  size_t strlen;
+
+  /* Inline strings are special for the same reasons as in
+   * ava_value_siphash(). Unlike ava_value_hash(), the result is not cached on
+   * the string, since the hash slot belongs to SipHash, and recomputing this
+   * is usually not much more expensive than looking it up would be.
+   */
+  str = ava_to_string(value);
+  if ((a9 = ava_string_to_ascii9(str)) || (a9 = ava_string_to_bin7(str))) {
+    return ava_fasthash(&a9, 1, 0, 0, ava_siphash_k[0], ava_siphash_k[1]);
+  } else {
+    strlen = ava_strlen(str);
+    return ava_fasthash(
+      (const ava_ulong*)ava_string_to_cstring_buff(tmpbuf, str),
+      strlen / sizeof(ava_ulong), strlen % sizeof(ava_ulong), strlen,
+      ava_siphash_k[0], ava_siphash_k[1]);
+  }
+}
+
+ava_ulong ava_value_hash_with_strategy(ava_value value,
+                                       ava_value_hash_strategy strategy) {
+  switch (strategy) {
+  case ava_vhs_siphash: return ava_value_hash(value);
+  case ava_vhs_fast:    return ava_value_hash_fast(value);
+  default:
+    /* unreachable */
+    abort();
+  }
+}
+
+void ava_value_hash_set_default_strategy(ava_value_hash_strategy strategy) {
+  ava_value_hash_default_strategy = strategy;
+}
+
+ava_value_hash_strategy ava_value_hash_get_default_strategy(void) {
+  return ava_value_hash_default_strategy;
 }
 
 ava_ulong ava_value_hash_semiconsistent(ava_value value) {
@@ -176,6 +361,37 @@ ava_ulong ava_value_hash_semiconsistent(ava_value value) {
 
 static ava_ulong ava_value_siphash(ava_value value,
                                    ava_ulong k0, ava_ulong k1) {
+  /* Generally, only strings and short data will be hashed. Under this
+   * assumption, err on the side of simplicity and just stringify the whole
+   * value; this way, we can just read from the string iterator 8 bytes at a
+   * time and not worry about chunk boundaries.
+   *
+   * ASCII9 and BIN7 strings are passed in as an 8-byte-long chunk with a
+   * reported length of 0, in order to avoid the decoding overhead. Since bit 0
+   * distinguishes the two formats, they never collide with each other; and
+   * strings which could be represented inline are always hashed as such, so
+   * the hash does not depend on the representation.
+   */
+  ava_string str;
+  ava_ulong a9;
+  ava_str_tmpbuff tmpbuf;
+  size_t strlen;
+
+  str = ava_to_string(value);
+  if ((a9 = ava_string_to_ascii9(str)) || (a9 = ava_string_to_bin7(str))) {
+    return ava_siphash(&a9, 1, 0, 0, k0, k1);
+  } else {
+    strlen = ava_strlen(str);
+    return ava_siphash(
+      (const ava_ulong*)ava_string_to_cstring_buff(tmpbuf, str),
+      strlen / sizeof(ava_ulong), strlen % sizeof(ava_ulong), strlen,
+      k0, k1);
+  }
+}
+
+static ava_ulong ava_siphash(const ava_ulong*restrict data,
+                             size_t n, size_t rem, size_t strlen,
+                             ava_ulong k0, ava_ulong k1) {
   /* Adapted from https://github.com/veorq/SipHash
    *
    * More specifically,
@@ -185,21 +401,14 @@ static ava_ulong ava_value_siphash(ava_value value,
    * characters is reversed. This doesn't affect the soundness of the
    * algorithm, though, as it's equivalent to passing the string through a 1:1
    * function first.
-   *
-   * It also differs in that ASCII9 strings are passed in as an 8-byte-long
-   * chunk with a reported length of 0, in order to avoid the decoding
-   * overhead.
    */
 
-  ava_string str;
   /* Constants and vars, from lines 69--76 */
   ava_ulong
     v0 = 0x736f6d6570736575ULL, v1 = 0x646f72616e646f6dULL,
     v2 = 0x6c7967656e657261ULL, v3 = 0x7465646279746573ULL,
-    b, m, a9;
-  size_t i, n, rem, strlen;
-  ava_str_tmpbuff tmpbuf;
-  const ava_ulong*restrict data;
+    b, m;
+  size_t i;
 
   /* Lines 42--48 */
 #define SIPROUND() do {                                         \
@@ -214,24 +423,6 @@ static ava_ulong ava_value_siphash(ava_value value,
       SIPROUND();                               \
   } while (0)
 
-  /* Generally, only strings and short data will be hashed. Under this
-   * assumption, err on the side of simplicity and just stringify the whole
-   * value; this way, we can just read from the string iterator 8 bytes at a
-   * time and not worry about chunk boundaries.
-   */
-  str = ava_to_string(value);
-  if ((a9 = ava_string_to_ascii9(str))) {
-    strlen = 0;
-    data = &a9;
-    n = 1;
-    rem = 0;
-  } else {
-    strlen = ava_strlen(str);
-    data = (const ava_ulong*)ava_string_to_cstring_buff(tmpbuf, str);
-    n = strlen / sizeof(ava_ulong);
-    rem = strlen % sizeof(ava_ulong);
-  }
-
   /* Mix key with initialisation vector, and initialise b.
    *
    * Lines 80--84
@@ -267,6 +458,53 @@ static ava_ulong ava_value_siphash(ava_value value,
   return v0 ^ v1 ^ v2 ^ v3;
 }
 
+/**
+ * Multiplies a and b to a 128-bit product and folds the halves together.
+ *
+ * This is the core of the wyhash family of functions; a single multiply
+ * diffuses every bit of either input into every bit of the output about as
+ * well as several rounds of shifts and adds would.
+ */
+static inline ava_ulong ava_fasthash_mix(ava_ulong a, ava_ulong b) {
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 r = (unsigned __int128)a * b;
+  return (ava_ulong)r ^ (ava_ulong)(r >> 64);
+#else
+  /* Assemble the 128-bit product from 32-bit halves */
+  ava_ulong ahi = a >> 32, alo = (ava_uint)a;
+  ava_ulong bhi = b >> 32, blo = (ava_uint)b;
+  ava_ulong hh = ahi * bhi, hl = ahi * blo, lh = alo * bhi, ll = alo * blo;
+  ava_ulong mid = (ll >> 32) + (ava_uint)hl + (ava_uint)lh;
+  ava_ulong lo = (mid << 32) | (ava_uint)ll;
+  ava_ulong hi = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+  return lo ^ hi;
+#endif
+}
+
+static ava_ulong ava_fasthash(const ava_ulong*restrict data,
+                              size_t n, size_t rem, size_t strlen,
+                              ava_ulong k0, ava_ulong k1) {
+  /* A simplification of wyhash (https://github.com/wangyi-fudan/wyhash),
+   * consuming two words per multiply. Both halves of each multiply include
+   * key material, so that an attacker who does not know the key cannot
+   * choose data that zeroes either operand, though it is still far weaker
+   * than SipHash against anyone who can observe hash-dependent behaviour.
+   * hash-map-impl.c falls back to SipHash when a table using this hash
+   * suffers too many collisions.
+   */
+  ava_ulong seed = k0, last, tail;
+  size_t i;
+
+  for (i = 0; i + 2 <= n; i += 2)
+    seed = ava_fasthash_mix(data[i] ^ k1, data[i+1] ^ seed);
+
+  last = i < n? data[i++] : 0;
+  tail = rem? data[i] : 0;
+
+  seed = ava_fasthash_mix(last ^ k1, tail ^ seed);
+  return ava_fasthash_mix(seed ^ strlen, k1 ^ 0xe7037ed1a0b428dbULL);
+}
+
 ava_uint ava_ascii9_hash(ava_ascii9_string str) {
   /* Hashing ASCII9 values is a bit difficult, since the lower bits are often
    * all zeroes.
@@ -0,0 +1,299 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include <unistd.h>
+#include <pthread.h>
+
+/* The threads allocate from the GC heap, so they must be created through the
+ * collector's wrapper for pthread_create().
+ */
+#define GC_THREADS 1
+#if defined(HAVE_GC_GC_H)
+#include <gc/gc.h>
+#elif defined(HAVE_GC_H)
+#include <gc.h>
+#else
+#error "Neither <gc/gc.h> nor <gc.h> could be found."
+#endif
+
+#include <atomic_ops.h>
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/-esba.h"
+
+/*
+ * Measures how ESBAs behave when several threads hold and modify versions of
+ * the same array at once, at every thread count from one up to the number of
+ * CPUs. Each line reports wall-clock time divided by the total number of
+ * operations across all threads, so perfect scaling halves the figure every
+ * time the thread count doubles.
+ *
+ * The workloads are:
+ *
+ * - "append private": each thread appends to its own version. This is the
+ *   uncontended baseline.
+ *
+ * - "append shared": every thread appends to whichever version was most
+ *   recently published by any thread, then publishes the result. Writers
+ *   that lose the race must copy the array out.
+ *
+ * - "set shared": as "append shared", but replacing a random element.
+ *
+ * - "read+set shared": as "set shared", but three in four operations instead
+ *   read a random element of the latest version, which is frequently stale by
+ *   the time it is read.
+ *
+ * - "stale read N": each thread makes N sets to its own version, then reads
+ *   from the version it started with, which must replay N rollback entries.
+ *
+ * - "copy-out": each thread appends to a version that has already been
+ *   appended to, which always copies the array.
+ *
+ * If the runtime was configured with --enable-esba-stats, the contention
+ * counters accumulated by each run are printed after it.
+ */
+
+#define NELTS 4096
+#define NOPS 20000
+#define MAX_THREADS 64
+
+typedef struct {
+  ava_esba esba;
+} boxed_esba;
+
+typedef struct {
+  const char* name;
+  void (*run)(ava_ulong* rand_state, unsigned nops);
+} workload;
+
+static pthread_barrier_t start_barrier;
+static AO_t /* const boxed_esba* */ latest;
+static ava_esba base;
+static const workload* current_workload;
+
+static ava_ulong next_rand(ava_ulong* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static ava_esba make_base(void) {
+  ava_value* values = ava_alloc(sizeof(ava_value) * NELTS);
+  unsigned i;
+
+  for (i = 0; i < NELTS; ++i)
+    values[i] = ava_value_of_integer(i);
+
+  return ava_esba_append(
+    ava_esba_new(sizeof(ava_value), NELTS, ava_alloc, NULL),
+    values, NELTS);
+}
+
+static ava_value read_element(ava_esba esba, size_t ix) {
+  const ava_value* data;
+  ava_esba_tx tx;
+  ava_value value;
+
+  do {
+    data = ava_esba_access(esba, &tx);
+    value = data[ix];
+  } while (!ava_esba_check_access(esba, data, tx));
+
+  return value;
+}
+
+static ava_esba get_latest(void) {
+  return ((const boxed_esba*)AO_load_acquire_read(&latest))->esba;
+}
+
+static void publish(ava_esba esba) {
+  boxed_esba* box = AVA_NEW(boxed_esba);
+
+  box->esba = esba;
+  AO_store_release_write(&latest, (AO_t)box);
+}
+
+static void run_append_private(ava_ulong* rand_state, unsigned nops) {
+  ava_esba esba = base;
+  ava_value value;
+  unsigned i;
+
+  for (i = 0; i < nops; ++i) {
+    value = ava_value_of_integer(next_rand(rand_state));
+    esba = ava_esba_append(esba, &value, 1);
+  }
+
+  BENCH_KEEP(ava_esba_length(esba));
+}
+
+static void run_append_shared(ava_ulong* rand_state, unsigned nops) {
+  ava_value value;
+  unsigned i;
+
+  for (i = 0; i < nops; ++i) {
+    value = ava_value_of_integer(next_rand(rand_state));
+    publish(ava_esba_append(get_latest(), &value, 1));
+  }
+}
+
+static void run_set_shared(ava_ulong* rand_state, unsigned nops) {
+  ava_value value;
+  unsigned i;
+
+  for (i = 0; i < nops; ++i) {
+    value = ava_value_of_integer(i);
+    publish(ava_esba_set(get_latest(), next_rand(rand_state) % NELTS,
+                         &value));
+  }
+}
+
+static void run_read_set_shared(ava_ulong* rand_state, unsigned nops) {
+  ava_value value;
+  unsigned i;
+
+  for (i = 0; i < nops; ++i) {
+    if (i & 3) {
+      BENCH_KEEP(ava_value_ulong(read_element(
+                                   get_latest(),
+                                   next_rand(rand_state) % NELTS)));
+    } else {
+      value = ava_value_of_integer(i);
+      publish(ava_esba_set(get_latest(), next_rand(rand_state) % NELTS,
+                           &value));
+    }
+  }
+}
+
+static void run_stale_read(ava_ulong* rand_state, unsigned nops,
+                           unsigned sets_per_read) {
+  ava_esba esba = base, old;
+  ava_value value;
+  unsigned i, j;
+
+  for (i = 0; i < nops; i += sets_per_read) {
+    old = esba;
+    for (j = 0; j < sets_per_read; ++j) {
+      value = ava_value_of_integer(j);
+      esba = ava_esba_set(esba, next_rand(rand_state) % NELTS, &value);
+    }
+
+    BENCH_KEEP(ava_value_ulong(read_element(
+                                 old, next_rand(rand_state) % NELTS)));
+  }
+}
+
+static void run_stale_read_1(ava_ulong* rand_state, unsigned nops) {
+  run_stale_read(rand_state, nops, 1);
+}
+
+static void run_stale_read_64(ava_ulong* rand_state, unsigned nops) {
+  run_stale_read(rand_state, nops, 64);
+}
+
+static void run_copy_out(ava_ulong* rand_state, unsigned nops) {
+  ava_value value;
+  unsigned i;
+
+  for (i = 0; i < nops; ++i) {
+    value = ava_value_of_integer(next_rand(rand_state));
+    BENCH_KEEP(ava_esba_length(ava_esba_append(base, &value, 1)));
+  }
+}
+
+static const workload workloads[] = {
+  { "append private", run_append_private },
+  { "append shared", run_append_shared },
+  { "set shared", run_set_shared },
+  { "read+set shared", run_read_set_shared },
+  { "stale read 1", run_stale_read_1 },
+  { "stale read 64", run_stale_read_64 },
+  { "copy-out", run_copy_out },
+};
+
+static void* thread_main(void* arg) {
+  ava_ulong rand_state = 0x2545F4914F6CDD1DULL * (1 + (ava_ulong)arg);
+
+  pthread_barrier_wait(&start_barrier);
+  (*current_workload->run)(&rand_state, NOPS);
+  return NULL;
+}
+
+static void run(const workload* w, unsigned nthreads) {
+  pthread_t threads[MAX_THREADS];
+  const ava_value base_value[1] = { ava_value_of_integer(0) };
+  ava_esba_stats stats;
+  char name[64];
+  double start;
+  unsigned i;
+
+  current_workload = w;
+  base = make_base();
+  /* Appending once leaves base truncating, so every further append to it
+   * copies out.
+   */
+  if (run_copy_out == w->run)
+    BENCH_KEEP(ava_esba_length(ava_esba_append(base, base_value, 1)));
+  publish(base);
+  ava_esba_reset_stats();
+
+  pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+  for (i = 0; i < nthreads; ++i) {
+    if (pthread_create(threads + i, NULL, thread_main,
+                       (void*)(ava_ulong)i)) {
+      perror("pthread_create");
+      exit(1);
+    }
+  }
+
+  pthread_barrier_wait(&start_barrier);
+  start = bench_now();
+  for (i = 0; i < nthreads; ++i)
+    pthread_join(threads[i], NULL);
+
+  snprintf(name, sizeof(name), "%s, %u thread%s",
+           w->name, nthreads, 1 == nthreads? "" : "s");
+  printf("%-48s %12.1f ns/op\n", name,
+         (bench_now() - start) / ((double)nthreads * NOPS));
+  pthread_barrier_destroy(&start_barrier);
+
+  if (ava_esba_get_stats(&stats))
+    printf("  cas failures %zu, copy-outs %zu (%zu stale, %zu raced), "
+           "replayed %zu (longest %zu)\n",
+           stats.cas_failures, stats.copy_outs, stats.stale_copy_outs,
+           stats.lost_freshen_races, stats.replayed_entries,
+           stats.longest_replay);
+}
+
+int main(void) {
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned max_threads, nthreads, w;
+
+  ava_init();
+
+  max_threads = ncpus < 1? 1 : ncpus > MAX_THREADS? MAX_THREADS : ncpus;
+
+  for (w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+    for (nthreads = 1; nthreads < max_threads; nthreads *= 2)
+      run(workloads + w, nthreads);
+    run(workloads + w, max_threads);
+  }
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/map.h"
+#include "runtime/-hash-map.h"
+#include "runtime/-parallel.h"
+
+/*
+ * Measures building hash maps of 10M pairs from a list, as when loading a
+ * dictionary, for each kind of key: ASCII9 strings, integers, and longer
+ * strings. Maps this large are built across all CPUs; the number in use is
+ * printed first.
+ */
+
+#define NELTS (10 * 1024 * 1024)
+
+static ava_list_value make_pairs(const char* format) {
+  ava_value* pairs = ava_alloc(sizeof(ava_value) * 2 * NELTS);
+  char str[32];
+  size_t i;
+
+  for (i = 0; i < NELTS; ++i) {
+    if (format) {
+      snprintf(str, sizeof(str), format, (unsigned)i);
+      pairs[2*i] = ava_value_of_cstring(str);
+    } else {
+      pairs[2*i] = ava_value_of_integer(i);
+    }
+    pairs[2*i + 1] = pairs[2*i];
+  }
+
+  return ava_list_of_values(pairs, 2 * NELTS);
+}
+
+static void run(const char* name, const char* format) {
+  ava_list_value list = make_pairs(format);
+  char label[64];
+
+  snprintf(label, sizeof(label), "build 10M %s", name);
+  BENCH(label, 1, BENCH_KEEP(ava_map_npairs(ava_hash_map_of_list(list))));
+}
+
+int main(void) {
+  ava_init();
+
+  printf("using %u threads\n", ava_parallel_width());
+  run("ascii9 strings", "k%u");
+  run("integers", NULL);
+  run("long strings", "a-longer-key-%08u");
+
+  return 0;
+}
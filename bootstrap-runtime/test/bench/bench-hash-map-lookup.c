@@ -0,0 +1,123 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include <string.h>
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/map.h"
+#include "runtime/-hash-map.h"
+
+/*
+ * Measures looking keys up in hash maps of 10M pairs, in random order, for
+ * each of the hash functions a map of that size can use: ASCII9 strings,
+ * integers (integer hashing), and longer strings (value hashing). Each is
+ * measured with keys that are present and with keys that are not; the
+ * latter have to probe to the end of their sequence, so they show most
+ * clearly the cost of examining slots that do not match.
+ *
+ * A map this size normally uses 32-bit indices, so the integer maps are also
+ * built with the 64-bit specialisation, whose lanes hold half as many slots.
+ */
+
+#define NELTS (10 * 1024 * 1024)
+
+static ava_ulong rand_state = 0x2545F4914F6CDD1DULL;
+
+static ava_ulong next_rand(void) {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 7;
+  rand_state ^= rand_state << 17;
+  return rand_state;
+}
+
+static ava_value* make_keys(const char* format, unsigned base) {
+  ava_value* keys = ava_alloc(sizeof(ava_value) * NELTS);
+  char str[32];
+  size_t i;
+
+  for (i = 0; i < NELTS; ++i) {
+    if (format) {
+      snprintf(str, sizeof(str), format, (unsigned)(base + i));
+      keys[i] = ava_value_of_cstring(str);
+    } else {
+      keys[i] = ava_value_of_integer(base + i);
+    }
+  }
+
+  return keys;
+}
+
+/**
+ * Returns a random permutation of keys, so that lookups don't visit the map
+ * in insertion order.
+ */
+static ava_value* shuffle(const ava_value* keys) {
+  ava_value* shuffled = ava_alloc(sizeof(ava_value) * NELTS);
+  ava_value tmp;
+  size_t i, j;
+
+  memcpy(shuffled, keys, sizeof(ava_value) * NELTS);
+  for (i = NELTS - 1; i > 0; --i) {
+    j = next_rand() % (i + 1);
+    tmp = shuffled[i];
+    shuffled[i] = shuffled[j];
+    shuffled[j] = tmp;
+  }
+
+  return shuffled;
+}
+
+static void run(const char* name, ava_map_value map,
+                const ava_value* keys, const ava_value* absent) {
+  const ava_value* present = shuffle(keys);
+  char label[64];
+
+  snprintf(label, sizeof(label), "find 10M %s, present", name);
+  BENCH(label, NELTS, BENCH_KEEP(ava_map_find(map, present[bench_i])));
+  snprintf(label, sizeof(label), "find 10M %s, absent", name);
+  BENCH(label, NELTS, BENCH_KEEP(ava_map_find(map, absent[bench_i])));
+}
+
+int main(void) {
+  ava_value* keys, * absent;
+
+  ava_init();
+
+  keys = make_keys("k%u", 0);
+  absent = make_keys("k%u", NELTS);
+  run("ascii9 strings", ava_hash_map_of_raw(keys, 1, keys, 1, NELTS),
+      keys, absent);
+
+  keys = make_keys(NULL, 0);
+  absent = make_keys(NULL, NELTS);
+  run("integers", ava_hash_map_of_raw(keys, 1, keys, 1, NELTS),
+      keys, absent);
+  run("integers, 64-bit index",
+      ava_hash_map_of_raw_ava_ulong(keys, 1, keys, 1, NELTS,
+                                    ava_vhs_siphash),
+      keys, absent);
+
+  keys = make_keys("a-longer-key-%08u", 0);
+  absent = make_keys("a-longer-key-%08u", NELTS);
+  run("long strings", ava_hash_map_of_raw(keys, 1, keys, 1, NELTS),
+      keys, absent);
+
+  return 0;
+}
@@ -0,0 +1,76 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/map.h"
+#include "runtime/-hash-map.h"
+#include "runtime/-list-map.h"
+
+/*
+ * Measures repeated lookups in list-maps built directly over lists of
+ * various sizes, which promote themselves to hash indices after a few
+ * searches, against hash-maps of the same pairs. Each measurement starts from
+ * a fresh list-map, so it includes the linear searches made before promotion
+ * and the cost of building the index.
+ */
+
+static ava_ulong rand_state = 0x2545F4914F6CDD1DULL;
+
+static ava_ulong next_rand(void) {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 7;
+  rand_state ^= rand_state << 17;
+  return rand_state;
+}
+
+static void run(size_t npairs, size_t nlookups) {
+  ava_value* pairs = ava_alloc(sizeof(ava_value) * 2 * npairs);
+  ava_value* keys = ava_alloc(sizeof(ava_value) * nlookups);
+  ava_list_value list;
+  ava_map_value map;
+  char label[64];
+  size_t i;
+
+  for (i = 0; i < npairs; ++i)
+    pairs[2*i] = pairs[2*i + 1] = ava_value_of_integer(i);
+  for (i = 0; i < nlookups; ++i)
+    keys[i] = ava_value_of_integer(next_rand() % npairs);
+
+  list = ava_list_of_values(pairs, 2 * npairs);
+
+  map = ava_list_map_of_list(list);
+  snprintf(label, sizeof(label), "find in %zu pairs, list-map", npairs);
+  BENCH(label, nlookups, BENCH_KEEP(ava_map_find(map, keys[bench_i])));
+
+  map = ava_hash_map_of_list(list);
+  snprintf(label, sizeof(label), "find in %zu pairs, hash-map", npairs);
+  BENCH(label, nlookups, BENCH_KEEP(ava_map_find(map, keys[bench_i])));
+}
+
+int main(void) {
+  size_t npairs;
+
+  ava_init();
+
+  for (npairs = 4; npairs <= 1024 * 1024; npairs *= 8)
+    run(npairs, 1024 * 1024);
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/-list-parse.h"
+
+/*
+ * Measures converting a string of about 64MB, shaped like a table written out
+ * by a batch job, to a list. The "one part" run forces the serial path by
+ * making the only part as long as the whole string.
+ */
+
+#define NROWS (1024 * 1024)
+
+static ava_string make_table(void) {
+  char* str;
+  size_t off = 0;
+  unsigned i;
+
+  str = ava_alloc_atomic((size_t)NROWS * 64);
+  for (i = 0; i < NROWS; ++i)
+    off += sprintf(str + off, "[%u row-%u \"cell %u\" %u.5]\n",
+                   i, i, i * 7, i % 1000);
+
+  return ava_string_of_bytes(str, off);
+}
+
+int main(void) {
+  ava_string table;
+
+  ava_init();
+  table = make_table();
+
+  BENCH("parse 64MB table, one part", 4, {
+      BENCH_KEEP(ava_list_length(ava_list_value_of_string_in_parts(
+                                   table, ava_strlen(table))));
+    });
+  BENCH("parse 64MB table, default parts", 4, {
+      BENCH_KEEP(ava_list_length(ava_list_value_of_string_in_parts(
+                                   table, AVA_LIST_PARALLEL_PARSE_PART)));
+    });
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/real.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/numeric-list.h"
+#include "runtime/avalanche/list-sort.h"
+#include "runtime/-list-sort.h"
+
+/*
+ * Measures sorting lists of 10M elements of each kind that has its own
+ * comparator: integers in an integer list, reals in a real list, ASCII9
+ * strings, and longer strings. Each is sorted once serially (one piece) and
+ * once the way ava_list_sort() does it by default, which splits the work
+ * across the worker pool.
+ */
+
+#define NELTS (10 * 1024 * 1024)
+
+static ava_ulong rand_state = 0x2545F4914F6CDD1DULL;
+
+static ava_ulong next_rand(void) {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 7;
+  rand_state ^= rand_state << 17;
+  return rand_state;
+}
+
+static ava_list_value make_integers(void) {
+  ava_integer* keys = ava_alloc_atomic(sizeof(ava_integer) * NELTS);
+  size_t i;
+
+  for (i = 0; i < NELTS; ++i)
+    keys[i] = (ava_integer)next_rand();
+
+  return ava_integer_list_of_array(keys, NELTS);
+}
+
+static ava_list_value make_reals(void) {
+  ava_real* keys = ava_alloc_atomic(sizeof(ava_real) * NELTS);
+  size_t i;
+
+  for (i = 0; i < NELTS; ++i)
+    keys[i] = (ava_real)(next_rand() >> 11) / (ava_real)(1ULL << 53);
+
+  return ava_real_list_of_array(keys, NELTS);
+}
+
+static ava_list_value make_strings(const char* format) {
+  ava_value* values = ava_alloc(sizeof(ava_value) * NELTS);
+  char str[32];
+  size_t i;
+
+  for (i = 0; i < NELTS; ++i) {
+    snprintf(str, sizeof(str), format, (unsigned)(next_rand() % 100000000));
+    values[i] = ava_value_of_cstring(str);
+  }
+
+  return ava_list_of_values(values, NELTS);
+}
+
+static void run(const char* name, ava_list_value list,
+                ava_list_sort_order order) {
+  char label[64];
+
+  snprintf(label, sizeof(label), "sort 10M %s, one piece", name);
+  BENCH(label, 1, {
+      BENCH_KEEP(ava_list_length(ava_list_sort_in_pieces(list, order, 1)));
+    });
+  snprintf(label, sizeof(label), "sort 10M %s, default", name);
+  BENCH(label, 1, {
+      BENCH_KEEP(ava_list_length(ava_list_sort(list, order)));
+    });
+}
+
+int main(void) {
+  ava_init();
+
+  run("integers", make_integers(), ava_lso_integer);
+  run("reals", make_reals(), ava_lso_real);
+  run("ascii9 strings", make_strings("k%u"), ava_lso_lexical);
+  run("long strings", make_strings("a-longer-key-%08u"), ava_lso_lexical);
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/map.h"
+#include "runtime/avalanche/ordered-map.h"
+#include "runtime/-hash-map.h"
+
+/*
+ * Measures ordered maps of 1M pairs with integer and ASCII9 string keys,
+ * inserted in random order: building the tree, point lookups against a hash
+ * map of the same pairs, range queries of about 16 pairs, and adding to an
+ * existing ordered map.
+ */
+
+#define NELTS (1024 * 1024)
+
+static ava_ulong rand_state = 0x2545F4914F6CDD1DULL;
+
+static ava_ulong next_rand(void) {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 7;
+  rand_state ^= rand_state << 17;
+  return rand_state;
+}
+
+/**
+ * Returns NELTS distinct keys in random order, interleaved with themselves as
+ * values.
+ */
+static ava_value* make_pairs(const char* format) {
+  ava_value* pairs = ava_alloc(sizeof(ava_value) * 2 * NELTS);
+  ava_value tmp;
+  char str[32];
+  size_t i, j;
+
+  for (i = 0; i < NELTS; ++i) {
+    if (format) {
+      snprintf(str, sizeof(str), format, (unsigned)i);
+      pairs[2*i] = ava_value_of_cstring(str);
+    } else {
+      pairs[2*i] = ava_value_of_integer(i);
+    }
+  }
+
+  for (i = NELTS - 1; i > 0; --i) {
+    j = next_rand() % (i + 1);
+    tmp = pairs[2*i];
+    pairs[2*i] = pairs[2*j];
+    pairs[2*j] = tmp;
+  }
+
+  for (i = 0; i < NELTS; ++i)
+    pairs[2*i+1] = pairs[2*i];
+
+  return pairs;
+}
+
+static void run(const char* name, const char* format) {
+  ava_value* pairs = make_pairs(format);
+  ava_list_value list = ava_list_of_values(pairs, 2 * NELTS);
+  ava_map_value ordered = ava_empty_map(), hashed;
+  char label[64];
+
+  snprintf(label, sizeof(label), "build 1M %s", name);
+  BENCH(label, 1, ordered = ava_ordered_map_of(ava_map_value_of(list.v)));
+  hashed = ava_hash_map_of_raw(pairs, 2, pairs + 1, 2, NELTS);
+
+  snprintf(label, sizeof(label), "find 1M %s, ordered", name);
+  BENCH(label, NELTS, BENCH_KEEP(ava_map_find(ordered, pairs[2*bench_i])));
+  snprintf(label, sizeof(label), "find 1M %s, hashed", name);
+  BENCH(label, NELTS, BENCH_KEEP(ava_map_find(hashed, pairs[2*bench_i])));
+
+  snprintf(label, sizeof(label), "range ~16 of 1M %s", name);
+  BENCH(label, NELTS, {
+      size_t lower = ava_ordered_map_lower_bound(ordered, pairs[2*bench_i]);
+      size_t upper = lower + 16 < NELTS? lower + 16 : NELTS;
+      BENCH_KEEP(ava_list_length(
+                   ava_ordered_map_slice(ordered, lower, upper)));
+    });
+
+  snprintf(label, sizeof(label), "add to 1M %s, ordered", name);
+  BENCH(label, 4096, BENCH_KEEP(
+          ava_map_npairs(ava_map_add(ordered, pairs[2*bench_i],
+                                     pairs[2*bench_i]))));
+}
+
+int main(void) {
+  ava_init();
+
+  run("integers", NULL);
+  run("ascii9 strings", "k%u");
+  run("long strings", "a-longer-key-%08u");
+
+  return 0;
+}
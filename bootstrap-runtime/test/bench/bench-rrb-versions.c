@@ -0,0 +1,108 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/-esba-list.h"
+#include "runtime/-rrb-list.h"
+
+/*
+ * Measures lists of NELTS integers when NVERSIONS versions of them are alive
+ * at once and each is read and modified independently, as in an undo stack.
+ * Each operation picks a random live version, reads or modifies one element,
+ * and replaces a random live version with the result.
+ *
+ * The "esba" runs start from an ESBA list, which migrates to an RRB list by
+ * itself after the first few copy-outs; the cost of getting there is
+ * included. The "linear" runs modify only the latest version, which is the
+ * case ESBA lists are optimised for, for comparison.
+ */
+
+#define NELTS 100000
+#define NVERSIONS 256
+#define NOPS 100000
+
+static ava_ulong rand_state = 0x2545F4914F6CDD1DULL;
+
+static ava_ulong next_rand(void) {
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 7;
+  rand_state ^= rand_state << 17;
+  return rand_state;
+}
+
+static ava_list_value make_esba_list(void) {
+  ava_value* values = ava_alloc(sizeof(ava_value) * NELTS);
+  unsigned i;
+
+  for (i = 0; i < NELTS; ++i)
+    values[i] = ava_value_of_integer(i);
+
+  /* Append the last element separately so the list has spare capacity, as
+   * most lists built up incrementally do.
+   */
+  return ava_list_append(ava_esba_list_of_raw(values, NELTS - 1),
+                         values[NELTS - 1]);
+}
+
+static void run_versions(const char* name, ava_list_value base) {
+  ava_list_value versions[NVERSIONS];
+  ava_list_value list;
+  unsigned i;
+
+  for (i = 0; i < NVERSIONS; ++i)
+    versions[i] = base;
+
+  BENCH(name, NOPS, {
+      list = versions[next_rand() % NVERSIONS];
+      if (bench_i & 1) {
+        list = ava_list_set(list, next_rand() % NELTS,
+                            ava_value_of_integer(bench_i));
+        versions[next_rand() % NVERSIONS] = list;
+      } else {
+        BENCH_KEEP(ava_value_ulong(ava_list_index(
+                                     list, next_rand() % NELTS)));
+      }
+    });
+}
+
+static void run_linear(const char* name, ava_list_value list) {
+  BENCH(name, NOPS, {
+      list = ava_list_set(list, next_rand() % NELTS,
+                          ava_value_of_integer(bench_i));
+      BENCH_KEEP(ava_value_ulong(ava_list_index(
+                                   list, next_rand() % NELTS)));
+    });
+}
+
+int main(void) {
+  ava_list_value esba, rrb;
+
+  ava_init();
+
+  esba = make_esba_list();
+  rrb = ava_rrb_list_copy_of(esba, 0, NELTS);
+
+  run_linear("linear set+index, esba", make_esba_list());
+  run_linear("linear set+index, rrb", rrb);
+  run_versions("versioned set/index, esba (migrating)", esba);
+  run_versions("versioned set/index, rrb", rrb);
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include <string.h>
+
+#include "runtime/avalanche/string.h"
+#include "runtime/-string-kernels.h"
+
+/*
+ * Compares the string search and comparison kernels against the scalar
+ * (memchr()/memcmp()) path they replace, on multi-kilobyte inputs resembling
+ * log lines.
+ */
+
+#define LENGTH 4096
+#define ITERATIONS 200000
+
+static char text[LENGTH], copy[LENGTH];
+
+static void run_kernels(const ava_string_kernels* k) {
+  static const char needle[] = "status=503 upstream";
+  char name[64];
+
+  snprintf(name, sizeof(name), "%s find_byte (miss)", k->name);
+  BENCH(name, ITERATIONS, BENCH_KEEP(k->find_byte(text, '\n', LENGTH)));
+
+  snprintf(name, sizeof(name), "%s mismatch (equal)", k->name);
+  BENCH(name, ITERATIONS, BENCH_KEEP(k->mismatch(text, copy, LENGTH)));
+
+  snprintf(name, sizeof(name), "%s find_bytes (near end)", k->name);
+  BENCH(name, ITERATIONS,
+        BENCH_KEEP(k->find_bytes(text, LENGTH, needle, sizeof(needle) - 1)));
+}
+
+int main(void) {
+  const ava_string_kernels*const* k;
+  ava_string str, other, needle;
+  unsigned i;
+
+  ava_init();
+
+  for (i = 0; i < LENGTH; ++i)
+    text[i] = "GET /index.html HTTP/1.1 status=200 "[i % 36];
+  memcpy(text + LENGTH - 32, "status=503 upstream timed out   ", 32);
+  memcpy(copy, text, LENGTH);
+
+  for (k = ava_string_kernels_all; *k; ++k)
+    if ((*k)->supported())
+      run_kernels(*k);
+
+  printf("selected kernels: %s\n", ava_string_kernels_get()->name);
+  str = ava_string_of_bytes(text, LENGTH);
+  other = ava_string_of_bytes(copy, LENGTH);
+  needle = ava_string_of_cstring("status=503 upstream");
+
+  BENCH("ava_strchr (miss)", ITERATIONS,
+        BENCH_KEEP(ava_strchr(str, '\n')));
+  BENCH("ava_string_equal (equal)", ITERATIONS,
+        BENCH_KEEP(ava_string_equal(str, other)));
+  BENCH("ava_strcmp (equal)", ITERATIONS,
+        BENCH_KEEP(ava_strcmp(str, other)));
+  BENCH("ava_strstr (near end)", ITERATIONS,
+        BENCH_KEEP(ava_strstr(str, needle)));
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+
+#include <string.h>
+
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/map.h"
+
+/*
+ * Measures the effect of caching hash codes in heap strings, using a million
+ * distinct 96-byte keys.
+ *
+ * The "shared" map builds insert the same key strings into several maps in
+ * succession, so only the first build needs to hash them. The "distinct" builds
+ * give each map its own copies of the keys, which is what every build cost
+ * before hash codes were cached. ava_value_hash_semiconsistent() does not use
+ * the cache, and so gives the cost of hashing alone.
+ *
+ * The last build uses the fast hash strategy on fresh keys, for comparison
+ * with the distinct-key SipHash builds.
+ */
+
+#define NKEYS 1000000
+#define KEY_LENGTH 96
+#define NMAPS 4
+
+static ava_value* make_keys(void) {
+  ava_value* keys = ava_alloc(sizeof(ava_value) * NKEYS);
+  char buf[KEY_LENGTH];
+  unsigned i, j;
+
+  for (i = 0; i < NKEYS; ++i) {
+    for (j = 0; j < KEY_LENGTH; ++j)
+      buf[j] = "abcdefghijklmnopqrstuvwxyz012345"[
+        ((i >> (j % 20)) + j) & 31];
+    snprintf(buf, sizeof(buf), "key-%08u", i);
+    buf[13] = '/';
+    keys[i] = ava_value_of_string(ava_string_of_bytes(buf, KEY_LENGTH));
+  }
+
+  return keys;
+}
+
+int main(void) {
+  ava_value* keys[NMAPS];
+  ava_map_value map;
+  double start;
+  unsigned i;
+
+  ava_init();
+
+  for (i = 0; i < NMAPS; ++i)
+    keys[i] = make_keys();
+
+  BENCH("ava_value_hash_semiconsistent", NKEYS,
+        BENCH_KEEP(ava_value_hash_semiconsistent(keys[0][bench_i])));
+  BENCH("ava_value_hash (cold)", NKEYS,
+        BENCH_KEEP(ava_value_hash(keys[0][bench_i])));
+  BENCH("ava_value_hash (warm)", NKEYS,
+        BENCH_KEEP(ava_value_hash(keys[0][bench_i])));
+  BENCH("ava_value_hash_fast", NKEYS,
+        BENCH_KEEP(ava_value_hash_fast(keys[0][bench_i])));
+
+  /* keys[0] is now warm; the others are still cold */
+  start = bench_now();
+  for (i = 1; i < NMAPS; ++i) {
+    map = ava_map_of_values(keys[i], 1, keys[i], 1, NKEYS);
+    BENCH_KEEP(ava_map_npairs(map));
+  }
+  printf("%-48s %12.1f ns/op\n", "build maps, distinct keys",
+         (bench_now() - start) / (NKEYS * (NMAPS-1)));
+
+  start = bench_now();
+  for (i = 1; i < NMAPS; ++i) {
+    map = ava_map_of_values(keys[0], 1, keys[0], 1, NKEYS);
+    BENCH_KEEP(ava_map_npairs(map));
+  }
+  printf("%-48s %12.1f ns/op\n", "build maps, shared keys",
+         (bench_now() - start) / (NKEYS * (NMAPS-1)));
+
+  ava_value_hash_set_default_strategy(ava_vhs_fast);
+  for (i = 1; i < NMAPS; ++i)
+    keys[i] = make_keys();
+  start = bench_now();
+  for (i = 1; i < NMAPS; ++i) {
+    map = ava_map_of_values(keys[i], 1, keys[i], 1, NKEYS);
+    BENCH_KEEP(ava_map_npairs(map));
+  }
+  printf("%-48s %12.1f ns/op\n", "build maps, distinct keys, fast hash",
+         (bench_now() - start) / (NKEYS * (NMAPS-1)));
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef BENCH_H_
+#define BENCH_H_
+
+/**
+ * @file
+ *
+ * Minimal support for the microbenchmarks in this directory.
+ *
+ * The benchmarks are not run as part of `make check`; build them with
+ * `make bench` and run them by hand. Each prints one line per measurement, of
+ * the form "name: N ns/op".
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "runtime/avalanche/defs.h"
+
+/**
+ * Returns the current value of a monotonic clock, in nanoseconds.
+ */
+static inline double bench_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1.0e9 + ts.tv_nsec;
+}
+
+/**
+ * Defeats dead-code elimination of the given value.
+ */
+static volatile ava_ulong bench_sink;
+#define BENCH_KEEP(x) (bench_sink += (ava_ulong)(x))
+
+/**
+ * Runs body n times and reports the mean time per iteration under the given
+ * name.
+ *
+ * The body may refer to the iteration counter `bench_i`.
+ */
+#define BENCH(name, n, body) do {                               \
+    unsigned long long bench_i, bench_n = (n);                  \
+    double bench_start = bench_now();                           \
+    for (bench_i = 0; bench_i < bench_n; ++bench_i) {           \
+      body;                                                     \
+    }                                                           \
+    printf("%-48s %12.1f ns/op\n", (name),                      \
+           (bench_now() - bench_start) / bench_n);              \
+  } while (0)
+
+#endif /* BENCH_H_ */
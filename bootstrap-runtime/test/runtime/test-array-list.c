@@ -52,6 +52,28 @@ deftest(stringification_produces_normal_form) {
                    ava_string_to_cstring(ava_to_string(list.v)));
 }
 
+deftest(cached_string_follows_in_place_append) {
+  /* Appending to a list built from raw values reallocates with spare
+   * capacity, so the second append happens in place.
+   */
+  ava_list_value list = ava_list_append(
+    ava_array_list_of_raw(values, 6), values[6]);
+  ava_list_value longer;
+  ava_string a, b;
+
+  ck_assert_str_eq("a b c d e f g",
+                   ava_string_to_cstring(ava_to_string(list.v)));
+  longer = ava_list_append(list, values[7]);
+  ck_assert_ptr_eq(ava_value_attr(list.v), ava_value_attr(longer.v));
+
+  a = ava_to_string(longer.v);
+  b = ava_to_string(longer.v);
+  ck_assert_str_eq("a b c d e f g h", ava_string_to_cstring(a));
+  ck_assert_ptr_eq(a.twine, b.twine);
+  ck_assert_str_eq("a b c d e f g",
+                   ava_string_to_cstring(ava_to_string(list.v)));
+}
+
 deftest(simple_indexing) {
   ava_list_value list = ava_array_list_of_raw(values, 4);
   unsigned i;
@@ -297,3 +319,58 @@ deftest(set) {
     ck_assert(values_equal(values[2 == i? 20 : i], ava_list_index(new, i)));
   }
 }
+
+deftest(index_range) {
+  ava_list_value list = ava_array_list_of_raw(values, 4);
+  ava_value out[3];
+  unsigned i;
+
+  ava_list_index_range(list, 1, 4, out);
+  for (i = 0; i < 3; ++i)
+    ck_assert(values_equal(values[i+1], out[i]));
+}
+
+deftest(inplace_append_n) {
+  ava_list_value orig = ava_array_list_of_raw(values, 1);
+  /* Grow the array so that the batch fits in-place */
+  ava_list_value old = ava_list_append(orig, values[1]);
+  ava_list_value new = ava_list_append_n(old, values + 2, 3);
+  unsigned i;
+
+  ck_assert_ptr_eq(ava_value_attr(old.v), ava_value_attr(new.v));
+  ck_assert_int_eq(2, ava_list_length(old));
+  ck_assert_int_eq(5, ava_list_length(new));
+  ck_assert_int_eq(5, ava_array_list_used(new.v));
+  for (i = 0; i < 5; ++i)
+    ck_assert(values_equal(values[i], ava_list_index(new, i)));
+}
+
+deftest(conflicting_append_n) {
+  ava_list_value base = ava_list_append(
+    ava_array_list_of_raw(values, 1), values[1]);
+  ava_list_value left = ava_list_append_n(base, values + 2, 2);
+  ava_list_value right = ava_list_append_n(base, values + 4, 2);
+
+  ck_assert_int_eq(4, ava_list_length(left));
+  ck_assert_int_eq(4, ava_list_length(right));
+  ck_assert(values_equal(values[3], ava_list_index(left, 3)));
+  ck_assert(values_equal(values[5], ava_list_index(right, 3)));
+  ck_assert_ptr_ne(ava_value_attr(left.v), ava_value_attr(right.v));
+}
+
+deftest(append_n_past_threshold) {
+  ava_list_value orig = ava_array_list_of_raw(values, 4);
+  ava_list_value new = ava_list_append_n(
+    orig, values + 4, 2 * AVA_ARRAY_LIST_THRESH - 4);
+  unsigned i;
+
+  ck_assert_int_eq(2 * AVA_ARRAY_LIST_THRESH, ava_list_length(new));
+  for (i = 0; i < 2 * AVA_ARRAY_LIST_THRESH; ++i)
+    ck_assert(values_equal(values[i], ava_list_index(new, i)));
+}
+
+deftest(empty_append_n) {
+  ava_list_value orig = ava_array_list_of_raw(values, 4);
+
+  ck_assert(values_equal(orig.v, ava_list_append_n(orig, values, 0).v));
+}
@@ -0,0 +1,344 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "test.c"
+
+#include <stdio.h>
+
+#include "runtime/avalanche/defs.h"
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/map.h"
+#include "runtime/avalanche/ordered-map.h"
+#include "runtime/-btree-map.h"
+#include "runtime/-hash-map.h"
+
+defsuite(btree_map);
+
+static ava_map_value ordered_map_of_cstring(const char* str) {
+  return ava_btree_map_of_list(ava_list_value_of(ava_value_of_cstring(str)));
+}
+
+static void assert_looks_like(const char* expected, ava_value actual) {
+  ck_assert_str_eq(expected, ava_string_to_cstring(ava_to_string(actual)));
+}
+
+/**
+ * Checks the tree's invariants, that every pair can be found as it would be
+ * by a linear scan, and that the key order agrees with ava_value_strcmp().
+ */
+static void assert_consistent(ava_map_value map) {
+  size_t n, i, j;
+  ava_value key, prev;
+  ava_map_cursor cursor, expected;
+
+  ck_assert(ava_btree_map_check(map));
+
+  n = ava_map_npairs(map);
+  for (i = 0; i < n; ++i) {
+    key = ava_list_index(map.v, i*2);
+
+    for (j = 0; !ava_value_equal(key, ava_list_index(map.v, j*2)); ++j);
+    ck_assert_int_eq(j, ava_map_find(map, key));
+
+    for (j = i + 1; j < n &&
+           !ava_value_equal(key, ava_list_index(map.v, j*2)); ++j);
+    expected = j < n? j : AVA_MAP_CURSOR_NONE;
+    ck_assert_int_eq(expected, ava_map_next(map, i));
+  }
+
+  for (i = 0; i < n; ++i) {
+    cursor = ava_ordered_map_cursor_at(map, i);
+    key = ava_map_get_key(map, cursor);
+    if (i > 0)
+      ck_assert_int_le(ava_value_strcmp(prev, key), 0);
+    prev = key;
+  }
+}
+
+static ava_value random_key(unsigned* state) {
+  char str[32];
+
+  *state = *state * 1103515245 + 12345;
+  switch ((*state >> 16) % 4) {
+  case 0:
+    return ava_value_of_integer((ava_integer)(*state >> 8) % 200 - 100);
+
+  case 1:
+    snprintf(str, sizeof(str), "k%u", (*state >> 8) % 100);
+    return ava_value_of_cstring(str);
+
+  case 2:
+    snprintf(str, sizeof(str), "a-longer-key-%u", (*state >> 8) % 100);
+    return ava_value_of_cstring(str);
+
+  default:
+    return ava_value_of_integer(
+      ((ava_integer)*state << 20) * ((*state & 1)? -1 : 1));
+  }
+}
+
+deftest(list_construction) {
+  ava_map_value map = ordered_map_of_cstring("foo bar baz quux foo plugh");
+
+  ck_assert_int_eq(3, ava_map_npairs(map));
+  ck_assert(ava_map_is_ordered(map));
+  assert_looks_like("foo bar baz quux foo plugh", map.v);
+
+  ck_assert_int_eq(0, ava_map_find(map, WORD(foo)));
+  ck_assert_int_eq(2, ava_map_next(map, 0));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(map, 2));
+  ck_assert_int_eq(1, ava_map_find(map, WORD(baz)));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(map, 1));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, WORD(xyzzy)));
+  assert_values_equal(WORD(plugh), ava_map_get(map, 2));
+  assert_values_equal(WORD(foo), ava_map_get_key(map, 2));
+  assert_consistent(map);
+}
+
+deftest(empty_list_produces_empty_map) {
+  ava_map_value map = ava_btree_map_of_list(ava_empty_list());
+
+  ck_assert_int_eq(0, ava_map_npairs(map));
+  ck_assert(ava_map_is_ordered(map));
+  ck_assert_int_eq(0, ava_ordered_map_lower_bound(map, WORD(foo)));
+  ck_assert_int_eq(0, ava_ordered_map_upper_bound(map, WORD(foo)));
+  ck_assert_int_eq(0, ava_list_length(
+                     ava_ordered_map_range(map, WORD(a), WORD(z)).v));
+}
+
+deftest(ordered_map_of_converts_other_maps) {
+  ava_value keys[] = { WORD(e), WORD(d), WORD(c), WORD(b), WORD(a) };
+  ava_map_value hash = ava_hash_map_of_raw(keys, 1, keys, 1, 5);
+  ava_map_value ordered;
+
+  ck_assert(!ava_map_is_ordered(hash));
+  ordered = ava_ordered_map_of(hash);
+  ck_assert(ava_map_is_ordered(ordered));
+  assert_values_equal(hash.v, ordered.v);
+  assert_consistent(ordered);
+
+  ck_assert_ptr_eq(ava_value_attr(ordered.v),
+                   ava_value_attr(ava_ordered_map_of(ordered).v));
+}
+
+deftest(key_order_is_lexical) {
+  ava_value elements[] = {
+    INT(10), WORD(a),
+    INT(9), WORD(b),
+    INT(-1), WORD(c),
+    WORD(abc), WORD(d),
+    ava_value_of_cstring("a-longer-key"), WORD(e),
+    INT(100), WORD(f),
+    WORD(0x2A), WORD(g),
+  };
+  ava_map_value map = ava_btree_map_of_list(ava_list_of_values(
+                                              elements, 14));
+
+  assert_looks_like("-1 c 0x2A g 10 a 100 f 9 b a-longer-key e abc d",
+                    ava_ordered_map_slice(map, 0, 7).v);
+  assert_looks_like("100 f 9 b",
+                    ava_ordered_map_slice(map, 3, 5).v);
+  assert_consistent(map);
+}
+
+deftest(integer_order_agrees_with_strings) {
+  static const ava_integer special[] = {
+    0, 1, -1, 9, 10, 11, 99, 100, 101, -9, -10, -100,
+    12345678, 123456789, 1234567890, 123456780, 12345679,
+    -12345678, -123456789, -1234567890,
+    99999999, 100000000, 999999999999999999LL, 1000000000000000000LL,
+    0x7FFFFFFFFFFFFFFFLL, -0x7FFFFFFFFFFFFFFFLL - 1,
+  };
+  ava_value elements[2 * (26 + 200)];
+  ava_map_value map;
+  unsigned state = 42;
+  size_t i, n = 0;
+  ava_string prev, curr;
+
+  for (i = 0; i < sizeof(special) / sizeof(special[0]); ++i) {
+    elements[n++] = ava_value_of_integer(special[i]);
+    elements[n++] = WORD(x);
+  }
+  for (i = 0; i < 200; ++i) {
+    state = state * 1103515245 + 12345;
+    elements[n++] = ava_value_of_integer((ava_integer)(
+      ((ava_ulong)state << (state % 40)) * ((state & 2)? -1 : 1)));
+    elements[n++] = WORD(y);
+  }
+
+  map = ava_btree_map_of_list(ava_list_of_values(elements, n));
+  for (i = 1; i < n/2; ++i) {
+    prev = ava_to_string(ava_map_get_key(
+                           map, ava_ordered_map_cursor_at(map, i-1)));
+    curr = ava_to_string(ava_map_get_key(
+                           map, ava_ordered_map_cursor_at(map, i)));
+    ck_assert_int_le(ava_strcmp(prev, curr), 0);
+  }
+
+  assert_consistent(map);
+}
+
+deftest(keys_sharing_prefixes) {
+  ava_map_value map = ordered_map_of_cstring(
+    "prefix-b 1 prefix-ab 2 prefix- 3 prefix-a 4 prefix-a 5 prefi 6");
+
+  assert_looks_like("prefi 6 prefix- 3 prefix-a 4 prefix-a 5 "
+                    "prefix-ab 2 prefix-b 1",
+                    ava_ordered_map_slice(map, 0, 6).v);
+  ck_assert_int_eq(3, ava_map_find(map, WORD(prefix-a)));
+  ck_assert_int_eq(4, ava_map_next(map, 3));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE,
+                   ava_map_find(map, WORD(prefix-aa)));
+  assert_consistent(map);
+}
+
+deftest(equal_keys_keep_map_order) {
+  ava_map_value map = ordered_map_of_cstring("k v1 j x k v2 l y k v3");
+
+  assert_looks_like("j x k v1 k v2 k v3 l y",
+                    ava_ordered_map_slice(map, 0, 5).v);
+  ck_assert_int_eq(1, ava_ordered_map_lower_bound(map, WORD(k)));
+  ck_assert_int_eq(4, ava_ordered_map_upper_bound(map, WORD(k)));
+}
+
+deftest(bounds_of_absent_keys) {
+  ava_map_value map = ordered_map_of_cstring("b 1 d 2 f 3");
+
+  ck_assert_int_eq(0, ava_ordered_map_lower_bound(map, WORD(a)));
+  ck_assert_int_eq(0, ava_ordered_map_upper_bound(map, WORD(a)));
+  ck_assert_int_eq(1, ava_ordered_map_lower_bound(map, WORD(c)));
+  ck_assert_int_eq(1, ava_ordered_map_upper_bound(map, WORD(c)));
+  ck_assert_int_eq(3, ava_ordered_map_lower_bound(map, WORD(g)));
+  ck_assert_int_eq(3, ava_ordered_map_upper_bound(map, WORD(g)));
+}
+
+deftest(range_is_inclusive) {
+  ava_map_value map = ordered_map_of_cstring("e 5 a 1 c 3 b 2 d 4 c 6");
+
+  assert_looks_like("b 2 c 3 c 6 d 4",
+                    ava_ordered_map_range(map, WORD(b), WORD(d)).v);
+  assert_looks_like("c 3 c 6",
+                    ava_ordered_map_range(map, WORD(c), WORD(c)).v);
+  assert_looks_like("d 4 e 5",
+                    ava_ordered_map_range(map, WORD(cc), WORD(z)).v);
+  assert_looks_like("", ava_ordered_map_range(map, WORD(d), WORD(b)).v);
+  assert_looks_like("", ava_ordered_map_range(map, WORD(f), WORD(z)).v);
+}
+
+deftest(range_of_unordered_map) {
+  ava_value keys[] = { INT(5), INT(3), INT(1), INT(4), INT(2) };
+  ava_map_value hash = ava_hash_map_of_raw(keys, 1, keys, 1, 5);
+
+  assert_looks_like("2 2 3 3 4 4",
+                    ava_ordered_map_range(hash, INT(2), INT(4)).v);
+  ck_assert_int_eq(1, ava_ordered_map_lower_bound(hash, INT(2)));
+}
+
+deftest(cursor_at_walks_key_order) {
+  ava_map_value map = ordered_map_of_cstring("c 1 a 2 b 3");
+
+  assert_values_equal(WORD(a), ava_map_get_key(
+                        map, ava_ordered_map_cursor_at(map, 0)));
+  assert_values_equal(WORD(3), ava_map_get(
+                        map, ava_ordered_map_cursor_at(map, 1)));
+  ck_assert_int_eq(0, ava_ordered_map_cursor_at(map, 2));
+}
+
+deftest(add_splits_nodes) {
+  ava_map_value map = ordered_map_of_cstring("k0 v");
+  ava_value key;
+  unsigned state = 1, i;
+
+  for (i = 0; i < 600; ++i) {
+    key = random_key(&state);
+    map = ava_map_add(map, key, ava_value_of_integer(i));
+    ck_assert(ava_map_is_ordered(map));
+    if (0 == i % 50)
+      assert_consistent(map);
+  }
+
+  ck_assert_int_eq(601, ava_map_npairs(map));
+  ck_assert_int_ge(ava_btree_map_height(map), 2);
+  assert_consistent(map);
+  assert_values_equal(INT(599), ava_map_get(map, 600));
+}
+
+deftest(add_preserves_original) {
+  ava_map_value orig = ordered_map_of_cstring("a 1 b 2 c 3 d 4 e 5 f 6 g 7 h 8");
+  ava_map_value added = ava_map_add(orig, WORD(a), WORD(9));
+
+  assert_looks_like("a 1 b 2 c 3 d 4 e 5 f 6 g 7 h 8", orig.v);
+  assert_looks_like("a 1 b 2 c 3 d 4 e 5 f 6 g 7 h 8 a 9", added.v);
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(orig, 0));
+  ck_assert_int_eq(8, ava_map_next(added, 0));
+  assert_consistent(orig);
+  assert_consistent(added);
+}
+
+deftest(set_keeps_tree) {
+  ava_map_value map = ordered_map_of_cstring("a 1 b 2 a 3");
+
+  map = ava_map_set(map, 2, WORD(x));
+  ck_assert(ava_map_is_ordered(map));
+  assert_looks_like("a 1 b 2 a x", map.v);
+  ck_assert_int_eq(2, ava_map_next(map, 0));
+  assert_values_equal(WORD(x), ava_map_get(map, 2));
+  assert_consistent(map);
+}
+
+deftest(remove_renumbers_cursors) {
+  ava_map_value map = ordered_map_of_cstring("a 1 b 2 a 3 c 4 a 5");
+
+  map = ava_map_remove(map, 1);
+  ck_assert(ava_map_is_ordered(map));
+  assert_looks_like("a 1 a 3 c 4 a 5", map.v);
+  ck_assert_int_eq(0, ava_map_find(map, WORD(a)));
+  ck_assert_int_eq(1, ava_map_next(map, 0));
+  ck_assert_int_eq(3, ava_map_next(map, 1));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, WORD(b)));
+  assert_consistent(map);
+}
+
+deftest(remove_last_pair) {
+  ava_map_value map = ordered_map_of_cstring("a 1");
+
+  map = ava_map_remove(map, 0);
+  ck_assert_int_eq(0, ava_map_npairs(map));
+}
+
+deftest(random_adds_and_removes) {
+  ava_map_value map = ordered_map_of_cstring("k0 v");
+  unsigned state = 7, i;
+  size_t n;
+
+  for (i = 0; i < 1000; ++i) {
+    n = ava_map_npairs(map);
+    state = state * 1103515245 + 12345;
+    if (n > 1 && 0 == (state >> 16) % 3) {
+      map = ava_map_remove(map, (state >> 8) % n);
+    } else {
+      map = ava_map_add(map, random_key(&state), ava_value_of_integer(i));
+    }
+
+    if (0 == i % 100)
+      assert_consistent(map);
+  }
+
+  assert_consistent(map);
+}
@@ -25,6 +25,7 @@
 #include "runtime/avalanche/integer.h"
 #include "runtime/-array-list.h"
 #include "runtime/-esba-list.h"
+#include "runtime/-rrb-list.h"
 
 defsuite(esba_list);
 
@@ -34,7 +35,7 @@ deftest(single_element_list) {
 
   ck_assert_int_eq(1, ava_list_length(list));
   assert_values_equal(fourty_two, ava_list_index(list, 0));
-  ck_assert_int_eq(0, ava_esba_list_element_size(list.v));
+  ck_assert_int_eq(0, ava_esba_list_element_bits(list.v));
 }
 
 /* The following couple of tests specifically test handling of zero-sized
@@ -49,7 +50,7 @@ deftest(identical_append) {
     list = ava_list_append(list, fourty_two);
 
   ck_assert_int_eq(256, ava_list_length(list));
-  ck_assert_int_eq(0, ava_esba_list_element_size(list.v));
+  ck_assert_int_eq(0, ava_esba_list_element_bits(list.v));
   for (i = 0; i < 256; ++i)
     assert_values_equal(fourty_two, ava_list_index(list, i));
 }
@@ -63,7 +64,7 @@ deftest(identical_set) {
     list = ava_list_set(list, 0, fourty_two);
 
   ck_assert_int_eq(1, ava_list_length(list));
-  ck_assert_int_eq(0, ava_esba_list_element_size(list.v));
+  ck_assert_int_eq(0, ava_esba_list_element_bits(list.v));
   assert_values_equal(fourty_two, ava_list_index(list, 0));
 }
 
@@ -76,7 +77,7 @@ deftest(polymorphic_value_append) {
     list = ava_list_append(list, ava_value_of_integer(i));
 
   ck_assert_int_eq(256, ava_list_length(list));
-  ck_assert_int_eq(sizeof(ava_ulong), ava_esba_list_element_size(list.v));
+  ck_assert_int_eq(16, ava_esba_list_element_bits(list.v));
   for (i = 0; i < 256; ++i)
     ck_assert_int_eq(i, ava_integer_of_value(ava_list_index(list, i), -1));
 }
@@ -88,7 +89,7 @@ deftest(polymorphic_value_and_type_append) {
   list = ava_list_append(list, string);
 
   ck_assert_int_eq(2, ava_list_length(list));
-  ck_assert_int_eq(sizeof(ava_value), ava_esba_list_element_size(list.v));
+  ck_assert_int_eq(8 * sizeof(ava_value), ava_esba_list_element_bits(list.v));
   assert_values_equal(fourty_two, ava_list_index(list, 0));
   assert_values_equal(string, ava_list_index(list, 1));
 }
@@ -103,7 +104,7 @@ deftest(fully_polymorphic_append) {
   list = ava_list_append(list, list_value);
 
   ck_assert_int_eq(3, ava_list_length(list));
-  ck_assert_int_eq(sizeof(ava_value), ava_esba_list_element_size(list.v));
+  ck_assert_int_eq(8 * sizeof(ava_value), ava_esba_list_element_bits(list.v));
   assert_values_equal(fourty_two, ava_list_index(list, 0));
   assert_values_equal(string, ava_list_index(list, 1));
   assert_values_equal(list_value, ava_list_index(list, 2));
@@ -387,3 +388,309 @@ deftest(incompatible_set) {
   assert_values_equal(str, ava_list_index(result, 1));
   assert_values_equal(values[2], ava_list_index(result, 2));
 }
+
+deftest(index_range_matches_index) {
+  ava_value values[300], out[300];
+  ava_list_value list;
+  unsigned i;
+
+  for (i = 0; i < 300; ++i)
+    values[i] = ava_value_of_integer(i);
+  list = ava_esba_list_of_raw(values, 300);
+
+  ava_list_index_range(list, 0, 0, out);
+  ava_list_index_range(list, 17, 283, out);
+  for (i = 17; i < 283; ++i)
+    assert_values_equal(values[i], out[i - 17]);
+}
+
+deftest(index_range_on_polymorphic_list) {
+  ava_value values[4] = {
+    ava_value_of_integer(0),
+    ava_value_of_string(ava_string_of_cstring("foo")),
+    ava_value_of_integer(2),
+    ava_value_of_string(ava_string_of_cstring("bar")),
+  };
+  ava_value out[3];
+  ava_list_value list = ava_esba_list_of_raw(values, 4);
+  unsigned i;
+
+  ava_list_index_range(list, 1, 4, out);
+  for (i = 0; i < 3; ++i)
+    assert_values_equal(values[i + 1], out[i]);
+}
+
+deftest(append_n_matches_append) {
+  ava_value values[300];
+  ava_list_value batched, single;
+  unsigned i;
+
+  for (i = 0; i < 300; ++i)
+    values[i] = ava_value_of_integer(i);
+
+  batched = ava_esba_list_of_raw(values, 1);
+  single = batched;
+  for (i = 1; i < 300; i += 37)
+    batched = ava_list_append_n(batched, values + i,
+                                i + 37 < 300? 37 : 300 - i);
+  for (i = 1; i < 300; ++i)
+    single = ava_list_append(single, values[i]);
+
+  ck_assert_int_eq(300, ava_list_length(batched));
+  ck_assert_int_eq(ava_esba_list_element_bits(single.v),
+                   ava_esba_list_element_bits(batched.v));
+  for (i = 0; i < 300; ++i)
+    assert_values_equal(values[i], ava_list_index(batched, i));
+}
+
+deftest(polymorphic_append_n) {
+  ava_value fourty_two = ava_value_of_integer(42);
+  ava_value values[3] = {
+    ava_value_of_integer(42),
+    ava_value_of_string(ava_string_of_cstring("hello world")),
+    ava_value_of_integer(56),
+  };
+  ava_list_value list = ava_esba_list_of_raw(&fourty_two, 1);
+  ava_list_value result = ava_list_append_n(list, values, 3);
+  unsigned i;
+
+  ck_assert_int_eq(1, ava_list_length(list));
+  ck_assert_int_eq(0, ava_esba_list_element_bits(list.v));
+  ck_assert_int_eq(4, ava_list_length(result));
+  ck_assert_int_eq(8 * sizeof(ava_value),
+                   ava_esba_list_element_bits(result.v));
+  assert_values_equal(fourty_two, ava_list_index(result, 0));
+  for (i = 0; i < 3; ++i)
+    assert_values_equal(values[i], ava_list_index(result, i + 1));
+}
+
+deftest(cached_string_follows_versions) {
+  ava_value values[8];
+  ava_list_value list, set, appended;
+  unsigned i;
+
+  for (i = 0; i < 8; ++i)
+    values[i] = ava_value_of_integer(i);
+  /* Make the list polymorphic so it isn't a numeric list */
+  values[7] = ava_value_of_cstring("x");
+
+  list = ava_esba_list_of_raw(values, 8);
+  ck_assert_str_eq("0 1 2 3 4 5 6 x", ava_string_to_cstring(
+                     ava_to_string(list.v)));
+  ck_assert_str_eq("0 1 2 3 4 5 6 x", ava_string_to_cstring(
+                     ava_to_string(list.v)));
+
+  set = ava_list_set(list, 0, ava_value_of_integer(9));
+  ck_assert_str_eq("9 1 2 3 4 5 6 x", ava_string_to_cstring(
+                     ava_to_string(set.v)));
+  ck_assert_str_eq("0 1 2 3 4 5 6 x", ava_string_to_cstring(
+                     ava_to_string(list.v)));
+
+  appended = ava_list_append(set, ava_value_of_integer(8));
+  ck_assert_str_eq("9 1 2 3 4 5 6 x 8", ava_string_to_cstring(
+                     ava_to_string(appended.v)));
+  ck_assert_str_eq("9 1 2 3 4 5 6 x", ava_string_to_cstring(
+                     ava_to_string(set.v)));
+}
+
+deftest(booleans_packed_into_bits) {
+  ava_value values[200];
+  ava_list_value list;
+  unsigned i;
+
+  for (i = 0; i < 200; ++i)
+    values[i] = ava_value_of_integer(i % 3 == 0);
+
+  list = ava_esba_list_of_raw(values, 200);
+  ck_assert_int_eq(200, ava_list_length(list));
+  ck_assert_int_eq(1, ava_esba_list_element_bits(list.v));
+  for (i = 0; i < 200; ++i)
+    assert_values_equal(values[i], ava_list_index(list, i));
+}
+
+deftest(small_integers_packed_by_range) {
+  ava_value values[3] = {
+    ava_value_of_integer(0),
+    ava_value_of_integer(1),
+  };
+  ava_slong third[5] = { -128, 255, 32767, -2147483648LL, 2147483648LL };
+  unsigned expected[5] = { 8, 8, 16, 32, 64 };
+  ava_list_value list;
+  unsigned i;
+
+  for (i = 0; i < 5; ++i) {
+    values[2] = ava_value_of_integer(third[i]);
+    list = ava_esba_list_of_raw(values, 3);
+    ck_assert_int_eq(expected[i], ava_esba_list_element_bits(list.v));
+    assert_values_equal(values[2], ava_list_index(list, 2));
+  }
+}
+
+deftest(packed_list_widened_as_needed) {
+  ava_value values[100];
+  ava_list_value list, appended, set, wide;
+  unsigned i;
+
+  for (i = 0; i < 100; ++i)
+    values[i] = ava_value_of_integer(i & 1);
+
+  list = ava_esba_list_of_raw(values, 100);
+  appended = ava_list_append(list, ava_value_of_integer(-5));
+  ck_assert_int_eq(8, ava_esba_list_element_bits(appended.v));
+  set = ava_list_set(appended, 42, ava_value_of_integer(1000));
+  ck_assert_int_eq(16, ava_esba_list_element_bits(set.v));
+  wide = ava_list_append(set, ava_value_of_integer(100000));
+  ck_assert_int_eq(32, ava_esba_list_element_bits(wide.v));
+
+  ck_assert_int_eq(1, ava_esba_list_element_bits(list.v));
+  ck_assert_int_eq(102, ava_list_length(wide));
+  for (i = 0; i < 100; ++i) {
+    assert_values_equal(values[i], ava_list_index(list, i));
+    if (42 != i)
+      assert_values_equal(values[i], ava_list_index(wide, i));
+  }
+  assert_values_equal(ava_value_of_integer(1000), ava_list_index(wide, 42));
+  assert_values_equal(ava_value_of_integer(-5), ava_list_index(wide, 100));
+  assert_values_equal(ava_value_of_integer(100000),
+                      ava_list_index(wide, 101));
+}
+
+deftest(packed_versions_fill_shared_word_independently) {
+  ava_value values[3] = {
+    ava_value_of_integer(5),
+    ava_value_of_integer(6),
+    ava_value_of_integer(7),
+  };
+  ava_list_value list = ava_esba_list_of_raw(values, 3);
+  ava_list_value a = ava_list_append(list, ava_value_of_integer(10));
+  ava_list_value b = ava_list_append(list, ava_value_of_integer(20));
+
+  ck_assert_int_eq(8, ava_esba_list_element_bits(list.v));
+  ck_assert_int_eq(3, ava_list_length(list));
+  ck_assert_int_eq(4, ava_list_length(a));
+  ck_assert_int_eq(4, ava_list_length(b));
+  assert_values_equal(ava_value_of_integer(10), ava_list_index(a, 3));
+  assert_values_equal(ava_value_of_integer(20), ava_list_index(b, 3));
+  assert_values_equal(ava_value_of_integer(7), ava_list_index(a, 2));
+  assert_values_equal(ava_value_of_integer(7), ava_list_index(b, 2));
+}
+
+deftest(bytes_packed_into_bytes) {
+  ava_value values[256];
+  ava_list_value list, signed_list;
+  unsigned i;
+
+  for (i = 0; i < 256; ++i)
+    values[i] = ava_value_of_integer(i);
+
+  list = ava_esba_list_of_raw(values, 256);
+  ck_assert_int_eq(8, ava_esba_list_element_bits(list.v));
+  for (i = 0; i < 256; ++i)
+    assert_values_equal(values[i], ava_list_index(list, i));
+
+  /* Bytes and negative numbers together need 16 bits */
+  signed_list = ava_list_append(list, ava_value_of_integer(-1));
+  ck_assert_int_eq(16, ava_esba_list_element_bits(signed_list.v));
+  assert_values_equal(ava_value_of_integer(255),
+                      ava_list_index(signed_list, 255));
+  assert_values_equal(ava_value_of_integer(-1),
+                      ava_list_index(signed_list, 256));
+}
+
+deftest(packed_append_leaves_older_versions_fresh) {
+  ava_value values[AVA_RRB_LIST_THRESH + 3];
+  ava_list_value versions[65];
+  unsigned i, j;
+
+  for (i = 0; i < AVA_RRB_LIST_THRESH + 3; ++i)
+    values[i] = ava_value_of_integer(i % 100);
+
+  /* Start with a partial last word, then keep every version alive and read
+   * it after each append. Were appends to replace the shared partial word,
+   * each read would copy the array out and the list would soon become an
+   * RRB list.
+   */
+  versions[0] = ava_esba_list_of_raw(values, AVA_RRB_LIST_THRESH + 3);
+  for (i = 1; i < 65; ++i) {
+    versions[i] = ava_list_append(versions[i-1], ava_value_of_integer(i));
+    assert_values_equal(ava_value_of_integer(2 + i / 8),
+                        ava_list_index(versions[i-1], 2 + i / 8));
+  }
+
+  ck_assert(!ava_list_is_rrb_list(versions[64]));
+  ck_assert_int_eq(8, ava_esba_list_element_bits(versions[64].v));
+  for (i = 0; i < 65; ++i) {
+    ck_assert_int_eq(AVA_RRB_LIST_THRESH + 3 + i,
+                     ava_list_length(versions[i]));
+    for (j = 1; j <= i; ++j)
+      assert_values_equal(
+        ava_value_of_integer(j),
+        ava_list_index(versions[i], AVA_RRB_LIST_THRESH + 2 + j));
+  }
+}
+
+deftest(packed_set_in_partial_word) {
+  ava_value values[11];
+  ava_list_value list, set;
+  unsigned i;
+
+  for (i = 0; i < 11; ++i)
+    values[i] = ava_value_of_integer(i);
+
+  list = ava_esba_list_of_raw(values, 11);
+  set = ava_list_set(list, 9, ava_value_of_integer(-9));
+  assert_values_equal(ava_value_of_integer(-9), ava_list_index(set, 9));
+  assert_values_equal(ava_value_of_integer(9), ava_list_index(list, 9));
+  assert_values_equal(ava_value_of_integer(10), ava_list_index(set, 10));
+  ck_assert_int_eq(11, ava_list_length(set));
+}
+
+deftest(packed_prefix_through_same_attribute) {
+  static const unsigned lengths[] = { 8, 11 };
+  ava_value values[11];
+  ava_list_value list, prefix;
+  unsigned i, j, k;
+
+  for (i = 0; i < 11; ++i)
+    values[i] = ava_value_of_integer(i + 1000);
+
+  /* Clients such as the hash map keep one attribute and read shorter lengths
+   * through it, both of a whole-word list and of one ending in a tail.
+   */
+  for (k = 0; k < 2; ++k) {
+    j = lengths[k];
+    list = ava_esba_list_of_raw(values, j);
+    for (i = 1; i <= j; ++i) {
+      prefix = (ava_list_value) {
+        ava_value_with_ulong(ava_value_attr(list.v), i)
+      };
+      assert_values_equal(values[i - 1], ava_list_index(prefix, i - 1));
+      assert_values_equal(ava_value_of_integer(-1),
+                          ava_list_index(ava_list_append(
+                                           prefix, ava_value_of_integer(-1)),
+                                         i));
+    }
+  }
+}
+
+deftest(packed_remove_and_slice_unaligned) {
+  ava_value values[100], out[40];
+  ava_list_value list, removed, sliced;
+  unsigned i;
+
+  for (i = 0; i < 100; ++i)
+    values[i] = ava_value_of_integer((ava_integer)i - 50);
+
+  list = ava_esba_list_of_raw(values, 100);
+  removed = ava_list_remove(list, 3, 58);
+  ck_assert_int_eq(45, ava_list_length(removed));
+  for (i = 0; i < 45; ++i)
+    assert_values_equal(values[i < 3? i : i + 55],
+                        ava_list_index(removed, i));
+
+  sliced = ava_list_slice(list, 13, 53);
+  ck_assert_int_eq(40, ava_list_length(sliced));
+  ava_list_index_range(sliced, 0, 40, out);
+  for (i = 0; i < 40; ++i)
+    assert_values_equal(values[i + 13], out[i]);
+}
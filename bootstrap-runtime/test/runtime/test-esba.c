@@ -300,3 +300,34 @@ deftest(two_part_append) {
   ck_assert_int_eq(42, get_at(right, 0));
   ck_assert_int_eq(56, get_at(right, 1));
 }
+
+deftest(stats_count_contention) {
+  ava_esba base, left, right, conflict;
+  ava_esba_stats stats;
+
+  ava_esba_reset_stats();
+  base = ava_esba_append(new(), (ava_ulong[]) { 0, 0, 0 }, 3);
+  left = set_at(base, 0, 1);
+  right = set_at(left, 1, 2);
+  /* left is stale, so this loses the race for the array and replays one
+   * rollback entry.
+   */
+  conflict = set_at(left, 2, 3);
+  /* base is two versions behind, so reading it replays two entries */
+  ck_assert_int_eq(0, get_at(base, 0));
+  ck_assert_int_eq(2, get_at(right, 1));
+  ck_assert_int_eq(3, get_at(conflict, 2));
+
+  if (ava_esba_get_stats(&stats)) {
+    ck_assert_int_eq(1, stats.cas_failures);
+    ck_assert_int_eq(2, stats.copy_outs);
+    ck_assert_int_eq(2, stats.stale_copy_outs);
+    ck_assert_int_eq(0, stats.lost_freshen_races);
+    ck_assert_int_eq(3, stats.replayed_entries);
+    ck_assert_int_eq(2, stats.longest_replay);
+  } else {
+    ck_assert_int_eq(0, stats.cas_failures);
+    ck_assert_int_eq(0, stats.copy_outs);
+    ck_assert_int_eq(0, stats.replayed_entries);
+  }
+}
@@ -1549,6 +1549,19 @@ TEST_INVOKE(invoke_varargs, "a b c d e f g",
             { .type = ava_fpt_spread, .value = WORD(f g) },
             { .type = ava_fpt_spread, .value = ava_empty_list().v })
 
+TEST_INVOKE(invoke_many_varargs,
+            "a b c d e f g h i j k l m n o p q r s t u v w x y",
+            "ava varargs",
+            ava_value, (ava_value v), v,
+            STATWORD(a), STATWORD(b), STATWORD(c), STATWORD(d),
+            STATWORD(e), STATWORD(f), STATWORD(g), STATWORD(h),
+            STATWORD(i), STATWORD(j), STATWORD(k), STATWORD(l),
+            STATWORD(m), STATWORD(n), STATWORD(o), STATWORD(p),
+            STATWORD(q), STATWORD(r),
+            { .type = ava_fpt_spread, .value = WORD(s t) },
+            STATWORD(u), STATWORD(v), STATWORD(w), STATWORD(x),
+            STATWORD(y))
+
 TEST_INVOKE(invoke_explosively, "abcd e fg",
             "ava pos \"named -b b\" \"named -c\" varargs pos",
             ava_value, (ava_value a, ava_value b, ava_value c, ava_value va,
@@ -1558,6 +1571,33 @@ TEST_INVOKE(invoke_explosively, "abcd e fg",
             { .type = ava_fpt_spread,
                 .value = ava_value_of_cstring("-c c -b b d e f g") })
 
+static ava_value long_spread_f(ava_value first, ava_value middle,
+                               ava_value last) {
+  return cat(3, first,
+             ava_value_of_integer(ava_list_length(ava_list_value_of(middle))),
+             last);
+}
+
+deftest(invoke_explosively_with_long_spread) {
+  char funspec[256];
+  ava_value elements[150];
+  ava_function_parameter parms[1];
+  unsigned i;
+
+  for (i = 0; i < 150; ++i)
+    elements[i] = INT(i);
+
+  /* Spans positional parameters, so it must be exploded, and is longer than
+   * the block in which spreads are read.
+   */
+  parms[0].type = ava_fpt_spread;
+  parms[0].value = ava_list_of_values(elements, 150).v;
+  snprintf(funspec, sizeof(funspec), "%lld ava pos varargs pos",
+           (long long)long_spread_f);
+  assert_value_equals_str(
+    "0148149", ava_function_bind_invoke(of_cstring(funspec), 1, parms));
+}
+
 static const char* strplus(const char* base, unsigned offset) {
   return base + offset;
 }
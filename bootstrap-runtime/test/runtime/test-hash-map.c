@@ -16,6 +16,7 @@
 #include "test.c"
 
 #include "runtime/avalanche/defs.h"
+#include "runtime/avalanche/alloc.h"
 #include "runtime/avalanche/string.h"
 #include "runtime/avalanche/value.h"
 #include "runtime/avalanche/integer.h"
@@ -25,6 +26,9 @@
 
 defsuite(hash_map);
 
+/* A key which is neither an ASCII9 string nor an integer */
+#define LONG_KEY ava_value_of_cstring("a-longer-key")
+
 deftest(array_construction) {
   ava_value keys[] = { WORD(foo), WORD(bar) };
   ava_value values[] = { WORD(plugh), WORD(xyzzy) };
@@ -660,3 +664,382 @@ deftest(list_set) {
   result = ava_list_set(map, 1, WORD(xyzzy));
   assert_value_equals_str("0 xyzzy 2 3", result);
 }
+
+deftest(fast_strategy_used_for_non_ascii9_keys) {
+  ava_value values[] = {
+    WORD(foo), WORD(bar),
+    INT(42), INT(56),
+  };
+  ava_map_value map = ava_hash_map_of_list_with_strategy(
+    ava_list_of_values(values, 4), ava_vhs_fast);
+  ava_map_cursor cursor;
+
+  ck_assert_str_eq("fast", ava_hash_map_get_hash_function(map));
+
+  cursor = ava_map_find(map, WORD(foo));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(WORD(bar), ava_map_get(map, cursor));
+  cursor = ava_map_find(map, INT(42));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(INT(56), ava_map_get(map, cursor));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, INT(56)));
+}
+
+deftest(fast_strategy_still_prefers_ascii9) {
+  ava_map_value map = ava_hash_map_of_raw_with_strategy(
+    (ava_value[]) { WORD(foo) }, 1,
+    (ava_value[]) { WORD(bar) }, 1, 1, ava_vhs_fast);
+
+  ck_assert_str_eq("ascii9", ava_hash_map_get_hash_function(map));
+
+  map = ava_map_add(map, INT(42), INT(56));
+  ck_assert_str_eq("fast", ava_hash_map_get_hash_function(map));
+  assert_value_equals_str("foo bar 42 56", map.v);
+}
+
+deftest(default_strategy_applies_to_new_maps) {
+  ava_map_value map;
+
+  ava_value_hash_set_default_strategy(ava_vhs_fast);
+  map = ava_hash_map_of_list(
+    ava_list_of_values((ava_value[]) { LONG_KEY, INT(2) }, 2));
+  ava_value_hash_set_default_strategy(ava_vhs_siphash);
+
+  ck_assert_str_eq("fast", ava_hash_map_get_hash_function(map));
+  ck_assert_int_eq(ava_vhs_siphash, ava_value_hash_get_default_strategy());
+}
+
+deftest(fast_hashing_switches_to_value_hashing_on_too_many_collisions) {
+  ava_map_value map = ava_hash_map_of_list_with_strategy(
+    ava_list_of_values(
+      (ava_value[]) { LONG_KEY, INT(0) }, 2), ava_vhs_fast);
+  ava_map_cursor cursor;
+  unsigned i;
+
+  ck_assert_str_eq("fast", ava_hash_map_get_hash_function(map));
+
+  /* As with the ASCII9 test, duplicates stand in for real collisions */
+  for (i = 1; i < 512; ++i)
+    map = ava_map_add(map, LONG_KEY, INT(i));
+
+  ck_assert_str_eq("value", ava_hash_map_get_hash_function(map));
+
+  cursor = ava_map_find(map, LONG_KEY);
+  for (i = 0; i < 512; ++i) {
+    ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+    assert_values_equal(INT(i), ava_map_get(map, cursor));
+    cursor = ava_map_next(map, cursor);
+  }
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, cursor);
+
+  /* Further growth doesn't go back to the fast hash */
+  for (i = 0; i < 1024; ++i)
+    map = ava_map_add(map, INT(i), INT(i));
+  ck_assert_str_eq("value", ava_hash_map_get_hash_function(map));
+}
+
+deftest(fast_strategy_survives_promotion) {
+  ava_map_value map = ava_hash_map_of_list_with_strategy(
+    ava_list_of_values((ava_value[]) { LONG_KEY, INT(0) }, 2), ava_vhs_fast);
+  unsigned i;
+
+  /* Grows past the limit of the 16-bit specialisation */
+  for (i = 0; i < 8192; ++i)
+    map = ava_map_add(map, INT(i), INT(i));
+
+  ck_assert_str_eq("fast", ava_hash_map_get_hash_function(map));
+  for (i = 0; i < 8192; i += 97)
+    assert_values_equal(INT(i), ava_map_get(map, ava_map_find(map, INT(i))));
+}
+
+deftest(integer_keys_use_integer_hashing) {
+  ava_value values[] = {
+    INT(42), WORD(foo),
+    INT(-5), WORD(bar),
+  };
+  ava_map_value map = ava_hash_map_of_list(ava_list_of_values(values, 4));
+  ava_map_cursor cursor;
+
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(map));
+
+  cursor = ava_map_find(map, INT(42));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(WORD(foo), ava_map_get(map, cursor));
+  cursor = ava_map_find(map, INT(-5));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(WORD(bar), ava_map_get(map, cursor));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, INT(5)));
+}
+
+deftest(integer_hashed_finds_keys_by_normal_form) {
+  ava_value values[] = {
+    INT(42), WORD(foo),
+    INT(-5), WORD(bar),
+  };
+  ava_map_value map = ava_hash_map_of_list(ava_list_of_values(values, 4));
+  ava_map_cursor cursor;
+
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(map));
+
+  cursor = ava_map_find(map, WORD(42));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(WORD(foo), ava_map_get(map, cursor));
+  cursor = ava_map_find(map, WORD(-5));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(WORD(bar), ava_map_get(map, cursor));
+
+  /* These parse to keys in the map, but aren't equal to them */
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, WORD(0x2A)));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, WORD(+42)));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE,
+                   ava_map_find(map, ava_value_of_cstring(" 42")));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, WORD(foo)));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE,
+                   ava_map_find(map, ava_value_of_cstring("")));
+}
+
+deftest(add_non_integer_to_integer_hashed) {
+  ava_map_value map = ava_hash_map_of_list(
+    ava_list_of_values((ava_value[]) { INT(1), INT(2) }, 2));
+  ava_map_value orig = map;
+  ava_map_cursor cursor;
+
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(map));
+  map = ava_map_add(map, INT(3), INT(4));
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(map));
+
+  /* An integer in a string is not good enough */
+  map = ava_map_add(map, WORD(5), INT(6));
+  ck_assert_str_eq("value", ava_hash_map_get_hash_function(map));
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(orig));
+  assert_value_equals_str("1 2 3 4 5 6", map.v);
+
+  cursor = ava_map_find(map, INT(1));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(INT(2), ava_map_get(map, cursor));
+  cursor = ava_map_find(map, WORD(3));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(INT(4), ava_map_get(map, cursor));
+  cursor = ava_map_find(map, INT(5));
+  ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+  assert_values_equal(INT(6), ava_map_get(map, cursor));
+}
+
+deftest(integer_hashing_falls_back_to_strategy) {
+  ava_map_value map = ava_hash_map_of_list_with_strategy(
+    ava_list_of_values((ava_value[]) { INT(1), INT(2) }, 2), ava_vhs_fast);
+
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(map));
+  map = ava_map_add(map, LONG_KEY, INT(4));
+  ck_assert_str_eq("fast", ava_hash_map_get_hash_function(map));
+}
+
+deftest(integer_hashing_switches_to_value_hashing_on_too_many_collisions) {
+  ava_map_value map = ava_hash_map_of_list(
+    ava_list_of_values((ava_value[]) { INT(7), INT(0) }, 2));
+  ava_map_cursor cursor;
+  unsigned i;
+
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(map));
+
+  /* As with the ASCII9 test, duplicates stand in for real collisions */
+  for (i = 1; i < 512; ++i)
+    map = ava_map_add(map, INT(7), INT(i));
+
+  ck_assert_str_eq("value", ava_hash_map_get_hash_function(map));
+
+  cursor = ava_map_find(map, INT(7));
+  for (i = 0; i < 512; ++i) {
+    ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+    assert_values_equal(INT(i), ava_map_get(map, cursor));
+    cursor = ava_map_next(map, cursor);
+  }
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, cursor);
+}
+
+deftest(integer_hashing_survives_promotion) {
+  ava_map_value map = ava_hash_map_of_list(
+    ava_list_of_values((ava_value[]) { INT(-1), INT(0) }, 2));
+  unsigned i;
+
+  /* Grows past the limit of the 16-bit specialisation */
+  for (i = 0; i < 8192; ++i)
+    map = ava_map_add(map, INT(i), INT(i));
+
+  ck_assert_str_eq("integer", ava_hash_map_get_hash_function(map));
+  for (i = 0; i < 8192; i += 97)
+    assert_values_equal(INT(i), ava_map_get(map, ava_map_find(map, INT(i))));
+}
+
+/* The tests below call each specialisation directly, since otherwise only
+ * enormous maps would exercise the 64-bit one. Each has a different lane
+ * size: 32, 16, and 8 slots, respectively.
+ */
+typedef ava_map_value (*hash_map_of_raw_f)(
+  const ava_value*restrict keys, size_t key_stride,
+  const ava_value*restrict values, size_t value_stride,
+  size_t count, ava_value_hash_strategy strategy);
+
+static const hash_map_of_raw_f specialisations[] = {
+  ava_hash_map_of_raw_ava_ushort,
+  ava_hash_map_of_raw_ava_uint,
+  ava_hash_map_of_raw_ava_ulong,
+};
+#define NUM_SPECIALISATIONS \
+  (sizeof(specialisations) / sizeof(specialisations[0]))
+
+deftest(every_specialisation_finds_all_keys) {
+  ava_value keys[2000], values[2000];
+  ava_map_value map;
+  ava_map_cursor cursor;
+  unsigned s, i;
+
+  for (i = 0; i < 2000; ++i) {
+    keys[i] = INT(i * 7919);
+    values[i] = INT(i);
+  }
+
+  for (s = 0; s < NUM_SPECIALISATIONS; ++s) {
+    map = specialisations[s](keys, 1, values, 1, 1000, ava_vhs_siphash);
+    for (i = 1000; i < 2000; ++i)
+      map = ava_map_add(map, keys[i], values[i]);
+
+    for (i = 0; i < 2000; ++i) {
+      cursor = ava_map_find(map, keys[i]);
+      ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+      assert_values_equal(values[i], ava_map_get(map, cursor));
+      ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(map, cursor));
+
+      ck_assert_int_eq(AVA_MAP_CURSOR_NONE,
+                       ava_map_find(map, INT(i * 7919 + 1)));
+    }
+  }
+}
+
+deftest(every_specialisation_probes_past_full_lanes) {
+  ava_value keys[] = { INT(42), INT(56) };
+  ava_value values[] = { INT(0), INT(0) };
+  ava_map_value map;
+  ava_map_cursor cursor;
+  unsigned s, i;
+
+  for (s = 0; s < NUM_SPECIALISATIONS; ++s) {
+    map = specialisations[s](keys, 1, values, 1, 2, ava_vhs_siphash);
+    /* Every duplicate has the same hash, so this fills several whole lanes
+     * with identical tags.
+     */
+    for (i = 1; i < 100; ++i) {
+      map = ava_map_add(map, keys[0], INT(i));
+      map = ava_map_add(map, keys[1], INT(i));
+    }
+
+    cursor = ava_map_find(map, keys[0]);
+    for (i = 0; i < 100; ++i) {
+      ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+      assert_values_equal(keys[0], ava_map_get_key(map, cursor));
+      assert_values_equal(INT(i), ava_map_get(map, cursor));
+      cursor = ava_map_next(map, cursor);
+    }
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, cursor);
+
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, INT(43)));
+  }
+}
+
+deftest(every_specialisation_keeps_diverged_versions_apart) {
+  ava_value keys[] = { WORD(foo), WORD(bar) };
+  ava_value values[] = { INT(0), INT(0) };
+  ava_map_value orig, a, b;
+  ava_map_cursor cursor;
+  unsigned s;
+
+  for (s = 0; s < NUM_SPECIALISATIONS; ++s) {
+    orig = specialisations[s](keys, 1, values, 1, 2, ava_vhs_siphash);
+    a = ava_map_add(orig, WORD(foo), INT(1));
+    /* Forks the index, which must forget the slot a used */
+    b = ava_map_add(orig, WORD(foo), INT(2));
+    b = ava_map_add(b, WORD(baz), INT(3));
+
+    cursor = ava_map_next(a, ava_map_find(a, WORD(foo)));
+    ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+    assert_values_equal(INT(1), ava_map_get(a, cursor));
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(a, WORD(baz)));
+
+    cursor = ava_map_next(b, ava_map_find(b, WORD(foo)));
+    ck_assert_int_ne(AVA_MAP_CURSOR_NONE, cursor);
+    assert_values_equal(INT(2), ava_map_get(b, cursor));
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(b, cursor));
+    assert_values_equal(INT(3), ava_map_get(b, ava_map_find(b, WORD(baz))));
+
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(orig, WORD(baz)));
+  }
+}
+
+/* Large enough to be built in bulk when there is more than one CPU */
+#define BULK_COUNT 100000
+
+deftest(bulk_build_keeps_duplicates_in_order) {
+  ava_value* keys = ava_alloc(sizeof(ava_value) * BULK_COUNT);
+  ava_value* values = ava_alloc(sizeof(ava_value) * BULK_COUNT);
+  ava_map_value map;
+  ava_map_cursor cursor;
+  unsigned i, j;
+
+  /* Every key appears 100 times, so that whole lanes fill with a single key
+   * and later copies have to probe past them.
+   */
+  for (i = 0; i < BULK_COUNT; ++i) {
+    keys[i] = INT(i % 1000);
+    values[i] = INT(i);
+  }
+
+  map = ava_hash_map_of_raw(keys, 1, values, 1, BULK_COUNT);
+  ck_assert_int_eq(BULK_COUNT, ava_map_npairs(map));
+
+  for (i = 0; i < 1000; ++i) {
+    cursor = ava_map_find(map, INT(i));
+    for (j = i; j < BULK_COUNT; j += 1000) {
+      ck_assert_int_eq(j, cursor);
+      assert_values_equal(INT(j), ava_map_get(map, cursor));
+      cursor = ava_map_next(map, cursor);
+    }
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, cursor);
+  }
+
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, INT(1000)));
+}
+
+deftest(bulk_build_finds_every_kind_of_key) {
+  static const char*const formats[] = { "k%u", "a-longer-key-%u", NULL };
+  ava_value* list = ava_alloc(sizeof(ava_value) * 2 * BULK_COUNT);
+  ava_map_value map;
+  ava_map_cursor cursor;
+  char str[32];
+  unsigned f, i;
+
+  for (f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f) {
+    for (i = 0; i < BULK_COUNT; ++i) {
+      if (formats[f]) {
+        snprintf(str, sizeof(str), formats[f], i);
+        list[2*i] = ava_value_of_cstring(str);
+      } else {
+        list[2*i] = INT(i * 7919);
+      }
+      list[2*i + 1] = INT(i);
+    }
+
+    map = ava_hash_map_of_list(ava_list_of_values(list, 2 * BULK_COUNT));
+    for (i = 0; i < BULK_COUNT; ++i) {
+      cursor = ava_map_find(map, list[2*i]);
+      ck_assert_int_eq(i, cursor);
+      ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(map, cursor));
+    }
+
+    /* Growing past the load factor rehashes from the hash cache */
+    for (i = 0; i < BULK_COUNT; ++i)
+      map = ava_map_add(map, INT(-1 - (ava_integer)i), INT(i));
+    cursor = ava_map_find(map, list[2*(BULK_COUNT-1)]);
+    ck_assert_int_eq(BULK_COUNT-1, cursor);
+    ck_assert_int_eq(BULK_COUNT, ava_map_find(map, INT(-1)));
+  }
+}
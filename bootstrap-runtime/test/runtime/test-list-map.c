@@ -277,3 +277,112 @@ deftest(grows_into_better_map_type) {
     assert_values_equal(INT(i), ava_map_get(map, cursor));
   }
 }
+
+static ava_map_value large_list_map(unsigned npairs) {
+  ava_value values[2*npairs];
+  unsigned i;
+
+  for (i = 0; i < npairs; ++i) {
+    values[2*i + 0] = INT(i % (npairs / 2));
+    values[2*i + 1] = INT(i);
+  }
+
+  return ava_list_map_of_list(ava_list_of_values(values, 2*npairs));
+}
+
+deftest(small_map_never_promotes) {
+  ava_value values[] = {
+    ava_value_of_cstring("foo"), ava_value_of_cstring("bar"),
+    ava_value_of_cstring("baz"), ava_value_of_cstring("quux"),
+  };
+  ava_map_value map = ava_list_map_of_list(
+    ava_list_of_values(values, 4));
+  unsigned i;
+
+  for (i = 0; i < 100; ++i)
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE,
+                     ava_map_find(map, ava_value_of_cstring("xyzzy")));
+
+  ck_assert(!ava_list_map_is_promoted(map));
+}
+
+deftest(four_pair_map_of_values_never_promotes) {
+  ava_value keys[4], values[4];
+  ava_map_value map;
+  unsigned i;
+
+  for (i = 0; i < 4; ++i) {
+    keys[i] = INT(i);
+    values[i] = INT(i + 4);
+  }
+
+  map = ava_map_of_values(keys, 1, values, 1, 4);
+  ck_assert_str_eq("list-map",
+                   ((const ava_attribute*)ava_value_attr(map.v))->tag->name);
+
+  for (i = 0; i < 100; ++i)
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, INT(4)));
+
+  ck_assert(!ava_list_map_is_promoted(map));
+}
+
+deftest(large_map_promotes_after_lookups) {
+  ava_map_value map = large_list_map(64);
+  unsigned i;
+
+  ck_assert_int_eq(0, ava_map_find(map, INT(0)));
+  ck_assert(!ava_list_map_is_promoted(map));
+
+  for (i = 0; i < AVA_LIST_MAP_PROMOTE_FACTOR + 1; ++i)
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, INT(64)));
+
+  ck_assert(ava_list_map_is_promoted(map));
+  ck_assert_str_eq("list-map",
+                   ((const ava_attribute*)ava_value_attr(map.v))->tag->name);
+}
+
+deftest(promoted_map_finds_same_cursors) {
+  ava_map_value map = large_list_map(64);
+  ava_map_cursor cursor;
+  unsigned i;
+
+  while (!ava_list_map_is_promoted(map))
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(map, INT(64)));
+
+  for (i = 0; i < 32; ++i) {
+    cursor = ava_map_find(map, INT(i));
+    ck_assert_int_eq(i, cursor);
+    assert_values_equal(INT(i), ava_map_get_key(map, cursor));
+    assert_values_equal(INT(i), ava_map_get(map, cursor));
+    cursor = ava_map_next(map, cursor);
+    ck_assert_int_eq(i + 32, cursor);
+    assert_values_equal(INT(i + 32), ava_map_get(map, cursor));
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(map, cursor));
+  }
+}
+
+deftest(promoted_map_derives_hash_maps) {
+  ava_map_value orig = large_list_map(64), map;
+  ava_map_cursor cursor;
+
+  while (!ava_list_map_is_promoted(orig))
+    ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_find(orig, INT(64)));
+
+  map = ava_map_set(orig, 1, INT(-1));
+  ck_assert_str_ne("list-map",
+                   ((const ava_attribute*)ava_value_attr(map.v))->tag->name);
+  assert_values_equal(INT(-1), ava_map_get(map, ava_map_find(map, INT(1))));
+
+  map = ava_map_remove(map, 0);
+  ck_assert_int_eq(63, ava_map_npairs(map));
+  cursor = ava_map_find(map, INT(0));
+  assert_values_equal(INT(32), ava_map_get(map, cursor));
+  ck_assert_int_eq(AVA_MAP_CURSOR_NONE, ava_map_next(map, cursor));
+
+  map = ava_map_add(map, INT(64), INT(64));
+  ck_assert_int_eq(64, ava_map_npairs(map));
+  assert_values_equal(INT(64), ava_map_get(map, ava_map_find(map, INT(64))));
+
+  ck_assert_int_eq(64, ava_map_npairs(orig));
+  assert_values_equal(INT(1), ava_map_get(orig, ava_map_find(orig, INT(1))));
+}
@@ -17,11 +17,13 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 
 #include "runtime/avalanche/defs.h"
 #include "runtime/avalanche/value.h"
 #include "runtime/avalanche/integer.h"
 #include "runtime/avalanche/list.h"
+#include "runtime/avalanche/function.h"
 #include "runtime/avalanche/list-proj.h"
 
 defsuite(list_proj);
@@ -36,6 +38,25 @@ static ava_list_value range(unsigned low, unsigned high) {
   return ava_list_value_of(accum);
 }
 
+static unsigned num_calls;
+
+static const ava_function* c_function(ava_value (*f)(ava_value)) {
+  char funspec[64];
+
+  snprintf(funspec, sizeof(funspec), "%lld ava pos", (long long)f);
+  return ava_function_of_value(ava_value_of_cstring(funspec));
+}
+
+static ava_value times_ten(ava_value v) {
+  ++num_calls;
+  return ava_value_of_integer(10 * ava_integer_of_value(v, 0));
+}
+
+static ava_value is_odd(ava_value v) {
+  ++num_calls;
+  return ava_value_of_integer(ava_integer_of_value(v, 0) & 1);
+}
+
 static void assert_looks_like(const char* expected, ava_list_value actual) {
   ck_assert_str_eq(expected, ava_string_to_cstring(
                      ava_to_string(actual.v)));
@@ -202,3 +223,179 @@ deftest(empty_flatten) {
 
   ck_assert_int_eq(0, memcmp(&empty, &result, sizeof(result)));
 }
+
+deftest(interleave_index_range) {
+  ava_list_value input[3] = { range(0, 100), range(100, 200), range(200, 300) };
+  ava_list_value result = ava_list_proj_interleave(input, 3);
+  ava_value out[250];
+  unsigned i;
+
+  ava_list_index_range(result, 25, 275, out);
+  for (i = 25; i < 275; ++i)
+    assert_values_equal(ava_list_index(result, i), out[i - 25]);
+}
+
+deftest(demux_index_range) {
+  ava_list_value input = range(0, 1000);
+  ava_list_value result;
+  ava_value out[200];
+  unsigned stride, i;
+
+  for (stride = 2; stride < 40; stride += 37) {
+    result = ava_list_proj_demux(input, 1, stride);
+    ava_list_index_range(result, 3, 23, out);
+    for (i = 3; i < 23; ++i)
+      assert_values_equal(ava_value_of_integer(1 + i * stride), out[i - 3]);
+  }
+}
+
+deftest(group_index_range) {
+  ava_list_value result = ava_list_proj_group(range(0, 10), 3);
+  ava_value out[4];
+
+  ava_list_index_range(result, 0, 4, out);
+  assert_looks_like("0 1 2", ava_list_value_of(out[0]));
+  assert_looks_like("9", ava_list_value_of(out[3]));
+}
+
+deftest(basic_map) {
+  ava_list_value result = ava_list_proj_map(
+    range(0, 5), c_function(times_ten), ava_false);
+
+  ck_assert_int_eq(5, ava_list_length(result.v));
+  assert_looks_like("0 10 20 30 40", result);
+}
+
+deftest(map_is_lazy) {
+  ava_list_value result;
+
+  num_calls = 0;
+  result = ava_list_proj_map(range(0, 100), c_function(times_ten), ava_false);
+  ck_assert_int_eq(0, num_calls);
+  assert_values_equal(ava_value_of_integer(420), ava_list_index(result, 42));
+  ck_assert_int_eq(1, num_calls);
+}
+
+deftest(memoised_map_calls_function_once) {
+  ava_list_value result;
+  ava_value out[100];
+  unsigned i;
+
+  num_calls = 0;
+  result = ava_list_proj_map(range(0, 100), c_function(times_ten), ava_true);
+  assert_values_equal(ava_value_of_integer(420), ava_list_index(result, 42));
+  ava_list_index_range(result, 0, 100, out);
+  assert_values_equal(ava_value_of_integer(420), ava_list_index(result, 42));
+  ck_assert_int_eq(100, num_calls);
+
+  for (i = 0; i < 100; ++i)
+    assert_values_equal(ava_value_of_integer(10 * i), out[i]);
+}
+
+deftest(empty_map) {
+  ava_list_value result = ava_list_proj_map(
+    ava_empty_list(), c_function(times_ten), ava_true);
+  ava_list_value empty = ava_empty_list();
+
+  ck_assert_int_eq(0, memcmp(&empty, &result, sizeof(result)));
+}
+
+deftest(basic_filter) {
+  ava_list_value result = ava_list_proj_filter(
+    range(0, 10), c_function(is_odd));
+
+  ck_assert_int_eq(5, ava_list_length(result.v));
+  assert_looks_like("1 3 5 7 9", result);
+}
+
+deftest(filter_is_incremental) {
+  ava_list_value result;
+
+  num_calls = 0;
+  result = ava_list_proj_filter(range(0, 10000), c_function(is_odd));
+  ck_assert_int_eq(0, num_calls);
+  assert_values_equal(ava_value_of_integer(7), ava_list_index(result, 3));
+  ck_assert_int_lt(num_calls, 10000);
+  ck_assert_int_eq(5000, ava_list_length(result.v));
+  ck_assert_int_eq(10000, num_calls);
+}
+
+deftest(filter_index_range) {
+  ava_list_value result = ava_list_proj_filter(
+    range(0, 2000), c_function(is_odd));
+  ava_value out[500];
+  unsigned i;
+
+  ava_list_index_range(result, 250, 750, out);
+  for (i = 250; i < 750; ++i)
+    assert_values_equal(ava_value_of_integer(2 * i + 1), out[i - 250]);
+}
+
+deftest(basic_zip) {
+  ava_list_value input[3] = { range(0, 3), range(3, 6), range(6, 10) };
+  ava_list_value result = ava_list_proj_zip(input, 3);
+
+  ck_assert_int_eq(3, ava_list_length(result.v));
+  assert_looks_like("[0 3 6] [1 4 7] [2 5 8]", result);
+}
+
+deftest(zip_index_range) {
+  ava_list_value input[3] = { range(0, 100), range(100, 200), range(200, 300) };
+  ava_list_value result = ava_list_proj_zip(input, 3);
+  ava_value out[90];
+  unsigned i;
+
+  ava_list_index_range(result, 5, 95, out);
+  for (i = 5; i < 95; ++i)
+    assert_values_equal(ava_list_index(result, i), out[i - 5]);
+}
+
+deftest(flatten_zip_is_interleave) {
+  ava_list_value input[2] = { range(0, 3), range(3, 7) };
+  ava_list_value result = ava_list_proj_flatten(
+    ava_list_proj_zip(input, 2));
+
+  assert_looks_like("0 3 1 4 2 5", result);
+}
+
+deftest(basic_range) {
+  assert_looks_like("0 3 6 9", ava_list_proj_range(0, 10, 3));
+  assert_looks_like("0 3 6 9", ava_list_proj_range(0, 12, 3));
+  assert_looks_like("5 4 3", ava_list_proj_range(5, 2, -1));
+  assert_looks_like("", ava_list_proj_range(5, 2, 1));
+  assert_looks_like("", ava_list_proj_range(2, 2, 1));
+}
+
+deftest(range_extremes) {
+  ava_list_value result = ava_list_proj_range(
+    INT64_MIN, INT64_MAX, INT64_MAX);
+
+  ck_assert_int_eq(3, ava_list_length(result.v));
+  assert_values_equal(ava_value_of_integer(INT64_MAX - 1),
+                      ava_list_index(result, 2));
+}
+
+deftest(range_slice_and_index_range) {
+  ava_list_value result = ava_list_slice(
+    ava_list_proj_range(100, 0, -2), 5, 10);
+  ava_value out[5];
+  unsigned i;
+
+  assert_looks_like("90 88 86 84 82", result);
+  ava_list_index_range(result, 0, 5, out);
+  for (i = 0; i < 5; ++i)
+    assert_values_equal(ava_value_of_integer(90 - 2 * i), out[i]);
+}
+
+deftest(pipeline_flatten) {
+  ava_list_value filtered = ava_list_proj_filter(
+    ava_list_proj_range(0, 20, 1), c_function(is_odd));
+  ava_list_value mapped = ava_list_proj_map(
+    filtered, c_function(times_ten), ava_false);
+  ava_list_value grouped = ava_list_proj_group(mapped, 3);
+
+  assert_looks_like("10 30 50 70 90 110 130 150 170 190",
+                    ava_list_proj_flatten(grouped));
+  assert_looks_like("10 30 50 70 90 110 130 150 170 190",
+                    ava_list_proj_flatten(mapped));
+}
@@ -0,0 +1,311 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "test.c"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "runtime/avalanche/defs.h"
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/exception.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/real.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/numeric-list.h"
+#include "runtime/avalanche/function.h"
+#include "runtime/avalanche/list-sort.h"
+#include "runtime/-list-sort.h"
+
+defsuite(list_sort);
+
+static ava_list_value list_of_cstring(const char* str) {
+  return ava_list_value_of(ava_value_of_cstring(str));
+}
+
+static void assert_looks_like(const char* expected, ava_list_value actual) {
+  ck_assert_str_eq(expected, ava_string_to_cstring(
+                     ava_to_string(actual.v)));
+}
+
+static const ava_function* c_function(ava_value (*f)(ava_value, ava_value)) {
+  char funspec[64];
+
+  snprintf(funspec, sizeof(funspec), "%lld ava pos pos", (long long)f);
+  return ava_function_of_value(ava_value_of_cstring(funspec));
+}
+
+static ava_value descending(ava_value a, ava_value b) {
+  return ava_value_of_integer(
+    ava_integer_of_value(b, 0) - ava_integer_of_value(a, 0));
+}
+
+static ava_value ascending(ava_value a, ava_value b) {
+  return ava_value_of_integer(
+    ava_integer_of_value(a, 0) - ava_integer_of_value(b, 0));
+}
+
+static ava_value throwing(ava_value a, ava_value b) {
+  ava_throw_str(&ava_format_exception, AVA_ASCII9_STRING("compare"));
+}
+
+static ava_value by_length(ava_value a, ava_value b) {
+  return ava_value_of_integer(
+    (ava_integer)ava_strlen(ava_to_string(a)) -
+    (ava_integer)ava_strlen(ava_to_string(b)));
+}
+
+/**
+ * Returns a list of n pseudo-random elements, made by applying make to
+ * numbers between 0 and modulus.
+ */
+static ava_list_value pseudo_random(size_t n, unsigned modulus,
+                                    ava_value (*make)(unsigned)) {
+  ava_value* values = ava_alloc(sizeof(ava_value) * n);
+  unsigned state = 12345;
+  size_t i;
+
+  for (i = 0; i < n; ++i) {
+    state = state * 1103515245 + 12345;
+    values[i] = (*make)((state >> 8) % modulus);
+  }
+
+  return ava_list_of_values(values, n);
+}
+
+static ava_value make_integer(unsigned i) {
+  return ava_value_of_integer((ava_integer)i - 500);
+}
+
+static ava_value make_real(unsigned i) {
+  return ava_value_of_real(((ava_real)i - 500) / 4.0);
+}
+
+static ava_value make_short_string(unsigned i) {
+  char str[16];
+
+  snprintf(str, sizeof(str), "k%u", i);
+  return ava_value_of_cstring(str);
+}
+
+static ava_value make_long_string(unsigned i) {
+  char str[32];
+
+  snprintf(str, sizeof(str), "a-rather-long-key-%u", i);
+  return ava_value_of_cstring(str);
+}
+
+/* Integer-valued elements whose string forms differ, so that the stability
+ * of the sort can be observed.
+ */
+static ava_value make_tagged_integer(unsigned i) {
+  char str[16];
+
+  snprintf(str, sizeof(str), i & 1? "%u" : "0x%X", i >> 1);
+  return ava_value_of_cstring(str);
+}
+
+static void assert_pieces_agree(ava_list_value list,
+                                ava_list_sort_order order) {
+  ava_list_value serial, parallel;
+  size_t pieces;
+
+  serial = ava_list_sort_in_pieces(list, order, 1);
+  for (pieces = 2; pieces <= 9; ++pieces) {
+    parallel = ava_list_sort_in_pieces(list, order, pieces);
+    ck_assert_int_eq(ava_list_length(serial.v), ava_list_length(parallel.v));
+    ck_assert(ava_value_equal(serial.v, parallel.v));
+  }
+}
+
+deftest(empty_and_singleton_unchanged) {
+  ava_list_value empty = ava_empty_list(), one = list_of_cstring("foo");
+
+  ck_assert(ava_value_equal(empty.v, ava_list_sort(empty, ava_lso_lexical).v));
+  ck_assert(ava_value_equal(one.v, ava_list_sort(one, ava_lso_integer).v));
+  ck_assert(ava_value_equal(empty.v, ava_list_sort_by(empty, NULL).v));
+}
+
+deftest(lexical_ascii9) {
+  assert_looks_like("10 9 bar foo",
+                    ava_list_sort(list_of_cstring("foo bar 10 9"),
+                                  ava_lso_lexical));
+}
+
+deftest(lexical_long_strings) {
+  assert_looks_like(
+    "a-long-string a-longer-string b \"with space\"",
+    ava_list_sort(list_of_cstring(
+                    "\"with space\" b a-longer-string a-long-string"),
+                  ava_lso_lexical));
+}
+
+deftest(lexical_mixed_types) {
+  ava_value values[3] = {
+    ava_value_of_integer(20),
+    ava_value_of_cstring("100"),
+    ava_value_of_real(3.5),
+  };
+
+  assert_looks_like("100 20 3.5",
+                    ava_list_sort(ava_list_of_values(values, 3),
+                                  ava_lso_lexical));
+}
+
+deftest(integer_of_strings_is_stable) {
+  assert_looks_like("-1 9 0x2A 42",
+                    ava_list_sort(list_of_cstring("0x2A 9 42 -1"),
+                                  ava_lso_integer));
+}
+
+deftest(integer_of_integers_is_numeric) {
+  ava_integer keys[4] = { 5, -3, 0, 1 };
+  ava_list_value sorted = ava_list_sort(
+    ava_integer_list_of_array(keys, 4), ava_lso_integer);
+
+  ck_assert(ava_list_is_integer_list(sorted));
+  assert_looks_like("-3 0 1 5", sorted);
+}
+
+static void do_sort_integer(void* list) {
+  ava_list_sort(*(ava_list_value*)list, ava_lso_integer);
+}
+
+deftest(integer_of_non_integer_throws) {
+  ava_list_value list = list_of_cstring("1 2 foo 3");
+  ava_exception ex;
+
+  if (ava_catch(&ex, do_sort_integer, &list)) {
+    ck_assert_ptr_eq(&ava_format_exception, ex.type);
+  } else {
+    ck_abort_msg("no exception thrown");
+  }
+}
+
+deftest(real_nan_ordered_last) {
+  ava_value values[4] = {
+    ava_value_of_real(NAN),
+    ava_value_of_real(2.5),
+    ava_value_of_real(-1.0),
+    ava_value_of_real(0.0),
+  };
+  ava_list_value sorted = ava_list_sort(ava_list_of_values(values, 4),
+                                        ava_lso_real);
+
+  ck_assert(ava_list_is_real_list(sorted));
+  ck_assert_int_eq(4, ava_list_length(sorted.v));
+  ck_assert(-1.0 == ava_real_of_value(ava_list_index(sorted.v, 0), 0));
+  ck_assert(0.0 == ava_real_of_value(ava_list_index(sorted.v, 1), 0));
+  ck_assert(2.5 == ava_real_of_value(ava_list_index(sorted.v, 2), 0));
+  ck_assert(isnan(ava_real_of_value(ava_list_index(sorted.v, 3), 0)));
+}
+
+deftest(real_of_strings) {
+  assert_looks_like("-0.5 1 2.5",
+                    ava_list_sort(list_of_cstring("2.5 1 -0.5"),
+                                  ava_lso_real));
+}
+
+deftest(sort_by_descending) {
+  assert_looks_like("5 3 2 1",
+                    ava_list_sort_by(list_of_cstring("3 1 5 2"),
+                                     c_function(descending)));
+}
+
+deftest(sort_by_is_stable) {
+  assert_looks_like("b a dd cc aaa",
+                    ava_list_sort_by(list_of_cstring("dd aaa b cc a"),
+                                     c_function(by_length)));
+}
+
+deftest(sort_by_large) {
+  ava_list_value list = pseudo_random(1000, 1000, make_integer);
+  ava_list_value sorted = ava_list_sort_by(list, c_function(descending));
+  size_t i;
+
+  for (i = 1; i < ava_list_length(sorted.v); ++i)
+    ck_assert_int_ge(ava_integer_of_value(ava_list_index(sorted.v, i-1), 0),
+                     ava_integer_of_value(ava_list_index(sorted.v, i), 0));
+}
+
+deftest(sort_by_pieces_agree) {
+  ava_list_value list = pseudo_random(1000, 100, make_tagged_integer);
+  ava_list_value serial, parallel;
+  size_t pieces;
+
+  serial = ava_list_sort_by_in_pieces(list, c_function(ascending), 1);
+  for (pieces = 2; pieces <= 9; ++pieces) {
+    parallel = ava_list_sort_by_in_pieces(list, c_function(ascending), pieces);
+    ck_assert(ava_value_equal(serial.v, parallel.v));
+  }
+}
+
+static void do_sort_by_throwing_in_pieces(void* list) {
+  ava_list_sort_by_in_pieces(*(ava_list_value*)list, c_function(throwing), 4);
+}
+
+deftest(sort_by_in_pieces_propagates_exception) {
+  ava_list_value list = pseudo_random(1000, 1000, make_integer);
+  ava_exception ex;
+
+  if (ava_catch(&ex, do_sort_by_throwing_in_pieces, &list)) {
+    ck_assert_ptr_eq(&ava_format_exception, ex.type);
+  } else {
+    ck_abort_msg("no exception thrown");
+  }
+}
+
+deftest(pieces_agree_integer) {
+  assert_pieces_agree(pseudo_random(1000, 1000, make_integer),
+                      ava_lso_integer);
+}
+
+deftest(pieces_agree_tagged_integer) {
+  assert_pieces_agree(pseudo_random(1000, 100, make_tagged_integer),
+                      ava_lso_integer);
+}
+
+deftest(pieces_agree_real) {
+  assert_pieces_agree(pseudo_random(1000, 1000, make_real), ava_lso_real);
+}
+
+deftest(pieces_agree_ascii9) {
+  assert_pieces_agree(pseudo_random(1000, 300, make_short_string),
+                      ava_lso_lexical);
+}
+
+deftest(pieces_agree_long_string) {
+  assert_pieces_agree(pseudo_random(1000, 300, make_long_string),
+                      ava_lso_lexical);
+}
+
+deftest(pieces_agree_presorted) {
+  ava_value values[1000];
+  unsigned i;
+
+  for (i = 0; i < 1000; ++i)
+    values[i] = ava_value_of_integer(i / 3);
+
+  assert_pieces_agree(ava_list_of_values(values, 1000), ava_lso_integer);
+  assert_looks_like("0 0 0 1 1 1 2",
+                    ava_list_value_of(ava_list_slice(
+                      ava_list_sort_in_pieces(
+                        ava_list_of_values(values, 1000),
+                        ava_lso_integer, 4).v, 0, 7)));
+}
@@ -21,10 +21,13 @@
 
 #define AVA__INTERNAL_INCLUDE 1
 #include "runtime/avalanche/defs.h"
+#include "runtime/avalanche/alloc.h"
 #include "runtime/avalanche/string.h"
 #include "runtime/avalanche/value.h"
 #include "runtime/avalanche/list.h"
 #include "runtime/avalanche/exception.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/-list-parse.h"
 
 defsuite(list);
 
@@ -272,3 +275,201 @@ deftest(empty_string_is_quoted) {
 
   ck_assert_str_eq("\"\" \"\"", ava_string_to_cstring(str));
 }
+
+deftest(long_list_stringified_across_blocks) {
+  ava_value values[150];
+  ava_string expected = AVA_EMPTY_STRING;
+  unsigned i;
+
+  for (i = 0; i < 150; ++i) {
+    values[i] = ava_value_of_integer(i);
+    if (i) expected = ava_strcat(expected, AVA_ASCII9_STRING(" "));
+    expected = ava_strcat(expected, ava_to_string(values[i]));
+  }
+
+  ck_assert_str_eq(ava_string_to_cstring(expected),
+                   ava_string_to_cstring(
+                     ava_to_string(ava_list_of_values(values, 150).v)));
+}
+
+deftest(long_list_streamed_in_block_chunks) {
+  ava_value values[150];
+  ava_value list;
+  ava_datum it;
+  char str[8];
+  unsigned i, chunks;
+
+  for (i = 0; i < 150; ++i) {
+    snprintf(str, sizeof(str), i & 1? "e%u" : "[%u]", i);
+    values[i] = ava_value_of_cstring(str);
+  }
+  list = ava_list_of_values(values, 150).v;
+
+  it = ava_string_chunk_iterator(list);
+  for (chunks = 0; ava_string_is_present(ava_iterate_string_chunk(&it, list));
+       ++chunks);
+  ck_assert_int_eq(3, chunks);
+
+  ck_assert_str_eq(ava_string_to_cstring(ava_to_string(list)),
+                   ava_string_to_cstring(ava_string_of_chunk_iterator(list)));
+}
+
+typedef struct {
+  const char* str;
+  size_t part_length;
+  ava_value result;
+} parse_in_parts_args;
+
+static void do_parse_in_parts(void* vargs) {
+  parse_in_parts_args* args = vargs;
+
+  if (args->part_length)
+    args->result = ava_list_value_of_string_in_parts(
+      ava_string_of_cstring(args->str), args->part_length).v;
+  else
+    args->result = ava_list_value_of(ava_value_of_cstring(args->str)).v;
+}
+
+/**
+ * Asserts that parsing str in parts of every length up to its own length
+ * gives exactly what parsing it in one go gives, including the error thrown
+ * if it is not a valid list.
+ */
+static void assert_parses_same_in_parts(const char* str) {
+  parse_in_parts_args serial = { str, 0 }, parallel;
+  ava_exception serial_ex, parallel_ex;
+  ava_bool serial_threw, parallel_threw;
+  size_t part_length;
+
+  serial_threw = ava_catch(&serial_ex, do_parse_in_parts, &serial);
+
+  for (part_length = 1; part_length <= strlen(str); ++part_length) {
+    parallel.str = str;
+    parallel.part_length = part_length;
+    parallel_threw = ava_catch(&parallel_ex, do_parse_in_parts, &parallel);
+
+    ck_assert_int_eq(serial_threw, parallel_threw);
+    if (serial_threw) {
+      ck_assert_ptr_eq(serial_ex.type, parallel_ex.type);
+      assert_values_equal(ava_exception_get_value(&serial_ex),
+                          ava_exception_get_value(&parallel_ex));
+    } else {
+      assert_values_equal(serial.result, parallel.result);
+    }
+  }
+}
+
+deftest(parse_in_parts_simple) {
+  assert_parses_same_in_parts("foo bar  baz\tquux\n\nxyzzy  ");
+}
+
+deftest(parse_in_parts_nested) {
+  assert_parses_same_in_parts(
+    "a [b c] [[d] e [f [g h]]] [] [[]] i\n[j\n k]\n[[l]]");
+}
+
+deftest(parse_in_parts_quoted) {
+  assert_parses_same_in_parts(
+    "\"a b [c\" d \\{e [ f\\} \"g ] h\" [\"i j\" k] \\{\\{l\\} m\\}");
+}
+
+deftest(parse_in_parts_comments_and_continuations) {
+  assert_parses_same_in_parts("a ; b [ c\nd \\\n e ;f\n \\ g");
+}
+
+deftest(parse_in_parts_errors) {
+  assert_parses_same_in_parts("a b [c d] e]");
+  assert_parses_same_in_parts("a [b [c d] e");
+  assert_parses_same_in_parts("a [b c]d e");
+  assert_parses_same_in_parts("a b (c) d");
+  assert_parses_same_in_parts("a b\"c\" d");
+  assert_parses_same_in_parts("a b c d \"e f");
+  assert_parses_same_in_parts("a b ] c \"d");
+  assert_parses_same_in_parts("a ] b [c]x d");
+}
+
+deftest(parse_in_parts_large) {
+  char* str;
+  unsigned i, n = 20000;
+  size_t off = 0;
+
+  str = ava_alloc_atomic(n * 16 + 1);
+  for (i = 0; i < n; ++i)
+    off += sprintf(str + off, i % 7? "%u " : "[%u \"%u\"] ", i, i);
+
+  assert_values_equal(
+    ava_list_value_of(ava_value_of_cstring(str)).v,
+    ava_list_value_of_string_in_parts(
+      ava_string_of_cstring(str), 1000).v);
+}
+
+deftest(builder_appends_across_flushes) {
+  ava_list_builder builder;
+  ava_list_value list;
+  unsigned i;
+
+  ava_list_builder_init(&builder);
+  for (i = 0; i < 3 * AVA_LIST_BUILDER_BUFFER + 1; ++i)
+    ava_list_builder_append(&builder, ava_value_of_integer(i));
+
+  list = ava_list_builder_list(&builder);
+  ck_assert_int_eq(3 * AVA_LIST_BUILDER_BUFFER + 1, ava_list_length(list));
+  for (i = 0; i < 3 * AVA_LIST_BUILDER_BUFFER + 1; ++i)
+    ck_assert_int_eq(i, ava_integer_of_value(ava_list_index(list, i), -1));
+}
+
+deftest(builder_concat_keeps_buffered_elements_first) {
+  ava_list_builder builder;
+  ava_value bc[2] = { ava_value_of_cstring("b"), ava_value_of_cstring("c") };
+
+  ava_list_builder_init(&builder);
+  ava_list_builder_append(&builder, ava_value_of_cstring("a"));
+  ava_list_builder_concat(&builder, ava_list_of_values(bc, 2));
+  ava_list_builder_append(&builder, ava_value_of_cstring("d"));
+
+  ck_assert_str_eq("a b c d", ava_string_to_cstring(
+                     ava_to_string(ava_list_builder_list(&builder).v)));
+}
+
+deftest(builder_list_does_not_reset) {
+  ava_list_builder builder;
+  ava_list_value first;
+
+  ava_list_builder_init(&builder);
+  ck_assert_int_eq(0, ava_list_length(ava_list_builder_list(&builder)));
+  ava_list_builder_append(&builder, ava_value_of_cstring("a"));
+  first = ava_list_builder_list(&builder);
+  ava_list_builder_append(&builder, ava_value_of_cstring("b"));
+
+  ck_assert_str_eq("a", ava_string_to_cstring(ava_to_string(first.v)));
+  ck_assert_str_eq("a b", ava_string_to_cstring(
+                     ava_to_string(ava_list_builder_list(&builder).v)));
+}
+
+deftest(cursor_reads_across_blocks) {
+  ava_list_builder builder;
+  ava_list_cursor cursor;
+  ava_value val;
+  unsigned i;
+
+  ava_list_builder_init(&builder);
+  for (i = 0; i < 2 * AVA_LIST_CURSOR_BLOCK + 1; ++i)
+    ava_list_builder_append(&builder, ava_value_of_integer(i));
+
+  ava_list_cursor_init(&cursor, ava_list_builder_list(&builder));
+  for (i = 0; i < 2 * AVA_LIST_CURSOR_BLOCK + 1; ++i) {
+    ck_assert(ava_list_cursor_next(&cursor, &val));
+    ck_assert_int_eq(i, ava_integer_of_value(val, -1));
+  }
+
+  ck_assert(!ava_list_cursor_next(&cursor, &val));
+  ck_assert(!ava_list_cursor_next(&cursor, &val));
+}
+
+deftest(cursor_over_empty_list_is_exhausted) {
+  ava_list_cursor cursor;
+  ava_value val;
+
+  ava_list_cursor_init(&cursor, ava_empty_list());
+  ck_assert(!ava_list_cursor_next(&cursor, &val));
+}
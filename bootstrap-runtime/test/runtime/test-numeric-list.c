@@ -0,0 +1,404 @@
+/*-
+ * Copyright (c) 2015, Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "test.c"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "runtime/avalanche/defs.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/avalanche/real.h"
+#include "runtime/avalanche/numeric-list.h"
+#include "runtime/-array-list.h"
+#include "runtime/-esba-list.h"
+
+defsuite(numeric_list);
+
+#define N 100
+
+static ava_value integers[N], reals[N];
+
+defsetup {
+  unsigned i;
+
+  for (i = 0; i < N; ++i) {
+    integers[i] = ava_value_of_integer((ava_integer)i * 3 - 50);
+    reals[i] = ava_value_of_real(i * 0.25 - 7.0);
+  }
+}
+
+defteardown { }
+
+static ava_bool values_equal(ava_value a, ava_value b) {
+  return 0 == memcmp(&a, &b, sizeof(a));
+}
+
+static void assert_list_contents(ava_list_value list,
+                                 const ava_value*restrict expected,
+                                 size_t length) {
+  size_t i;
+
+  ck_assert_int_eq(length, ava_list_length(list));
+  for (i = 0; i < length; ++i)
+    ck_assert(values_equal(expected[i], ava_list_index(list, i)));
+}
+
+deftest(homogeneous_integers_promoted) {
+  ava_list_value list = ava_list_of_values(integers, N);
+
+  ck_assert(ava_list_is_integer_list(list));
+  ck_assert(!ava_list_is_real_list(list));
+  assert_list_contents(list, integers, N);
+}
+
+deftest(homogeneous_reals_promoted) {
+  ava_list_value list = ava_list_of_values(reals, N);
+
+  ck_assert(ava_list_is_real_list(list));
+  assert_list_contents(list, reals, N);
+}
+
+deftest(small_lists_not_promoted) {
+  ck_assert(!ava_list_is_integer_list(
+              ava_list_of_values(integers, AVA_ARRAY_LIST_THRESH)));
+}
+
+deftest(heterogeneous_lists_not_promoted) {
+  ava_value values[N];
+
+  memcpy(values, integers, sizeof(values));
+  values[N/2] = reals[0];
+  ck_assert(!ava_list_is_integer_list(ava_list_of_values(values, N)));
+
+  values[N/2] = ava_value_of_string(AVA_ASCII9_STRING("42"));
+  ck_assert(!ava_list_is_integer_list(ava_list_of_values(values, N)));
+}
+
+deftest(array_list_growth_promotes) {
+  ava_list_value list = ava_array_list_of_raw(integers, AVA_ARRAY_LIST_THRESH);
+  unsigned i;
+
+  for (i = AVA_ARRAY_LIST_THRESH; i < N; ++i)
+    list = ava_list_append(list, integers[i]);
+
+  ck_assert(ava_list_is_integer_list(list));
+  assert_list_contents(list, integers, N);
+}
+
+deftest(index_range_boxes) {
+  ava_list_value list = ava_list_of_values(integers, N);
+  ava_value out[N];
+
+  ava_list_index_range(list, 10, 90, out);
+  ck_assert_int_eq(0, memcmp(out, integers + 10, sizeof(ava_value) * 80));
+}
+
+deftest(stringification) {
+  ava_list_value numeric = ava_list_of_values(integers, N);
+  ava_list_value esba = ava_esba_list_copy_of(numeric, 0, N);
+
+  ck_assert(!ava_list_is_integer_list(esba));
+  ck_assert_str_eq(ava_string_to_cstring(ava_to_string(esba.v)),
+                   ava_string_to_cstring(ava_to_string(numeric.v)));
+}
+
+deftest(append_same_type_stays_numeric) {
+  ava_list_value list = ava_list_of_values(integers, N - 1);
+
+  list = ava_list_append(list, integers[N-1]);
+  ck_assert(ava_list_is_integer_list(list));
+  assert_list_contents(list, integers, N);
+}
+
+deftest(append_other_type_demotes) {
+  ava_list_value orig = ava_list_of_values(integers, N - 1);
+  ava_value expected[N];
+  ava_list_value list;
+
+  memcpy(expected, integers, sizeof(expected));
+  expected[N-1] = ava_value_of_string(AVA_ASCII9_STRING("foo"));
+  list = ava_list_append(orig, expected[N-1]);
+
+  ck_assert(!ava_list_is_integer_list(list));
+  assert_list_contents(list, expected, N);
+  assert_list_contents(orig, integers, N - 1);
+}
+
+deftest(append_does_not_clobber_shared_backing) {
+  ava_list_value base = ava_list_of_values(integers, N - 2);
+  ava_list_value a = ava_list_append(base, integers[N-2]);
+  ava_list_value b = ava_list_append(base, integers[N-1]);
+
+  ck_assert(values_equal(integers[N-2], ava_list_index(a, N-2)));
+  ck_assert(values_equal(integers[N-1], ava_list_index(b, N-2)));
+}
+
+deftest(concat_numeric_lists) {
+  ava_list_value list = ava_list_concat(
+    ava_list_of_values(integers, N/2),
+    ava_list_of_values(integers + N/2, N - N/2));
+
+  ck_assert(ava_list_is_integer_list(list));
+  assert_list_contents(list, integers, N);
+}
+
+deftest(concat_absorbs_homogeneous_array_list) {
+  ava_list_value list = ava_list_concat(
+    ava_list_of_values(integers, N - 4),
+    ava_array_list_of_raw(integers + N - 4, 4));
+
+  ck_assert(ava_list_is_integer_list(list));
+  assert_list_contents(list, integers, N);
+}
+
+deftest(concat_heterogeneous_demotes) {
+  ava_value expected[N];
+  ava_list_value list;
+
+  memcpy(expected, integers, sizeof(expected));
+  expected[N-1] = reals[0];
+  list = ava_list_concat(
+    ava_list_of_values(integers, N - 4),
+    ava_array_list_of_raw(expected + N - 4, 4));
+
+  ck_assert(!ava_list_is_integer_list(list));
+  assert_list_contents(list, expected, N);
+}
+
+deftest(slice_and_remove) {
+  ava_list_value list = ava_list_of_values(integers, N);
+  ava_value expected[N];
+
+  assert_list_contents(ava_list_slice(list, 10, 30), integers + 10, 20);
+
+  memcpy(expected, integers, sizeof(ava_value) * 10);
+  memcpy(expected + 10, integers + 30, sizeof(ava_value) * (N - 30));
+  assert_list_contents(ava_list_remove(list, 10, 30), expected, N - 20);
+}
+
+deftest(set) {
+  ava_list_value list = ava_list_of_values(integers, N);
+  ava_list_value same, other;
+  ava_value expected[N];
+
+  memcpy(expected, integers, sizeof(expected));
+  expected[5] = ava_value_of_integer(12345);
+  same = ava_list_set(list, 5, expected[5]);
+  ck_assert(ava_list_is_integer_list(same));
+  assert_list_contents(same, expected, N);
+
+  expected[5] = ava_value_of_string(AVA_ASCII9_STRING("x"));
+  other = ava_list_set(list, 5, expected[5]);
+  ck_assert(!ava_list_is_integer_list(other));
+  assert_list_contents(other, expected, N);
+
+  assert_list_contents(list, integers, N);
+}
+
+deftest(integer_sum) {
+  ava_integer sum;
+  ava_integer_overflow overflow;
+
+  ck_assert(ava_integer_list_sum(&sum, &overflow,
+                                 ava_list_of_values(integers, N)));
+  ck_assert_int_eq(3 * N * (N-1) / 2 - 50 * N, sum);
+
+  ck_assert(ava_integer_list_sum(&sum, &overflow, ava_empty_list()));
+  ck_assert_int_eq(0, sum);
+}
+
+deftest(integer_sum_of_strings) {
+  ava_integer sum;
+  ava_integer_overflow overflow;
+
+  ck_assert(ava_integer_list_sum(
+              &sum, &overflow,
+              ava_list_value_of(
+                ava_value_of_string(ava_string_of_cstring("1 2 \"\" 4")))));
+  ck_assert_int_eq(7, sum);
+}
+
+deftest(integer_sum_intermediate_overflow_ignored) {
+  ava_integer array[] = {
+    0x7FFFFFFFFFFFFFFFLL, 1, -2, -0x7FFFFFFFFFFFFFFFLL - 1, 5
+  };
+  ava_integer sum;
+  ava_integer_overflow overflow;
+
+  ck_assert(ava_integer_list_sum(&sum, &overflow,
+                                 ava_integer_list_of_array(array, 5)));
+  ck_assert_int_eq(3, sum);
+}
+
+deftest(integer_sum_overflow) {
+  ava_integer array[] = { 0x7FFFFFFFFFFFFFFFLL - 1, 1, 1, 1 };
+  ava_integer sum;
+  ava_integer_overflow overflow;
+
+  ck_assert(!ava_integer_list_sum(&sum, &overflow,
+                                  ava_integer_list_of_array(array, 4)));
+  ck_assert_int_eq(0x7FFFFFFFFFFFFFFFLL, overflow.a);
+  ck_assert_str_eq("+", overflow.op);
+  ck_assert_int_eq(1, overflow.b);
+}
+
+deftest(integer_min_max) {
+  ava_list_value list = ava_list_of_values(integers, N);
+  ava_integer result;
+
+  ck_assert(ava_integer_list_min(&result, list));
+  ck_assert_int_eq(-50, result);
+  ck_assert(ava_integer_list_max(&result, list));
+  ck_assert_int_eq(3 * (N-1) - 50, result);
+
+  ck_assert(!ava_integer_list_min(&result, ava_empty_list()));
+  ck_assert(!ava_integer_list_max(&result, ava_empty_list()));
+}
+
+deftest(integer_dot) {
+  ava_integer a[] = { 1, 2, 3 }, b[] = { 4, 5, 6 }, dot;
+  ava_integer_overflow overflow;
+
+  ck_assert(ava_integer_list_dot(&dot, &overflow,
+                                 ava_integer_list_of_array(a, 3),
+                                 ava_list_value_of(
+                                   ava_value_of_string(
+                                     ava_string_of_cstring("4 5 6")))));
+  ck_assert_int_eq(32, dot);
+
+  ck_assert(ava_integer_list_dot(&dot, &overflow,
+                                 ava_integer_list_of_array(a, 3),
+                                 ava_integer_list_of_array(b, 3)));
+  ck_assert_int_eq(32, dot);
+}
+
+deftest(integer_dot_overflow) {
+  ava_integer a[] = { 1, 0x100000000LL }, b[] = { 2, 0x100000000LL }, dot;
+  ava_integer_overflow overflow;
+
+  ck_assert(!ava_integer_list_dot(&dot, &overflow,
+                                  ava_integer_list_of_array(a, 2),
+                                  ava_integer_list_of_array(b, 2)));
+  ck_assert_str_eq("*", overflow.op);
+  ck_assert_int_eq(0x100000000LL, overflow.a);
+  ck_assert_int_eq(0x100000000LL, overflow.b);
+}
+
+deftest(integer_scale) {
+  ava_list_value result;
+  ava_integer_overflow overflow;
+  ava_value expected[N];
+  unsigned i;
+
+  for (i = 0; i < N; ++i)
+    expected[i] = ava_value_of_integer(
+      -2 * ava_value_slong(integers[i]));
+
+  ck_assert(ava_integer_list_scale(&result, &overflow,
+                                   ava_list_of_values(integers, N), -2));
+  ck_assert(ava_list_is_integer_list(result));
+  assert_list_contents(result, expected, N);
+}
+
+deftest(integer_scale_overflow) {
+  ava_integer array[] = { 1, 0x4000000000000000LL };
+  ava_list_value result;
+  ava_integer_overflow overflow;
+
+  ck_assert(!ava_integer_list_scale(&result, &overflow,
+                                    ava_integer_list_of_array(array, 2), 2));
+  ck_assert_str_eq("*", overflow.op);
+  ck_assert_int_eq(0x4000000000000000LL, overflow.a);
+  ck_assert_int_eq(2, overflow.b);
+}
+
+deftest(integer_select_numeric) {
+  ava_list_value result = ava_integer_list_select(
+    ava_list_of_values(integers, N), ava_nc_geq, 3 * (N-3) - 50);
+
+  ck_assert(ava_list_is_integer_list(result));
+  assert_list_contents(result, integers + N - 3, 3);
+}
+
+deftest(integer_select_preserves_original_values) {
+  ava_list_value result = ava_integer_list_select(
+    ava_list_value_of(
+      ava_value_of_string(ava_string_of_cstring("5 1 0x4 2 3"))),
+    ava_nc_sgt, 2);
+
+  ck_assert_str_eq("5 0x4 3",
+                   ava_string_to_cstring(ava_to_string(result.v)));
+}
+
+deftest(integer_select_nothing) {
+  ck_assert_int_eq(0, ava_list_length(
+                     ava_integer_list_select(
+                       ava_list_of_values(integers, N), ava_nc_slt, -1000)));
+}
+
+deftest(real_sum_independent_of_representation) {
+  ava_list_value numeric = ava_list_of_values(reals, N);
+  ava_list_value esba = ava_list_value_of(
+    ava_value_of_string(ava_to_string(numeric.v)));
+
+  ck_assert(!ava_list_is_real_list(esba));
+  ck_assert(ava_real_list_sum(numeric) == ava_real_list_sum(esba));
+  ck_assert(ava_real_list_dot(numeric, numeric) ==
+            ava_real_list_dot(esba, numeric));
+}
+
+deftest(real_sum_of_integers) {
+  ck_assert(ava_real_list_sum(ava_list_of_values(integers, N)) ==
+            3 * N * (N-1) / 2 - 50 * N);
+}
+
+deftest(real_min_max) {
+  ava_real array[] = { 3.0, NAN, -1.5, 2.0, 7.25 };
+  ava_list_value list = ava_real_list_of_array(array, 5);
+
+  ck_assert(-1.5 == ava_real_list_min(list));
+  ck_assert(7.25 == ava_real_list_max(list));
+  ck_assert(isinf(ava_real_list_min(ava_empty_list())));
+  ck_assert(ava_real_list_min(ava_empty_list()) > 0);
+  ck_assert(isinf(ava_real_list_max(ava_empty_list())));
+  ck_assert(ava_real_list_max(ava_empty_list()) < 0);
+}
+
+deftest(real_scale) {
+  ava_real array[] = { 1.0, -2.0, 0.5 };
+  ava_list_value result = ava_real_list_scale(
+    ava_real_list_of_array(array, 3), 2.0);
+
+  ck_assert(ava_list_is_real_list(result));
+  ck_assert(-4.0 == ava_value_real(ava_list_index(result, 1)));
+}
+
+deftest(real_select_nan_is_unequal) {
+  ava_real array[] = { 1.0, NAN, 2.0 };
+  ava_list_value list = ava_real_list_of_array(array, 3);
+
+  ck_assert_int_eq(0, ava_list_length(
+                     ava_real_list_select(list, ava_nc_equ, NAN)));
+  ck_assert_int_eq(3, ava_list_length(
+                     ava_real_list_select(list, ava_nc_neq, NAN)));
+  ck_assert_int_eq(1, ava_list_length(
+                     ava_real_list_select(list, ava_nc_sgt, 1.5)));
+}
@@ -0,0 +1,87 @@
+/*-
+ * Copyright (c) 2015, Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "test.c"
+
+#include <atomic_ops.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "runtime/avalanche/defs.h"
+#include "runtime/avalanche/exception.h"
+#include "runtime/-parallel.h"
+
+defsuite(parallel);
+
+#define NUM_ITEMS 1000
+
+static AO_t calls[NUM_ITEMS];
+
+static void count_call(void* ignore, size_t ix) {
+  AO_fetch_and_add1(calls + ix);
+}
+
+deftest(every_index_called_once) {
+  unsigned i;
+
+  memset(calls, 0, sizeof(calls));
+  ava_parallel_for(NUM_ITEMS, count_call, NULL);
+
+  for (i = 0; i < NUM_ITEMS; ++i)
+    ck_assert_int_eq(1, calls[i]);
+}
+
+static void throw_at_half(void* ignore, size_t ix) {
+  AO_fetch_and_add1(calls + ix);
+  if (NUM_ITEMS / 2 == ix)
+    ava_throw_str(&ava_format_exception, AVA_ASCII9_STRING("half"));
+}
+
+static void run_throw_at_half(void* ignore) {
+  ava_parallel_for(NUM_ITEMS, throw_at_half, NULL);
+}
+
+deftest(exception_rethrown_on_caller) {
+  ava_exception ex;
+  unsigned i;
+
+  memset(calls, 0, sizeof(calls));
+  ck_assert(ava_catch(&ex, run_throw_at_half, NULL));
+  ck_assert_ptr_eq(&ava_format_exception, ex.type);
+  assert_value_equals_str("half", ava_exception_get_value(&ex));
+
+  ck_assert_int_eq(1, calls[NUM_ITEMS / 2]);
+  for (i = 0; i < NUM_ITEMS; ++i)
+    ck_assert_int_ge(1, calls[i]);
+}
+
+static void throw_everywhere(void* ignore, size_t ix) {
+  ava_throw_str(&ava_format_exception, AVA_ASCII9_STRING("every"));
+}
+
+static void run_throw_everywhere(void* ignore) {
+  ava_parallel_for(NUM_ITEMS, throw_everywhere, NULL);
+}
+
+deftest(one_exception_from_many) {
+  ava_exception ex;
+
+  ck_assert(ava_catch(&ex, run_throw_everywhere, NULL));
+  assert_value_equals_str("every", ava_exception_get_value(&ex));
+
+  /* The pool still works afterwards */
+  memset(calls, 0, sizeof(calls));
+  ava_parallel_for(NUM_ITEMS, count_call, NULL);
+  ck_assert_int_eq(1, calls[NUM_ITEMS - 1]);
+}
@@ -0,0 +1,240 @@
+/*-
+ * Copyright (c) 2015 Jason Lingle
+ *
+ * Permission to  use, copy,  modify, and/or distribute  this software  for any
+ * purpose  with or  without fee  is hereby  granted, provided  that the  above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE  IS PROVIDED "AS  IS" AND  THE AUTHOR DISCLAIMS  ALL WARRANTIES
+ * WITH  REGARD   TO  THIS  SOFTWARE   INCLUDING  ALL  IMPLIED   WARRANTIES  OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT  SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL,  DIRECT,   INDIRECT,  OR  CONSEQUENTIAL  DAMAGES   OR  ANY  DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF  CONTRACT, NEGLIGENCE  OR OTHER  TORTIOUS ACTION,  ARISING OUT  OF OR  IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "test.c"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define AVA__INTERNAL_INCLUDE 1
+#include "runtime/avalanche/defs.h"
+#include "runtime/avalanche/alloc.h"
+#include "runtime/avalanche/string.h"
+#include "runtime/avalanche/list.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/avalanche/integer.h"
+#include "runtime/-esba-list.h"
+#include "runtime/-rrb-list.h"
+
+defsuite(rrb_list);
+
+/* Large enough for the trees to be three levels deep */
+#define N 5000
+
+static ava_value* values;
+
+defsetup {
+  unsigned i;
+
+  values = ava_alloc(sizeof(ava_value) * N);
+  for (i = 0; i < N; ++i)
+    values[i] = ava_value_of_integer(i);
+}
+
+defteardown { }
+
+static ava_list_value rrb_of_range(size_t begin, size_t end) {
+  return ava_rrb_list_copy_of(
+    ava_esba_list_of_raw(values + begin, end - begin), 0, end - begin);
+}
+
+static void assert_list_range(ava_list_value list, ava_integer first,
+                              size_t length) {
+  ava_value* contents;
+  size_t i;
+
+  ck_assert_int_eq(length, ava_list_length(list));
+
+  contents = ava_alloc(sizeof(ava_value) * length);
+  ava_list_index_range(list, 0, length, contents);
+  for (i = 0; i < length; ++i) {
+    ck_assert_int_eq(first + i, ava_integer_of_value(contents[i], -1));
+    /* Spot-check single-element access too */
+    if (0 == i % 37)
+      ck_assert_int_eq(first + i, ava_integer_of_value(
+                         ava_list_index(list, i), -1));
+  }
+}
+
+deftest(copy_of) {
+  ava_list_value list = rrb_of_range(0, N);
+
+  ck_assert(ava_list_is_rrb_list(list));
+  assert_list_range(list, 0, N);
+}
+
+deftest(stringification) {
+  ava_list_value list = rrb_of_range(0, 3);
+
+  ck_assert_str_eq("0 1 2", ava_string_to_cstring(ava_to_string(list.v)));
+}
+
+deftest(append) {
+  ava_list_value list = rrb_of_range(0, 1);
+  unsigned i;
+
+  for (i = 1; i < N; ++i)
+    list = ava_list_append(list, values[i]);
+
+  ck_assert(ava_list_is_rrb_list(list));
+  assert_list_range(list, 0, N);
+}
+
+deftest(append_n) {
+  ava_list_value list = rrb_of_range(0, 1);
+  size_t length = 1, batch = 1;
+
+  /* Both small batches, which are pushed one at a time, and large ones, which
+   * are concatenated as a tree.
+   */
+  while (length < N) {
+    batch = (batch * 13 + 5) % 97 + 1;
+    if (length + batch > N)
+      batch = N - length;
+
+    list = ava_list_append_n(list, values + length, batch);
+    length += batch;
+  }
+
+  ck_assert(ava_list_is_rrb_list(list));
+  assert_list_range(list, 0, N);
+}
+
+deftest(set_is_persistent) {
+  ava_list_value orig = rrb_of_range(0, N);
+  ava_list_value a, b;
+
+  a = ava_list_set(orig, 1234, ava_value_of_integer(-1));
+  b = ava_list_set(orig, 1234, ava_value_of_integer(-2));
+
+  ck_assert_int_eq(1234, ava_integer_of_value(
+                     ava_list_index(orig, 1234), 0));
+  ck_assert_int_eq(-1, ava_integer_of_value(ava_list_index(a, 1234), 0));
+  ck_assert_int_eq(-2, ava_integer_of_value(ava_list_index(b, 1234), 0));
+  ck_assert_int_eq(1233, ava_integer_of_value(ava_list_index(a, 1233), 0));
+  ck_assert_int_eq(1235, ava_integer_of_value(ava_list_index(b, 1235), 0));
+}
+
+deftest(slice) {
+  ava_list_value list = rrb_of_range(0, N);
+
+  assert_list_range(ava_list_slice(list, 100, 4000), 100, 3900);
+  assert_list_range(ava_list_slice(list, 0, 1025), 0, 1025);
+  assert_list_range(ava_list_slice(list, 1023, N), 1023, N - 1023);
+  assert_list_range(ava_list_slice(list, 500, 503), 500, 3);
+}
+
+deftest(slice_to_empty_list) {
+  ava_list_value list = rrb_of_range(0, N);
+
+  assert_values_equal(ava_empty_list().v, ava_list_slice(list, 7, 7).v);
+}
+
+deftest(concat_many_uneven_pieces) {
+  ava_list_value list = rrb_of_range(0, 1);
+  size_t length = 1, piece = 1;
+
+  /* Pieces of awkward sizes force the concatenation to produce relaxed nodes
+   * and rebalance them.
+   */
+  while (length < N) {
+    piece = (piece * 7 + 3) % 61 + 1;
+    if (length + piece > N)
+      piece = N - length;
+
+    list = ava_list_concat(list, rrb_of_range(length, length + piece));
+    length += piece;
+  }
+
+  ck_assert(ava_list_is_rrb_list(list));
+  assert_list_range(list, 0, N);
+}
+
+deftest(concat_slices) {
+  ava_list_value list = rrb_of_range(0, N);
+  ava_list_value joined;
+
+  joined = ava_list_concat(ava_list_slice(list, 0, 2345),
+                           ava_list_slice(list, 2345, N));
+  assert_list_range(joined, 0, N);
+
+  /* And again on the relaxed result */
+  joined = ava_list_concat(ava_list_slice(joined, 10, 1000),
+                           ava_list_slice(joined, 1000, 4321));
+  assert_list_range(joined, 10, 4311);
+  assert_list_range(ava_list_append(joined, values[4321]), 10, 4312);
+  assert_list_range(ava_list_set(joined, 5, values[15]), 10, 4311);
+}
+
+deftest(concat_other_list_type) {
+  ava_list_value list = rrb_of_range(0, 100);
+
+  list = ava_list_concat(
+    list, ava_esba_list_of_raw(values + 100, N - 100));
+  ck_assert(ava_list_is_rrb_list(list));
+  assert_list_range(list, 0, N);
+}
+
+deftest(remove) {
+  ava_list_value list = rrb_of_range(0, N);
+  ava_list_value result;
+  size_t i;
+
+  result = ava_list_remove(list, 0, 1000);
+  assert_list_range(result, 1000, N - 1000);
+  result = ava_list_remove(list, 1000, N);
+  assert_list_range(result, 0, 1000);
+
+  result = ava_list_remove(list, 1000, 3000);
+  ck_assert_int_eq(N - 2000, ava_list_length(result));
+  for (i = 0; i < 1000; ++i)
+    ck_assert_int_eq(i, ava_integer_of_value(ava_list_index(result, i), -1));
+  for (i = 1000; i < N - 2000; ++i)
+    ck_assert_int_eq(i + 2000, ava_integer_of_value(
+                       ava_list_index(result, i), -1));
+
+  assert_values_equal(ava_empty_list().v, ava_list_remove(list, 0, N).v);
+}
+
+deftest(esba_list_migrates_after_repeated_stale_copy_outs) {
+  ava_list_value orig, result;
+  unsigned i;
+
+  /* Build orig in two halves so that it has spare capacity. The first set
+   * then happens in-place, leaving orig stale; every one after that needs to
+   * copy orig out again.
+   */
+  orig = ava_list_concat(ava_esba_list_of_raw(values, N / 2),
+                         ava_esba_list_of_raw(values + N / 2, N - N / 2));
+  result = orig;
+  for (i = 0; i < 16 && !ava_list_is_rrb_list(result); ++i)
+    result = ava_list_set(orig, i, ava_value_of_integer(-1));
+
+  ck_assert(ava_list_is_rrb_list(result));
+  ck_assert_int_eq(N, ava_list_length(result));
+  ck_assert_int_eq(-1, ava_integer_of_value(
+                     ava_list_index(result, i - 1), 0));
+  assert_list_range(orig, 0, N);
+}
+
+deftest(esba_list_used_linearly_does_not_migrate) {
+  ava_list_value list = ava_esba_list_of_raw(values, N);
+  unsigned i;
+
+  for (i = 0; i < 64; ++i)
+    list = ava_list_set(list, i, ava_value_of_integer(i));
+
+  ck_assert(!ava_list_is_rrb_list(list));
+}
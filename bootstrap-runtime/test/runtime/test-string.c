@@ -16,8 +16,14 @@
 #include "test.c"
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "runtime/avalanche/string.h"
+#include "runtime/avalanche/value.h"
+#include "runtime/-string.h"
+#include "runtime/-string-kernels.h"
 
 static char large_string[65536];
 
@@ -271,6 +277,123 @@ deftest(flat_flat_to_flat_concat) {
   ck_assert_str_eq("\303\237\303\237", ava_string_to_cstring(str));
 }
 
+deftest(short_binary_string_is_bin7) {
+  ava_string str = ava_string_of_bytes("a\0\303", 3);
+
+  ck_assert(ava_string_is_bin7(str));
+  ck_assert(ava_string_is_inline(str));
+  ck_assert_int_eq(3, ava_strlen(str));
+  ck_assert_int_eq('a', ava_string_index(str, 0));
+  ck_assert_int_eq(0, ava_string_index(str, 1));
+  ck_assert_int_eq('\303', ava_string_index(str, 2));
+  ck_assert_int_eq(0, memcmp("a\0\303", ava_string_to_cstring(str), 4));
+}
+
+deftest(bin7_used_only_when_ascii9_cannot_be) {
+  ck_assert(ava_string_is_ascii9(ava_string_of_bytes("abcdefg", 7)));
+  ck_assert(ava_string_is_bin7(ava_string_of_bytes("\377bcdefg", 7)));
+  ck_assert(!ava_string_is_inline(ava_string_of_bytes("\377bcdefgh", 8)));
+}
+
+deftest(bin7_bin7_to_bin7_concat) {
+  AVA_STATIC_STRING(flat, "\303\237\303\237");
+  ava_string str = ava_strcat(ava_string_of_bytes("\303\237", 2),
+                              ava_string_of_bytes("\303\237", 2));
+
+  ck_assert(ava_string_is_bin7(str));
+  ck_assert_int_eq(4, ava_strlen(str));
+  ck_assert(ava_string_equal(flat, str));
+  ck_assert(ava_string_equal(str, flat));
+  ck_assert_str_eq("\303\237\303\237", ava_string_to_cstring(str));
+}
+
+deftest(ascii9_bin7_to_bin7_concat) {
+  ava_string str = ava_strcat(AVA_ASCII9_STRING("foo"),
+                              ava_string_of_bytes("\303\237", 2));
+
+  ck_assert(ava_string_is_bin7(str));
+  ck_assert_str_eq("foo\303\237", ava_string_to_cstring(str));
+}
+
+deftest(bin7_bin7_to_flat_concat) {
+  ava_string str = ava_strcat(ava_string_of_bytes("\201\202\203\204", 4),
+                              ava_string_of_bytes("\205\206\207\210", 4));
+
+  ck_assert(!ava_string_is_inline(str));
+  ck_assert_int_eq(8, ava_strlen(str));
+  ck_assert_str_eq("\201\202\203\204\205\206\207\210",
+                   ava_string_to_cstring(str));
+}
+
+deftest(bin7_flat_concat) {
+  ava_string str = ava_strcat(ava_string_of_bytes("\303\237", 2),
+                              ava_string_of_cstring("avalanche"));
+  str = ava_strcat(ava_string_of_cstring("avalanche"), str);
+  str = ava_strcat(str, ava_string_of_bytes("\303\237", 2));
+
+  ck_assert_str_eq("avalanche\303\237avalanche\303\237",
+                   ava_string_to_cstring(str));
+}
+
+deftest(bin7_slice_can_produce_ascii9) {
+  ava_string str = ava_string_of_bytes("ab\303cd", 5);
+
+  ck_assert(ava_string_is_ascii9(ava_string_slice(str, 0, 2)));
+  ck_assert(ava_string_is_ascii9(ava_string_behead(str, 3)));
+  ck_assert(ava_string_equal(AVA_ASCII9_STRING("cd"),
+                             ava_string_behead(str, 3)));
+  ck_assert(ava_string_is_bin7(ava_string_slice(str, 1, 3)));
+  ck_assert_str_eq("b\303", ava_string_to_cstring(
+                     ava_string_slice(str, 1, 3)));
+}
+
+deftest(bin7_comparisons) {
+  AVA_STATIC_STRING(flat, "\303\237");
+  ava_string a = ava_string_of_bytes("\001", 1);
+  ava_string b = ava_string_of_bytes("\377", 1);
+  ava_string c = ava_string_of_bytes("\303\237", 2);
+
+  ck_assert(ava_strcmp(a, b) < 0);
+  ck_assert(ava_strcmp(b, a) > 0);
+  ck_assert(ava_strcmp(AVA_ASCII9_STRING("a"), b) < 0);
+  ck_assert_int_eq(0, ava_strcmp(c, flat));
+  ck_assert(!ava_string_equal(a, b));
+  ck_assert(!ava_string_equal(a, AVA_ASCII9_STRING("a")));
+  ck_assert(!ava_string_equal(AVA_EMPTY_STRING, a));
+  ck_assert(ava_string_starts_with(c, ava_string_of_bytes("\303", 1)));
+  ck_assert_int_eq(1, ava_strchr(c, '\237'));
+  ck_assert_int_eq(-1, ava_strchr(c, 'a'));
+  ck_assert_int_eq(c.ascii9, ava_string_to_bin7(flat));
+  ck_assert_int_eq(0, ava_string_to_ascii9(c));
+  ck_assert_int_eq(0, ava_string_to_bin7(AVA_ASCII9_STRING("a")));
+}
+
+deftest(bin7_hash_independent_of_representation) {
+  AVA_STATIC_STRING(flat, "\303\237");
+
+  ck_assert_int_eq(
+    ava_value_hash(ava_value_of_string(flat)),
+    ava_value_hash(ava_value_of_string(ava_string_of_bytes("\303\237", 2))));
+  ck_assert_int_ne(
+    ava_value_hash(ava_value_of_string(ava_string_of_bytes("\303", 1))),
+    ava_value_hash(ava_value_of_string(ava_string_of_bytes("\303\237", 2))));
+}
+
+deftest(rope_of_bin7_chars) {
+  ava_string str = AVA_EMPTY_STRING;
+  unsigned i;
+
+  for (i = 0; i < 2048; ++i)
+    str = ava_strcat(str, ava_string_of_char(0x80 | (i & 0x7F)));
+
+  ck_assert_int_eq(2048, ava_strlen(str));
+  for (i = 0; i < 2048; ++i)
+    ck_assert_int_eq((char)(0x80 | (i & 0x7F)), ava_string_index(str, i));
+  for (i = 0; i < 2048; ++i)
+    ck_assert_int_eq((char)(0x80 | (i & 0x7F)),
+                     ava_string_to_cstring(str)[i]);
+}
+
 deftest(flat_flat_to_rope_concat) {
   ava_string str = ava_strcat(
     ava_string_of_bytes(large_string + 0, 256),
@@ -933,3 +1056,687 @@ deftest(strchr_general_twine_miss) {
   AVA_STATIC_STRING(str, "avalanches");
   ck_assert_int_eq(-1, ava_strchr(str, 'x'));
 }
+
+deftest(strchr_general_large_twine_hit) {
+  ava_string str = ava_string_of_bytes(large_string, sizeof(large_string));
+  const char* expected = memchr(large_string, '_', sizeof(large_string));
+
+  ck_assert_ptr_ne(NULL, expected);
+  ck_assert_int_eq(expected - large_string, ava_strchr(str, '_'));
+}
+
+deftest(strchr_general_large_twine_miss) {
+  ava_string str = ava_string_of_bytes(large_string, sizeof(large_string));
+  ck_assert_int_eq(-1, ava_strchr(str, '~'));
+}
+
+deftest(strstr_ascii9_in_ascii9) {
+  ck_assert_int_eq(4, ava_strstr(AVA_ASCII9_STRING("avalanche"),
+                                 AVA_ASCII9_STRING("anc")));
+}
+
+deftest(strstr_ascii9_miss) {
+  ck_assert_int_eq(-1, ava_strstr(AVA_ASCII9_STRING("avalanche"),
+                                  AVA_ASCII9_STRING("ava!")));
+}
+
+deftest(strstr_single_char) {
+  ck_assert_int_eq(3, ava_strstr(AVA_ASCII9_STRING("foo.bar"),
+                                 AVA_ASCII9_STRING(".")));
+}
+
+deftest(strstr_twine_in_twine) {
+  AVA_STATIC_STRING(haystack, "the quick brown fox jumps over the lazy dog");
+  AVA_STATIC_STRING(needle, "over the lazy");
+  ck_assert_int_eq(26, ava_strstr(haystack, needle));
+}
+
+deftest(strstr_needle_longer_than_haystack) {
+  AVA_STATIC_STRING(needle, "avalanches!");
+  ck_assert_int_eq(-1, ava_strstr(AVA_ASCII9_STRING("avalanche"), needle));
+}
+
+deftest(strstr_empty_needle) {
+  ck_assert_int_eq(0, ava_strstr(AVA_ASCII9_STRING("foo"),
+                                 AVA_EMPTY_STRING));
+  ck_assert_int_eq(0, ava_strstr(AVA_EMPTY_STRING, AVA_EMPTY_STRING));
+}
+
+deftest(strstr_large_string_finds_every_suffix) {
+  ava_string haystack = ava_string_of_bytes(
+    large_string, sizeof(large_string));
+  unsigned i;
+
+  for (i = 1; i < 64; ++i) {
+    ava_string needle = ava_string_of_bytes(
+      large_string + sizeof(large_string) - i * 37, 5 + i);
+    ssize_t found = ava_strstr(haystack, needle);
+
+    ck_assert_int_le(0, found);
+    ck_assert_int_ge(sizeof(large_string) - i * 37, found);
+    ck_assert_int_eq(0, memcmp(large_string + found,
+                               large_string + sizeof(large_string) - i * 37,
+                               5 + i));
+  }
+}
+
+deftest(string_index_of_skips_earlier_matches) {
+  AVA_STATIC_STRING(haystack, "abcabcabc");
+  ck_assert_int_eq(3, ava_string_index_of(
+                     haystack, AVA_ASCII9_STRING("abc"), 1));
+  ck_assert_int_eq(6, ava_string_index_of(
+                     haystack, AVA_ASCII9_STRING("abc"), 4));
+  ck_assert_int_eq(-1, ava_string_index_of(
+                     haystack, AVA_ASCII9_STRING("abc"), 7));
+}
+
+deftest(string_index_of_empty_needle_at_end) {
+  ck_assert_int_eq(3, ava_string_index_of(
+                     AVA_ASCII9_STRING("foo"), AVA_EMPTY_STRING, 3));
+  ck_assert_int_eq(-1, ava_string_index_of(
+                     AVA_ASCII9_STRING("foo"), AVA_EMPTY_STRING, 4));
+}
+
+deftest(strcmp_large_twines_differing_late) {
+  char copy[sizeof(large_string)];
+  ava_string a, b;
+
+  memcpy(copy, large_string, sizeof(copy));
+  copy[sizeof(copy) - 3] = (char)0xFF;
+  a = ava_string_of_bytes(large_string, sizeof(large_string));
+  b = ava_string_of_bytes(copy, sizeof(copy));
+
+  ck_assert_int_gt(0, ava_strcmp(a, b));
+  ck_assert_int_lt(0, ava_strcmp(b, a));
+  ck_assert(!ava_string_equal(a, b));
+  ck_assert(ava_string_equal(
+              a, ava_string_of_bytes(large_string, sizeof(large_string))));
+  ck_assert(ava_string_starts_with(b, ava_string_trunc(a, sizeof(copy) - 3)));
+  ck_assert(!ava_string_starts_with(b, ava_string_trunc(a, sizeof(copy) - 2)));
+}
+
+deftest(string_kernels_agree_with_scalar) {
+  const ava_string_kernels*const* kernels;
+  const ava_string_kernels* k, * s = &ava_string_kernels_scalar;
+  char haystack[300], needle[8], other[300];
+  unsigned i, j, hlen, nlen;
+  char ch;
+
+  for (kernels = ava_string_kernels_all; *kernels; ++kernels) {
+    k = *kernels;
+    if (!k->supported()) continue;
+
+    for (i = 0; i < 10000; ++i) {
+      /* Small alphabet so that matches and near-misses are common */
+      hlen = rand() % sizeof(haystack);
+      nlen = rand() % sizeof(needle);
+      ch = 'a' + rand() % 3;
+      for (j = 0; j < hlen; ++j)
+        haystack[j] = 'a' + rand() % 3;
+      for (j = 0; j < nlen; ++j)
+        needle[j] = 'a' + rand() % 3;
+      memcpy(other, haystack, hlen);
+      if (hlen)
+        other[rand() % hlen] ^= 1;
+
+      ck_assert_int_eq(s->find_byte(haystack, ch, hlen),
+                       k->find_byte(haystack, ch, hlen));
+      ck_assert_int_eq(s->find_bytes(haystack, hlen, needle, nlen),
+                       k->find_bytes(haystack, hlen, needle, nlen));
+      ck_assert_int_eq(s->mismatch(haystack, other, hlen),
+                       k->mismatch(haystack, other, hlen));
+      ck_assert_int_eq(hlen, k->mismatch(haystack, haystack, hlen));
+    }
+  }
+}
+
+/**
+ * Fills dst with n bytes of text that is mostly, but not always, valid
+ * UTF-8, with long ASCII runs so that the vector paths get exercised.
+ */
+static void random_utf8ish(char* dst, unsigned n) {
+  static const char*const fragments[] = {
+    "a", "abcdefghijklmnopqrstuvwxyz0123456789", "\303\251",
+    "\342\202\254", "\360\237\230\200", "\364\217\277\277",
+    "\355\237\277", "\356\200\200",
+    /* Invalid: continuation, overlong, surrogate, too large, truncated */
+    "\200", "\300\200", "\340\200\200", "\355\240\200",
+    "\364\220\200\200", "\370", "\342\202", "\360\237\230",
+  };
+  unsigned i = 0, f, l;
+
+  while (i < n) {
+    f = rand() % (sizeof(fragments) / sizeof(fragments[0]));
+    /* Keep valid text far more common than errors */
+    if (f >= 8 && rand() % 16) continue;
+    l = strlen(fragments[f]);
+    if (l > n - i) l = n - i;
+    memcpy(dst + i, fragments[f], l);
+    i += l;
+  }
+}
+
+deftest(utf8_kernels_agree_with_scalar) {
+  const ava_string_kernels*const* kernels;
+  const ava_string_kernels* k, * s = &ava_string_kernels_scalar;
+  char text[300];
+  unsigned i, len, cp;
+
+  for (kernels = ava_string_kernels_all; *kernels; ++kernels) {
+    k = *kernels;
+    if (!k->supported()) continue;
+
+    for (i = 0; i < 10000; ++i) {
+      len = rand() % sizeof(text);
+      random_utf8ish(text, len);
+      cp = rand() % (len + 2);
+
+      ck_assert_int_eq(s->ascii_prefix(text, len),
+                       k->ascii_prefix(text, len));
+      ck_assert_int_eq(s->utf8_valid_prefix(text, len),
+                       k->utf8_valid_prefix(text, len));
+      ck_assert_int_eq(s->utf8_count(text, len),
+                       k->utf8_count(text, len));
+      ck_assert_int_eq(s->utf8_offset(text, len, cp),
+                       k->utf8_offset(text, len, cp));
+    }
+  }
+}
+
+deftest(scalar_utf8_validation) {
+  const ava_string_kernels* s = &ava_string_kernels_scalar;
+#define VALID_PREFIX(str) s->utf8_valid_prefix(str, sizeof(str) - 1)
+
+  ck_assert_int_eq(3, VALID_PREFIX("foo"));
+  ck_assert_int_eq(4, VALID_PREFIX("\302\200\337\277"));
+  ck_assert_int_eq(6, VALID_PREFIX("\340\240\200\357\277\277"));
+  ck_assert_int_eq(4, VALID_PREFIX("\364\217\277\277"));
+  /* Overlong */
+  ck_assert_int_eq(1, VALID_PREFIX("x\301\277"));
+  ck_assert_int_eq(1, VALID_PREFIX("x\340\237\277"));
+  ck_assert_int_eq(1, VALID_PREFIX("x\360\217\277\277"));
+  /* Surrogate */
+  ck_assert_int_eq(1, VALID_PREFIX("x\355\240\200"));
+  /* Beyond U+10FFFF */
+  ck_assert_int_eq(1, VALID_PREFIX("x\364\220\200\200"));
+  ck_assert_int_eq(1, VALID_PREFIX("x\365\200\200\200"));
+  /* Stray continuation and truncation */
+  ck_assert_int_eq(1, VALID_PREFIX("x\200"));
+  ck_assert_int_eq(1, VALID_PREFIX("x\342\202"));
+  ck_assert_int_eq(1, VALID_PREFIX("x\342\202x"));
+#undef VALID_PREFIX
+}
+
+static ava_string build_rope(unsigned piece_size) {
+  ava_string accum = AVA_EMPTY_STRING;
+  unsigned i;
+
+  for (i = 0; i < sizeof(large_string); i += piece_size)
+    accum = ava_strcat(
+      accum, ava_string_of_bytes(
+        large_string + i,
+        i + piece_size < sizeof(large_string)?
+        piece_size : sizeof(large_string) - i));
+
+  return accum;
+}
+
+static unsigned count_chunks(ava_string str) {
+  size_t offset = 0;
+  unsigned n = 0;
+
+  while (ava_string_is_present(ava_string_next_chunk(str, &offset)))
+    ++n;
+
+  return n;
+}
+
+deftest(rope_index_matches_and_does_not_flatten) {
+  ava_string str = build_rope(16);
+  unsigned i;
+
+  ck_assert_int_eq(sizeof(large_string), ava_strlen(str));
+  for (i = 0; i < sizeof(large_string); i += 97)
+    ck_assert_int_eq(large_string[i], ava_string_index(str, i));
+
+  ck_assert_int_lt(1, count_chunks(str));
+  assert_matches_large_string(str, 0, sizeof(large_string));
+}
+
+deftest(rope_chunks_reassemble_to_original) {
+  ava_string str = build_rope(37), chunk;
+  size_t offset = 0, prev;
+
+  while (prev = offset,
+         ava_string_is_present((chunk = ava_string_next_chunk(str, &offset)))) {
+    ck_assert_int_eq(offset - prev, ava_strlen(chunk));
+    assert_matches_large_string(chunk, prev, offset);
+  }
+
+  ck_assert_int_eq(sizeof(large_string), offset);
+}
+
+deftest(rope_slices_share_structure) {
+  ava_string str = build_rope(64), slice;
+  unsigned i, begin, end;
+
+  for (i = 0; i < 256; ++i) {
+    begin = rand() % sizeof(large_string);
+    end = begin + rand() % (sizeof(large_string) - begin + 1);
+    slice = ava_string_slice(str, begin, end);
+    assert_matches_large_string(slice, begin, end);
+    if (end - begin > 0)
+      ck_assert_int_eq(large_string[(begin + end) / 2],
+                       ava_string_index(slice, (end - begin) / 2));
+  }
+
+  ck_assert_int_lt(1, count_chunks(str));
+}
+
+deftest(rope_prepend_and_append) {
+  ava_string str = AVA_EMPTY_STRING;
+  unsigned i, mid = sizeof(large_string) / 2;
+
+  /* Grow outward from the middle in both directions */
+  for (i = 0; i < mid; i += 8) {
+    str = ava_strcat(ava_string_of_bytes(large_string + mid - i - 8, 8), str);
+    str = ava_strcat(str, ava_string_of_bytes(large_string + mid + i, 8));
+  }
+
+  assert_matches_large_string(str, 0, sizeof(large_string));
+  ck_assert_int_eq(large_string[12345], ava_string_index(str, 12345));
+}
+
+deftest(next_chunk_of_flat_string_is_whole_string) {
+  AVA_STATIC_STRING(str, "avalanches");
+  size_t offset = 0;
+
+  ck_assert(ava_string_equal(str, ava_string_next_chunk(str, &offset)));
+  ck_assert_int_eq(10, offset);
+  ck_assert(!ava_string_is_present(ava_string_next_chunk(str, &offset)));
+}
+
+deftest(interning_ascii9_is_identity) {
+  AVA_STATIC_STRING(str, "foo");
+
+  ck_assert_int_eq(AVA_ASCII9_STRING("foo").ascii9,
+                   ava_string_intern(AVA_ASCII9_STRING("foo")).ascii9);
+  ck_assert_int_eq(AVA_ASCII9_STRING("foo").ascii9,
+                   ava_string_intern(str).ascii9);
+  ck_assert_int_eq(AVA_ASCII9_STRING("foo").ascii9,
+                   ava_string_of_cstring_interned("foo").ascii9);
+}
+
+deftest(interning_produces_one_instance) {
+  ava_string a, b, c, d;
+
+  a = ava_string_of_cstring_interned("interned string");
+  b = ava_string_intern(ava_string_of_cstring("interned string"));
+  c = ava_string_intern(ava_strcat(ava_string_of_cstring("interned "),
+                                   ava_string_of_cstring("string")));
+  d = ava_string_intern(a);
+
+  ck_assert(ava_string_is_interned(a));
+  ck_assert(!ava_string_is_interned(ava_string_of_cstring("interned string")));
+  ck_assert_ptr_eq(a.twine, b.twine);
+  ck_assert_ptr_eq(a.twine, c.twine);
+  ck_assert_ptr_eq(a.twine, d.twine);
+  ck_assert_str_eq("interned string", ava_string_to_cstring(a));
+}
+
+deftest(interning_bin7_is_identity) {
+  ava_string a = ava_string_of_bytes_interned("\xff", 1);
+  ava_string b = ava_string_intern(ava_string_of_bytes("\xff", 1));
+
+  ck_assert(ava_string_is_bin7(a));
+  ck_assert_int_eq(a.ascii9, b.ascii9);
+}
+
+deftest(interning_non_ascii_short_string) {
+  ava_string a = ava_string_of_bytes_interned("\xff\xfe\xfd\xfc"
+                                              "\xfb\xfa\xf9\xf8", 8);
+  ava_string b = ava_string_intern(ava_string_of_bytes("\xff\xfe\xfd\xfc"
+                                                       "\xfb\xfa\xf9\xf8",
+                                                       8));
+
+  ck_assert(ava_string_is_interned(a));
+  ck_assert_ptr_eq(a.twine, b.twine);
+}
+
+deftest(interning_long_string) {
+  ava_string a = ava_string_of_bytes_interned(large_string, 1000);
+  ava_string b = ava_string_intern(
+    ava_string_slice(ava_string_of_bytes(large_string, 2000), 0, 1000));
+
+  ck_assert_ptr_eq(a.twine, b.twine);
+  ck_assert_int_eq(1000, ava_strlen(a));
+  ck_assert_int_eq(0, memcmp(large_string, ava_string_to_cstring(a), 1000));
+}
+
+deftest(interned_strings_compare_correctly) {
+  ava_string a = ava_string_of_cstring_interned("interned alpha");
+  ava_string b = ava_string_of_cstring_interned("interned bravo");
+  ava_string a2 = ava_string_of_cstring("interned alpha");
+
+  ck_assert(ava_string_equal(a, a));
+  ck_assert(!ava_string_equal(a, b));
+  ck_assert(ava_string_equal(a, a2));
+  ck_assert(ava_string_equal(a2, a));
+  ck_assert_int_eq(0, ava_strcmp(a, a));
+  ck_assert_int_eq(0, ava_strcmp(a, a2));
+  ck_assert_int_gt(0, ava_strcmp(a, b));
+  ck_assert_int_lt(0, ava_strcmp(b, a));
+}
+
+deftest(interned_strings_have_hash_precomputed) {
+  ava_string a = ava_string_of_cstring_interned("interned and hashed");
+  ava_string b = ava_string_of_cstring("interned and hashed");
+  ava_str_tmpbuff tmp;
+  AO_t*restrict slot;
+
+  ava_string_to_cstring_hash_slot(tmp, a, &slot);
+  ck_assert_ptr_ne(NULL, slot);
+  ck_assert_int_eq(ava_value_hash(ava_value_of_string(b)), AO_load(slot));
+}
+
+deftest(interning_many_strings) {
+  ava_string strs[4096];
+  char buf[32];
+  unsigned i;
+
+  for (i = 0; i < 4096; ++i) {
+    snprintf(buf, sizeof(buf), "interned-%u", i);
+    strs[i] = ava_string_of_cstring_interned(buf);
+  }
+
+  for (i = 0; i < 4096; ++i) {
+    snprintf(buf, sizeof(buf), "interned-%u", i);
+    ck_assert_ptr_eq(strs[i].twine,
+                     ava_string_intern(ava_string_of_cstring(buf)).twine);
+  }
+}
+
+static ava_string mmap_file_of(const char* data, size_t length) {
+  char path[] = "/tmp/test-string-mmap-XXXXXX";
+  int fd = mkstemp(path);
+  ava_string ret;
+
+  ck_assert_int_ne(-1, fd);
+  ck_assert_int_eq(length, write(fd, data, length));
+  close(fd);
+
+  ret = ava_string_of_mmap(path);
+  unlink(path);
+  return ret;
+}
+
+deftest(mmap_small_file) {
+  ava_string str = mmap_file_of("hello, mapped world", 19);
+  ava_str_tmpbuff tmp;
+  AO_t*restrict slot;
+
+  ck_assert(ava_string_is_present(str));
+  ck_assert_str_eq("hello, mapped world",
+                   ava_string_to_cstring_hash_slot(tmp, str, &slot));
+  /* Read into an ordinary heap string */
+  ck_assert_ptr_ne(NULL, slot);
+}
+
+deftest(mmap_empty_file) {
+  ava_string str = mmap_file_of("", 0);
+
+  ck_assert(ava_string_is_present(str));
+  ck_assert_int_eq(0, ava_strlen(str));
+}
+
+deftest(mmap_large_file) {
+  ava_string str = mmap_file_of(large_string, sizeof(large_string));
+  ava_str_tmpbuff tmp;
+  AO_t*restrict slot;
+  const char* data;
+
+  assert_matches_large_string(str, 0, sizeof(large_string));
+  ck_assert(ava_string_equal(
+              ava_string_slice(str, 1000, 2000),
+              ava_string_of_bytes(large_string + 1000, 1000)));
+
+  data = ava_string_to_cstring_hash_slot(tmp, str, &slot);
+  /* Forced in place, like a static twine, rather than copied to the heap */
+  ck_assert_ptr_eq(NULL, slot);
+  ck_assert_ptr_eq(data, ava_string_to_cstring(str));
+  /* Terminated and padded even though the file is a whole number of pages */
+  ck_assert_int_eq(0, data[sizeof(large_string)]);
+  ck_assert_int_eq(0, memcmp(large_string, data, sizeof(large_string)));
+
+  ck_assert_int_eq(
+    ava_value_hash(ava_value_of_string(str)),
+    ava_value_hash(ava_value_of_string(
+                     ava_string_of_bytes(large_string,
+                                         sizeof(large_string)))));
+}
+
+deftest(mmap_nonexistent_file) {
+  ava_string str = ava_string_of_mmap("/nonexistent/test-string-mmap");
+
+  ck_assert(!ava_string_is_present(str));
+  ck_assert_int_eq(ENOENT, errno);
+}
+
+deftest(builder_empty) {
+  ava_string_builder builder;
+
+  ava_string_builder_init(&builder, 0);
+  ck_assert_int_eq(0, ava_strlen(ava_string_builder_finish(&builder)));
+  ava_string_builder_init(&builder, 100);
+  ck_assert_int_eq(0, ava_strlen(ava_string_builder_finish(&builder)));
+}
+
+deftest(builder_short_result_is_ascii9) {
+  ava_string_builder builder;
+  ava_string str;
+
+  ava_string_builder_init(&builder, 0);
+  ava_string_builder_append_bytes(&builder, "foo", 3);
+  ava_string_builder_append_string(&builder, AVA_ASCII9_STRING("bar"));
+  ava_string_builder_append_integer(&builder, 42);
+  str = ava_string_builder_finish(&builder);
+
+  ck_assert(str.ascii9 & 1);
+  ck_assert_str_eq("foobar42", ava_string_to_cstring(str));
+}
+
+deftest(builder_appends_all_string_kinds) {
+  ava_string_builder builder;
+  ava_string str, rope;
+  unsigned i;
+
+  rope = AVA_EMPTY_STRING;
+  for (i = 0; i < 64; ++i)
+    rope = ava_strcat(rope, ava_string_of_bytes(large_string, 1000));
+
+  ava_string_builder_init(&builder, 0);
+  ava_string_builder_append_string(&builder, AVA_ASCII9_STRING("<"));
+  ava_string_builder_append_string(
+    &builder, ava_string_slice(
+      ava_string_of_bytes(large_string, sizeof(large_string)), 10, 1010));
+  ava_string_builder_append_string(&builder, rope);
+  ava_string_builder_append_string(&builder, ava_string_of_cstring(">"));
+  str = ava_string_builder_finish(&builder);
+
+  ck_assert_int_eq(1 + 1000 + 64000 + 1, ava_strlen(str));
+  ck_assert_int_eq('<', ava_string_index(str, 0));
+  ck_assert(ava_string_equal(
+              ava_string_of_bytes(large_string + 10, 1000),
+              ava_string_slice(str, 1, 1001)));
+  ck_assert(ava_string_equal(rope, ava_string_slice(str, 1001, 65001)));
+  ck_assert_int_eq('>', ava_string_index(str, 65001));
+  ck_assert_int_eq(0, ava_string_to_cstring(str)[65002]);
+}
+
+deftest(builder_result_is_flat_and_hash_cached) {
+  ava_string_builder builder;
+  ava_str_tmpbuff tmp;
+  ava_string str;
+  AO_t*restrict slot;
+  unsigned i;
+
+  ava_string_builder_init(&builder, 0);
+  for (i = 0; i < 1000; ++i)
+    ava_string_builder_append_bytes(&builder, "0123456789", 10);
+  str = ava_string_builder_finish(&builder);
+
+  ck_assert_int_eq(10000, ava_strlen(str));
+  ava_string_to_cstring_hash_slot(tmp, str, &slot);
+  ck_assert_ptr_ne(NULL, slot);
+  for (i = 0; i < 1000; ++i)
+    ck_assert_int_eq('0' + i % 10, ava_string_index(str, i));
+}
+
+deftest(builder_formats_integers) {
+  ava_string_builder builder;
+
+  ava_string_builder_init(&builder, 0);
+  ava_string_builder_append_integer(&builder, 0);
+  ava_string_builder_append_bytes(&builder, " ", 1);
+  ava_string_builder_append_integer(&builder, -1234567890123LL);
+  ava_string_builder_append_bytes(&builder, " ", 1);
+  ava_string_builder_append_integer(&builder, INT64_MAX);
+  ava_string_builder_append_bytes(&builder, " ", 1);
+  ava_string_builder_append_integer(&builder, INT64_MIN);
+
+  ck_assert_str_eq("0 -1234567890123 9223372036854775807 "
+                   "-9223372036854775808",
+                   ava_string_to_cstring(
+                     ava_string_builder_finish(&builder)));
+}
+
+deftest(builder_reusable_after_finish) {
+  ava_string_builder builder;
+  ava_string a, b;
+  unsigned i;
+
+  ava_string_builder_init(&builder, 16);
+  for (i = 0; i < 100; ++i)
+    ava_string_builder_append_bytes(&builder, "a", 1);
+  a = ava_string_builder_finish(&builder);
+
+  for (i = 0; i < 100; ++i)
+    ava_string_builder_append_bytes(&builder, "b", 1);
+  b = ava_string_builder_finish(&builder);
+
+  ck_assert_int_eq(100, ava_strlen(a));
+  ck_assert_int_eq(100, ava_strlen(b));
+  ck_assert_int_eq('a', ava_string_index(a, 99));
+  ck_assert_int_eq('b', ava_string_index(b, 0));
+}
+
+deftest(utf8_queries_on_inline_strings) {
+  ava_string e_acute = ava_string_of_cstring("\303\251");
+
+  ck_assert(ava_string_is_ascii(AVA_EMPTY_STRING));
+  ck_assert(ava_string_is_utf8(AVA_EMPTY_STRING));
+  ck_assert_int_eq(0, ava_string_utf8_length(AVA_EMPTY_STRING));
+  ck_assert_int_eq(0, ava_string_utf8_offset(AVA_EMPTY_STRING, 0));
+  ck_assert_int_eq(-1, ava_string_utf8_offset(AVA_EMPTY_STRING, 1));
+
+  ck_assert(ava_string_is_ascii(AVA_ASCII9_STRING("foo")));
+  ck_assert(ava_string_is_utf8(AVA_ASCII9_STRING("foo")));
+  ck_assert_int_eq(3, ava_string_utf8_length(AVA_ASCII9_STRING("foo")));
+  ck_assert_int_eq(2, ava_string_utf8_offset(AVA_ASCII9_STRING("foo"), 2));
+
+  ck_assert(ava_string_is_bin7(e_acute));
+  ck_assert(!ava_string_is_ascii(e_acute));
+  ck_assert(ava_string_is_utf8(e_acute));
+  ck_assert_int_eq(1, ava_string_utf8_length(e_acute));
+  ck_assert_int_eq(2, ava_string_utf8_offset(e_acute, 1));
+
+  ck_assert(!ava_string_is_utf8(ava_string_of_cstring("\303")));
+  ck_assert(!ava_string_is_utf8(ava_string_of_cstring("x\200")));
+}
+
+deftest(utf8_queries_on_flat_string) {
+  const ava_string_kernels* s = &ava_string_kernels_scalar;
+  char text[1000];
+  ava_string str;
+  size_t count, cp;
+
+  random_utf8ish(text, sizeof(text));
+  str = ava_string_of_bytes(text, sizeof(text));
+  count = s->utf8_count(text, sizeof(text));
+
+  ck_assert(!ava_string_is_ascii(str));
+  ck_assert_int_eq(sizeof(text) == s->utf8_valid_prefix(text, sizeof(text)),
+                   ava_string_is_utf8(str));
+  ck_assert_int_eq(count, ava_string_utf8_length(str));
+  for (cp = 0; cp <= count; ++cp)
+    ck_assert_int_eq(s->utf8_offset(text, sizeof(text), cp),
+                     ava_string_utf8_offset(str, cp));
+  ck_assert_int_eq(-1, ava_string_utf8_offset(str, count + 1));
+}
+
+deftest(utf8_properties_cached_on_flat_string) {
+  ava_str_tmpbuff tmp;
+  AO_t* slot, * props;
+  const char* data;
+  ava_string str = ava_string_of_cstring(
+    "\342\202\254 is not \360\237\230\200 is not ascii");
+
+  data = ava_string_to_cstring_hash_slot(tmp, str, &slot);
+  ck_assert_ptr_ne(NULL, slot);
+  props = ava_string_props_slot(data, ava_strlen(str));
+  ck_assert_int_eq(0, *props);
+
+  /* AO_load() since the queries are pure as far as the compiler knows */
+  ck_assert(ava_string_is_utf8(str));
+  ck_assert_int_ne(0, AO_load(props));
+  ck_assert_int_eq(23, ava_string_utf8_length(str));
+  /* The hash slot is unaffected */
+  ck_assert_int_eq(0, AO_load(slot));
+
+  /* Poison the cache to show that it is really used */
+  AO_store(props, (AO_load(props) & 7) | 99 << 3);
+  ck_assert_int_eq(99, ava_string_utf8_length(str));
+}
+
+deftest(utf8_validation_across_rope_leaves) {
+  static const char piece[] =
+    "na\303\257ve \342\202\254 \360\237\230\200 "
+    "abcdefghijklmnopqrstuvwxyz0123456789 ";
+  char text[4096];
+  ava_string rope, flat;
+  size_t i, count;
+
+  for (i = 0; i < sizeof(text); ++i)
+    text[i] = piece[i % (sizeof(piece) - 1)];
+  /* End on a code point boundary */
+  count = sizeof(text) - sizeof(text) % (sizeof(piece) - 1);
+
+  rope = AVA_EMPTY_STRING;
+  /* 61 is coprime with the piece length, so leaf boundaries fall in every
+   * position within multi-byte sequences.
+   */
+  for (i = 0; i < count; i += 61)
+    rope = ava_strcat(rope, ava_string_of_bytes(
+                        text + i, i + 61 < count? 61 : count - i));
+  flat = ava_string_of_bytes(text, count);
+
+  ck_assert_int_lt(1, count_chunks(rope));
+  ck_assert(ava_string_is_utf8(rope));
+  ck_assert(!ava_string_is_ascii(rope));
+  ck_assert_int_eq(ava_string_utf8_length(flat),
+                   ava_string_utf8_length(rope));
+  for (i = 0; i <= ava_string_utf8_length(flat); i += 7)
+    ck_assert_int_eq(ava_string_utf8_offset(flat, i),
+                     ava_string_utf8_offset(rope, i));
+
+  /* Sequences which are truncated or malformed across a leaf boundary */
+  ck_assert(!ava_string_is_utf8(
+              ava_strcat(ava_string_of_bytes(text, 2 * 61 + 3),
+                         ava_string_of_bytes(text, 61))));
+  ck_assert(!ava_string_is_utf8(
+              ava_strcat(ava_string_of_bytes(text, 61),
+                         ava_string_of_cstring(
+                           "\340\200\200 overlong, split across leaves"))));
+  ck_assert(!ava_string_is_utf8(ava_strcat(rope, ava_string_of_cstring(
+                                             "\360\237\230"))));
+}
@@ -18,6 +18,7 @@
 #define AVA__INTERNAL_INCLUDE 1
 #include "runtime/avalanche/value.h"
 #include "runtime/avalanche/integer.h"
+#include "runtime/-string.h"
 
 defsuite(value);
 
@@ -181,3 +182,140 @@ deftest(hash_crosses_rope_boundaries_correctly) {
   ck_assert_int_eq(ava_value_hash(ava_value_of_string(rope)),
                    ava_value_hash(ava_value_of_string(flat)));
 }
+
+deftest(fast_hash_basically_works) {
+  ava_value a = ava_value_of_cstring("hello world");
+  ava_value b = ava_value_of_cstring("hello worle");
+  ava_value c = ava_value_of_cstring("hello");
+
+  ck_assert_int_eq(ava_value_hash_fast(a), ava_value_hash_fast(a));
+  ck_assert_int_ne(ava_value_hash_fast(a), ava_value_hash_fast(b));
+  ck_assert_int_ne(ava_value_hash_fast(a), ava_value_hash_fast(c));
+  ck_assert_int_eq(ava_value_hash_fast(a),
+                   ava_value_hash_with_strategy(a, ava_vhs_fast));
+  ck_assert_int_eq(ava_value_hash(a),
+                   ava_value_hash_with_strategy(a, ava_vhs_siphash));
+}
+
+deftest(fast_hash_crosses_rope_boundaries_correctly) {
+  char buf[246];
+  ava_string base = ava_to_string(xn_of(123));
+  ava_string rope = ava_strcat(base, base);
+  ava_string_to_bytes(buf, rope, 0, 246);
+  ava_string flat = ava_string_of_bytes(buf, 246);
+
+  ck_assert_int_eq(ava_value_hash_fast(ava_value_of_string(rope)),
+                   ava_value_hash_fast(ava_value_of_string(flat)));
+}
+
+deftest(fast_hash_distinguishes_lengths) {
+  /* Strings differing only in trailing NULs have identical padded data */
+  ava_value a = ava_value_of_string(ava_string_of_bytes("0123456789a", 11));
+  ava_value b = ava_value_of_string(ava_string_of_bytes("0123456789a\0", 12));
+
+  ck_assert_int_ne(ava_value_hash_fast(a), ava_value_hash_fast(b));
+}
+
+deftest(hash_cached_in_heap_strings) {
+  AVA_STATIC_STRING(static_str,
+                    "the quick brown fox jumps over the lazy dog");
+  ava_string flat = ava_string_of_cstring(
+    "the quick brown fox jumps over the lazy dog");
+  ava_string concat = ava_strcat(
+    ava_string_of_cstring("the quick brown fox "),
+    ava_string_of_cstring("jumps over the lazy dog"));
+  ava_str_tmpbuff tmp;
+  AO_t*restrict slot;
+  ava_ulong hash;
+
+  ava_string_to_cstring_hash_slot(tmp, flat, &slot);
+  ck_assert_ptr_ne(NULL, slot);
+  ck_assert_int_eq(0, AO_load(slot));
+
+  hash = ava_value_hash(ava_value_of_string(flat));
+  ck_assert_int_eq(hash, AO_load(slot));
+  ck_assert_int_eq(hash, ava_value_hash(ava_value_of_string(flat)));
+
+  ava_string_to_cstring_hash_slot(tmp, concat, &slot);
+  ck_assert_ptr_ne(NULL, slot);
+  ck_assert_int_eq(hash, ava_value_hash(ava_value_of_string(concat)));
+  ck_assert_int_eq(hash, AO_load(slot));
+
+  ava_string_to_cstring_hash_slot(tmp, static_str, &slot);
+  ck_assert_ptr_eq(NULL, slot);
+  ck_assert_int_eq(hash, ava_value_hash(ava_value_of_string(static_str)));
+
+  ava_string_to_cstring_hash_slot(tmp, AVA_ASCII9_STRING("foo"), &slot);
+  ck_assert_ptr_eq(NULL, slot);
+}
+
+static const ava_attribute_tag cache_test_tag_a = { .name = "cache-test-a" };
+static const ava_attribute_tag cache_test_tag_b = { .name = "cache-test-b" };
+static const ava_attribute cache_test_attr_b = {
+  .tag = &cache_test_tag_b, .next = &xn_type.header,
+};
+static const ava_attribute cache_test_attr_a = {
+  .tag = &cache_test_tag_a, .next = &cache_test_attr_b,
+};
+
+deftest(attribute_cache_matches_uncached_lookup) {
+  static ava_attribute_cache cache;
+  ava_attribute heads[4];
+  ava_value values[6];
+  unsigned i, pass;
+
+  for (i = 0; i < 4; ++i) {
+    /* Per-instance headers sharing a common tail */
+    heads[i].tag = &cache_test_tag_a;
+    heads[i].next = &cache_test_attr_b;
+    values[i] = ava_value_with_ulong(heads + i, i);
+  }
+  values[4] = ava_value_with_ulong(&cache_test_attr_a, 0);
+  values[5] = xn_of(0);
+
+  for (pass = 0; pass < 3; ++pass) {
+    for (i = 0; i < 6; ++i) {
+      ck_assert_ptr_eq(
+        ava_get_attribute(values[i], &cache_test_tag_b),
+        ava_get_attribute_cached(values[i], &cache_test_tag_b, &cache));
+    }
+  }
+
+  /* Only the first lookup on the shared tail needed to walk the chain */
+  ck_assert_int_eq(1, cache.misses);
+#ifdef AVA_ATTRIBUTE_CACHE_STATS
+  ck_assert_int_eq(14, cache.hits);
+#endif
+}
+
+deftest(attribute_cache_caches_absent_attributes) {
+  static ava_attribute_cache cache;
+  ava_value value = ava_value_with_ulong(&cache_test_attr_b, 0);
+
+  ck_assert_ptr_eq(NULL, ava_get_attribute_cached(
+                     value, &cache_test_tag_a, &cache));
+  ck_assert_ptr_eq(NULL, ava_get_attribute_cached(
+                     value, &cache_test_tag_a, &cache));
+  ck_assert_int_eq(1, cache.misses);
+#ifdef AVA_ATTRIBUTE_CACHE_STATS
+  ck_assert_int_eq(1, cache.hits);
+#endif
+}
+
+deftest(attribute_cache_stats_include_used_caches) {
+  static ava_attribute_cache cache;
+  ava_attribute_cache_stats before, after;
+  ava_value value = ava_value_with_ulong(&cache_test_attr_a, 0);
+
+  ava_attribute_cache_get_stats(&before);
+  ava_get_attribute_cached(value, &ava_value_trait_tag, &cache);
+  ava_get_attribute_cached(value, &ava_value_trait_tag, &cache);
+  ava_get_attribute_cached(value, &ava_value_trait_tag, &cache);
+  ava_attribute_cache_get_stats(&after);
+
+  ck_assert_int_eq(before.sites + 1, after.sites);
+#ifdef AVA_ATTRIBUTE_CACHE_STATS
+  ck_assert_int_le(before.hits + 2, after.hits);
+#endif
+  ck_assert_int_le(before.misses + 1, after.misses);
+}